@@ -0,0 +1,254 @@
+#include "AssetArchive.h"
+#include "Compression.h"
+#include "Hash.h"
+#include "ThreadPool.h"
+
+#include <cstdio>
+#include <cstring>
+
+namespace
+{
+	uint64_t AlignUp(uint64_t value, uint64_t alignment)
+	{
+		return (value + alignment - 1) & ~(alignment - 1);
+	}
+
+	char NormalizeChar(char c)
+	{
+		if ('\\' == c) return '/';
+		if (c >= 'A' && c <= 'Z') return c - 'A' + 'a';
+		return c;
+	}
+
+	bool WritePadded(FILE* fp, const void* data, uint64_t size, uint64_t& offset, uint64_t alignment)
+	{
+		static const char padding[ArchiveAlignment] = {};
+
+		uint64_t aligned = AlignUp(offset, alignment);
+		if (aligned != offset && fwrite(padding, 1, aligned - offset, fp) != aligned - offset)
+			return false;
+
+		offset = aligned + size;
+		return 0 == size || fwrite(data, 1, size, fp) == size;
+	}
+}
+
+bool AssetArchive::Open(const char * filename)
+{
+	Close();
+
+	if (!file.Open(filename))
+		return false;
+
+	const uint8_t* base = static_cast<const uint8_t*>(file.GetData());
+	const uint64_t fileSize = file.GetSize();
+
+	auto InFile = [fileSize](uint64_t offset, uint64_t size) { return offset <= fileSize && size <= fileSize - offset; };
+
+	const ArchiveHeader* h = reinterpret_cast<const ArchiveHeader*>(base);
+	bool valid = fileSize >= sizeof(ArchiveHeader)
+		&& h->magic == ArchiveMagic
+		&& h->version == ArchiveVersion
+		&& h->fileSize == fileSize
+		&& h->tableSize > 0 && 0 == (h->tableSize & (h->tableSize - 1)) && h->tableSize > h->entriesCount
+		&& InFile(h->entriesOffset, uint64_t(h->entriesCount) * sizeof(ArchiveEntry))
+		&& InFile(h->tableOffset, uint64_t(h->tableSize) * sizeof(uint32_t))
+		&& InFile(h->namesOffset, h->namesSize)
+		&& h->namesSize > 0 && 0 == base[h->namesOffset + h->namesSize - 1];
+
+	const ArchiveEntry* e = valid ? reinterpret_cast<const ArchiveEntry*>(base + h->entriesOffset) : nullptr;
+	for (uint32_t i = 0; valid && i < h->entriesCount; ++i)
+	{
+		valid = InFile(e[i].offset, e[i].storedSize)
+			&& e[i].nameOffset < h->namesSize
+			&& ((e[i].flags & ArchiveEntryCompressed) || e[i].storedSize == e[i].size);
+	}
+
+	if (!valid)
+	{
+		file.Close();
+		return false;
+	}
+
+	header = h;
+	entries = e;
+	table = reinterpret_cast<const uint32_t*>(base + h->tableOffset);
+	names = reinterpret_cast<const char*>(base + h->namesOffset);
+	return true;
+}
+
+void AssetArchive::Close()
+{
+	file.Close();
+	header = nullptr;
+	entries = nullptr;
+	table = nullptr;
+	names = nullptr;
+}
+
+const ArchiveEntry * AssetArchive::Find(const char * name) const
+{
+	if (!IsOpen())
+		return nullptr;
+
+	const uint64_t hash = HashName(name);
+	const uint32_t mask = header->tableSize - 1;
+
+	// Linear probing, the table is at most half full.
+	for (uint32_t slot = static_cast<uint32_t>(hash) & mask, probes = 0; probes < header->tableSize; slot = (slot + 1) & mask, ++probes)
+	{
+		uint32_t index = table[slot];
+		if (0 == index || index > header->entriesCount)
+			return nullptr;
+
+		const ArchiveEntry& entry = entries[index - 1];
+		if (entry.nameHash == hash && NamesMatch(GetName(entry), name))
+			return &entry;
+	}
+	return nullptr;
+}
+
+const void * AssetArchive::GetView(const ArchiveEntry & entry) const
+{
+	if (entry.flags & ArchiveEntryCompressed)
+		return nullptr;
+	return static_cast<const uint8_t*>(file.GetData()) + entry.offset;
+}
+
+bool AssetArchive::Read(const ArchiveEntry & entry, void * dest) const
+{
+	const uint8_t* data = static_cast<const uint8_t*>(file.GetData()) + entry.offset;
+	if (entry.flags & ArchiveEntryCompressed)
+		return DecompressBlock(data, static_cast<size_t>(entry.storedSize), dest, static_cast<size_t>(entry.size));
+
+	memcpy(dest, data, static_cast<size_t>(entry.size));
+	return true;
+}
+
+uint64_t AssetArchive::HashName(const char * name)
+{
+	uint64_t hash = HashSeed;
+	for (; *name; ++name)
+	{
+		char c = NormalizeChar(*name);
+		hash = HashBytes(&c, 1, hash);
+	}
+	return hash;
+}
+
+bool AssetArchive::NamesMatch(const char * a, const char * b)
+{
+	for (; *a && *b; ++a, ++b)
+	{
+		if (NormalizeChar(*a) != NormalizeChar(*b))
+			return false;
+	}
+	return *a == *b;
+}
+
+void AssetArchiveWriter::Add(const char * name, const void * data, size_t size, bool compress)
+{
+	const uint8_t* bytes = static_cast<const uint8_t*>(data);
+	sources.push_back({ name, std::vector<uint8_t>(bytes, bytes + size), compress });
+}
+
+bool AssetArchiveWriter::Write(const char * filename, Stats * stats) const
+{
+	const size_t count = sources.size();
+
+	ArchiveHeader header = {};
+	header.magic = ArchiveMagic;
+	header.version = ArchiveVersion;
+	header.entriesCount = static_cast<uint32_t>(count);
+	header.tableSize = 2;
+	while (header.tableSize < count * 2)
+		header.tableSize *= 2;
+
+	std::vector<ArchiveEntry> entries(count);
+	std::vector<uint32_t> table(header.tableSize, 0);
+	std::string names;
+
+	for (size_t i = 0; i < count; ++i)
+	{
+		ArchiveEntry& entry = entries[i];
+		entry.nameHash = AssetArchive::HashName(sources[i].name.c_str());
+		entry.nameOffset = static_cast<uint32_t>(names.size());
+		entry.size = sources[i].data.size();
+		names.append(sources[i].name.c_str(), sources[i].name.size() + 1);
+
+		uint32_t slot = static_cast<uint32_t>(entry.nameHash) & (header.tableSize - 1);
+		for (; 0 != table[slot]; slot = (slot + 1) & (header.tableSize - 1))
+		{
+			if (AssetArchive::NamesMatch(sources[table[slot] - 1].name.c_str(), sources[i].name.c_str()))
+				return false;
+		}
+		table[slot] = static_cast<uint32_t>(i + 1);
+	}
+
+	std::vector<std::vector<uint8_t>> compressed(count);
+	ThreadPool::Shared().ParallelFor(count, [&](size_t i)
+	{
+		const std::vector<uint8_t>& data = sources[i].data;
+		if (!sources[i].compress || data.empty())
+			return;
+
+		compressed[i].resize(CompressBound(data.size()));
+		size_t size = CompressBlock(data.data(), data.size(), compressed[i].data(), compressed[i].size());
+		if (0 == size || size > data.size() - data.size() / 8)
+			compressed[i].clear();
+		else
+			compressed[i].resize(size);
+	});
+
+	FILE* fp = fopen(filename, "wb");
+	if (nullptr == fp) return false;
+
+	// Header first, entry data next, then the tables once the offsets are known.
+	uint64_t offset = sizeof(ArchiveHeader);
+	bool ok = fwrite(&header, sizeof(header), 1, fp) == 1;
+
+	for (size_t i = 0; ok && i < count; ++i)
+	{
+		ArchiveEntry& entry = entries[i];
+		const std::vector<uint8_t>& stored = compressed[i].empty() ? sources[i].data : compressed[i];
+		entry.flags = 0;
+		if (!compressed[i].empty())
+			entry.flags |= ArchiveEntryCompressed;
+		entry.storedSize = stored.size();
+		entry.offset = AlignUp(offset, ArchiveAlignment);
+		ok = WritePadded(fp, stored.data(), stored.size(), offset, ArchiveAlignment);
+	}
+
+	header.entriesOffset = AlignUp(offset, alignof(ArchiveEntry));
+	ok = ok && WritePadded(fp, entries.data(), entries.size() * sizeof(ArchiveEntry), offset, alignof(ArchiveEntry));
+	header.tableOffset = offset;
+	ok = ok && WritePadded(fp, table.data(), table.size() * sizeof(uint32_t), offset, 1);
+	header.namesOffset = offset;
+	header.namesSize = names.size() + 1;
+	ok = ok && WritePadded(fp, names.c_str(), names.size() + 1, offset, 1);
+
+	header.fileSize = offset;
+	ok = ok && fseek(fp, 0, SEEK_SET) == 0 && fwrite(&header, sizeof(header), 1, fp) == 1;
+
+	fclose(fp);
+
+	if (!ok)
+	{
+		remove(filename);
+		return false;
+	}
+
+	if (nullptr != stats)
+	{
+		*stats = {};
+		stats->entriesCount = count;
+		stats->fileSize = header.fileSize;
+		for (const ArchiveEntry& entry : entries)
+		{
+			stats->compressedCount += (entry.flags & ArchiveEntryCompressed) ? 1 : 0;
+			stats->size += entry.size;
+			stats->storedSize += entry.storedSize;
+		}
+	}
+	return true;
+}
@@ -0,0 +1,116 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+#include "MappedFile.h"
+
+// On-disk layout of a packed asset archive (*.pak), written by AssetCooker's
+// pack command. Entry data is aligned for texture placement, so mapped views
+// can be copied into upload memory as they are. Names are looked up through
+// an open addressing hash table.
+
+constexpr uint32_t ArchiveMagic = 0x4b434150;	// 'PACK'
+constexpr uint32_t ArchiveVersion = 1;
+constexpr uint64_t ArchiveAlignment = 512;
+
+enum ArchiveEntryFlags : uint32_t
+{
+	// Stored as one LZ4 block, see Compression.h.
+	ArchiveEntryCompressed = 1 << 0,
+};
+
+struct ArchiveEntry
+{
+	uint64_t	nameHash;
+	uint64_t	offset;
+	uint64_t	storedSize;
+	uint64_t	size;
+	uint32_t	nameOffset;
+	uint32_t	flags;
+};
+
+struct ArchiveHeader
+{
+	uint32_t	magic;
+	uint32_t	version;
+	uint64_t	fileSize;
+	uint32_t	entriesCount;
+	// Power of two, each slot holds an entry index + 1 or 0 when empty.
+	uint32_t	tableSize;
+	uint64_t	entriesOffset;
+	uint64_t	tableOffset;
+	// Zero terminated names, in entry order.
+	uint64_t	namesOffset;
+	uint64_t	namesSize;
+};
+
+// Read-only view of a mapped archive, safe to share between threads.
+class AssetArchive
+{
+public:
+	AssetArchive() : header(nullptr), entries(nullptr), table(nullptr), names(nullptr) {}
+
+	AssetArchive(const AssetArchive&) = delete;
+	AssetArchive& operator=(const AssetArchive&) = delete;
+
+	bool Open(const char* filename);
+	void Close();
+	bool IsOpen() const { return nullptr != header; }
+
+	// Names are matched ignoring case, with '\\' and '/' the same.
+	const ArchiveEntry* Find(const char* name) const;
+
+	size_t GetEntriesCount() const { return nullptr != header ? header->entriesCount : 0; }
+	const ArchiveEntry& GetEntry(size_t i) const { return entries[i]; }
+	const char* GetName(const ArchiveEntry& entry) const { return names + entry.nameOffset; }
+
+	// Points into the mapping, valid while the archive is open. Null for
+	// compressed entries, those have to be Read.
+	const void* GetView(const ArchiveEntry& entry) const;
+
+	// Copies or decompresses the entry into dest, which holds entry.size bytes.
+	bool Read(const ArchiveEntry& entry, void* dest) const;
+
+	static uint64_t HashName(const char* name);
+	static bool NamesMatch(const char* a, const char* b);
+
+private:
+	MappedFile				file;
+	const ArchiveHeader*	header;
+	const ArchiveEntry*		entries;
+	const uint32_t*			table;
+	const char*				names;
+};
+
+// Collects files in memory and writes them out as one archive.
+class AssetArchiveWriter
+{
+public:
+	struct Stats
+	{
+		size_t		entriesCount;
+		size_t		compressedCount;
+		uint64_t	size;
+		uint64_t	storedSize;
+		uint64_t	fileSize;
+	};
+
+	// Entries that compress by less than an eighth are stored as is.
+	void Add(const char* name, const void* data, size_t size, bool compress = true);
+
+	// Fails on duplicate names. Entries are compressed in parallel.
+	bool Write(const char* filename, Stats* stats = nullptr) const;
+
+private:
+	struct Source
+	{
+		std::string				name;
+		std::vector<uint8_t>	data;
+		bool					compress;
+	};
+
+	std::vector<Source>		sources;
+};
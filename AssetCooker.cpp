@@ -0,0 +1,238 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+#include <vector>
+
+#include "AssetArchive.h"
+#include "Hash.h"
+#include "MappedFile.h"
+#include "Mesh.h"
+#include "MeshOptimizer.h"
+#include "Texture.h"
+#include "ThreadPool.h"
+#include "VertexLayout.h"
+
+namespace
+{
+	void ReportVertexCompression(const Mesh& mesh)
+	{
+		const char* const names[] = { "position", "normal", "tangent", "uv" };
+		const char* const units[] = { "", " deg", " deg", "" };
+
+		VertexLayout full = VertexLayout::Full();
+		VertexLayout compressed = VertexLayout::Compressed();
+
+		std::vector<unsigned char> packed(mesh.GetVerticesCount() * compressed.GetStride());
+		VertexPackInfo info;
+		compressed.Pack(mesh, packed.data(), &info);
+
+		printf("compressed vertices: %u -> %u bytes/vertex, %zu bytes saved\n",
+			full.GetStride(), compressed.GetStride(), mesh.GetVerticesCount() * (full.GetStride() - compressed.GetStride()));
+		for (size_t i = 0; i < compressed.GetElementsCount(); ++i)
+			printf("  %-8s max error %g%s, mean %g%s\n", names[i], info.errors[i].maxError, units[i], info.errors[i].meanError, units[i]);
+	}
+
+	int CookMesh(int argc, char** argv)
+	{
+		if (argc < 1)
+		{
+			printf("usage: AssetCooker mesh <source> [output]\n");
+			return 1;
+		}
+
+		const char* source = argv[0];
+		char output[260];
+		if (argc > 1)
+			snprintf(output, sizeof(output), "%s", argv[1]);
+		else
+			Mesh::GetCacheFilename(source, output, sizeof(output));
+
+		uint64_t sourceHash = 0;
+		if (!Mesh::HashSourceFile(source, sourceHash))
+		{
+			printf("error: cannot read %s\n", source);
+			return 1;
+		}
+
+		Mesh mesh;
+		if (!mesh.ImportFromFile(source))
+		{
+			printf("error: cannot import %s\n", source);
+			return 1;
+		}
+
+		Mesh::WeldStats weldStats;
+		mesh.Weld(1e-6f, &weldStats);
+
+		MeshOptimizeStats stats;
+		mesh.Optimize(&stats);
+		mesh.GenerateLods();
+		mesh.BuildMeshlets();
+
+		if (!mesh.SaveToCache(output, sourceHash))
+		{
+			printf("error: cannot write %s\n", output);
+			return 1;
+		}
+
+		printf("%s -> %s: %zu vertices, %zu indices, %zu submeshes\n",
+			source, output, mesh.GetVerticesCount(), mesh.GetIndicesCount(), mesh.GetSubmeshesCount());
+		printf("weld: %zu -> %zu vertices, index buffer %zu -> %zu bytes\n",
+			weldStats.verticesBefore, weldStats.verticesAfter, weldStats.indexBytes32, weldStats.indexBytesPacked);
+		printf("vertex cache: ACMR %.3f -> %.3f, ATVR %.3f -> %.3f\n",
+			stats.cacheBefore.acmr, stats.cacheAfter.acmr, stats.cacheBefore.atvr, stats.cacheAfter.atvr);
+		printf("vertex fetch: overfetch %.3f -> %.3f, efficiency %.1f%% -> %.1f%%\n",
+			stats.fetchBefore.overfetch, stats.fetchAfter.overfetch, stats.fetchBefore.efficiency * 100.0, stats.fetchAfter.efficiency * 100.0);
+		for (size_t lod = 0; lod < mesh.GetLodsCount(); ++lod)
+			printf("lod %zu: %zu triangles, error %g\n", lod, mesh.GetLodIndicesCount(lod) / 3, mesh.GetLodError(lod));
+		printf("meshlets: %zu, %.1f vertices and %.1f triangles each\n", mesh.GetMeshletsCount(),
+			static_cast<double>(mesh.GetMeshletVerticesCount()) / std::max<size_t>(mesh.GetMeshletsCount(), 1),
+			static_cast<double>(mesh.GetMeshletTrianglesCount()) / std::max<size_t>(mesh.GetMeshletsCount(), 1));
+		ReportVertexCompression(mesh);
+		return 0;
+	}
+
+	int CookTextureFile(int argc, char** argv)
+	{
+		struct FormatName
+		{
+			const char*		name;
+			TextureFormat	format;
+		};
+		const FormatName formats[] =
+		{
+			{ "bc1", TextureFormatBC1 },
+			{ "bc3", TextureFormatBC3 },
+			{ "bc7", TextureFormatBC7 },
+			{ "rgba8", TextureFormatRGBA8 },
+		};
+
+		if (argc < 1)
+		{
+			printf("usage: AssetCooker texture <source> [bc1|bc3|bc7|rgba8] [srgb|linear] [output]\n");
+			return 1;
+		}
+
+		const char* source = argv[0];
+		const char* formatName = argc > 1 ? argv[1] : "bc7";
+		const FormatName* format = nullptr;
+		for (const FormatName& candidate : formats)
+		{
+			if (0 == strcmp(formatName, candidate.name))
+				format = &candidate;
+		}
+		if (nullptr == format)
+		{
+			printf("error: unknown format %s\n", formatName);
+			return 1;
+		}
+		// Color textures are sRGB, masks and normal maps linear.
+		bool srgb = argc <= 2 || 0 != strcmp(argv[2], "linear");
+		char output[260];
+		if (argc > 3)
+			snprintf(output, sizeof(output), "%s", argv[3]);
+		else
+			CookedTexture::GetCacheFilename(source, output, sizeof(output));
+
+		MappedFile file;
+		Image image;
+		if (!file.Open(source) || !DecodeImage(file.GetData(), file.GetSize(), image))
+		{
+			printf("error: cannot decode %s\n", source);
+			return 1;
+		}
+
+		std::vector<uint8_t> cooked;
+		if (!CookTexture(image, format->format, srgb, HashBytes(file.GetData(), file.GetSize()), ThreadPool::Shared(), cooked))
+		{
+			printf("error: cannot cook %s (%ux%u, block compression needs multiples of 4)\n", source, image.width, image.height);
+			return 1;
+		}
+
+		FILE* fp = fopen(output, "wb");
+		bool ok = nullptr != fp && fwrite(cooked.data(), 1, cooked.size(), fp) == cooked.size();
+		if (nullptr != fp)
+			ok = 0 == fclose(fp) && ok;
+		if (!ok)
+		{
+			remove(output);
+			printf("error: cannot write %s\n", output);
+			return 1;
+		}
+
+		CookedTexture texture;
+		texture.Open(cooked.data(), cooked.size());
+		printf("%s -> %s: %ux%u %s%s, %u mips, %zu -> %zu bytes\n", source, output, image.width, image.height, format->name, srgb ? " srgb" : "",
+			texture.GetMipsCount(), image.texels.size(), cooked.size());
+		return 0;
+	}
+
+	int PackArchive(int argc, char** argv)
+	{
+		if (argc < 2)
+		{
+			printf("usage: AssetCooker pack <output> <file>...\n");
+			return 1;
+		}
+
+		const char* output = argv[0];
+		AssetArchiveWriter writer;
+
+		for (int i = 1; i < argc; ++i)
+		{
+			MappedFile source;
+			if (!source.Open(argv[i]))
+			{
+				printf("error: cannot read %s\n", argv[i]);
+				return 1;
+			}
+
+			// Cooked meshes and textures are used in place from the mapping, so they stay uncompressed.
+			size_t length = strlen(argv[i]);
+			bool compress = !(length > 5 && 0 == strcmp(argv[i] + length - 5, ".mesh")) && !(length > 4 && 0 == strcmp(argv[i] + length - 4, ".tex"));
+			writer.Add(argv[i], source.GetData(), source.GetSize(), compress);
+		}
+
+		AssetArchiveWriter::Stats stats;
+		if (!writer.Write(output, &stats))
+		{
+			printf("error: cannot write %s (duplicate names?)\n", output);
+			return 1;
+		}
+
+		printf("%s: %zu entries, %zu compressed, %llu -> %llu bytes, file %llu bytes\n", output, stats.entriesCount, stats.compressedCount,
+			static_cast<unsigned long long>(stats.size), static_cast<unsigned long long>(stats.storedSize), static_cast<unsigned long long>(stats.fileSize));
+		return 0;
+	}
+
+	struct Command
+	{
+		const char*	name;
+		int			(*run)(int argc, char** argv);
+	};
+
+	const Command g_Commands[] =
+	{
+		{ "mesh", CookMesh },
+		{ "texture", CookTextureFile },
+		{ "pack", PackArchive },
+	};
+}
+
+int main(int argc, char** argv)
+{
+	if (argc >= 2)
+	{
+		for (const Command& cmd : g_Commands)
+		{
+			if (0 == strcmp(argv[1], cmd.name))
+				return cmd.run(argc - 2, argv + 2);
+		}
+	}
+
+	printf("usage: AssetCooker <command> [args]\ncommands:\n");
+	for (const Command& cmd : g_Commands)
+		printf("  %s\n", cmd.name);
+	return 1;
+}
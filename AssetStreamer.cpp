@@ -0,0 +1,125 @@
+#include "AssetStreamer.h"
+
+bool AssetRequest::Cancel()
+{
+	return Transition(AssetState::Queued, AssetState::Cancelled) || Transition(AssetState::Loading, AssetState::Cancelled);
+}
+
+bool AssetRequest::Transition(AssetState from, AssetState to)
+{
+	return state.compare_exchange_strong(from, to);
+}
+
+AssetStreamer::AssetStreamer(size_t threadsCount) : pending(0), nextSequence(0), stopping(false)
+{
+	if (0 == threadsCount)
+		threadsCount = 1;
+
+	threads.reserve(threadsCount);
+	for (size_t i = 0; i < threadsCount; ++i)
+		threads.emplace_back(&AssetStreamer::WorkerLoop, this);
+}
+
+AssetStreamer::~AssetStreamer()
+{
+	Stop();
+}
+
+AssetHandle AssetStreamer::Request(AssetPriority priority, std::function<bool()> load, std::function<void(bool)> complete)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+
+	AssetHandle request(new AssetRequest(priority, nextSequence++, std::move(load), std::move(complete)));
+	if (stopping)
+	{
+		request->state = AssetState::Cancelled;
+		return request;
+	}
+
+	pending++;
+	queue.push(request);
+	wake.notify_one();
+	return request;
+}
+
+size_t AssetStreamer::Pump(size_t maxCompletions)
+{
+	size_t count = 0;
+	while (count < maxCompletions)
+	{
+		AssetHandle request;
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			if (completed.empty())
+				break;
+			request = std::move(completed.front());
+			completed.pop_front();
+		}
+
+		// A cancelled request is dropped without running its completion.
+		bool loaded = request->Transition(AssetState::Loaded, AssetState::Completed);
+		if (loaded || AssetState::Failed == request->GetState())
+		{
+			if (request->complete)
+				request->complete(loaded);
+			count++;
+		}
+		request->load = nullptr;
+		request->complete = nullptr;
+		pending--;
+	}
+	return count;
+}
+
+void AssetStreamer::Stop()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		if (stopping)
+			return;
+		stopping = true;
+
+		while (!queue.empty())
+		{
+			queue.top()->Cancel();
+			queue.pop();
+			pending--;
+		}
+	}
+	wake.notify_all();
+
+	for (std::thread& thread : threads)
+		thread.join();
+	threads.clear();
+
+	std::lock_guard<std::mutex> lock(mutex);
+	for (const AssetHandle& request : completed)
+		request->Cancel();
+	pending -= completed.size();
+	completed.clear();
+}
+
+void AssetStreamer::WorkerLoop()
+{
+	for (;;)
+	{
+		AssetHandle request;
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			wake.wait(lock, [this]() { return stopping || !queue.empty(); });
+			if (queue.empty())
+				return;
+			request = queue.top();
+			queue.pop();
+		}
+
+		if (request->Transition(AssetState::Queued, AssetState::Loading))
+		{
+			bool succeeded = request->load();
+			request->Transition(AssetState::Loading, succeeded ? AssetState::Loaded : AssetState::Failed);
+		}
+
+		std::lock_guard<std::mutex> lock(mutex);
+		completed.push_back(std::move(request));
+	}
+}
@@ -0,0 +1,125 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+enum class AssetPriority : uint8_t
+{
+	// Needed before anything can be drawn.
+	Critical,
+	High,
+	Normal,
+	Low,
+};
+
+enum class AssetState : uint8_t
+{
+	Queued,
+	Loading,
+	// Loaded or failed, the completion callback runs on the next Pump.
+	Loaded,
+	Failed,
+	// The completion callback ran after a successful load.
+	Completed,
+	Cancelled,
+};
+
+class AssetStreamer;
+
+// Shared by the caller and the streamer, dropping the handle does not cancel.
+class AssetRequest
+{
+public:
+	AssetState GetState() const { return state; }
+	AssetPriority GetPriority() const { return priority; }
+
+	// Cancels a request that is queued or loading, its completion never runs.
+	// Returns false once the load has finished.
+	bool Cancel();
+
+private:
+	friend class AssetStreamer;
+
+	AssetRequest(AssetPriority priority, uint64_t sequence, std::function<bool()> load, std::function<void(bool)> complete)
+		: state(AssetState::Queued), priority(priority), sequence(sequence), load(std::move(load)), complete(std::move(complete)) {}
+
+	bool Transition(AssetState from, AssetState to);
+
+	std::atomic<AssetState>		state;
+	AssetPriority				priority;
+	uint64_t					sequence;
+	std::function<bool()>		load;
+	std::function<void(bool)>	complete;
+};
+
+using AssetHandle = std::shared_ptr<AssetRequest>;
+
+// Reads and decodes assets on background threads, most urgent first, and
+// hands the results back on whichever thread calls Pump, typically the
+// render thread, so GPU uploads stay off the workers.
+class AssetStreamer
+{
+public:
+	// I/O bound, so a couple of workers are enough by default.
+	explicit AssetStreamer(size_t threadsCount = 2);
+	~AssetStreamer();
+
+	AssetStreamer(const AssetStreamer&) = delete;
+	AssetStreamer& operator=(const AssetStreamer&) = delete;
+
+	// load runs on a worker, complete(succeeded) on the thread calling Pump.
+	AssetHandle Request(AssetPriority priority, std::function<bool()> load, std::function<void(bool)> complete);
+
+	// Same, with a T that load fills in and complete consumes.
+	template<typename T, typename LoadF, typename CompleteF>
+	AssetHandle Request(AssetPriority priority, LoadF load, CompleteF complete)
+	{
+		std::shared_ptr<T> result = std::make_shared<T>();
+		return Request(priority,
+			[result, load]() { return load(*result); },
+			[result, complete](bool succeeded) { complete(*result, succeeded); });
+	}
+
+	// Runs up to maxCompletions completion callbacks, in the order the loads
+	// finished. Returns how many ran.
+	size_t Pump(size_t maxCompletions = ~static_cast<size_t>(0));
+
+	// True when nothing is queued, loading or waiting for Pump.
+	bool IsIdle() const { return 0 == pending; }
+
+	// Cancels everything queued, waits for the loads in flight and joins the
+	// workers. Completions that are left never run.
+	void Stop();
+
+private:
+	struct Compare
+	{
+		bool operator()(const AssetHandle& a, const AssetHandle& b) const
+		{
+			// priority_queue pops the largest, so "less" means less urgent.
+			if (a->priority != b->priority)
+				return a->priority > b->priority;
+			return a->sequence > b->sequence;
+		}
+	};
+
+	void WorkerLoop();
+
+	std::vector<std::thread>	threads;
+	std::priority_queue<AssetHandle, std::vector<AssetHandle>, Compare>	queue;
+	std::deque<AssetHandle>		completed;
+	std::mutex					mutex;
+	std::condition_variable		wake;
+	std::atomic<size_t>			pending;
+	uint64_t					nextSequence;
+	bool						stopping;
+};
@@ -0,0 +1,134 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "AssetArchive.h"
+#include "Benchmark.h"
+#include "MappedFile.h"
+
+namespace
+{
+	// The loose-file path the viewer used: size the file, then read it whole.
+	size_t ReadLoose(const char* filename, std::vector<char>& data)
+	{
+		FILE* fp = fopen(filename, "rb");
+		if (nullptr == fp) return 0;
+
+		fseek(fp, 0, SEEK_END);
+		size_t length = ftell(fp);
+		fseek(fp, 0, SEEK_SET);
+
+		data.resize(length);
+		size_t read = fread(data.data(), 1, length, fp);
+		fclose(fp);
+		return read;
+	}
+
+	// Sums one byte per page so the views are really paged in.
+	size_t Touch(const void* data, size_t size)
+	{
+		const unsigned char* bytes = static_cast<const unsigned char*>(data);
+		size_t sum = 0;
+		for (size_t i = 0; i < size; i += 4096)
+			sum += bytes[i];
+		return sum;
+	}
+}
+
+// Packs the given files into bench.pak, then reads every file back through
+// fopen/fread and through the mapped archive.
+int BenchArchive(int argc, char** argv)
+{
+	if (argc < 1)
+		return 1;
+
+	int iterations = 100;
+	if (argc > 1 && 0 == strncmp(argv[0], "-n", 2))
+	{
+		iterations = atoi(argv[0] + 2);
+		argc--, argv++;
+		if (iterations < 1) iterations = 1;
+	}
+
+	const char* archiveFilename = "bench.pak";
+	{
+		AssetArchiveWriter writer;
+		for (int i = 0; i < argc; ++i)
+		{
+			MappedFile source;
+			if (!source.Open(argv[i]))
+			{
+				printf("error: cannot read %s\n", argv[i]);
+				return 1;
+			}
+			writer.Add(argv[i], source.GetData(), source.GetSize());
+		}
+
+		AssetArchiveWriter::Stats stats;
+		BenchTimer timer;
+		if (!writer.Write(archiveFilename, &stats))
+		{
+			printf("error: cannot write %s\n", archiveFilename);
+			return 1;
+		}
+		BenchReport("archive", "pack", "ms", timer.ElapsedMs());
+		BenchReport("archive", "pack", "bytes", static_cast<double>(stats.size));
+		BenchReport("archive", "pack", "stored_bytes", static_cast<double>(stats.storedSize));
+		BenchReport("archive", "pack", "compressed_entries", static_cast<double>(stats.compressedCount));
+	}
+
+	std::vector<char> loose;
+	size_t checksum = 0;
+
+	BenchTimer timer;
+	for (int n = 0; n < iterations; ++n)
+	{
+		for (int i = 0; i < argc; ++i)
+			checksum += ReadLoose(argv[i], loose);
+	}
+	double looseMs = timer.ElapsedMs() / iterations;
+
+	timer.Reset();
+	AssetArchive archive;
+	if (!archive.Open(archiveFilename))
+	{
+		printf("error: cannot open %s\n", archiveFilename);
+		return 1;
+	}
+	double openMs = timer.ElapsedMs();
+
+	std::vector<char> scratch;
+	double viewMs = 0.0, decompressMs = 0.0;
+	for (int n = 0; n < iterations; ++n)
+	{
+		for (int i = 0; i < argc; ++i)
+		{
+			timer.Reset();
+			const ArchiveEntry* entry = archive.Find(argv[i]);
+			const void* view = nullptr != entry ? archive.GetView(*entry) : nullptr;
+			if (nullptr != view)
+			{
+				checksum += Touch(view, static_cast<size_t>(entry->size));
+				viewMs += timer.ElapsedMs();
+			}
+			else if (nullptr != entry)
+			{
+				scratch.resize(static_cast<size_t>(entry->size));
+				archive.Read(*entry, scratch.data());
+				decompressMs += timer.ElapsedMs();
+			}
+		}
+	}
+
+	BenchReport("archive", "loose", "ms_per_pass", looseMs);
+	BenchReport("archive", "archive_open", "ms", openMs);
+	BenchReport("archive", "archive_view", "ms_per_pass", viewMs / iterations);
+	BenchReport("archive", "archive_decompress", "ms_per_pass", decompressMs / iterations);
+	BenchReport("archive", "archive", "ms_per_pass", (viewMs + decompressMs) / iterations);
+	BenchReport("archive", "speedup", "x", looseMs * iterations / (viewMs + decompressMs));
+
+	// Keeps the reads from being optimized out.
+	if (0 == checksum) printf("\n");
+	return 0;
+}
@@ -0,0 +1,73 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "Benchmark.h"
+#include "ConstantAllocator.h"
+
+namespace
+{
+	// Same size as the viewer's ConstantsPerInstance.
+	struct ObjectConstants
+	{
+		float	matWorld[16];
+		float	matWorldIT[16];
+	};
+}
+
+// Writes per-object constants for many objects a frame through the
+// ConstantAllocator, with a fake fence lagging the CPU by the number of
+// regions minus one, and reports the cost per object.
+int BenchConstants(int argc, char** argv)
+{
+	int objectsCount = argc > 0 ? atoi(argv[0]) : 10000;
+	int frames = argc > 1 ? atoi(argv[1]) : 1000;
+	int regionsCount = argc > 2 ? atoi(argv[2]) : 3;
+	if (objectsCount < 1) objectsCount = 1;
+	if (frames < 1) frames = 1;
+	if (regionsCount < 1) regionsCount = 1;
+
+	ConstantAllocator allocator;
+	allocator.Reset(static_cast<uint64_t>(objectsCount) * ConstantAllocator::Alignment, regionsCount);
+	std::vector<uint8_t> buffer(static_cast<size_t>(allocator.GetBufferSize()));
+
+	ObjectConstants constants = {};
+	uint64_t completed = 0, stalls = 0, checksum = 0;
+
+	BenchTimer timer;
+	for (int frame = 1; frame <= frames; ++frame)
+	{
+		// The GPU trails by regionsCount - 1 frames.
+		if (frame >= regionsCount)
+			completed = frame - regionsCount + 1;
+		if (!allocator.BeginFrame(completed))
+		{
+			completed = allocator.GetNextFenceValue();
+			allocator.BeginFrame(completed);
+			stalls++;
+		}
+
+		for (int i = 0; i < objectsCount; ++i)
+		{
+			constants.matWorld[12] = static_cast<float>(i);
+			uint64_t offset = allocator.Allocate<ObjectConstants>();
+			memcpy(buffer.data() + offset, &constants, sizeof(constants));
+			checksum += offset;
+		}
+
+		allocator.EndFrame(frame);
+	}
+	double ms = timer.ElapsedMs();
+
+	char caseName[32];
+	snprintf(caseName, sizeof(caseName), "%d_objects", objectsCount);
+	BenchReport("constants", caseName, "ns_per_object", ms * 1e6 / (static_cast<double>(frames) * objectsCount));
+	BenchReport("constants", caseName, "ms_per_frame", ms / frames);
+	BenchReport("constants", caseName, "kb_per_frame", allocator.GetFrameUsedSize() / 1024.0);
+	BenchReport("constants", caseName, "stalls_per_frame", static_cast<double>(stalls) / frames);
+
+	// Keeps the writes from being optimized out.
+	if (0 == checksum) printf("\n");
+	return 0;
+}
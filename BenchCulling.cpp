@@ -0,0 +1,171 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+#include "Benchmark.h"
+#include "CullingBvh.h"
+#include "ThreadPool.h"
+
+namespace
+{
+	// View looking from the origin at angle about Y, times a 60 degree
+	// left-handed perspective, row-major for row vectors as XMMATRIX.
+	void ViewProjection(float angle, float farZ, float* m)
+	{
+		const float nearZ = 0.1f;
+		const float scale = 1.0f / std::tan(3.14159265f / 6.0f);
+		const float range = farZ / (farZ - nearZ);
+		float c = std::cos(angle), s = std::sin(angle);
+		// Inverse of the camera rotation, then the projection.
+		const float view[4][4] = {
+			{ c, 0.0f, s, 0.0f },
+			{ 0.0f, 1.0f, 0.0f, 0.0f },
+			{ -s, 0.0f, c, 0.0f },
+			{ 0.0f, 0.0f, 0.0f, 1.0f },
+		};
+		const float projection[4][4] = {
+			{ scale, 0.0f, 0.0f, 0.0f },
+			{ 0.0f, scale, 0.0f, 0.0f },
+			{ 0.0f, 0.0f, range, 1.0f },
+			{ 0.0f, 0.0f, -range * nearZ, 0.0f },
+		};
+		for (int r = 0; r < 4; ++r)
+		{
+			for (int col = 0; col < 4; ++col)
+				m[r * 4 + col] = view[r][0] * projection[0][col] + view[r][1] * projection[1][col] + view[r][2] * projection[2][col] + view[r][3] * projection[3][col];
+		}
+	}
+
+	// Tests every box against every plane, the way the viewer would without
+	// a hierarchy.
+	void CullLinear(const Frustum& frustum, const std::vector<Aabb>& boxes, std::vector<uint32_t>& visible)
+	{
+		visible.clear();
+		for (size_t i = 0; i < boxes.size(); ++i)
+		{
+			const Aabb& box = boxes[i];
+			bool inside = true;
+			for (int p = 0; p < 6 && inside; ++p)
+			{
+				const float* plane = frustum.planes[p];
+				float x = plane[0] >= 0.0f ? box.max[0] : box.min[0];
+				float y = plane[1] >= 0.0f ? box.max[1] : box.min[1];
+				float z = plane[2] >= 0.0f ? box.max[2] : box.min[2];
+				inside = (plane[0] * x + plane[1] * y) + (plane[2] * z + plane[3]) >= 0.0f;
+			}
+			if (inside)
+				visible.push_back(static_cast<uint32_t>(i));
+		}
+	}
+}
+
+// Scatters unit boxes at constant density around a camera that turns on the
+// spot, and per frame moves them, refits the BVH and culls it single
+// threaded and on the shared pool, against a linear scan of every box.
+int BenchCulling(int argc, char** argv)
+{
+	std::vector<int> counts;
+	for (int i = 0; i < argc; ++i)
+		counts.push_back(atoi(argv[i]));
+	if (counts.empty())
+		counts = { 10000, 100000, 1000000 };
+
+	const int frames = 20;
+	ThreadPool& pool = ThreadPool::Shared();
+	uint64_t checksum = 0;
+
+	for (int count : counts)
+	{
+		if (count < 1)
+			continue;
+
+		// About 2 units between objects, and a far plane at a third of the
+		// way to the edge.
+		const float half = std::cbrt(static_cast<float>(count));
+		const float farZ = half / 3.0f;
+		std::mt19937 rng(1234);
+		std::uniform_real_distribution<float> position(-half, half), phase(0.0f, 6.2831853f);
+		std::vector<float> centers(count * 3), phases(count);
+		for (int i = 0; i < count; ++i)
+		{
+			for (int k = 0; k < 3; ++k)
+				centers[i * 3 + k] = position(rng);
+			phases[i] = phase(rng);
+		}
+
+		std::vector<Aabb> boxes(count);
+		auto move = [&](float time)
+		{
+			for (int i = 0; i < count; ++i)
+			{
+				float offset = 0.25f * std::sin(time + phases[i]);
+				for (int k = 0; k < 3; ++k)
+				{
+					boxes[i].min[k] = centers[i * 3 + k] + offset - 0.5f;
+					boxes[i].max[k] = centers[i * 3 + k] + offset + 0.5f;
+				}
+			}
+		};
+
+		move(0.0f);
+		CullingBvh bvh;
+		BenchTimer buildTimer;
+		bvh.Build(boxes.data(), boxes.size());
+		double buildMs = buildTimer.ElapsedMs();
+
+		double refitMs = 0.0, cullMs = 0.0, cullPoolMs = 0.0, linearMs = 0.0;
+		size_t visibleCount = 0, mismatches = 0;
+		std::vector<uint32_t> visible, visiblePool, visibleLinear;
+		for (int frame = 0; frame < frames; ++frame)
+		{
+			float time = frame * 0.1f;
+			move(time);
+			float m[16];
+			ViewProjection(time, farZ, m);
+			Frustum frustum = Frustum::FromViewProjection(m);
+
+			BenchTimer timer;
+			bvh.Refit(boxes.data(), &pool);
+			refitMs += timer.ElapsedMs();
+
+			timer.Reset();
+			bvh.Cull(frustum, nullptr, visible);
+			cullMs += timer.ElapsedMs();
+
+			timer.Reset();
+			bvh.Cull(frustum, &pool, visiblePool);
+			cullPoolMs += timer.ElapsedMs();
+
+			timer.Reset();
+			CullLinear(frustum, boxes, visibleLinear);
+			linearMs += timer.ElapsedMs();
+
+			std::sort(visible.begin(), visible.end());
+			if (visible != visibleLinear || visiblePool.size() != visible.size())
+				++mismatches;
+			visibleCount += visible.size();
+			for (uint32_t index : visiblePool)
+				checksum += index;
+		}
+
+		char caseName[32];
+		snprintf(caseName, sizeof(caseName), "%d_objects", count);
+		BenchReport("culling", caseName, "build_ms", buildMs);
+		BenchReport("culling", caseName, "nodes", static_cast<double>(bvh.GetNodesCount()));
+		BenchReport("culling", caseName, "refit_ms_per_frame", refitMs / frames);
+		BenchReport("culling", caseName, "bvh_ms_per_frame", cullMs / frames);
+		BenchReport("culling", caseName, "bvh_pool_ms_per_frame", cullPoolMs / frames);
+		BenchReport("culling", caseName, "linear_ms_per_frame", linearMs / frames);
+		BenchReport("culling", caseName, "visible_per_frame", static_cast<double>(visibleCount) / frames);
+		BenchReport("culling", caseName, "speedup", linearMs / cullPoolMs);
+		if (0 != mismatches)
+			printf("error: %zu frames where the BVH and the linear scan disagree\n", mismatches);
+	}
+
+	// Keeps the culling from being optimized out.
+	if (0 == checksum) printf("\n");
+	return 0;
+}
@@ -0,0 +1,104 @@
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <random>
+#include <vector>
+
+#include "Benchmark.h"
+#include "DescriptorAllocator.h"
+
+// Exercises the descriptor bookkeeping without a device: texture-like churn
+// in a staging free list, persistent bindless slots freed behind a fake
+// fence, and transient tables allocated from the ring every frame.
+int BenchDescriptors(int argc, char** argv)
+{
+	int tablesPerFrame = argc > 0 ? atoi(argv[0]) : 2000;
+	int tableSize = argc > 1 ? atoi(argv[1]) : 4;
+	int frames = argc > 2 ? atoi(argv[2]) : 1000;
+	const int latency = 2;
+	if (tablesPerFrame < 1) tablesPerFrame = 1;
+	if (tableSize < 1) tableSize = 1;
+	if (frames < 1) frames = 1;
+
+	std::mt19937 rng(1);
+
+	{
+		DescriptorFreeList staging(256);
+		std::vector<DescriptorHandle> live;
+		const int operations = 1000000;
+		int stale = 0;
+
+		BenchTimer timer;
+		for (int i = 0; i < operations; ++i)
+		{
+			if (live.size() < 10000 && (live.empty() || rng() % 2))
+				live.push_back(staging.Allocate());
+			else
+			{
+				size_t k = rng() % live.size();
+				DescriptorHandle handle = live[k];
+				live[k] = live.back();
+				live.pop_back();
+				staging.Free(handle);
+				// The same handle again must be refused.
+				stale += !staging.Free(handle);
+			}
+		}
+		double ms = timer.ElapsedMs();
+
+		BenchReport("descriptors", "staging", "ns_per_operation", ms * 1e6 / operations);
+		BenchReport("descriptors", "staging", "pages", staging.GetPagesCount());
+		BenchReport("descriptors", "staging", "stale_frees_refused", stale);
+	}
+
+	{
+		const uint32_t ringCount = static_cast<uint32_t>(tablesPerFrame * tableSize * (latency + 1));
+		ShaderVisibleDescriptorAllocator allocator;
+		allocator.Reset(4096, ringCount);
+
+		std::deque<DescriptorHandle> bindless;
+		uint64_t completed = 0, stalls = 0, failures = 0;
+
+		BenchTimer timer;
+		for (int frame = 1; frame <= frames; ++frame)
+		{
+			if (frame > latency)
+				completed = frame - latency;
+			allocator.Retire(completed);
+
+			// A few textures stream in and out every frame.
+			for (int i = 0; i < 8; ++i)
+			{
+				DescriptorHandle handle = allocator.AllocatePersistent();
+				if (handle.IsValid())
+					bindless.push_back(handle);
+			}
+			while (bindless.size() > 2048)
+			{
+				allocator.FreePersistent(bindless.front(), frame);
+				bindless.pop_front();
+			}
+
+			for (int i = 0; i < tablesPerFrame; ++i)
+			{
+				uint32_t index = allocator.AllocateTable(tableSize);
+				while (DescriptorHandle::InvalidIndex == index && 0 != allocator.GetOldestFenceValue())
+				{
+					completed = allocator.GetOldestFenceValue();
+					allocator.Retire(completed);
+					stalls++;
+					index = allocator.AllocateTable(tableSize);
+				}
+				failures += DescriptorHandle::InvalidIndex == index;
+			}
+
+			allocator.Submit(frame);
+		}
+		double ms = timer.ElapsedMs();
+
+		BenchReport("descriptors", "tables", "ns_per_table", ms * 1e6 / (static_cast<double>(frames) * tablesPerFrame));
+		BenchReport("descriptors", "tables", "stalls_per_frame", static_cast<double>(stalls) / frames);
+		BenchReport("descriptors", "tables", "failures", static_cast<double>(failures));
+	}
+	return 0;
+}
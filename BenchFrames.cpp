@@ -0,0 +1,133 @@
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+#include "Benchmark.h"
+#include "FrameScheduler.h"
+
+namespace
+{
+	typedef std::chrono::steady_clock Clock;
+
+	// Stands in for the command queue and its fence: every submitted frame
+	// starts latency after its submission, once the previous one is done, and
+	// takes gpuMs.
+	class SimulatedQueue
+	{
+	public:
+		SimulatedQueue(double gpuMs, double latencyMs)
+			: gpuTime(std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double, std::milli>(gpuMs)))
+			, latency(std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double, std::milli>(latencyMs)))
+			, completed(0), stopping(false), worker(&SimulatedQueue::Run, this) {}
+
+		~SimulatedQueue()
+		{
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				stopping = true;
+			}
+			wake.notify_all();
+			worker.join();
+		}
+
+		void Signal(uint64_t fenceValue)
+		{
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				pending.push_back(Submission{ fenceValue, Clock::now() });
+			}
+			wake.notify_all();
+		}
+
+		void Wait(uint64_t fenceValue)
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			done.wait(lock, [&]() { return completed >= fenceValue; });
+		}
+
+	private:
+		struct Submission
+		{
+			uint64_t			fenceValue;
+			Clock::time_point	time;
+		};
+
+		void Run()
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			for (;;)
+			{
+				wake.wait(lock, [&]() { return stopping || !pending.empty(); });
+				if (pending.empty())
+					return;
+
+				Submission submission = pending.front();
+				pending.pop_front();
+				lock.unlock();
+
+				std::this_thread::sleep_until(submission.time + latency);
+				std::this_thread::sleep_for(gpuTime);
+
+				lock.lock();
+				completed = submission.fenceValue;
+				done.notify_all();
+			}
+		}
+
+		Clock::duration				gpuTime;
+		Clock::duration				latency;
+		std::deque<Submission>		pending;
+		uint64_t					completed;
+		bool						stopping;
+		std::mutex					mutex;
+		std::condition_variable		wake;
+		std::condition_variable		done;
+		std::thread					worker;
+	};
+}
+
+// Runs the same frame loop with 1 to 3 frames in flight against a simulated
+// GPU queue. 1 is the old loop that waited on the GPU at the end of every
+// frame.
+int BenchFrames(int argc, char** argv)
+{
+	double cpuMs = argc > 0 ? atof(argv[0]) : 4.0;
+	double gpuMs = argc > 1 ? atof(argv[1]) : 4.0;
+	double latencyMs = argc > 2 ? atof(argv[2]) : 1.0;
+	int frames = argc > 3 ? atoi(argv[3]) : 200;
+	if (frames < 1) frames = 1;
+
+	const Clock::duration cpuTime = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double, std::milli>(cpuMs));
+
+	for (uint32_t framesInFlight = 1; framesInFlight <= 3; ++framesInFlight)
+	{
+		SimulatedQueue queue(gpuMs, latencyMs);
+		FrameScheduler scheduler(framesInFlight);
+		double waitMs = 0.0;
+
+		BenchTimer timer;
+		for (int frame = 0; frame < frames; ++frame)
+		{
+			BenchTimer wait;
+			queue.Wait(scheduler.BeginFrame());
+			waitMs += wait.ElapsedMs();
+
+			// Recording.
+			std::this_thread::sleep_for(cpuTime);
+
+			queue.Signal(scheduler.EndFrame());
+		}
+		queue.Wait(scheduler.GetLastFenceValue());
+		double ms = timer.ElapsedMs();
+
+		char caseName[32];
+		snprintf(caseName, sizeof(caseName), "%u_in_flight", framesInFlight);
+		BenchReport("frames", caseName, "ms_per_frame", ms / frames);
+		BenchReport("frames", caseName, "cpu_wait_ms_per_frame", waitMs / frames);
+	}
+	return 0;
+}
@@ -0,0 +1,95 @@
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+#include "Benchmark.h"
+#include "TlsfAllocator.h"
+
+// Churns one TlsfAllocator the size of a GPU heap block with a mix of
+// resources: 64 KB aligned buffers and 4 KB aligned small textures, sizes
+// spread log-uniformly up to a maximum. Frees are random, and the heap is
+// kept around three quarters full so fragmentation has room to show.
+int BenchHeap(int argc, char** argv)
+{
+	int heapMb = argc > 0 ? atoi(argv[0]) : 64;
+	int operations = argc > 1 ? atoi(argv[1]) : 1000000;
+	int maxKb = argc > 2 ? atoi(argv[2]) : 4096;
+	if (heapMb < 1) heapMb = 1;
+	if (operations < 1) operations = 1;
+	if (maxKb < 4) maxKb = 4;
+
+	const uint64_t heapSize = static_cast<uint64_t>(heapMb) * 1024 * 1024;
+	TlsfAllocator allocator(heapSize, 4096);
+
+	// Drawn up front so the timed loop measures the allocator alone.
+	std::mt19937 rng(1234);
+	std::uniform_real_distribution<double> logSize(0.0, std::log2(maxKb / 4.0));
+	std::vector<uint64_t> sizes(operations);
+	std::vector<uint32_t> picks(operations);
+	for (int i = 0; i < operations; ++i)
+	{
+		sizes[i] = static_cast<uint64_t>(4096.0 * std::exp2(logSize(rng)));
+		picks[i] = rng();
+	}
+
+	std::vector<TlsfAllocator::Allocation> live;
+	live.reserve(operations);
+	uint64_t usedSize = 0, failures = 0, allocations = 0, checksum = 0;
+	double fragmentationSum = 0.0, utilizationSum = 0.0;
+	int samples = 0;
+
+	BenchTimer timer;
+	for (int i = 0; i < operations; ++i)
+	{
+		bool allocate = live.empty() || (picks[i] & 3) != 0;
+		if (allocate && usedSize > heapSize * 3 / 4)
+			allocate = false;
+
+		if (allocate)
+		{
+			uint64_t alignment = (picks[i] & 4) ? 65536 : 4096;
+			TlsfAllocator::Allocation allocation;
+			if (allocator.Allocate(sizes[i], alignment, allocation))
+			{
+				live.push_back(allocation);
+				usedSize += allocation.size;
+				checksum += allocation.offset;
+				allocations++;
+			}
+			else
+				failures++;
+		}
+		else
+		{
+			size_t index = (picks[i] >> 3) % live.size();
+			usedSize -= live[index].size;
+			allocator.Free(live[index]);
+			live[index] = live.back();
+			live.pop_back();
+		}
+
+		// Sampling walks the free lists, rarely enough not to show in the time.
+		if (0 == (i & 4095))
+		{
+			TlsfAllocator::Stats stats = allocator.GetStats();
+			fragmentationSum += stats.GetFragmentation();
+			utilizationSum += static_cast<double>(stats.usedSize) / stats.size;
+			samples++;
+		}
+	}
+	double ms = timer.ElapsedMs();
+
+	char caseName[32];
+	snprintf(caseName, sizeof(caseName), "%d_mb_%d_kb", heapMb, maxKb);
+	BenchReport("heap", caseName, "ns_per_op", ms * 1e6 / operations);
+	BenchReport("heap", caseName, "allocations", static_cast<double>(allocations));
+	BenchReport("heap", caseName, "failure_rate", static_cast<double>(failures) / (allocations + failures));
+	BenchReport("heap", caseName, "utilization", utilizationSum / samples);
+	BenchReport("heap", caseName, "fragmentation", fragmentationSum / samples);
+
+	// Keeps the allocations from being optimized out.
+	if (0 == checksum) printf("\n");
+	return 0;
+}
@@ -0,0 +1,75 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+#include "Benchmark.h"
+#include "InstanceBuilder.h"
+
+// Builds the instance buffer of a frame the way the viewer does: every
+// instance is added under a random batch key, as an LOD would pick it, then
+// packed batch after batch. Reports the CPU cost per instance of both steps.
+int BenchInstances(int argc, char** argv)
+{
+	int instancesCount = argc > 0 ? atoi(argv[0]) : 100000;
+	int batchesCount = argc > 1 ? atoi(argv[1]) : 4;
+	int frames = argc > 2 ? atoi(argv[2]) : 100;
+	if (instancesCount < 1) instancesCount = 1;
+	if (batchesCount < 1) batchesCount = 1;
+	if (frames < 1) frames = 1;
+
+	// Row-vector world matrices: a rotation about Y and a translation.
+	std::mt19937 rng(1234);
+	std::uniform_real_distribution<float> position(-100.0f, 100.0f);
+	std::uniform_real_distribution<float> angle(0.0f, 6.2831853f);
+	std::vector<float> worlds(static_cast<size_t>(instancesCount) * 16);
+	std::vector<uint32_t> keys(instancesCount);
+	for (int i = 0; i < instancesCount; ++i)
+	{
+		float a = angle(rng), c = std::cos(a), s = std::sin(a);
+		float m[16] = {
+			c, 0.0f, -s, 0.0f,
+			0.0f, 1.0f, 0.0f, 0.0f,
+			s, 0.0f, c, 0.0f,
+			position(rng), position(rng), position(rng), 1.0f,
+		};
+		std::copy(m, m + 16, worlds.begin() + i * 16);
+		keys[i] = rng() % batchesCount;
+	}
+
+	InstanceBuilder builder;
+	std::vector<InstanceData> buffer(instancesCount);
+	double addMs = 0.0, packMs = 0.0;
+	size_t batches = 0;
+	float checksum = 0.0f;
+
+	for (int frame = 0; frame < frames; ++frame)
+	{
+		BenchTimer timer;
+		builder.Reset(batchesCount);
+		for (int i = 0; i < instancesCount; ++i)
+			builder.Add(keys[i], &worlds[i * 16], i & 3);
+		addMs += timer.ElapsedMs();
+
+		timer.Reset();
+		batches = builder.Pack(buffer.data()).size();
+		packMs += timer.ElapsedMs();
+
+		checksum += buffer[frame % instancesCount].transform.world[0][3];
+	}
+
+	char caseName[32];
+	snprintf(caseName, sizeof(caseName), "%d_instances", instancesCount);
+	double perInstance = 1e6 / (static_cast<double>(frames) * instancesCount);
+	BenchReport("instances", caseName, "add_ns_per_instance", addMs * perInstance);
+	BenchReport("instances", caseName, "pack_ns_per_instance", packMs * perInstance);
+	BenchReport("instances", caseName, "ms_per_frame", (addMs + packMs) / frames);
+	BenchReport("instances", caseName, "mb_per_frame", instancesCount * sizeof(InstanceData) / (1024.0 * 1024.0));
+	BenchReport("instances", caseName, "draws_per_submesh", static_cast<double>(batches));
+
+	// Keeps the packing from being optimized out.
+	if (0.0f == checksum) printf("\n");
+	return 0;
+}
@@ -0,0 +1,128 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <vector>
+
+#if defined(_WIN32)
+#include <Windows.h>
+#else
+#include <sys/mman.h>
+#endif
+
+#include "Benchmark.h"
+#include "Mesh.h"
+#include "VertexInterleave.h"
+
+namespace
+{
+	// Stands in for a mapped D3D12 upload heap, which is write-combined.
+	void* AllocUploadMemory(size_t size)
+	{
+#if defined(_WIN32)
+		return VirtualAlloc(nullptr, size, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE | PAGE_WRITECOMBINE);
+#else
+		void* ptr = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		return MAP_FAILED == ptr ? nullptr : ptr;
+#endif
+	}
+
+	void FreeUploadMemory(void* ptr, size_t size)
+	{
+#if defined(_WIN32)
+		(void)size;
+		VirtualFree(ptr, 0, MEM_RELEASE);
+#else
+		munmap(ptr, size);
+#endif
+	}
+
+	template<typename Fn>
+	double Measure(int iterations, Fn fn)
+	{
+		// One untimed pass to fault in the destination pages.
+		fn();
+
+		double best = 1e30;
+		for (int i = 0; i < iterations; ++i)
+		{
+			BenchTimer timer;
+			fn();
+			double ms = timer.ElapsedMs();
+			if (ms < best) best = ms;
+		}
+		return best;
+	}
+
+	void Report(size_t count, const char* kernel, double ms)
+	{
+		char caseName[64];
+		snprintf(caseName, sizeof(caseName), "%s/%zu", kernel, count);
+		BenchReport("interleave", caseName, "ms", ms);
+		BenchReport("interleave", caseName, "GB/s", count * Mesh::VertexSize / (ms * 1.0e6));
+	}
+}
+
+// Interleaves N vertices with each kernel, plus the direct path that only
+// stream-copies a stream built at import time.
+int BenchInterleave(int argc, char** argv)
+{
+	std::vector<size_t> counts;
+	for (int i = 0; i < argc; ++i)
+		counts.push_back(static_cast<size_t>(atof(argv[i]) * 1000000.0));
+	if (counts.empty())
+		counts = { 1000000, 5000000, 10000000, 50000000 };
+
+	const int iterations = 5;
+	int mismatches = 0;
+
+	for (size_t count : counts)
+	{
+		std::vector<Mesh::Vector3D> positions(count), normals(count), tangents(count);
+		std::vector<Mesh::Vector2D> uvs(count);
+		std::vector<Mesh::Vertex> interleaved(count);
+
+		// Every component of every vertex differs from the others, so the
+		// check catches a shuffle taking one for another.
+		for (size_t i = 0; i < count; ++i)
+		{
+			float f = static_cast<float>(i);
+			positions[i] = { f, -f - 0.125f, f + 0.25f };
+			normals[i] = { f + 0.375f, -f - 0.5f, f + 0.625f };
+			tangents[i] = { -f - 0.75f, f + 0.875f, -f - 1.0f / 16 };
+			uvs[i] = { f + 1.0f / 32, -f - 3.0f / 32 };
+		}
+		InterleaveVerticesScalar(interleaved.data(), positions.data(), normals.data(), tangents.data(), uvs.data(), count);
+
+		size_t size = count * Mesh::VertexSize;
+		Mesh::Vertex* dest = reinterpret_cast<Mesh::Vertex*>(AllocUploadMemory(size));
+		if (nullptr == dest)
+		{
+			printf("error: cannot allocate %zu bytes\n", size);
+			continue;
+		}
+
+		// Every kernel starts from a cleared destination and must end up with
+		// the reference vertices.
+		auto run = [&](const char* kernel, const std::function<void()>& fn)
+		{
+			memset(dest, 0, size);
+			Report(count, kernel, Measure(iterations, fn));
+			if (0 != memcmp(dest, interleaved.data(), size))
+			{
+				printf("error: %s output mismatch at %zu vertices\n", kernel, count);
+				++mismatches;
+			}
+		};
+		run("scalar", [&]() { InterleaveVerticesScalar(dest, positions.data(), normals.data(), tangents.data(), uvs.data(), count); });
+		run("sse", [&]() { InterleaveVerticesSSE(dest, positions.data(), normals.data(), tangents.data(), uvs.data(), count); });
+		if (GetBestInterleaveKernel() == InterleaveKernel::AVX)
+			run("avx", [&]() { InterleaveVerticesAVX(dest, positions.data(), normals.data(), tangents.data(), uvs.data(), count); });
+		run("direct_memcpy", [&]() { memcpy(dest, interleaved.data(), size); });
+		run("direct_stream", [&]() { StreamCopy(dest, interleaved.data(), size); });
+
+		FreeUploadMemory(dest, size);
+	}
+
+	return 0 != mismatches ? 1 : 0;
+}
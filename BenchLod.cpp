@@ -0,0 +1,96 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+#include "Benchmark.h"
+#include "LodSelector.h"
+#include "Mesh.h"
+
+// Scatters instances of one mesh over a field and flies the camera through it,
+// timing LOD selection and comparing the submitted triangles with drawing LOD 0.
+int BenchLod(int argc, char** argv)
+{
+	if (argc < 1)
+		return 1;
+
+	const char* source = argv[0];
+	int instancesCount = argc > 1 ? atoi(argv[1]) : 100000;
+	int frames = argc > 2 ? atoi(argv[2]) : 100;
+	if (instancesCount < 1) instancesCount = 1;
+	if (frames < 1) frames = 1;
+
+	Mesh mesh;
+	if (!mesh.ImportFromFile(source))
+	{
+		printf("error: cannot import %s\n", source);
+		return 1;
+	}
+	mesh.Weld();
+	mesh.Optimize(nullptr);
+	mesh.GenerateLods();
+
+	Mesh::AttributeView<Mesh::Vector3D> positions = mesh.GetPositions();
+	float radius = 0.0f;
+	for (size_t i = 0; i < mesh.GetVerticesCount(); ++i)
+		radius = std::max(radius, positions[i].x * positions[i].x + positions[i].y * positions[i].y + positions[i].z * positions[i].z);
+	radius = std::sqrt(radius);
+
+	const float fieldSize = 1000.0f;
+	std::mt19937 rng(1234);
+	std::uniform_real_distribution<float> position(-fieldSize * 0.5f, fieldSize * 0.5f);
+	std::uniform_real_distribution<float> scale(0.5f, 4.0f);
+
+	std::vector<LodInstance> instances(instancesCount);
+	for (LodInstance& instance : instances)
+	{
+		instance.center[0] = position(rng);
+		instance.center[1] = position(rng) * 0.05f;
+		instance.center[2] = position(rng);
+		instance.scale = scale(rng);
+		instance.radius = radius * instance.scale;
+	}
+
+	std::vector<uint8_t> lods(instancesCount);
+	std::vector<size_t> lodTriangles(mesh.GetLodsCount());
+	for (size_t lod = 0; lod < lodTriangles.size(); ++lod)
+	{
+		char caseName[32];
+		snprintf(caseName, sizeof(caseName), "lod%zu", lod);
+		lodTriangles[lod] = mesh.GetLodIndicesCount(lod) / 3;
+		BenchReport("lod", caseName, "triangles", static_cast<double>(lodTriangles[lod]));
+		BenchReport("lod", caseName, "error", mesh.GetLodError(lod));
+	}
+
+	// 90 degree vertical field of view on a 1080 line viewport.
+	LodSelector selector;
+	selector.SetProjection(1.0f, 1080.0f);
+	selector.SetThreshold(1.0f);
+
+	double selectMs = 0.0;
+	double trianglesLod = 0.0;
+	for (int frame = 0; frame < frames; ++frame)
+	{
+		float z = -fieldSize * 0.5f + fieldSize * frame / frames;
+		selector.SetCameraPosition(0.0f, 10.0f, z);
+
+		BenchTimer timer;
+		selector.Select(instances.data(), instances.size(), mesh.GetLodErrors(), mesh.GetLodsCount(), lods.data());
+		selectMs += timer.ElapsedMs();
+
+		for (uint8_t lod : lods)
+			trianglesLod += static_cast<double>(lodTriangles[lod]);
+	}
+
+	double trianglesFull = static_cast<double>(lodTriangles[0]) * instancesCount;
+	trianglesLod /= frames;
+
+	BenchReport("lod", "select", "ms_per_frame", selectMs / frames);
+	BenchReport("lod", "select", "ns_per_instance", selectMs * 1e6 / (static_cast<double>(frames) * instancesCount));
+	BenchReport("lod", "full", "triangles_per_frame", trianglesFull);
+	BenchReport("lod", "selected", "triangles_per_frame", trianglesLod);
+	BenchReport("lod", "reduction", "x", trianglesFull / trianglesLod);
+	return 0;
+}
@@ -0,0 +1,72 @@
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include "Benchmark.h"
+#include "Mesh.h"
+
+// Compares a full Assimp import against mapping the cooked cache. Both paths
+// interleave the vertices afterwards, since the mapped cache only pages data
+// in when it is first touched.
+int BenchMeshLoad(int argc, char** argv)
+{
+	if (argc < 1)
+		return 1;
+
+	const char* source = argv[0];
+	int iterations = argc > 1 ? atoi(argv[1]) : 10;
+	if (iterations < 1) iterations = 1;
+
+	char cacheFilename[260];
+	Mesh::GetCacheFilename(source, cacheFilename, sizeof(cacheFilename));
+
+	uint64_t sourceHash = 0;
+	if (!Mesh::HashSourceFile(source, sourceHash))
+	{
+		printf("error: cannot read %s\n", source);
+		return 1;
+	}
+
+	std::vector<Mesh::Vertex> scratch;
+
+	{
+		Mesh mesh;
+		if (!mesh.ImportFromFile(source) || !mesh.SaveToCache(cacheFilename, sourceHash))
+		{
+			printf("error: cannot cook %s\n", source);
+			return 1;
+		}
+		scratch.resize(mesh.GetVerticesCount());
+		BenchReport("mesh_load", source, "vertices", static_cast<double>(mesh.GetVerticesCount()));
+		BenchReport("mesh_load", source, "indices", static_cast<double>(mesh.GetIndicesCount()));
+	}
+
+	double importMs = 0.0, hashMs = 0.0, cacheMs = 0.0;
+
+	for (int i = 0; i < iterations; ++i)
+	{
+		Mesh mesh;
+		BenchTimer timer;
+		mesh.ImportFromFile(source);
+		mesh.FillInVerticesData(scratch.data());
+		importMs += timer.ElapsedMs();
+	}
+
+	for (int i = 0; i < iterations; ++i)
+	{
+		Mesh mesh;
+		BenchTimer timer;
+		uint64_t hash = 0;
+		Mesh::HashSourceFile(source, hash);
+		hashMs += timer.ElapsedMs();
+		mesh.LoadFromCache(cacheFilename, hash);
+		mesh.FillInVerticesData(scratch.data());
+		cacheMs += timer.ElapsedMs();
+	}
+
+	BenchReport("mesh_load", "assimp", "ms", importMs / iterations);
+	BenchReport("mesh_load", "cache", "ms", cacheMs / iterations);
+	BenchReport("mesh_load", "cache_hash_check", "ms", hashMs / iterations);
+	BenchReport("mesh_load", "speedup", "x", importMs / cacheMs);
+	return 0;
+}
@@ -0,0 +1,145 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include "Benchmark.h"
+#include "Mesh.h"
+#include "Meshlet.h"
+
+namespace
+{
+	void Multiply(const float a[4][4], const float b[4][4], float result[4][4])
+	{
+		for (int r = 0; r < 4; ++r)
+		{
+			for (int c = 0; c < 4; ++c)
+				result[r][c] = a[r][0] * b[0][c] + a[r][1] * b[1][c] + a[r][2] * b[2][c] + a[r][3] * b[3][c];
+		}
+	}
+
+	// Left handed, row vectors, matching DirectXMath's LookAtLH and PerspectiveFovLH.
+	void LookAt(const float eye[3], const float at[3], float view[4][4])
+	{
+		float z[3] = { at[0] - eye[0], at[1] - eye[1], at[2] - eye[2] };
+		float length = std::sqrt(z[0] * z[0] + z[1] * z[1] + z[2] * z[2]);
+		z[0] /= length; z[1] /= length; z[2] /= length;
+
+		// up = (0, 1, 0)
+		float x[3] = { z[2], 0.0f, -z[0] };
+		length = std::sqrt(x[0] * x[0] + x[2] * x[2]);
+		x[0] /= length; x[2] /= length;
+
+		float y[3] = { z[1] * x[2] - z[2] * x[1], z[2] * x[0] - z[0] * x[2], z[0] * x[1] - z[1] * x[0] };
+
+		for (int i = 0; i < 3; ++i)
+		{
+			view[i][0] = x[i];
+			view[i][1] = y[i];
+			view[i][2] = z[i];
+			view[i][3] = 0.0f;
+		}
+		view[3][0] = -(x[0] * eye[0] + x[1] * eye[1] + x[2] * eye[2]);
+		view[3][1] = -(y[0] * eye[0] + y[1] * eye[1] + y[2] * eye[2]);
+		view[3][2] = -(z[0] * eye[0] + z[1] * eye[1] + z[2] * eye[2]);
+		view[3][3] = 1.0f;
+	}
+
+	void Perspective(float fovY, float aspect, float nearZ, float farZ, float proj[4][4])
+	{
+		float h = 1.0f / std::tan(fovY * 0.5f);
+		float q = farZ / (farZ - nearZ);
+		float m[4][4] = {
+			{ h / aspect, 0.0f, 0.0f, 0.0f },
+			{ 0.0f, h, 0.0f, 0.0f },
+			{ 0.0f, 0.0f, q, 1.0f },
+			{ 0.0f, 0.0f, -q * nearZ, 0.0f },
+		};
+		for (int r = 0; r < 4; ++r)
+		{
+			for (int c = 0; c < 4; ++c)
+				proj[r][c] = m[r][c];
+		}
+	}
+}
+
+// Builds meshlets for a mesh, then orbits the camera around it and compares
+// the triangles that survive cluster culling with the cost of culling.
+int BenchMeshlet(int argc, char** argv)
+{
+	if (argc < 1)
+		return 1;
+
+	const char* source = argv[0];
+	int frames = argc > 1 ? atoi(argv[1]) : 360;
+	if (frames < 1) frames = 1;
+
+	Mesh mesh;
+	if (!mesh.ImportFromFile(source))
+	{
+		printf("error: cannot import %s\n", source);
+		return 1;
+	}
+	mesh.Weld();
+	mesh.Optimize(nullptr);
+
+	BenchTimer timer;
+	mesh.BuildMeshlets();
+	BenchReport("meshlet", "build", "ms", timer.ElapsedMs());
+
+	const size_t meshletsCount = mesh.GetMeshletsCount();
+	const Meshlet* meshlets = mesh.GetMeshlets();
+	const MeshletBounds* bounds = mesh.GetMeshletBounds();
+	const double trianglesTotal = static_cast<double>(mesh.GetMeshletTrianglesCount());
+
+	BenchReport("meshlet", "build", "meshlets", static_cast<double>(meshletsCount));
+	BenchReport("meshlet", "build", "vertices_per_meshlet", static_cast<double>(mesh.GetMeshletVerticesCount()) / meshletsCount);
+	BenchReport("meshlet", "build", "triangles_per_meshlet", trianglesTotal / meshletsCount);
+
+	// Orbit at twice the mesh radius, so part of the mesh leaves the frustum too.
+	float center[3] = {}, radius = 0.0f;
+	for (size_t i = 0; i < meshletsCount; ++i)
+	{
+		for (int k = 0; k < 3; ++k)
+			center[k] += bounds[i].center[k] / meshletsCount;
+	}
+	for (size_t i = 0; i < meshletsCount; ++i)
+	{
+		float d[3] = { bounds[i].center[0] - center[0], bounds[i].center[1] - center[1], bounds[i].center[2] - center[2] };
+		radius = std::max(radius, std::sqrt(d[0] * d[0] + d[1] * d[1] + d[2] * d[2]) + bounds[i].radius);
+	}
+
+	float proj[4][4];
+	Perspective(1.0f, 16.0f / 9.0f, radius * 0.01f, radius * 10.0f, proj);
+
+	std::vector<uint32_t> visible(meshletsCount);
+	double cullMs = 0.0, trianglesVisible = 0.0;
+
+	for (int frame = 0; frame < frames; ++frame)
+	{
+		float angle = 6.2831853f * frame / frames;
+		float eye[3] = { center[0] + std::sin(angle) * radius * 2.0f, center[1] + radius * 0.5f, center[2] - std::cos(angle) * radius * 2.0f };
+
+		float view[4][4], viewProj[4][4];
+		LookAt(eye, center, view);
+		Multiply(view, proj, viewProj);
+
+		timer.Reset();
+		Frustum frustum = Frustum::FromViewProjection(&viewProj[0][0]);
+		size_t visibleCount = CullMeshlets(bounds, meshletsCount, frustum, eye, visible.data());
+		cullMs += timer.ElapsedMs();
+
+		for (size_t i = 0; i < visibleCount; ++i)
+			trianglesVisible += meshlets[visible[i]].triangleCount;
+	}
+
+	trianglesVisible /= frames;
+
+	BenchReport("meshlet", "cull", "ms_per_frame", cullMs / frames);
+	BenchReport("meshlet", "cull", "ns_per_meshlet", cullMs * 1e6 / (static_cast<double>(frames) * meshletsCount));
+	BenchReport("meshlet", "cull", "triangles_total", trianglesTotal);
+	BenchReport("meshlet", "cull", "triangles_visible", trianglesVisible);
+	BenchReport("meshlet", "cull", "culled_percent", 100.0 * (1.0 - trianglesVisible / trianglesTotal));
+	return 0;
+}
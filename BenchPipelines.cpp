@@ -0,0 +1,203 @@
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+#include "Benchmark.h"
+#include "PipelineCache.h"
+#include "ThreadPool.h"
+
+namespace
+{
+	// Stand-in for ID3D12PipelineState.
+	struct Pipeline
+	{
+		uint64_t	key;
+
+		void Release() { delete this; }
+	};
+
+	// The fields of a pipeline description that vary in practice. Padding
+	// after blendEnable and cullMode must not reach the key.
+	struct Description
+	{
+		const std::vector<uint8_t>*	vs;
+		const std::vector<uint8_t>*	ps;
+		uint32_t					vertexStride;
+		bool						blendEnable;
+		uint32_t					rtvFormat;
+		uint32_t					dsvFormat;
+		uint8_t						cullMode;
+		float						depthBias;
+	};
+
+	uint64_t HashDescription(const Description& desc)
+	{
+		PipelineKey key;
+		key.AddBytes(desc.vs->data(), desc.vs->size());
+		key.AddBytes(desc.ps->data(), desc.ps->size());
+		key.Add(desc.vertexStride);
+		key.Add(desc.blendEnable);
+		key.Add(desc.rtvFormat);
+		key.Add(desc.dsvFormat);
+		key.Add(desc.cullMode);
+		key.Add(desc.depthBias);
+		return key.Get();
+	}
+
+	// Compiling from scratch takes compileMs, from a blob a tenth of it.
+	PipelineCache<Pipeline>::CompileFunction Compiler(uint64_t key, int compileMs)
+	{
+		return [key, compileMs](const std::vector<uint8_t>& cached, std::vector<uint8_t>& blob) -> Pipeline*
+		{
+			bool usable = cached.size() == sizeof(key) && 0 == memcmp(cached.data(), &key, sizeof(key));
+			std::this_thread::sleep_for(std::chrono::microseconds(compileMs * (usable ? 100 : 1000)));
+			blob.resize(sizeof(key));
+			memcpy(blob.data(), &key, sizeof(key));
+			return new Pipeline{ key };
+		};
+	}
+
+	// Requests every key twice, as two materials sharing pipelines would, and
+	// returns the time to get them all compiled.
+	double Run(PipelineCache<Pipeline>& cache, const std::vector<uint64_t>& keys, int compileMs, double& requestUs)
+	{
+		BenchTimer timer;
+		for (int pass = 0; pass < 2; ++pass)
+		{
+			for (uint64_t key : keys)
+				cache.Request(key, Compiler(key, compileMs));
+		}
+		requestUs = timer.ElapsedMs() * 1000.0 / (2 * keys.size());
+		cache.WaitAll();
+		return timer.ElapsedMs();
+	}
+}
+
+// Compiles permutations of a pipeline description through the cache: once
+// on the calling thread, then on workers with duplicate requests, then again
+// after saving and reloading the disk cache, as the next run would.
+int BenchPipelines(int argc, char** argv)
+{
+	int shadersCount = argc > 0 ? atoi(argv[0]) : 8;
+	int compileMs = argc > 1 ? atoi(argv[1]) : 20;
+	int threadsCount = argc > 2 ? atoi(argv[2]) : 4;
+	if (shadersCount < 1) shadersCount = 1;
+	if (compileMs < 0) compileMs = 0;
+	if (threadsCount < 1) threadsCount = 1;
+
+	std::vector<std::vector<uint8_t>> shaders(shadersCount);
+	for (int i = 0; i < shadersCount; ++i)
+	{
+		shaders[i].resize(2048 + 64 * i);
+		for (size_t b = 0; b < shaders[i].size(); ++b)
+			shaders[i][b] = static_cast<uint8_t>(b * 31 + i * 7);
+	}
+
+	// Vertex shader times blend times cull mode.
+	std::vector<Description> descriptions;
+	for (int vs = 0; vs < shadersCount; ++vs)
+	{
+		for (int blend = 0; blend < 2; ++blend)
+		{
+			for (uint8_t cull = 1; cull <= 3; ++cull)
+				descriptions.push_back(Description{ &shaders[vs], &shaders[shadersCount - 1 - vs], 16, 0 != blend, 28, 45, cull, 0.0f });
+		}
+	}
+
+	int errors = 0;
+	std::vector<uint64_t> keys;
+	std::unordered_set<uint64_t> unique;
+	for (const Description& desc : descriptions)
+	{
+		Description copy;
+		memset(&copy, 0xcd, sizeof(copy));
+		copy = desc;
+		uint64_t key = HashDescription(desc);
+		errors += key != HashDescription(copy);
+		keys.push_back(key);
+		unique.insert(key);
+	}
+	errors += unique.size() != keys.size();
+
+	char filename[64];
+	snprintf(filename, sizeof(filename), "bench_pipelines_%d.cache", shadersCount);
+	const uint64_t DeviceHash = 0x1234;
+
+	ThreadPool inlinePool(1);
+	double syncMs = 0.0;
+	{
+		// One worker, waited on right away: the old synchronous path.
+		PipelineCache<Pipeline> cache(inlinePool);
+		BenchTimer timer;
+		for (uint64_t key : keys)
+		{
+			cache.Request(key, Compiler(key, compileMs));
+			cache.Wait(key);
+		}
+		syncMs = timer.ElapsedMs();
+	}
+
+	ThreadPool pool(threadsCount);
+	double coldMs = 0.0, coldRequestUs = 0.0, warmMs = 0.0, warmRequestUs = 0.0;
+	PipelineCache<Pipeline>::Stats coldStats, warmStats;
+	{
+		PipelineDiskCache disk;
+		disk.Load(filename, DeviceHash);
+		PipelineCache<Pipeline> cache(pool, &disk);
+		coldMs = Run(cache, keys, compileMs, coldRequestUs);
+		coldStats = cache.GetStats();
+		for (uint64_t key : keys)
+		{
+			Pipeline* pipeline = cache.Find(key);
+			errors += nullptr == pipeline || pipeline->key != key;
+		}
+		if (!disk.Save(filename))
+		{
+			printf("error: cannot write %s\n", filename);
+			return 1;
+		}
+	}
+
+	long fileSize = 0;
+	{
+		PipelineDiskCache disk;
+		errors += !disk.Load(filename, DeviceHash) || disk.GetEntriesCount() != keys.size();
+		PipelineCache<Pipeline> cache(pool, &disk);
+		warmMs = Run(cache, keys, compileMs, warmRequestUs);
+		warmStats = cache.GetStats();
+		errors += disk.IsDirty();
+
+		// Another driver: nothing loads.
+		PipelineDiskCache stale;
+		errors += stale.Load(filename, DeviceHash + 1) || 0 != stale.GetEntriesCount();
+
+		FILE* fp = fopen(filename, "rb");
+		if (nullptr != fp)
+		{
+			fseek(fp, 0, SEEK_END);
+			fileSize = ftell(fp);
+			fclose(fp);
+		}
+	}
+	remove(filename);
+
+	if (0 != errors)
+		printf("error: %d key or cache problems\n", errors);
+
+	char caseName[32];
+	snprintf(caseName, sizeof(caseName), "%zu_pipelines", keys.size());
+	BenchReport("pipelines", caseName, "sync_ms", syncMs);
+	BenchReport("pipelines", caseName, "cold_ms", coldMs);
+	BenchReport("pipelines", caseName, "cold_request_us", coldRequestUs);
+	BenchReport("pipelines", caseName, "warm_ms", warmMs);
+	BenchReport("pipelines", caseName, "warm_request_us", warmRequestUs);
+	BenchReport("pipelines", caseName, "requests", coldStats.requests);
+	BenchReport("pipelines", caseName, "compiles", coldStats.compiles);
+	BenchReport("pipelines", caseName, "disk_hits", warmStats.diskHits);
+	BenchReport("pipelines", caseName, "file_KB", fileSize / 1024.0);
+	return 0 != errors ? 1 : 0;
+}
@@ -0,0 +1,134 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Benchmark.h"
+#include "Profiler.h"
+
+namespace
+{
+	volatile uint32_t g_Sink;
+
+	// Three nested scopes around a little work, as a frame's functions would.
+	void Work(uint32_t& value)
+	{
+		PROFILE_SCOPE("outer");
+		for (int i = 0; i < 4; ++i)
+		{
+			PROFILE_SCOPE("middle");
+			{
+				PROFILE_SCOPE("inner");
+				value = value * 1664525u + 1013904223u;
+			}
+		}
+	}
+}
+
+// What markers cost on the threads that record them, scopes per second with
+// every thread recording at once, what the frame statistics take to compute
+// and what writing a trace takes. With PROFILER_ENABLED 0 the scopes cost
+// nothing and the trace is empty.
+int BenchProfiler(int argc, char** argv)
+{
+	int iterations = argc > 0 ? atoi(argv[0]) : 100000;
+	int threadsCount = argc > 1 ? atoi(argv[1]) : 4;
+	const char* traceFilename = argc > 2 ? argv[2] : "bench_profile.json";
+	if (iterations < 1) iterations = 1;
+	if (threadsCount < 1) threadsCount = 1;
+
+	Profiler& profiler = Profiler::Shared();
+	profiler.SetThreadName("main");
+	const int ScopesPerWork = 9;
+
+	char caseName[64];
+	snprintf(caseName, sizeof(caseName), "%d_threads_%s", threadsCount, PROFILER_ENABLED ? "enabled" : "disabled");
+
+	{
+		uint32_t value = 1;
+		BenchTimer timer;
+		for (int i = 0; i < iterations; ++i)
+			Work(value);
+		g_Sink = value;
+		BenchReport("profiler", caseName, "scope_ns", timer.ElapsedMs() * 1e6 / (static_cast<double>(iterations) * ScopesPerWork));
+	}
+
+	{
+		std::vector<std::thread> threads;
+		BenchTimer timer;
+		for (int t = 0; t < threadsCount; ++t)
+		{
+			threads.emplace_back([&profiler, iterations, t]()
+			{
+				char name[32];
+				snprintf(name, sizeof(name), "worker %d", t);
+				profiler.SetThreadName(name);
+				uint32_t value = t;
+				for (int i = 0; i < iterations; ++i)
+					Work(value);
+				g_Sink = value;
+			});
+		}
+		for (std::thread& thread : threads)
+			thread.join();
+		BenchReport("profiler", caseName, "mscopes_per_s", static_cast<double>(iterations) * ScopesPerWork * threadsCount / (timer.ElapsedMs() * 1000.0));
+	}
+
+	// Frame times around 16 ms with a slow one in fifty.
+	std::mt19937 rng(1234);
+	std::normal_distribution<float> frameTime(16.0f, 1.0f);
+	FrameStats stats;
+	for (int i = 0; i < 1000; ++i)
+		stats.Add(0 == i % 50 ? 40.0f : frameTime(rng));
+	{
+		FrameStats::Summary summary = {};
+		BenchTimer timer;
+		for (int i = 0; i < 1000; ++i)
+			summary = stats.GetSummary();
+		BenchReport("profiler", caseName, "summary_us", timer.ElapsedMs());
+		BenchReport("profiler", caseName, "p50_ms", summary.p50);
+		BenchReport("profiler", caseName, "p95_ms", summary.p95);
+		BenchReport("profiler", caseName, "p99_ms", summary.p99);
+
+		uint32_t buckets[FrameStats::HistogramBuckets];
+		stats.GetHistogram(buckets);
+		BenchReport("profiler", caseName, "slowest_bucket_frames", buckets[FrameStats::HistogramBuckets - 1]);
+	}
+
+	BenchTimer timer;
+	if (!profiler.ExportChromeTrace(traceFilename))
+	{
+		printf("error: cannot write %s\n", traceFilename);
+		return 1;
+	}
+	double exportMs = timer.ElapsedMs();
+
+	// Every ring is full or holds all its thread recorded.
+	FILE* fp = fopen(traceFilename, "rb");
+	std::string trace;
+	if (nullptr != fp)
+	{
+		char chunk[64 * 1024];
+		size_t size;
+		while ((size = fread(chunk, 1, sizeof(chunk), fp)) > 0)
+			trace.append(chunk, size);
+		fclose(fp);
+	}
+	size_t eventsCount = 0;
+	for (size_t at = trace.find("\"ph\":\"X\""); std::string::npos != at; at = trace.find("\"ph\":\"X\"", at + 1))
+		++eventsCount;
+	const size_t perThread = PROFILER_ENABLED ? std::min(static_cast<size_t>(iterations) * ScopesPerWork, static_cast<size_t>(Profiler::EventsPerThread)) : 0;
+	const size_t expected = perThread * (threadsCount + 1);
+	BenchReport("profiler", caseName, "export_ms", exportMs);
+	BenchReport("profiler", caseName, "trace_KB", trace.size() / 1024.0);
+	BenchReport("profiler", caseName, "events", static_cast<double>(eventsCount));
+	if (eventsCount != expected || trace.compare(0, 2, "{\"") != 0 || trace.size() < 4 || trace.compare(trace.size() - 4, 4, "\n]}\n") != 0)
+	{
+		printf("error: %zu events in %s, %zu expected\n", eventsCount, traceFilename, expected);
+		return 1;
+	}
+	return 0;
+}
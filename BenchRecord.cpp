@@ -0,0 +1,83 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include "Benchmark.h"
+#include "ParallelRecord.h"
+
+namespace
+{
+	// Stands in for a command list: every draw appends its packets and the
+	// driver-side validation is modeled as a short dependent computation.
+	struct FakeCommandList
+	{
+		std::vector<uint32_t>	packets;
+
+		void Reset() { packets.clear(); }
+
+		void Draw(uint32_t draw, int work)
+		{
+			uint32_t hash = draw * 2654435761u;
+			for (int i = 0; i < work; ++i)
+				hash = (hash ^ (hash >> 15)) * 2246822519u;
+
+			packets.push_back(0xd0);
+			packets.push_back(draw);
+			packets.push_back(hash);
+		}
+	};
+}
+
+// Records the same draw list into 1, 2, 4 and 8 fake command lists on the
+// shared pool and reports the record time per frame and of the slowest list.
+int BenchRecord(int argc, char** argv)
+{
+	int drawsCount = argc > 0 ? atoi(argv[0]) : 20000;
+	int frames = argc > 1 ? atoi(argv[1]) : 200;
+	int work = argc > 2 ? atoi(argv[2]) : 200;
+	if (drawsCount < 1) drawsCount = 1;
+	if (frames < 1) frames = 1;
+	if (work < 0) work = 0;
+
+	const size_t MaxLists = 8;
+	std::vector<FakeCommandList> lists(MaxLists);
+	RecordChunk chunks[MaxLists];
+	ThreadPool& pool = ThreadPool::Shared();
+
+	for (size_t maxLists = 1; maxLists <= MaxLists; maxLists *= 2)
+	{
+		double slowestMs = 0.0;
+		size_t checksum = 0, listsCount = 0;
+
+		BenchTimer timer;
+		for (int frame = 0; frame < frames; ++frame)
+		{
+			listsCount = ParallelRecord(&pool, drawsCount, 64, maxLists, chunks, [&](size_t chunk, size_t begin, size_t end)
+			{
+				FakeCommandList& list = lists[chunk];
+				list.Reset();
+				for (size_t i = begin; i < end; ++i)
+					list.Draw(static_cast<uint32_t>(i), work);
+			});
+
+			double frameSlowest = 0.0;
+			for (size_t i = 0; i < listsCount; ++i)
+			{
+				frameSlowest = std::max(frameSlowest, chunks[i].ms);
+				checksum += lists[i].packets.back();
+			}
+			slowestMs += frameSlowest;
+		}
+		double ms = timer.ElapsedMs();
+
+		char caseName[32];
+		snprintf(caseName, sizeof(caseName), "%zu_lists", listsCount);
+		BenchReport("record", caseName, "ms_per_frame", ms / frames);
+		BenchReport("record", caseName, "slowest_list_ms", slowestMs / frames);
+
+		// Keeps the recording from being optimized out.
+		if (0 == checksum) printf("\n");
+	}
+	return 0;
+}
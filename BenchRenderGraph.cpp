@@ -0,0 +1,200 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+#include "Benchmark.h"
+#include "RenderGraph.h"
+
+namespace
+{
+	struct Use
+	{
+		uint32_t	resource;
+		uint32_t	state;
+		bool		write;
+	};
+
+	// A frame shaped like a deferred renderer with post effects: every pass
+	// writes a new render target or UAV and reads a few earlier ones; every
+	// eighth pass's output is never read. The last pass writes the back buffer.
+	struct Frame
+	{
+		std::vector<std::vector<Use>>	passes;
+		std::vector<uint64_t>			sizes;
+		uint32_t						backBuffer;
+
+		void Declare(RenderGraph& graph) const
+		{
+			graph.Reset();
+			graph.Import("back buffer", ResourceStatePresent, ResourceStatePresent);
+			for (size_t i = 1; i < sizes.size(); ++i)
+				graph.CreateTransient("transient", sizes[i], 64 * 1024);
+			for (const std::vector<Use>& uses : passes)
+			{
+				uint32_t pass = graph.AddPass("pass");
+				for (const Use& use : uses)
+				{
+					if (use.write)
+						graph.Write(pass, use.resource, use.state);
+					else
+						graph.Read(pass, use.resource, use.state);
+				}
+			}
+		}
+	};
+
+	Frame MakeFrame(int passesCount, std::mt19937& rng)
+	{
+		Frame frame;
+		frame.backBuffer = 0;
+		frame.sizes.push_back(0);
+		std::vector<uint32_t> readable;
+		for (int i = 0; i < passesCount; ++i)
+		{
+			std::vector<Use> uses;
+			bool last = i + 1 == passesCount;
+			for (int r = 0; r < 3 && !readable.empty(); ++r)
+			{
+				uint32_t resource = readable[readable.size() - 1 - rng() % std::min<size_t>(readable.size(), 6)];
+				bool duplicate = false;
+				for (const Use& use : uses)
+					duplicate |= use.resource == resource;
+				if (!duplicate)
+					uses.push_back(Use{ resource, 0 == rng() % 3 ? static_cast<uint32_t>(ResourceStateNonPixelShaderResource) : static_cast<uint32_t>(ResourceStatePixelShaderResource), false });
+			}
+
+			if (last)
+				uses.push_back(Use{ frame.backBuffer, ResourceStateRenderTarget, true });
+			else
+			{
+				uint32_t resource = static_cast<uint32_t>(frame.sizes.size());
+				frame.sizes.push_back((1 + rng() % 32) * 1024 * 1024);
+				uses.push_back(Use{ resource, 0 == rng() % 4 ? static_cast<uint32_t>(ResourceStateUnorderedAccess) : static_cast<uint32_t>(ResourceStateRenderTarget), true });
+				if (0 != i % 8)
+					readable.push_back(resource);
+			}
+			frame.passes.push_back(uses);
+		}
+		return frame;
+	}
+
+	// Replays the barriers against the declared uses. Returns the number of
+	// problems: states that do not match, or live transients sharing memory.
+	int Validate(const RenderGraph& graph, const Frame& frame)
+	{
+		int errors = 0;
+		const uint32_t Pending = ~1u;
+		std::vector<uint32_t> states(graph.GetResourcesCount());
+		for (uint32_t i = 0; i < states.size(); ++i)
+			states[i] = graph.IsTransient(i) ? graph.GetFinalState(i) : static_cast<uint32_t>(ResourceStatePresent);
+
+		std::vector<uint32_t> first(states.size(), ~0u), last(states.size(), ~0u);
+		const std::vector<RenderGraph::Step>& steps = graph.GetSteps();
+		for (uint32_t s = 0; s < steps.size(); ++s)
+		{
+			const RenderGraph::Barrier* barriers = graph.GetBarriers(steps[s]);
+			for (uint32_t b = 0; b < steps[s].barriersCount; ++b)
+			{
+				const RenderGraph::Barrier& barrier = barriers[b];
+				if (RenderGraph::BarrierType::Transition != barrier.type)
+					continue;
+				uint32_t& state = states[barrier.resource];
+				if (RenderGraph::BarrierSplit::End == barrier.split)
+					errors += Pending != state;
+				else
+					errors += barrier.before != state;
+				state = RenderGraph::BarrierSplit::Begin == barrier.split ? Pending : barrier.after;
+			}
+
+			if (RenderGraph::NoPass == steps[s].pass)
+				continue;
+			for (const Use& use : frame.passes[steps[s].pass])
+			{
+				uint32_t state = states[use.resource];
+				errors += use.write ? state != use.state : (Pending == state || use.state != (state & use.state));
+				if (~0u == first[use.resource])
+					first[use.resource] = s;
+				last[use.resource] = s;
+			}
+		}
+		errors += ResourceStatePresent != states[frame.backBuffer];
+
+		for (uint32_t a = 0; a < states.size(); ++a)
+		{
+			for (uint32_t b = a + 1; b < states.size(); ++b)
+			{
+				if (!graph.IsTransient(a) || !graph.IsTransient(b) || ~0u == first[a] || ~0u == first[b])
+					continue;
+				bool alive = first[a] <= last[b] && first[b] <= last[a];
+				bool shared = graph.GetHeapOffset(a) < graph.GetHeapOffset(b) + frame.sizes[b] && graph.GetHeapOffset(b) < graph.GetHeapOffset(a) + frame.sizes[a];
+				errors += alive && shared;
+			}
+		}
+		return errors;
+	}
+}
+
+// Declares and compiles a frame of passes over transient targets, as the
+// viewer does every frame, and reports how much culling, barrier merging and
+// aliasing the compile found.
+int BenchRenderGraph(int argc, char** argv)
+{
+	int passesCount = argc > 0 ? atoi(argv[0]) : 64;
+	int iterations = argc > 1 ? atoi(argv[1]) : 1000;
+	if (passesCount < 1) passesCount = 1;
+	if (iterations < 1) iterations = 1;
+
+	std::mt19937 rng(1234);
+	Frame frame = MakeFrame(passesCount, rng);
+
+	RenderGraph graph;
+	BenchTimer timer;
+	for (int i = 0; i < iterations; ++i)
+	{
+		frame.Declare(graph);
+		if (!graph.Compile())
+		{
+			printf("error: the graph does not compile\n");
+			return 1;
+		}
+	}
+	double compileUs = timer.ElapsedMs() * 1000.0 / iterations;
+
+	uint32_t culled = 0;
+	for (uint32_t i = 0; i < graph.GetPassesCount(); ++i)
+		culled += graph.IsCulled(i) ? 1 : 0;
+
+	size_t barriersCount = 0, batchesCount = 0, aliasingCount = 0;
+	for (const RenderGraph::Step& step : graph.GetSteps())
+	{
+		barriersCount += step.barriersCount;
+		batchesCount += 0 != step.barriersCount ? 1 : 0;
+		for (uint32_t b = 0; b < step.barriersCount; ++b)
+			aliasingCount += RenderGraph::BarrierType::Aliasing == graph.GetBarriers(step)[b].type ? 1 : 0;
+	}
+
+	uint64_t unaliasedSize = 0;
+	for (uint32_t i = 0; i < graph.GetResourcesCount(); ++i)
+	{
+		if (graph.IsTransient(i) && graph.IsUsed(i))
+			unaliasedSize += frame.sizes[i];
+	}
+
+	int errors = Validate(graph, frame);
+	if (0 != errors)
+		printf("error: %d barrier or aliasing problems\n", errors);
+
+	char caseName[32];
+	snprintf(caseName, sizeof(caseName), "%d_passes", passesCount);
+	BenchReport("rendergraph", caseName, "compile_us", compileUs);
+	BenchReport("rendergraph", caseName, "culled_passes", culled);
+	BenchReport("rendergraph", caseName, "barriers", static_cast<double>(barriersCount));
+	BenchReport("rendergraph", caseName, "barrier_batches", static_cast<double>(batchesCount));
+	BenchReport("rendergraph", caseName, "split_barriers", graph.GetSplitBarriersCount());
+	BenchReport("rendergraph", caseName, "aliasing_barriers", static_cast<double>(aliasingCount));
+	BenchReport("rendergraph", caseName, "heap_MB", graph.GetHeapSize() / (1024.0 * 1024.0));
+	BenchReport("rendergraph", caseName, "unaliased_MB", unaliasedSize / (1024.0 * 1024.0));
+	return 0;
+}
@@ -0,0 +1,235 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <random>
+#include <vector>
+
+#include "Benchmark.h"
+#include "ResidencyManager.h"
+
+namespace
+{
+	struct TraceRequest
+	{
+		uint32_t	texture;
+		uint32_t	mip;
+		uint32_t	priority;
+	};
+
+	// Texture sizes, then every frame's requests.
+	struct Trace
+	{
+		std::vector<uint32_t>					sizes;
+		std::vector<std::vector<TraceRequest>>	frames;
+	};
+
+	uint32_t GetMipsCount(uint32_t size)
+	{
+		uint32_t count = 1;
+		while (size > 1)
+			size /= 2, ++count;
+		return count;
+	}
+
+	// BC7, a byte per texel, 16 bytes for the smallest blocks.
+	std::vector<uint64_t> GetMipSizes(uint32_t size)
+	{
+		std::vector<uint64_t> sizes;
+		for (uint32_t mip = 0; mip < GetMipsCount(size); ++mip)
+		{
+			uint64_t blocks = (std::max(size >> mip, 1u) + 3) / 4;
+			sizes.push_back(blocks * blocks * 16);
+		}
+		return sizes;
+	}
+
+	// A camera circling through a field of textured objects, a 1080 pixel
+	// high view with a 90 degree field of view. Every visible object requests
+	// the mip its size on screen needs; one in sixteen is a priority object.
+	Trace RecordWalk(int texturesCount, int objectsCount, int framesCount)
+	{
+		std::mt19937 rng(1234);
+		Trace trace;
+		for (int i = 0; i < texturesCount; ++i)
+			trace.sizes.push_back(256u << rng() % 5);
+
+		struct Object
+		{
+			float		x, z, radius;
+			uint32_t	texture;
+			uint32_t	priority;
+		};
+		std::vector<Object> objects;
+		std::uniform_real_distribution<float> position(-500.0f, 500.0f), radius(1.0f, 6.0f);
+		for (int i = 0; i < objectsCount; ++i)
+			objects.push_back(Object{ position(rng), position(rng), radius(rng), static_cast<uint32_t>(rng() % texturesCount), 0 == rng() % 16 ? 1u : 0u });
+
+		const float PixelsPerUnit = 540.0f;
+		const float ViewDistance = 250.0f;
+		for (int frame = 0; frame < framesCount; ++frame)
+		{
+			float angle = frame * 0.002f;
+			float cameraX = std::cos(angle) * 300.0f, cameraZ = std::sin(angle) * 300.0f;
+			// Looking along the circle.
+			float forwardX = -std::sin(angle), forwardZ = std::cos(angle);
+
+			std::vector<TraceRequest> requests;
+			for (const Object& object : objects)
+			{
+				float dx = object.x - cameraX, dz = object.z - cameraZ;
+				float depth = dx * forwardX + dz * forwardZ;
+				float side = std::fabs(dx * forwardZ - dz * forwardX);
+				if (depth + object.radius < 0.5f || depth > ViewDistance || side > depth + object.radius * 1.5f)
+					continue;
+				float screenSize = 2.0f * object.radius * PixelsPerUnit / std::max(depth, 0.5f);
+				uint32_t size = trace.sizes[object.texture];
+				requests.push_back(TraceRequest{ object.texture, ResidencyManager::SelectMip(size, size, GetMipsCount(size), screenSize), object.priority });
+			}
+			trace.frames.push_back(requests);
+		}
+		return trace;
+	}
+
+	bool SaveTrace(const char* filename, const Trace& trace)
+	{
+		FILE* fp = fopen(filename, "w");
+		if (nullptr == fp)
+			return false;
+		fprintf(fp, "textures %zu\n", trace.sizes.size());
+		for (uint32_t size : trace.sizes)
+			fprintf(fp, "%u\n", size);
+		for (const std::vector<TraceRequest>& requests : trace.frames)
+		{
+			fprintf(fp, "frame %zu\n", requests.size());
+			for (const TraceRequest& request : requests)
+				fprintf(fp, "%u %u %u\n", request.texture, request.mip, request.priority);
+		}
+		return 0 == fclose(fp);
+	}
+
+	bool LoadTrace(const char* filename, Trace& trace)
+	{
+		FILE* fp = fopen(filename, "r");
+		if (nullptr == fp)
+			return false;
+
+		bool ok = true;
+		size_t count = 0;
+		ok = 1 == fscanf(fp, "textures %zu", &count);
+		for (size_t i = 0; ok && i < count; ++i)
+		{
+			uint32_t size = 0;
+			ok = 1 == fscanf(fp, "%u", &size) && size > 0;
+			trace.sizes.push_back(size);
+		}
+		while (ok && 1 == fscanf(fp, " frame %zu", &count))
+		{
+			std::vector<TraceRequest> requests(count);
+			for (TraceRequest& request : requests)
+				ok = ok && 3 == fscanf(fp, "%u %u %u", &request.texture, &request.mip, &request.priority) && request.texture < trace.sizes.size();
+			trace.frames.push_back(requests);
+		}
+		fclose(fp);
+		return ok && !trace.frames.empty();
+	}
+}
+
+// Replays a recorded trace of texture requests through the residency
+// manager, with loads that take a few frames to land. Given a trace file
+// that does not exist yet, records a walkthrough into it first.
+int BenchResidency(int argc, char** argv)
+{
+	int budgetMB = argc > 0 ? atoi(argv[0]) : 256;
+	int framesCount = argc > 1 ? atoi(argv[1]) : 2000;
+	const char* traceFilename = argc > 2 ? argv[2] : nullptr;
+	if (budgetMB < 1) budgetMB = 1;
+	if (framesCount < 1) framesCount = 1;
+
+	Trace trace;
+	if (nullptr == traceFilename || !LoadTrace(traceFilename, trace))
+	{
+		trace = RecordWalk(512, 4000, framesCount);
+		if (nullptr != traceFilename && !SaveTrace(traceFilename, trace))
+			printf("error: cannot write %s\n", traceFilename);
+	}
+
+	const uint64_t budget = static_cast<uint64_t>(budgetMB) * 1024 * 1024;
+	const int LoadLatencyFrames = 3;
+	ResidencyManager residency(budget, 16);
+
+	uint64_t fullSize = 0;
+	std::vector<std::vector<uint64_t>> mipSizes;
+	for (uint32_t size : trace.sizes)
+	{
+		mipSizes.push_back(GetMipSizes(size));
+		// Everything 64 KB and under, a tile, stays resident.
+		uint32_t tailMips = 0;
+		while (tailMips < mipSizes.back().size() && mipSizes.back()[mipSizes.back().size() - 1 - tailMips] <= 64 * 1024)
+			++tailMips;
+		residency.AddTexture(mipSizes.back().data(), static_cast<uint32_t>(mipSizes.back().size()), tailMips);
+		for (uint64_t mipSize : mipSizes.back())
+			fullSize += mipSize;
+	}
+
+	struct Pending
+	{
+		size_t		frame;
+		uint32_t	texture;
+		uint32_t	mip;
+	};
+	std::deque<Pending> pending;
+	size_t requestsCount = 0;
+	double updateMs = 0.0;
+	for (size_t frame = 0; frame < trace.frames.size(); ++frame)
+	{
+		while (!pending.empty() && pending.front().frame <= frame)
+		{
+			residency.OnLoaded(pending.front().texture, pending.front().mip);
+			pending.pop_front();
+		}
+
+		residency.BeginFrame();
+		for (const TraceRequest& request : trace.frames[frame])
+			residency.Request(request.texture, request.mip, request.priority);
+		requestsCount += trace.frames[frame].size();
+
+		BenchTimer timer;
+		const std::vector<ResidencyManager::Action>& actions = residency.Update();
+		updateMs += timer.ElapsedMs();
+		for (const ResidencyManager::Action& action : actions)
+		{
+			if (ResidencyManager::ActionType::Load == action.type)
+				pending.push_back(Pending{ frame + LoadLatencyFrames, action.texture, action.mip });
+		}
+	}
+
+	// The manager's byte count against the chains it says are resident.
+	uint64_t residentBytes = 0;
+	for (uint32_t i = 0; i < mipSizes.size(); ++i)
+	{
+		for (uint32_t mip = residency.GetResidentMip(i); mip < mipSizes[i].size(); ++mip)
+			residentBytes += mipSizes[i][mip];
+	}
+	const ResidencyManager::Stats& stats = residency.GetStats();
+	if (residentBytes != stats.residentBytes)
+		printf("error: %llu bytes resident, %llu counted\n", static_cast<unsigned long long>(residentBytes), static_cast<unsigned long long>(stats.residentBytes));
+
+	char caseName[64];
+	snprintf(caseName, sizeof(caseName), "%zu_textures_%d_MB", trace.sizes.size(), budgetMB);
+	const double MB = 1024.0 * 1024.0;
+	BenchReport("residency", caseName, "frames", static_cast<double>(trace.frames.size()));
+	BenchReport("residency", caseName, "requests_per_frame", static_cast<double>(requestsCount) / trace.frames.size());
+	BenchReport("residency", caseName, "hit_rate", static_cast<double>(stats.hits) / std::max<uint64_t>(stats.hits + stats.misses, 1));
+	BenchReport("residency", caseName, "misses", static_cast<double>(stats.misses));
+	BenchReport("residency", caseName, "loads", static_cast<double>(stats.loads));
+	BenchReport("residency", caseName, "evictions", static_cast<double>(stats.evictions));
+	BenchReport("residency", caseName, "deferred_loads", static_cast<double>(stats.deferredLoads));
+	BenchReport("residency", caseName, "streamed_MB", stats.loadedBytes / MB);
+	BenchReport("residency", caseName, "evicted_MB", stats.evictedBytes / MB);
+	BenchReport("residency", caseName, "peak_MB", stats.peakBytes / MB);
+	BenchReport("residency", caseName, "all_resident_MB", fullSize / MB);
+	BenchReport("residency", caseName, "update_us", updateMs * 1000.0 / trace.frames.size());
+	return residentBytes != stats.residentBytes ? 1 : 0;
+}
@@ -0,0 +1,79 @@
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+#include "AssetStreamer.h"
+#include "Benchmark.h"
+
+namespace
+{
+	// Stands in for reading and decoding one asset.
+	bool FakeLoad(int loadMs)
+	{
+		std::this_thread::sleep_for(std::chrono::milliseconds(loadMs));
+		return true;
+	}
+}
+
+// Loads the same set of fake assets blocking, as InitAssets used to, and
+// through the streamer while a render loop keeps presenting frames. A
+// quarter of the assets are critical and every eighth of the others is
+// cancelled.
+int BenchStreaming(int argc, char** argv)
+{
+	int assetsCount = argc > 0 ? atoi(argv[0]) : 64;
+	int loadMs = argc > 1 ? atoi(argv[1]) : 5;
+	int threadsCount = argc > 2 ? atoi(argv[2]) : 2;
+	if (assetsCount < 1) assetsCount = 1;
+	if (loadMs < 0) loadMs = 0;
+	if (threadsCount < 1) threadsCount = 1;
+
+	{
+		BenchTimer timer;
+		for (int i = 0; i < assetsCount; ++i)
+			FakeLoad(loadMs);
+		double ms = timer.ElapsedMs();
+		BenchReport("streaming", "blocking", "first_frame_ms", ms);
+		BenchReport("streaming", "blocking", "fully_loaded_ms", ms);
+	}
+
+	AssetStreamer streamer(threadsCount);
+	std::vector<AssetHandle> handles;
+	int criticalCount = 0, criticalDone = 0, cancelled = 0;
+	double criticalMs = 0.0;
+
+	BenchTimer timer;
+	for (int i = 0; i < assetsCount; ++i)
+	{
+		// Requested least urgent first, so ordering is down to the priorities.
+		AssetPriority priority = i >= assetsCount * 3 / 4 ? AssetPriority::Critical : i % 2 ? AssetPriority::Normal : AssetPriority::Low;
+		bool critical = AssetPriority::Critical == priority;
+		criticalCount += critical;
+
+		handles.push_back(streamer.Request(priority,
+			[loadMs]() { return FakeLoad(loadMs); },
+			[&, critical](bool) { if (critical && ++criticalDone == criticalCount) criticalMs = timer.ElapsedMs(); }));
+	}
+
+	for (int i = 0; i < assetsCount - criticalCount; i += 8)
+		cancelled += handles[i]->Cancel();
+
+	BenchReport("streaming", "streamed", "first_frame_ms", timer.ElapsedMs());
+
+	int frames = 0;
+	while (!streamer.IsIdle())
+	{
+		// A frame that only pumps completions, about 1 ms long.
+		streamer.Pump(4);
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		frames++;
+	}
+
+	BenchReport("streaming", "streamed", "critical_loaded_ms", criticalMs);
+	BenchReport("streaming", "streamed", "fully_loaded_ms", timer.ElapsedMs());
+	BenchReport("streaming", "streamed", "frames_while_loading", frames);
+	BenchReport("streaming", "streamed", "cancelled", cancelled);
+	return 0;
+}
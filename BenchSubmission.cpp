@@ -0,0 +1,276 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Benchmark.h"
+#include "Hash.h"
+#include "NullRenderDevice.h"
+#include "RenderGraph.h"
+#include "SceneRenderer.h"
+
+namespace
+{
+	// The viewer's camera: 20 units back from the grid's center, a 90 degree
+	// field of view, 0.5 to 60 depth, 1280x720.
+	const float CameraDistance = 20.0f;
+	const float NearZ = 0.5f;
+	const float FarZ = 60.0f;
+	const float ViewportWidth = 1280.0f;
+	const float ViewportHeight = 720.0f;
+
+	// View times projection, row-major for row vectors as XMMATRIX: a
+	// translation by CameraDistance, then the left-handed perspective.
+	void ViewProjection(float* m)
+	{
+		const float scaleY = 1.0f / std::tan(3.14159265f / 4.0f);
+		const float range = FarZ / (FarZ - NearZ);
+		const float rows[4][4] = {
+			{ scaleY * ViewportHeight / ViewportWidth, 0.0f, 0.0f, 0.0f },
+			{ 0.0f, scaleY, 0.0f, 0.0f },
+			{ 0.0f, 0.0f, range, 1.0f },
+			{ 0.0f, 0.0f, CameraDistance * range - NearZ * range, CameraDistance },
+		};
+		for (int i = 0; i < 16; ++i)
+			m[i] = rows[i / 4][i % 4];
+	}
+
+	// A unit cube with four LODs of one submesh, a quarter of the indices each.
+	struct SyntheticMesh
+	{
+		float						lodErrors[4];
+		std::vector<Mesh::IndexRange>	indexRanges;
+
+		SyntheticMesh() : lodErrors{ 0.0f, 0.01f, 0.04f, 0.16f }
+		{
+			size_t byteOffset = 0;
+			for (uint32_t lod = 0; lod < 4; ++lod)
+			{
+				Mesh::IndexRange range = { byteOffset, 3072u >> (2 * lod), 0, 2 };
+				indexRanges.push_back(range);
+				byteOffset += range.indexCount * range.indexSize;
+			}
+		}
+
+		SceneMesh GetSceneMesh() const
+		{
+			SceneMesh mesh = {};
+			mesh.box = { { -0.5f, -0.5f, -0.5f }, { 0.5f, 0.5f, 0.5f } };
+			mesh.radius = std::sqrt(0.75f);
+			mesh.lodErrors = lodErrors;
+			mesh.lodsCount = 4;
+			mesh.submeshesCount = 1;
+			mesh.indexRanges = indexRanges.data();
+			mesh.indexBufferAddress = 0x100000000ull;
+			return mesh;
+		}
+	};
+
+	struct Result
+	{
+		double		frameUs;
+		double		updateUs;
+		double		packUs;
+		double		recordUs;
+		double		graphUs;
+		size_t		visibleCount;
+		size_t		instancesCount;
+		size_t		drawsCount;
+		size_t		listsCount;
+		uint64_t	hash;
+		bool		valid;
+	};
+
+	// The viewer's frame without a GPU: update, pack the instances, then run
+	// a frame graph shaped like the viewer's, whose scene pass records the
+	// draws into the null device.
+	Result RunFrames(size_t objectsCount, uint32_t materialsCount, ThreadPool* pool, int frames)
+	{
+		SyntheticMesh syntheticMesh;
+		SceneRenderer scene;
+		// The viewer's four tints and spacing.
+		scene.Init(objectsCount, materialsCount, 4, 2.0f);
+		scene.SetMesh(syntheticMesh.GetSceneMesh());
+		float m[16];
+		ViewProjection(m);
+		scene.SetFrustum(Frustum::FromViewProjection(m));
+		scene.GetLodSelector().SetProjection(m[5], ViewportHeight);
+		scene.GetLodSelector().SetCameraPosition(0.0f, 0.0f, -CameraDistance);
+
+		std::vector<InstanceData> instances(objectsCount);
+		const uint64_t instancesAddress = 0x200000000ull;
+		NullRenderDevice device;
+		RenderGraph graph;
+		RenderCommandList* lists[SceneRenderer::MaxLists] = {};
+		size_t listsCount = 0;
+
+		Result result = {};
+		result.hash = HashSeed;
+		result.valid = true;
+		// The first frame builds the culling tree, the others refit it.
+		for (int frame = -1; frame < frames; ++frame)
+		{
+			BenchTimer frameTimer;
+			device.BeginFrame();
+
+			BenchTimer timer;
+			scene.Update(frame / 60.0f, pool);
+			const double updateMs = timer.ElapsedMs();
+
+			timer.Reset();
+			scene.Pack(instances.data(), instancesAddress);
+			const double packMs = timer.ElapsedMs();
+
+			timer.Reset();
+			graph.Reset();
+			uint32_t backBuffer = graph.Import("back buffer", ResourceStatePresent, ResourceStatePresent);
+			uint32_t depth = graph.CreateTransient("depth", 1280 * 720 * 4, 64 * 1024);
+			uint32_t texture = graph.Import("wood", ResourceStatePixelShaderResource);
+			uint32_t clearPass = graph.AddPass("clear");
+			graph.Write(clearPass, backBuffer, ResourceStateRenderTarget);
+			graph.Write(clearPass, depth, ResourceStateDepthWrite);
+			uint32_t scenePass = graph.AddPass("scene", [&]()
+			{
+				listsCount = scene.Record(device, pool, lists);
+			});
+			graph.Write(scenePass, backBuffer, ResourceStateRenderTarget);
+			graph.Write(scenePass, depth, ResourceStateDepthWrite);
+			graph.Read(scenePass, texture, ResourceStatePixelShaderResource);
+			listsCount = 0;
+			result.valid = graph.Compile() && result.valid;
+			for (const RenderGraph::Step& step : graph.GetSteps())
+				graph.Execute(step);
+			const double graphMs = timer.ElapsedMs() - scene.GetStats().recordMs;
+			const double frameMs = frameTimer.ElapsedMs();
+
+			// Every draw in a closed list, whatever the split.
+			const SceneRenderer::Stats& stats = scene.GetStats();
+			size_t drawsCount = 0;
+			for (size_t i = 0; i < listsCount; ++i)
+			{
+				const NullRenderDevice::CommandList* list = static_cast<const NullRenderDevice::CommandList*>(lists[i]);
+				result.valid = nullptr != list && list->IsClosed() && result.valid;
+				if (nullptr != list)
+					drawsCount += list->GetDrawsCount();
+			}
+			result.valid = drawsCount == stats.drawsCount && result.valid;
+
+			if (frame < 0)
+				continue;
+			result.frameUs += frameMs * 1000.0;
+			result.updateUs += updateMs * 1000.0;
+			result.packUs += packMs * 1000.0;
+			result.recordUs += stats.recordMs * 1000.0;
+			result.graphUs += graphMs * 1000.0;
+			result.visibleCount += stats.visibleCount;
+			result.instancesCount += stats.instancesCount;
+			result.drawsCount += stats.drawsCount;
+			result.listsCount += stats.listsCount;
+			const uint64_t frameHash = NullRenderDevice::Hash(lists, listsCount);
+			result.hash = HashBytes(&frameHash, sizeof(frameHash), result.hash);
+		}
+		return result;
+	}
+
+	// cpu_frame_us of every case in a file of this benchmark's output.
+	bool LoadBaseline(const char* filename, std::map<std::string, double>& frameUs)
+	{
+		FILE* fp = fopen(filename, "r");
+		if (nullptr == fp)
+			return false;
+
+		char line[256];
+		while (nullptr != fgets(line, sizeof(line), fp))
+		{
+			char caseName[128], metric[64];
+			double value = 0.0;
+			if (3 == sscanf(line, "submission,%127[^,],%63[^,],%lf", caseName, metric, &value) && std::string(metric) == "cpu_frame_us")
+				frameUs[caseName] = value;
+		}
+		fclose(fp);
+		return true;
+	}
+}
+
+// Runs the viewer's CPU frame headless, through the null device, over 1 to
+// max objects by tens, 1, 8 and 64 materials, and 1 to every hardware
+// thread. The recorded commands must not depend on the threads count. Given
+// the output of an earlier run, fails when a case's frame got slower than
+// tolerance percent.
+int BenchSubmission(int argc, char** argv)
+{
+	int frames = argc > 0 ? atoi(argv[0]) : 30;
+	long maxObjects = argc > 1 ? atol(argv[1]) : 1000000;
+	const char* baselineFilename = argc > 2 ? argv[2] : nullptr;
+	double tolerance = argc > 3 ? atof(argv[3]) : 10.0;
+	if (frames < 1) frames = 1;
+	if (maxObjects < 1) maxObjects = 1;
+	if (tolerance < 0.0) tolerance = 0.0;
+
+	std::map<std::string, double> baseline;
+	if (nullptr != baselineFilename && !LoadBaseline(baselineFilename, baseline))
+	{
+		printf("error: cannot read %s\n", baselineFilename);
+		return 1;
+	}
+
+	std::vector<size_t> threadCounts;
+	const size_t hardwareThreads = std::max(std::thread::hardware_concurrency(), 1u);
+	for (size_t threads = 1; threads < hardwareThreads; threads *= 2)
+		threadCounts.push_back(threads);
+	threadCounts.push_back(hardwareThreads);
+
+	const uint32_t materialCounts[] = { 1, 8, 64 };
+	int failures = 0;
+	for (size_t objectsCount = 1; objectsCount <= static_cast<size_t>(maxObjects); objectsCount *= 10)
+	{
+		for (uint32_t materialsCount : materialCounts)
+		{
+			uint64_t expectedHash = 0;
+			for (size_t threads : threadCounts)
+			{
+				std::unique_ptr<ThreadPool> pool(threads > 1 ? new ThreadPool(threads - 1) : nullptr);
+				Result result = RunFrames(objectsCount, materialsCount, pool.get(), frames);
+
+				char caseName[64];
+				snprintf(caseName, sizeof(caseName), "%zu_objects_%u_materials_%zu_threads", objectsCount, materialsCount, threads);
+				BenchReport("submission", caseName, "cpu_frame_us", result.frameUs / frames);
+				BenchReport("submission", caseName, "update_us", result.updateUs / frames);
+				BenchReport("submission", caseName, "pack_us", result.packUs / frames);
+				BenchReport("submission", caseName, "record_us", result.recordUs / frames);
+				BenchReport("submission", caseName, "graph_us", result.graphUs / frames);
+				BenchReport("submission", caseName, "visible", static_cast<double>(result.visibleCount) / frames);
+				BenchReport("submission", caseName, "instances", static_cast<double>(result.instancesCount) / frames);
+				BenchReport("submission", caseName, "draws", static_cast<double>(result.drawsCount) / frames);
+				BenchReport("submission", caseName, "lists", static_cast<double>(result.listsCount) / frames);
+				BenchReport("submission", caseName, "commands_hash", static_cast<double>(result.hash & 0xffffffff));
+
+				if (!result.valid)
+				{
+					printf("error: %s recorded a draw outside a closed list\n", caseName);
+					++failures;
+				}
+				if (threads == threadCounts.front())
+					expectedHash = result.hash;
+				else if (result.hash != expectedHash)
+				{
+					printf("error: %s recorded other commands than with %zu threads\n", caseName, threadCounts.front());
+					++failures;
+				}
+
+				auto base = baseline.find(caseName);
+				if (base != baseline.end() && result.frameUs / frames > base->second * (1.0 + tolerance / 100.0))
+				{
+					printf("error: %s takes %.1f us, %.1f us in the baseline\n", caseName, result.frameUs / frames, base->second);
+					++failures;
+				}
+			}
+		}
+	}
+	return 0 != failures ? 1 : 0;
+}
@@ -0,0 +1,210 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "Benchmark.h"
+#include "MappedFile.h"
+#include "Texture.h"
+#include "TextureCompression.h"
+#include "ThreadPool.h"
+
+namespace
+{
+	// Rings around an off-center point with some grain, as a binary PPM so
+	// DecodeImage takes it anywhere.
+	std::vector<uint8_t> MakeWoodPpm(uint32_t size)
+	{
+		char header[64];
+		int headerSize = snprintf(header, sizeof(header), "P6\n%u %u\n255\n", size, size);
+		std::vector<uint8_t> ppm(header, header + headerSize);
+		ppm.resize(headerSize + static_cast<size_t>(size) * size * 3);
+
+		uint32_t seed = 1234;
+		uint8_t* texels = ppm.data() + headerSize;
+		for (uint32_t y = 0; y < size; ++y)
+		{
+			for (uint32_t x = 0; x < size; ++x)
+			{
+				seed = seed * 1664525u + 1013904223u;
+				float dx = x - size * 0.3f, dy = (y - size * 0.6f) * 0.25f;
+				float ring = 0.5f + 0.5f * std::sin(std::sqrt(dx * dx + dy * dy) * 0.15f);
+				float grain = (seed >> 24) / 255.0f * 0.15f;
+				float value = 0.55f + 0.35f * ring + grain;
+				texels[0] = static_cast<uint8_t>(std::min(value * 200.0f, 255.0f));
+				texels[1] = static_cast<uint8_t>(std::min(value * 140.0f, 255.0f));
+				texels[2] = static_cast<uint8_t>(std::min(value * 80.0f, 255.0f));
+				texels += 3;
+			}
+		}
+		return ppm;
+	}
+
+	// Of the top mip against the source, over RGB.
+	double Psnr(const CookedTexture& texture, const Image& image)
+	{
+		const TextureCacheMip& mip = texture.GetMip(0);
+		const uint8_t* data = texture.GetMipData(0);
+		const uint32_t blockSize = GetBlockSize(texture.GetFormat());
+		double error = 0.0;
+		uint8_t texels[64];
+		for (uint32_t by = 0; by < mip.rowsCount; ++by)
+		{
+			for (uint32_t bx = 0; bx < mip.rowSize / blockSize; ++bx)
+			{
+				DecodeBlock(texture.GetFormat(), data + by * mip.rowPitch + bx * blockSize, texels);
+				for (uint32_t i = 0; i < 16; ++i)
+				{
+					const uint8_t* source = &image.texels[((by * 4 + i / 4) * image.width + bx * 4 + i % 4) * 4];
+					for (int c = 0; c < 3; ++c)
+						error += (texels[i * 4 + c] - source[c]) * (texels[i * 4 + c] - source[c]);
+				}
+			}
+		}
+		double mse = error / (3.0 * image.width * image.height);
+		return mse > 0.0 ? 10.0 * std::log10(255.0 * 255.0 / mse) : 99.0;
+	}
+}
+
+// Cooks an image to every block format, then compares what loading costs at
+// run time: decoding the source and padding its rows for the upload buffer,
+// as the WIC path does, against mapping the cooked file and one copy per mip.
+// Without a source a generated 1024x1024 PPM stands in; off Windows only PPM
+// decodes.
+int BenchTextures(int argc, char** argv)
+{
+	int iterations = argc > 0 ? atoi(argv[0]) : 10;
+	int threadsCount = argc > 1 ? atoi(argv[1]) : 0;
+	const char* source = argc > 2 ? argv[2] : nullptr;
+	if (iterations < 1) iterations = 1;
+	if (threadsCount < 0) threadsCount = 0;
+
+	std::vector<uint8_t> encoded;
+	if (nullptr != source)
+	{
+		MappedFile file;
+		if (!file.Open(source))
+		{
+			printf("error: cannot read %s\n", source);
+			return 1;
+		}
+		const uint8_t* data = static_cast<const uint8_t*>(file.GetData());
+		encoded.assign(data, data + file.GetSize());
+	}
+	else
+		encoded = MakeWoodPpm(1024);
+
+	Image image;
+	if (!DecodeImage(encoded.data(), encoded.size(), image))
+	{
+		printf("error: cannot decode %s\n", nullptr != source ? source : "the generated image");
+		return 1;
+	}
+
+	ThreadPool pool(threadsCount);
+	char caseName[64];
+	snprintf(caseName, sizeof(caseName), "%ux%u_%zu_threads", image.width, image.height, pool.GetThreadsCount() + 1);
+	const double megaTexels = image.width * image.height / 1e6;
+
+	{
+		std::vector<Image> mips;
+		BenchTimer timer;
+		for (int i = 0; i < iterations; ++i)
+			GenerateMips(image, true, pool, mips);
+		BenchReport("textures", caseName, "mips_ms", timer.ElapsedMs() / iterations);
+	}
+
+	// The old path: decode, then copy row by row into the pitched upload layout.
+	std::vector<uint8_t> staging;
+	{
+		const uint32_t rowSize = image.width * 4;
+		const uint32_t rowPitch = (rowSize + TextureCachePitchAlignment - 1) & ~(TextureCachePitchAlignment - 1);
+		staging.resize(static_cast<size_t>(rowPitch) * image.height);
+		BenchTimer timer;
+		for (int i = 0; i < iterations; ++i)
+		{
+			Image decoded;
+			DecodeImage(encoded.data(), encoded.size(), decoded);
+			for (uint32_t row = 0; row < decoded.height; ++row)
+				memcpy(&staging[static_cast<size_t>(row) * rowPitch], &decoded.texels[static_cast<size_t>(row) * rowSize], rowSize);
+		}
+		BenchReport("textures", caseName, "decode_load_ms", timer.ElapsedMs() / iterations);
+		BenchReport("textures", caseName, "decode_upload_KB", staging.size() / 1024.0);
+	}
+
+	const struct
+	{
+		const char*		name;
+		TextureFormat	format;
+	} formats[] =
+	{
+		{ "rgba8", TextureFormatRGBA8 },
+		{ "bc1", TextureFormatBC1 },
+		{ "bc3", TextureFormatBC3 },
+		{ "bc7", TextureFormatBC7 },
+	};
+
+	int errors = 0;
+	for (const auto& format : formats)
+	{
+		std::vector<uint8_t> cooked;
+		BenchTimer timer;
+		if (!CookTexture(image, format.format, true, 0, pool, cooked))
+		{
+			printf("error: cannot cook to %s\n", format.name);
+			return 1;
+		}
+		double cookMs = timer.ElapsedMs();
+
+		const std::string filename = std::string("bench_texture_") + format.name + ".tex";
+		FILE* fp = fopen(filename.c_str(), "wb");
+		bool written = nullptr != fp && fwrite(cooked.data(), 1, cooked.size(), fp) == cooked.size();
+		if (nullptr != fp)
+			fclose(fp);
+		if (!written)
+		{
+			printf("error: cannot write %s\n", filename.c_str());
+			return 1;
+		}
+
+		// What LoadTexture and OnTextureLoaded do with a cooked file.
+		size_t checksum = 0;
+		timer.Reset();
+		for (int i = 0; i < iterations; ++i)
+		{
+			MappedFile file;
+			CookedTexture texture;
+			if (!file.Open(filename.c_str()) || !texture.Open(file.GetData(), file.GetSize()))
+			{
+				++errors;
+				break;
+			}
+			staging.resize(static_cast<size_t>(file.GetSize()));
+			for (uint32_t mip = 0; mip < texture.GetMipsCount(); ++mip)
+				memcpy(&staging[static_cast<size_t>(texture.GetMip(mip).offset)], texture.GetMipData(mip), static_cast<size_t>(texture.GetMip(mip).size));
+			checksum += staging[staging.size() / 2];
+		}
+		double loadMs = timer.ElapsedMs() / iterations;
+
+		CookedTexture texture;
+		errors += !texture.Open(cooked.data(), cooked.size());
+		char formatCase[96];
+		snprintf(formatCase, sizeof(formatCase), "%s_%s", caseName, format.name);
+		BenchReport("textures", formatCase, "cook_ms", cookMs);
+		BenchReport("textures", formatCase, "cook_mtexels_per_s", megaTexels / (cookMs / 1000.0));
+		BenchReport("textures", formatCase, "cooked_load_ms", loadMs);
+		BenchReport("textures", formatCase, "upload_KB", cooked.size() / 1024.0);
+		BenchReport("textures", formatCase, "mips", texture.GetMipsCount());
+		if (TextureFormatRGBA8 != format.format)
+			BenchReport("textures", formatCase, "psnr_db", Psnr(texture, image));
+		if (0 == checksum) printf("\n");
+		remove(filename.c_str());
+	}
+
+	if (0 != errors)
+		printf("error: %d cooked textures do not load\n", errors);
+	return 0 != errors ? 1 : 0;
+}
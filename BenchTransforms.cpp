@@ -0,0 +1,195 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+#include "Benchmark.h"
+#include "ThreadPool.h"
+#include "TransformSystem.h"
+
+namespace
+{
+	// Row-major 4x4 for row vectors, as XMMATRIX.
+	struct Matrix
+	{
+		float	m[4][4];
+	};
+
+	Matrix Multiply(const Matrix& a, const Matrix& b)
+	{
+		Matrix result;
+		for (int r = 0; r < 4; ++r)
+		{
+			for (int c = 0; c < 4; ++c)
+				result.m[r][c] = a.m[r][0] * b.m[0][c] + a.m[r][1] * b.m[1][c] + a.m[r][2] * b.m[2][c] + a.m[r][3] * b.m[3][c];
+		}
+		return result;
+	}
+
+	// General 4x4 inverse by cofactors, the work XMMatrixInverse does.
+	Matrix Inverse(const Matrix& a)
+	{
+		const float* m = &a.m[0][0];
+		float inv[16];
+		inv[0] = m[5] * m[10] * m[15] - m[5] * m[11] * m[14] - m[9] * m[6] * m[15] + m[9] * m[7] * m[14] + m[13] * m[6] * m[11] - m[13] * m[7] * m[10];
+		inv[4] = -m[4] * m[10] * m[15] + m[4] * m[11] * m[14] + m[8] * m[6] * m[15] - m[8] * m[7] * m[14] - m[12] * m[6] * m[11] + m[12] * m[7] * m[10];
+		inv[8] = m[4] * m[9] * m[15] - m[4] * m[11] * m[13] - m[8] * m[5] * m[15] + m[8] * m[7] * m[13] + m[12] * m[5] * m[11] - m[12] * m[7] * m[9];
+		inv[12] = -m[4] * m[9] * m[14] + m[4] * m[10] * m[13] + m[8] * m[5] * m[14] - m[8] * m[6] * m[13] - m[12] * m[5] * m[10] + m[12] * m[6] * m[9];
+		inv[1] = -m[1] * m[10] * m[15] + m[1] * m[11] * m[14] + m[9] * m[2] * m[15] - m[9] * m[3] * m[14] - m[13] * m[2] * m[11] + m[13] * m[3] * m[10];
+		inv[5] = m[0] * m[10] * m[15] - m[0] * m[11] * m[14] - m[8] * m[2] * m[15] + m[8] * m[3] * m[14] + m[12] * m[2] * m[11] - m[12] * m[3] * m[10];
+		inv[9] = -m[0] * m[9] * m[15] + m[0] * m[11] * m[13] + m[8] * m[1] * m[15] - m[8] * m[3] * m[13] - m[12] * m[1] * m[11] + m[12] * m[3] * m[9];
+		inv[13] = m[0] * m[9] * m[14] - m[0] * m[10] * m[13] - m[8] * m[1] * m[14] + m[8] * m[2] * m[13] + m[12] * m[1] * m[10] - m[12] * m[2] * m[9];
+		inv[2] = m[1] * m[6] * m[15] - m[1] * m[7] * m[14] - m[5] * m[2] * m[15] + m[5] * m[3] * m[14] + m[13] * m[2] * m[7] - m[13] * m[3] * m[6];
+		inv[6] = -m[0] * m[6] * m[15] + m[0] * m[7] * m[14] + m[4] * m[2] * m[15] - m[4] * m[3] * m[14] - m[12] * m[2] * m[7] + m[12] * m[3] * m[6];
+		inv[10] = m[0] * m[5] * m[15] - m[0] * m[7] * m[13] - m[4] * m[1] * m[15] + m[4] * m[3] * m[13] + m[12] * m[1] * m[7] - m[12] * m[3] * m[5];
+		inv[14] = -m[0] * m[5] * m[14] + m[0] * m[6] * m[13] + m[4] * m[1] * m[14] - m[4] * m[2] * m[13] - m[12] * m[1] * m[6] + m[12] * m[2] * m[5];
+		inv[3] = -m[1] * m[6] * m[11] + m[1] * m[7] * m[10] + m[5] * m[2] * m[11] - m[5] * m[3] * m[10] - m[9] * m[2] * m[7] + m[9] * m[3] * m[6];
+		inv[7] = m[0] * m[6] * m[11] - m[0] * m[7] * m[10] - m[4] * m[2] * m[11] + m[4] * m[3] * m[10] + m[8] * m[2] * m[7] - m[8] * m[3] * m[6];
+		inv[11] = -m[0] * m[5] * m[11] + m[0] * m[7] * m[9] + m[4] * m[1] * m[11] - m[4] * m[3] * m[9] - m[8] * m[1] * m[7] + m[8] * m[3] * m[5];
+		inv[15] = m[0] * m[5] * m[10] - m[0] * m[6] * m[9] - m[4] * m[1] * m[10] + m[4] * m[2] * m[9] + m[8] * m[1] * m[6] - m[8] * m[2] * m[5];
+
+		float det = m[0] * inv[0] + m[1] * inv[4] + m[2] * inv[8] + m[3] * inv[12];
+		Matrix result;
+		for (int i = 0; i < 16; ++i)
+			(&result.m[0][0])[i] = inv[i] / det;
+		return result;
+	}
+
+	Matrix RotationYTranslation(float angle, float x, float y, float z)
+	{
+		float c = std::cos(angle), s = std::sin(angle);
+		Matrix result = { {
+			{ c, 0.0f, -s, 0.0f },
+			{ 0.0f, 1.0f, 0.0f, 0.0f },
+			{ s, 0.0f, c, 0.0f },
+			{ x, y, z, 1.0f },
+		} };
+		return result;
+	}
+
+	struct Node
+	{
+		uint32_t	parent;
+		float		position[3];
+		float		phase;
+	};
+}
+
+// Animates a hierarchy of transforms, each spinning about Y under its
+// parent, two ways: the viewer's old per-object code (4x4 matrices, a full
+// 4x4 inverse per object) and TransformSystem, single threaded and on the
+// shared pool. Also times a frame where only 1% of the leaves move.
+int BenchTransforms(int argc, char** argv)
+{
+	int count = argc > 0 ? atoi(argv[0]) : 1000000;
+	int frames = argc > 1 ? atoi(argv[1]) : 20;
+	int levelsCount = argc > 2 ? atoi(argv[2]) : 2;
+	if (count < 1) count = 1;
+	if (frames < 1) frames = 1;
+	if (levelsCount < 1) levelsCount = 1;
+
+	// Level l holds the nodes [l * count / levels, (l + 1) * count / levels),
+	// each with a random parent in the level above.
+	std::mt19937 rng(1234);
+	std::uniform_real_distribution<float> position(-10.0f, 10.0f);
+	std::vector<Node> nodes(count);
+	for (int i = 0; i < count; ++i)
+	{
+		int64_t level = static_cast<int64_t>(i) * levelsCount / count;
+		Node& node = nodes[i];
+		if (0 == level)
+			node.parent = TransformSystem::NoParent;
+		else
+		{
+			uint32_t first = static_cast<uint32_t>((level - 1) * count / levelsCount);
+			uint32_t last = static_cast<uint32_t>(level * count / levelsCount);
+			node.parent = first + rng() % (last - first);
+		}
+		node.position[0] = position(rng);
+		node.position[1] = position(rng);
+		node.position[2] = position(rng);
+		node.phase = position(rng);
+	}
+
+	std::vector<Matrix> worlds(count), worldsIT(count);
+	double perObjectMs = 0.0;
+	for (int frame = 0; frame < frames; ++frame)
+	{
+		float time = frame * 0.016f;
+		BenchTimer timer;
+		for (int i = 0; i < count; ++i)
+		{
+			const Node& node = nodes[i];
+			Matrix world = RotationYTranslation(time + node.phase, node.position[0], node.position[1], node.position[2]);
+			if (TransformSystem::NoParent != node.parent)
+				world = Multiply(world, worlds[node.parent]);
+			worlds[i] = world;
+			worldsIT[i] = Inverse(world);
+		}
+		perObjectMs += timer.ElapsedMs();
+	}
+
+	TransformSystem transforms;
+	for (int i = 0; i < count; ++i)
+	{
+		uint32_t handle = transforms.Add(nodes[i].parent);
+		transforms.SetTranslation(handle, nodes[i].position[0], nodes[i].position[1], nodes[i].position[2]);
+	}
+
+	ThreadPool& pool = ThreadPool::Shared();
+	double systemMs[2] = {};
+	for (int threaded = 0; threaded < 2; ++threaded)
+	{
+		for (int frame = 0; frame < frames; ++frame)
+		{
+			float time = frame * 0.016f;
+			BenchTimer timer;
+			for (int i = 0; i < count; ++i)
+			{
+				float half = (time + nodes[i].phase) * 0.5f;
+				transforms.SetRotation(i, 0.0f, std::sin(half), 0.0f, std::cos(half));
+			}
+			transforms.Update(threaded ? &pool : nullptr);
+			systemMs[threaded] += timer.ElapsedMs();
+		}
+	}
+
+	// Both ran the same last frame; compare the world and normal matrices.
+	double maxError = 0.0;
+	for (int i = 0; i < count; ++i)
+	{
+		const WorldTransform& transform = transforms.GetWorld(i);
+		for (int c = 0; c < 3; ++c)
+		{
+			for (int r = 0; r < 4; ++r)
+				maxError = std::max(maxError, static_cast<double>(std::fabs(transform.world[c][r] - worlds[i].m[r][c])));
+			for (int j = 0; j < 3; ++j)
+				maxError = std::max(maxError, static_cast<double>(std::fabs(transform.normal[c][j] - worldsIT[i].m[c][j])));
+		}
+	}
+
+	// Only some leaves move, the rest is skipped by the dirty flags.
+	double sparseMs = 0.0;
+	const int leavesBegin = static_cast<int>(static_cast<int64_t>(levelsCount - 1) * count / levelsCount);
+	for (int frame = 0; frame < frames; ++frame)
+	{
+		BenchTimer timer;
+		for (int i = leavesBegin + frame % 100; i < count; i += 100)
+			transforms.SetRotation(i, 0.0f, 0.0f, 0.0f, 1.0f);
+		transforms.Update(&pool);
+		sparseMs += timer.ElapsedMs();
+	}
+
+	char caseName[32];
+	snprintf(caseName, sizeof(caseName), "%d_transforms", count);
+	BenchReport("transforms", caseName, "per_object_ms_per_frame", perObjectMs / frames);
+	BenchReport("transforms", caseName, "soa_ms_per_frame", systemMs[0] / frames);
+	BenchReport("transforms", caseName, "soa_pool_ms_per_frame", systemMs[1] / frames);
+	BenchReport("transforms", caseName, "pool_threads", static_cast<double>(pool.GetThreadsCount() + 1));
+	BenchReport("transforms", caseName, "speedup", perObjectMs / systemMs[1]);
+	BenchReport("transforms", caseName, "sparse_1pct_ms_per_frame", sparseMs / frames);
+	BenchReport("transforms", caseName, "max_error", maxError);
+	return 0;
+}
@@ -0,0 +1,111 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "Benchmark.h"
+#include "UploadRing.h"
+
+namespace
+{
+	// Stands in for ID3D12Fence: the GPU finishes frame n once the CPU is
+	// latency frames ahead of it, or sooner when the CPU waits.
+	struct FakeFence
+	{
+		uint64_t	completed = 0;
+
+		void Wait(uint64_t value) { if (completed < value) completed = value; }
+	};
+}
+
+// Streams random sized uploads through an UploadRing for a number of frames
+// with the fence lagging a few frames behind, and reports how often the CPU
+// would have had to wait for the GPU.
+int BenchUpload(int argc, char** argv)
+{
+	int ringMb = argc > 0 ? atoi(argv[0]) : 32;
+	int latency = argc > 1 ? atoi(argv[1]) : 2;
+	int uploadsPerFrame = argc > 2 ? atoi(argv[2]) : 64;
+	int frames = argc > 3 ? atoi(argv[3]) : 2000;
+	if (ringMb < 1) ringMb = 1;
+	if (latency < 0) latency = 0;
+	if (uploadsPerFrame < 1) uploadsPerFrame = 1;
+	if (frames < 1) frames = 1;
+
+	const uint64_t capacity = static_cast<uint64_t>(ringMb) << 20;
+	std::vector<uint8_t> staging(static_cast<size_t>(capacity));
+	std::vector<uint8_t> source(256 * 1024, 0x5a);
+
+	// Mostly constants and small buffers, with the odd texture sized upload.
+	std::uniform_int_distribution<int> kind(0, 99);
+	std::uniform_int_distribution<uint64_t> small(16, 4096);
+	std::uniform_int_distribution<uint64_t> large(64 * 1024, source.size());
+
+	char caseName[64];
+	snprintf(caseName, sizeof(caseName), "ring_%dmb_latency_%d", ringMb, latency);
+
+	// Returns false when one frame's uploads do not fit in the ring at all.
+	auto run = [&](bool copy, uint64_t& stalls, uint64_t& bytes, uint64_t& peakUsed)
+	{
+		UploadRing ring(capacity);
+		FakeFence fence;
+		std::mt19937 rng(1);
+		stalls = bytes = peakUsed = 0;
+
+		for (int frame = 1; frame <= frames; ++frame)
+		{
+			if (frame > latency)
+				fence.Wait(static_cast<uint64_t>(frame - latency));
+			ring.Retire(fence.completed);
+
+			for (int i = 0; i < uploadsPerFrame; ++i)
+			{
+				bool isLarge = kind(rng) < 5;
+				uint64_t size = isLarge ? large(rng) : small(rng);
+				uint64_t alignment = isLarge ? 512 : 256;
+
+				uint64_t offset = ring.Allocate(size, alignment);
+				while (UploadRing::InvalidOffset == offset && 0 != ring.GetOldestFenceValue())
+				{
+					fence.Wait(ring.GetOldestFenceValue());
+					ring.Retire(fence.completed);
+					stalls++;
+					offset = ring.Allocate(size, alignment);
+				}
+				if (UploadRing::InvalidOffset == offset)
+					return false;
+
+				if (copy)
+					memcpy(staging.data() + offset, source.data(), static_cast<size_t>(size));
+				peakUsed = std::max(peakUsed, ring.GetUsedSize());
+				bytes += size;
+			}
+
+			ring.Submit(frame);
+		}
+		return true;
+	};
+
+	uint64_t stalls = 0, bytes = 0, peakUsed = 0;
+	BenchTimer timer;
+	if (!run(false, stalls, bytes, peakUsed))
+	{
+		printf("error: one frame of uploads does not fit in %d MB\n", ringMb);
+		return 1;
+	}
+	double allocateMs = timer.ElapsedMs();
+
+	timer.Reset();
+	run(true, stalls, bytes, peakUsed);
+	double copyMs = timer.ElapsedMs();
+
+	const double allocations = static_cast<double>(frames) * uploadsPerFrame;
+	BenchReport("upload", caseName, "ns_per_allocation", allocateMs * 1e6 / allocations);
+	BenchReport("upload", caseName, "mb_per_s", bytes / (1024.0 * 1024.0) / (copyMs / 1000.0));
+	BenchReport("upload", caseName, "stalls_per_frame", static_cast<double>(stalls) / frames);
+	BenchReport("upload", caseName, "peak_used_mb", peakUsed / (1024.0 * 1024.0));
+	BenchReport("upload", caseName, "mb_per_frame", bytes / (1024.0 * 1024.0) / frames);
+	return 0;
+}
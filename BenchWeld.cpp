@@ -0,0 +1,141 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "Benchmark.h"
+#include "Mesh.h"
+#include "MeshCache.h"
+
+namespace
+{
+	// A cooked mesh in memory: a flat side x side grid of unit quads, each
+	// with its own four vertices, offset along x and y. Welding leaves one
+	// vertex per grid point.
+	class GridCache
+	{
+	public:
+		GridCache(int side, float origin)
+		{
+			std::vector<Mesh::Vector3D> positions, normals, tangents;
+			std::vector<Mesh::Vector2D> uvs;
+			std::vector<unsigned int> indices;
+			for (int y = 0; y < side; ++y)
+			{
+				for (int x = 0; x < side; ++x)
+				{
+					const unsigned int first = static_cast<unsigned int>(positions.size());
+					for (int corner = 0; corner < 4; ++corner)
+					{
+						const float px = static_cast<float>(x + (corner & 1)), py = static_cast<float>(y + (corner >> 1));
+						positions.push_back(Mesh::Vector3D{ origin + px, origin + py, 0.0f });
+						normals.push_back(Mesh::Vector3D{ 0.0f, 0.0f, 1.0f });
+						tangents.push_back(Mesh::Vector3D{ 1.0f, 0.0f, 0.0f });
+						// Only the positions tell the grid points apart.
+						uvs.push_back(Mesh::Vector2D{ 0.0f, 0.0f });
+					}
+					const unsigned int quad[6] = { 0, 1, 2, 2, 1, 3 };
+					for (unsigned int index : quad)
+						indices.push_back(first + index);
+				}
+			}
+			Mesh::Submesh submesh = { 0, static_cast<uint32_t>(indices.size()), 0, 0 };
+			float lodError = 0.0f;
+
+			MeshCacheHeader header = {};
+			header.magic = MeshCacheMagic;
+			header.version = MeshCacheVersion;
+			header.numVertices = positions.size();
+			header.numIndices = indices.size();
+			header.numSubmeshes = 1;
+			header.numLods = 1;
+
+			uint64_t offset = sizeof(MeshCacheHeader);
+			auto place = [&](MeshCacheBlob& blob, uint64_t size)
+			{
+				offset = (offset + MeshCacheAlignment - 1) & ~(MeshCacheAlignment - 1);
+				blob.offset = offset;
+				blob.size = size;
+				offset += size;
+			};
+			place(header.positions, positions.size() * sizeof(Mesh::Vector3D));
+			place(header.normals, normals.size() * sizeof(Mesh::Vector3D));
+			place(header.tangents, tangents.size() * sizeof(Mesh::Vector3D));
+			place(header.uvs, uvs.size() * sizeof(Mesh::Vector2D));
+			place(header.indices, indices.size() * sizeof(unsigned int));
+			place(header.submeshes, sizeof(submesh));
+			place(header.lodErrors, sizeof(lodError));
+			place(header.meshlets, 0);
+			place(header.meshletVertices, 0);
+			place(header.meshletTriangles, 0);
+			place(header.meshletBounds, 0);
+			header.fileSize = offset;
+
+			// Blobs are used in place, so the data starts on the alignment.
+			storage.resize(static_cast<size_t>(offset + MeshCacheAlignment));
+			data = storage.data() + (MeshCacheAlignment - reinterpret_cast<uintptr_t>(storage.data()) % MeshCacheAlignment) % MeshCacheAlignment;
+			size = static_cast<size_t>(offset);
+			memcpy(data, &header, sizeof(header));
+			memcpy(data + header.positions.offset, positions.data(), header.positions.size);
+			memcpy(data + header.normals.offset, normals.data(), header.normals.size);
+			memcpy(data + header.tangents.offset, tangents.data(), header.tangents.size);
+			memcpy(data + header.uvs.offset, uvs.data(), header.uvs.size);
+			memcpy(data + header.indices.offset, indices.data(), header.indices.size);
+			memcpy(data + header.submeshes.offset, &submesh, sizeof(submesh));
+			memcpy(data + header.lodErrors.offset, &lodError, sizeof(lodError));
+		}
+
+		const void* GetData() const { return data; }
+		size_t GetSize() const { return size; }
+
+	private:
+		std::vector<uint8_t>	storage;
+		uint8_t*				data;
+		size_t					size;
+	};
+}
+
+// Welds the same grid of unit quads near the origin and far from it, where
+// the coordinates over the weld epsilon no longer fit 32 bits. Every
+// placement must weld to one vertex per grid point.
+int BenchWeld(int argc, char** argv)
+{
+	int side = argc > 0 ? atoi(argv[0]) : 256;
+	int iterations = argc > 1 ? atoi(argv[1]) : 10;
+	if (side < 1) side = 1;
+	if (iterations < 1) iterations = 1;
+
+	const size_t expected = static_cast<size_t>(side + 1) * (side + 1);
+	const float offsets[] = { 0.0f, 3000.0f, -100000.0f, 10000000.0f };
+	int failures = 0;
+	for (float offset : offsets)
+	{
+		GridCache cache(side, offset);
+		Mesh::WeldStats stats = {};
+		double ms = 0.0;
+		for (int i = 0; i < iterations; ++i)
+		{
+			Mesh mesh;
+			if (!mesh.LoadFromMemory(cache.GetData(), cache.GetSize(), 0))
+			{
+				printf("error: cannot load the grid at %g\n", offset);
+				return 1;
+			}
+			BenchTimer timer;
+			mesh.Weld(1e-6f, &stats);
+			ms += timer.ElapsedMs();
+		}
+
+		char caseName[64];
+		snprintf(caseName, sizeof(caseName), "%dx%d_at_%g", side, side, offset);
+		BenchReport("weld", caseName, "vertices_before", static_cast<double>(stats.verticesBefore));
+		BenchReport("weld", caseName, "vertices_after", static_cast<double>(stats.verticesAfter));
+		BenchReport("weld", caseName, "weld_ms", ms / iterations);
+		if (stats.verticesAfter != expected)
+		{
+			printf("error: %s welds to %zu vertices, %zu expected\n", caseName, stats.verticesAfter, expected);
+			++failures;
+		}
+	}
+	return 0 != failures ? 1 : 0;
+}
@@ -0,0 +1,63 @@
+#include <cstdio>
+#include <cstring>
+
+#include "Benchmark.h"
+
+namespace
+{
+	struct Entry
+	{
+		const char*	name;
+		const char*	usage;
+		int			(*run)(int argc, char** argv);
+	};
+
+	const Entry g_Benchmarks[] =
+	{
+		{ "mesh_load", "<source> [iterations]", BenchMeshLoad },
+		{ "interleave", "[millions of vertices...]", BenchInterleave },
+		{ "lod", "<source> [instances] [frames]", BenchLod },
+		{ "meshlet", "<source> [frames]", BenchMeshlet },
+		{ "streaming", "[assets] [load ms] [threads]", BenchStreaming },
+		{ "archive", "[-n<iterations>] <file>...", BenchArchive },
+		{ "upload", "[ring MB] [frames of latency] [uploads per frame] [frames]", BenchUpload },
+		{ "constants", "[objects] [frames] [frames in flight]", BenchConstants },
+		{ "frames", "[cpu ms] [gpu ms] [latency ms] [frames]", BenchFrames },
+		{ "record", "[draws] [frames] [work per draw]", BenchRecord },
+		{ "descriptors", "[tables per frame] [descriptors per table] [frames]", BenchDescriptors },
+		{ "heap", "[heap MB] [operations] [max allocation KB]", BenchHeap },
+		{ "instances", "[instances] [batches] [frames]", BenchInstances },
+		{ "transforms", "[transforms] [frames] [levels]", BenchTransforms },
+		{ "culling", "[objects...]", BenchCulling },
+		{ "rendergraph", "[passes] [iterations]", BenchRenderGraph },
+		{ "pipelines", "[shaders] [compile ms] [threads]", BenchPipelines },
+		{ "textures", "[iterations] [threads] [source]", BenchTextures },
+		{ "residency", "[budget MB] [frames] [trace]", BenchResidency },
+		{ "profiler", "[iterations] [threads] [trace]", BenchProfiler },
+		{ "submission", "[frames] [max objects] [baseline csv] [tolerance %]", BenchSubmission },
+		{ "weld", "[grid side] [iterations]", BenchWeld },
+	};
+}
+
+void BenchReport(const char * benchmark, const char * caseName, const char * metric, double value)
+{
+	printf("%s,%s,%s,%.6f\n", benchmark, caseName, metric, value);
+	fflush(stdout);
+}
+
+int main(int argc, char** argv)
+{
+	if (argc >= 2)
+	{
+		for (const Entry& bench : g_Benchmarks)
+		{
+			if (0 == strcmp(argv[1], bench.name))
+				return bench.run(argc - 2, argv + 2);
+		}
+	}
+
+	printf("usage: Benchmark <name> [args]\nbenchmarks:\n");
+	for (const Entry& bench : g_Benchmarks)
+		printf("  %s %s\n", bench.name, bench.usage);
+	return 1;
+}
@@ -0,0 +1,44 @@
+#pragma once
+#include <chrono>
+
+class BenchTimer
+{
+public:
+	BenchTimer() { Reset(); }
+
+	void Reset() { start = std::chrono::high_resolution_clock::now(); }
+
+	double ElapsedMs() const
+	{
+		return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+	}
+
+private:
+	std::chrono::high_resolution_clock::time_point start;
+};
+
+// Prints one "benchmark,case,metric,value" line so runs can be diffed or graphed.
+void BenchReport(const char* benchmark, const char* caseName, const char* metric, double value);
+
+int BenchMeshLoad(int argc, char** argv);
+int BenchInterleave(int argc, char** argv);
+int BenchLod(int argc, char** argv);
+int BenchMeshlet(int argc, char** argv);
+int BenchStreaming(int argc, char** argv);
+int BenchArchive(int argc, char** argv);
+int BenchUpload(int argc, char** argv);
+int BenchConstants(int argc, char** argv);
+int BenchFrames(int argc, char** argv);
+int BenchRecord(int argc, char** argv);
+int BenchDescriptors(int argc, char** argv);
+int BenchHeap(int argc, char** argv);
+int BenchInstances(int argc, char** argv);
+int BenchTransforms(int argc, char** argv);
+int BenchCulling(int argc, char** argv);
+int BenchRenderGraph(int argc, char** argv);
+int BenchPipelines(int argc, char** argv);
+int BenchTextures(int argc, char** argv);
+int BenchResidency(int argc, char** argv);
+int BenchProfiler(int argc, char** argv);
+int BenchSubmission(int argc, char** argv);
+int BenchWeld(int argc, char** argv);
@@ -0,0 +1,77 @@
+#include "CommandListPool.h"
+
+void CommandListPool::Init(ID3D12Device * device, unsigned int framesInFlight)
+{
+	Release();
+
+	this->device = device;
+	slots.resize(framesInFlight > 0 ? framesInFlight : 1);
+	slot = 0;
+}
+
+void CommandListPool::Release()
+{
+	for (Slot& s : slots)
+	{
+		for (Entry& entry : s.entries)
+		{
+			entry.list->Release();
+			entry.allocator->Release();
+		}
+	}
+	slots.clear();
+	device = nullptr;
+}
+
+void CommandListPool::BeginFrame(unsigned int slot)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	this->slot = slot;
+	slots[slot].usedCount = 0;
+}
+
+ID3D12GraphicsCommandList * CommandListPool::Acquire(ID3D12PipelineState * initialState)
+{
+	Entry entry = {};
+	bool reused = false;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		Slot& current = slots[slot];
+		if (current.usedCount < current.entries.size())
+		{
+			entry = current.entries[current.usedCount++];
+			reused = true;
+		}
+	}
+
+	if (reused)
+	{
+		// The slot's fence has completed, so the allocator is free to reset.
+		if (FAILED(entry.allocator->Reset()) || FAILED(entry.list->Reset(entry.allocator, initialState)))
+			return nullptr;
+		return entry.list;
+	}
+
+	if (FAILED(device->CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_DIRECT, IID_PPV_ARGS(&entry.allocator))))
+		return nullptr;
+	if (FAILED(device->CreateCommandList(0, D3D12_COMMAND_LIST_TYPE_DIRECT, entry.allocator, initialState, IID_PPV_ARGS(&entry.list))))
+	{
+		entry.allocator->Release();
+		return nullptr;
+	}
+
+	std::lock_guard<std::mutex> lock(mutex);
+	Slot& current = slots[slot];
+	current.entries.push_back(entry);
+	current.usedCount = current.entries.size();
+	return entry.list;
+}
+
+size_t CommandListPool::GetListsCount() const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	size_t count = 0;
+	for (const Slot& s : slots)
+		count += s.entries.size();
+	return count;
+}
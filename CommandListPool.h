@@ -0,0 +1,50 @@
+#pragma once
+#include <d3d12.h>
+
+#include <mutex>
+#include <vector>
+
+// Direct command lists and allocators, recycled per frame slot. Every list
+// handed out during a frame has its own allocator, so lists can be recorded
+// on different threads. A slot's allocators are reset when the slot comes
+// around again, which the caller does only after its fence has completed.
+class CommandListPool
+{
+public:
+	CommandListPool() : device(nullptr), slot(0) {}
+	~CommandListPool() { Release(); }
+
+	CommandListPool(const CommandListPool&) = delete;
+	CommandListPool& operator=(const CommandListPool&) = delete;
+
+	void Init(ID3D12Device* device, unsigned int framesInFlight);
+	void Release();
+
+	// Makes the lists used in slot the last time it was current available again.
+	void BeginFrame(unsigned int slot);
+
+	// Thread safe. Returns a list open for recording, or nullptr if creating
+	// a new one failed. It goes back to the pool on the next BeginFrame of
+	// this slot.
+	ID3D12GraphicsCommandList* Acquire(ID3D12PipelineState* initialState = nullptr);
+
+	size_t GetListsCount() const;
+
+private:
+	struct Entry
+	{
+		ID3D12CommandAllocator*		allocator;
+		ID3D12GraphicsCommandList*	list;
+	};
+
+	struct Slot
+	{
+		std::vector<Entry>	entries;
+		size_t				usedCount = 0;
+	};
+
+	ID3D12Device*		device;
+	std::vector<Slot>	slots;
+	unsigned int		slot;
+	mutable std::mutex	mutex;
+};
@@ -0,0 +1,190 @@
+#include "Compression.h"
+
+#include <cstring>
+
+namespace
+{
+	constexpr size_t MinMatch = 4;
+	// The format leaves the last bytes of a block as literals.
+	constexpr size_t LastLiterals = 5;
+	constexpr size_t MatchSearchLimit = 12;
+	constexpr size_t MaxOffset = 65535;
+	constexpr unsigned int HashBits = 12;
+
+	uint32_t Read32(const uint8_t* p)
+	{
+		uint32_t value;
+		memcpy(&value, p, sizeof(value));
+		return value;
+	}
+
+	uint32_t Hash(uint32_t sequence)
+	{
+		return (sequence * 2654435761u) >> (32 - HashBits);
+	}
+
+	// Lengths of 15 and more continue in extra bytes of up to 255 each.
+	bool WriteLength(uint8_t*& op, const uint8_t* end, size_t length)
+	{
+		for (; length >= 255; length -= 255)
+		{
+			if (op >= end) return false;
+			*op++ = 255;
+		}
+		if (op >= end) return false;
+		*op++ = static_cast<uint8_t>(length);
+		return true;
+	}
+
+	bool ReadLength(const uint8_t*& ip, const uint8_t* end, size_t& length)
+	{
+		uint8_t byte;
+		do
+		{
+			if (ip >= end) return false;
+			byte = *ip++;
+			length += byte;
+		} while (255 == byte);
+		return true;
+	}
+
+	bool WriteSequence(uint8_t*& op, const uint8_t* end, const uint8_t* literals, size_t literalLength, size_t offset, size_t matchLength)
+	{
+		if (op >= end) return false;
+		uint8_t* token = op++;
+
+		*token = static_cast<uint8_t>((literalLength < 15 ? literalLength : 15) << 4);
+		if (literalLength >= 15 && !WriteLength(op, end, literalLength - 15))
+			return false;
+
+		if (static_cast<size_t>(end - op) < literalLength)
+			return false;
+		memcpy(op, literals, literalLength);
+		op += literalLength;
+
+		// The last sequence has no match.
+		if (0 == matchLength)
+			return true;
+
+		if (end - op < 2) return false;
+		*op++ = static_cast<uint8_t>(offset);
+		*op++ = static_cast<uint8_t>(offset >> 8);
+
+		size_t extra = matchLength - MinMatch;
+		*token |= static_cast<uint8_t>(extra < 15 ? extra : 15);
+		return extra < 15 || WriteLength(op, end, extra - 15);
+	}
+}
+
+size_t CompressBound(size_t size)
+{
+	return size + size / 255 + 16;
+}
+
+size_t CompressBlock(const void * src, size_t size, void * dest, size_t capacity)
+{
+	const uint8_t* base = static_cast<const uint8_t*>(src);
+	uint8_t* op = static_cast<uint8_t*>(dest);
+	const uint8_t* end = op + capacity;
+
+	// Positions + 1, so zero is an empty slot.
+	uint32_t table[1 << HashBits] = {};
+
+	size_t ip = 0, anchor = 0;
+	if (size > MatchSearchLimit)
+	{
+		const size_t matchLimit = size - LastLiterals;
+		const size_t searchLimit = size - MatchSearchLimit;
+		size_t misses = 0;
+
+		while (ip < searchLimit)
+		{
+			uint32_t sequence = Read32(base + ip);
+			uint32_t& slot = table[Hash(sequence)];
+			size_t candidate = slot;
+			slot = static_cast<uint32_t>(ip + 1);
+
+			if (0 == candidate || ip - (candidate - 1) > MaxOffset || Read32(base + candidate - 1) != sequence)
+			{
+				// Skip ahead faster through data that does not compress.
+				ip += 1 + (misses++ >> 6);
+				continue;
+			}
+			misses = 0;
+
+			size_t match = candidate - 1;
+			size_t length = MinMatch;
+			while (ip + length < matchLimit && base[match + length] == base[ip + length])
+				length++;
+
+			if (!WriteSequence(op, end, base + anchor, ip - anchor, ip - match, length))
+				return 0;
+
+			ip += length;
+			anchor = ip;
+			if (ip >= 2 && ip < searchLimit)
+				table[Hash(Read32(base + ip - 2))] = static_cast<uint32_t>(ip - 2 + 1);
+		}
+	}
+
+	if (!WriteSequence(op, end, base + anchor, size - anchor, 0, 0))
+		return 0;
+
+	return op - static_cast<uint8_t*>(dest);
+}
+
+bool DecompressBlock(const void * src, size_t srcSize, void * dest, size_t destSize)
+{
+	const uint8_t* ip = static_cast<const uint8_t*>(src);
+	const uint8_t* ipEnd = ip + srcSize;
+	uint8_t* const start = static_cast<uint8_t*>(dest);
+	uint8_t* op = start;
+	uint8_t* const opEnd = op + destSize;
+
+	while (ip < ipEnd)
+	{
+		uint8_t token = *ip++;
+
+		size_t literalLength = token >> 4;
+		if (15 == literalLength && !ReadLength(ip, ipEnd, literalLength))
+			return false;
+		if (static_cast<size_t>(ipEnd - ip) < literalLength || static_cast<size_t>(opEnd - op) < literalLength)
+			return false;
+		memcpy(op, ip, literalLength);
+		ip += literalLength;
+		op += literalLength;
+
+		// Only the last sequence ends right after its literals.
+		if (ip == ipEnd)
+			break;
+
+		if (ipEnd - ip < 2)
+			return false;
+		size_t offset = ip[0] | (ip[1] << 8);
+		ip += 2;
+		if (0 == offset || offset > static_cast<size_t>(op - start))
+			return false;
+
+		size_t matchLength = token & 15;
+		if (15 == matchLength && !ReadLength(ip, ipEnd, matchLength))
+			return false;
+		matchLength += MinMatch;
+		if (static_cast<size_t>(opEnd - op) < matchLength)
+			return false;
+
+		// Overlapping matches repeat the last offset bytes, copy forwards.
+		const uint8_t* match = op - offset;
+		if (offset >= matchLength)
+		{
+			memcpy(op, match, matchLength);
+			op += matchLength;
+		}
+		else
+		{
+			for (size_t i = 0; i < matchLength; ++i)
+				*op++ = match[i];
+		}
+	}
+
+	return op == opEnd;
+}
@@ -0,0 +1,15 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+// LZ4 block format: fast to decode, meant for assets that are read far more
+// often than written. No frame header, the caller keeps both sizes.
+
+// Largest compressed size of size bytes of input.
+size_t CompressBound(size_t size);
+
+// Returns the compressed size, or 0 if it does not fit in capacity.
+size_t CompressBlock(const void* src, size_t size, void* dest, size_t capacity);
+
+// Fails unless the block decodes to exactly destSize bytes.
+bool DecompressBlock(const void* src, size_t srcSize, void* dest, size_t destSize);
@@ -0,0 +1,33 @@
+#include "ConstantAllocator.h"
+
+void ConstantAllocator::Reset(uint64_t regionSize, uint32_t regionsCount)
+{
+	this->regionSize = (regionSize + Alignment - 1) & ~(Alignment - 1);
+	fenceValues.assign(regionsCount > 0 ? regionsCount : 1, 0);
+	// The first BeginFrame moves to region 0.
+	region = static_cast<uint32_t>(fenceValues.size() - 1);
+	head = this->regionSize * fenceValues.size();
+}
+
+bool ConstantAllocator::BeginFrame(uint64_t completedValue)
+{
+	uint32_t next = static_cast<uint32_t>((region + 1) % fenceValues.size());
+	if (fenceValues[next] > completedValue)
+		return false;
+
+	region = next;
+	head = region * regionSize;
+	return true;
+}
+
+uint64_t ConstantAllocator::Allocate(uint64_t size)
+{
+	uint64_t size256 = (size + Alignment - 1) & ~(Alignment - 1);
+	uint64_t end = (region + 1) * regionSize;
+	if (0 == size || head + size256 > end)
+		return InvalidOffset;
+
+	uint64_t offset = head;
+	head += size256;
+	return offset;
+}
@@ -0,0 +1,46 @@
+#pragma once
+#include <stdint.h>
+
+#include <vector>
+
+// Hands out constant buffer slices from one persistently mapped buffer that
+// is split into one region per frame. Each frame bump-allocates from its
+// region, which is reused once the fence value given to its EndFrame has
+// completed. Like UploadRing it only deals in offsets.
+class ConstantAllocator
+{
+public:
+	// D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT.
+	static const uint64_t Alignment = 256;
+	static const uint64_t InvalidOffset = ~0ull;
+
+	ConstantAllocator() { Reset(0, 1); }
+
+	// regionSize is rounded up to Alignment.
+	void Reset(uint64_t regionSize, uint32_t regionsCount);
+
+	uint64_t GetBufferSize() const { return regionSize * fenceValues.size(); }
+
+	// Fence value that must complete before the next BeginFrame, 0 for none.
+	uint64_t GetNextFenceValue() const { return fenceValues[(region + 1) % fenceValues.size()]; }
+
+	// Moves to the next region; false while the GPU may still read it.
+	bool BeginFrame(uint64_t completedValue);
+
+	// Returns the offset of a size byte slice in the current region, or
+	// InvalidOffset once the region is full.
+	uint64_t Allocate(uint64_t size);
+
+	void EndFrame(uint64_t fenceValue) { fenceValues[region] = fenceValue; }
+
+	uint64_t GetFrameUsedSize() const { return head - region * regionSize; }
+
+	template<typename T>
+	uint64_t Allocate() { return Allocate(sizeof(T)); }
+
+private:
+	std::vector<uint64_t>	fenceValues;
+	uint64_t				regionSize;
+	uint32_t				region;
+	uint64_t				head;
+};
@@ -0,0 +1,356 @@
+#include "CullingBvh.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include <xmmintrin.h>
+
+#include "ThreadPool.h"
+
+namespace
+{
+	// Inverted box of empty lanes; finite so plane tests never see inf - inf.
+	const float Huge = 1e30f;
+
+	void Grow(Aabb& box, const Aabb& other)
+	{
+		for (int k = 0; k < 3; ++k)
+		{
+			box.min[k] = std::min(box.min[k], other.min[k]);
+			box.max[k] = std::max(box.max[k], other.max[k]);
+		}
+	}
+
+	const Aabb EmptyBox = { { Huge, Huge, Huge }, { -Huge, -Huge, -Huge } };
+}
+
+Aabb TransformAabb(const Aabb & box, const WorldTransform & transform)
+{
+	float center[3], extent[3];
+	for (int k = 0; k < 3; ++k)
+	{
+		center[k] = (box.min[k] + box.max[k]) * 0.5f;
+		extent[k] = (box.max[k] - box.min[k]) * 0.5f;
+	}
+
+	Aabb result;
+	for (int k = 0; k < 3; ++k)
+	{
+		const float* column = transform.world[k];
+		float c = center[0] * column[0] + center[1] * column[1] + center[2] * column[2] + column[3];
+		float e = extent[0] * std::fabs(column[0]) + extent[1] * std::fabs(column[1]) + extent[2] * std::fabs(column[2]);
+		result.min[k] = c - e;
+		result.max[k] = c + e;
+	}
+	return result;
+}
+
+Frustum Frustum::FromViewProjection(const float * m)
+{
+	// Clip space planes as combinations of the matrix columns.
+	static const float combinations[6][4] = {
+		{ 1.0f, 0.0f, 0.0f, 1.0f },		// left:   w + x
+		{ -1.0f, 0.0f, 0.0f, 1.0f },	// right:  w - x
+		{ 0.0f, 1.0f, 0.0f, 1.0f },		// bottom: w + y
+		{ 0.0f, -1.0f, 0.0f, 1.0f },	// top:    w - y
+		{ 0.0f, 0.0f, 1.0f, 0.0f },		// near:   z
+		{ 0.0f, 0.0f, -1.0f, 1.0f },	// far:    w - z
+	};
+
+	Frustum frustum;
+	for (int p = 0; p < 6; ++p)
+	{
+		for (int i = 0; i < 4; ++i)
+		{
+			frustum.planes[p][i] = 0.0f;
+			for (int c = 0; c < 4; ++c)
+				frustum.planes[p][i] += combinations[p][c] * m[i * 4 + c];
+		}
+
+		float length = std::sqrt(frustum.planes[p][0] * frustum.planes[p][0] + frustum.planes[p][1] * frustum.planes[p][1] + frustum.planes[p][2] * frustum.planes[p][2]);
+		if (length > 0.0f)
+		{
+			for (int i = 0; i < 4; ++i)
+				frustum.planes[p][i] /= length;
+		}
+	}
+	return frustum;
+}
+
+void CullingBvh::Build(const Aabb * bounds, size_t count)
+{
+	nodes.clear();
+	leaves.clear();
+	objects.resize(count);
+	for (size_t i = 0; i < count; ++i)
+		objects[i] = static_cast<uint32_t>(i);
+	if (0 == count)
+		return;
+
+	std::vector<float> centroids(count * 3);
+	for (size_t i = 0; i < count; ++i)
+	{
+		for (int k = 0; k < 3; ++k)
+			centroids[i * 3 + k] = bounds[i].min[k] + bounds[i].max[k];
+	}
+
+	nodes.reserve(count / 3 + 1);
+	BuildNode(bounds, centroids, 0, static_cast<uint32_t>(count));
+}
+
+uint32_t CullingBvh::BuildNode(const Aabb * bounds, const std::vector<float>& centroids, uint32_t first, uint32_t count)
+{
+	uint32_t index = static_cast<uint32_t>(nodes.size());
+	nodes.emplace_back();
+	for (uint32_t lane = 0; lane < Width; ++lane)
+	{
+		SetChildBounds(nodes[index], lane, EmptyBox);
+		nodes[index].children[lane] = NoChild;
+		nodes[index].first[lane] = first;
+		nodes[index].count[lane] = 0;
+	}
+
+	if (count <= Width)
+	{
+		Node& node = nodes[index];
+		node.leaf = true;
+		for (uint32_t lane = 0; lane < count; ++lane)
+		{
+			node.children[lane] = objects[first + lane];
+			node.first[lane] = first + lane;
+			node.count[lane] = 1;
+			SetChildBounds(node, lane, bounds[objects[first + lane]]);
+		}
+		leaves.push_back(index);
+		return index;
+	}
+
+	// Median splits along the longest centroid axis: one in two, then each
+	// half in two again.
+	auto split = [&](uint32_t begin, uint32_t end)
+	{
+		float lo[3] = { Huge, Huge, Huge }, hi[3] = { -Huge, -Huge, -Huge };
+		for (uint32_t i = begin; i < end; ++i)
+		{
+			for (int k = 0; k < 3; ++k)
+			{
+				lo[k] = std::min(lo[k], centroids[objects[i] * 3 + k]);
+				hi[k] = std::max(hi[k], centroids[objects[i] * 3 + k]);
+			}
+		}
+		int axis = 0;
+		if (hi[1] - lo[1] > hi[axis] - lo[axis]) axis = 1;
+		if (hi[2] - lo[2] > hi[axis] - lo[axis]) axis = 2;
+
+		uint32_t middle = begin + (end - begin) / 2;
+		std::nth_element(objects.begin() + begin, objects.begin() + middle, objects.begin() + end,
+			[&](uint32_t a, uint32_t b) { return centroids[a * 3 + axis] < centroids[b * 3 + axis]; });
+		return middle;
+	};
+
+	uint32_t bounds4[Width + 1];
+	bounds4[0] = first;
+	bounds4[2] = split(first, first + count);
+	bounds4[1] = split(first, bounds4[2]);
+	bounds4[3] = split(bounds4[2], first + count);
+	bounds4[4] = first + count;
+
+	nodes[index].leaf = false;
+	for (uint32_t lane = 0; lane < Width; ++lane)
+	{
+		uint32_t childCount = bounds4[lane + 1] - bounds4[lane];
+		if (0 == childCount)
+			continue;
+
+		// The recursion grows nodes, so this node is looked up again afterwards.
+		uint32_t child = BuildNode(bounds, centroids, bounds4[lane], childCount);
+		Aabb childBox = GetNodeBounds(nodes[child]);
+		Node& node = nodes[index];
+		node.children[lane] = child;
+		node.first[lane] = bounds4[lane];
+		node.count[lane] = childCount;
+		SetChildBounds(node, lane, childBox);
+	}
+	return index;
+}
+
+void CullingBvh::SetChildBounds(Node & node, uint32_t lane, const Aabb & box)
+{
+	for (int k = 0; k < 3; ++k)
+	{
+		node.bounds[k][lane] = box.min[k];
+		node.bounds[3 + k][lane] = box.max[k];
+	}
+}
+
+Aabb CullingBvh::GetNodeBounds(const Node & node) const
+{
+	Aabb box = EmptyBox;
+	for (uint32_t lane = 0; lane < Width; ++lane)
+	{
+		if (0 == node.count[lane])
+			continue;
+
+		Aabb child;
+		for (int k = 0; k < 3; ++k)
+		{
+			child.min[k] = node.bounds[k][lane];
+			child.max[k] = node.bounds[3 + k][lane];
+		}
+		Grow(box, child);
+	}
+	return box;
+}
+
+void CullingBvh::Refit(const Aabb * bounds, ThreadPool * pool)
+{
+	const size_t LeavesPerTask = 1024;
+	auto refitLeaves = [&](size_t task)
+	{
+		size_t end = std::min(leaves.size(), (task + 1) * LeavesPerTask);
+		for (size_t i = task * LeavesPerTask; i < end; ++i)
+		{
+			Node& node = nodes[leaves[i]];
+			for (uint32_t lane = 0; lane < Width; ++lane)
+			{
+				if (0 != node.count[lane])
+					SetChildBounds(node, lane, bounds[node.children[lane]]);
+			}
+		}
+	};
+
+	const size_t tasksCount = (leaves.size() + LeavesPerTask - 1) / LeavesPerTask;
+	if (nullptr != pool)
+		pool->ParallelFor(tasksCount, refitLeaves);
+	else
+	{
+		for (size_t t = 0; t < tasksCount; ++t)
+			refitLeaves(t);
+	}
+
+	// Children always come after their parent, so backwards is bottom-up.
+	for (size_t i = nodes.size(); i-- > 0;)
+	{
+		Node& node = nodes[i];
+		if (node.leaf)
+			continue;
+		for (uint32_t lane = 0; lane < Width; ++lane)
+		{
+			if (0 != node.count[lane])
+				SetChildBounds(node, lane, GetNodeBounds(nodes[node.children[lane]]));
+		}
+	}
+}
+
+void CullingBvh::Cull(const Frustum & frustum, ThreadPool * pool, std::vector<uint32_t>& visible) const
+{
+	visible.clear();
+	if (nodes.empty())
+		return;
+
+	// Opens the top of the tree until there are enough subtrees to spread
+	// over the pool, keeping them in tree order.
+	std::vector<Task> tasks(1, Task{ 0, false });
+	const size_t targetTasks = nullptr != pool ? (pool->GetThreadsCount() + 1) * 4 : 1;
+	std::vector<Task> next;
+	while (tasks.size() < targetTasks)
+	{
+		bool opened = false;
+		next.clear();
+		for (const Task& task : tasks)
+		{
+			const Node& node = nodes[task.node];
+			if (node.leaf || task.inside)
+			{
+				next.push_back(task);
+				continue;
+			}
+
+			opened = true;
+			int intersectMask;
+			int outsideMask = TestNode(frustum, node, intersectMask);
+			for (uint32_t lane = 0; lane < Width; ++lane)
+			{
+				if (0 != node.count[lane] && 0 == (outsideMask & (1 << lane)))
+					next.push_back(Task{ node.children[lane], 0 == (intersectMask & (1 << lane)) });
+			}
+		}
+		tasks.swap(next);
+		if (!opened)
+			break;
+	}
+
+	std::vector<std::vector<uint32_t>> results(tasks.size());
+	auto cullTask = [&](size_t i) { CullNode(frustum, tasks[i], results[i]); };
+	if (nullptr != pool)
+		pool->ParallelFor(tasks.size(), cullTask);
+	else
+	{
+		for (size_t i = 0; i < tasks.size(); ++i)
+			cullTask(i);
+	}
+
+	size_t total = 0;
+	for (const std::vector<uint32_t>& result : results)
+		total += result.size();
+	visible.reserve(total);
+	for (const std::vector<uint32_t>& result : results)
+		visible.insert(visible.end(), result.begin(), result.end());
+}
+
+int CullingBvh::TestNode(const Frustum & frustum, const Node & node, int & intersectMask)
+{
+	// Per plane, the box corner furthest along the normal decides whether the
+	// box is outside, the nearest one whether it is fully inside.
+	const __m128 zero = _mm_setzero_ps();
+	__m128 outside = zero, intersect = zero;
+	for (int p = 0; p < 6; ++p)
+	{
+		const float* plane = frustum.planes[p];
+		const __m128 a = _mm_set1_ps(plane[0]), b = _mm_set1_ps(plane[1]), c = _mm_set1_ps(plane[2]), d = _mm_set1_ps(plane[3]);
+		const int px = plane[0] >= 0.0f ? 3 : 0, py = plane[1] >= 0.0f ? 4 : 1, pz = plane[2] >= 0.0f ? 5 : 2;
+		const int nx = 3 - px, ny = 5 - py, nz = 7 - pz;
+
+		__m128 far = _mm_add_ps(
+			_mm_add_ps(_mm_mul_ps(a, _mm_loadu_ps(node.bounds[px])), _mm_mul_ps(b, _mm_loadu_ps(node.bounds[py]))),
+			_mm_add_ps(_mm_mul_ps(c, _mm_loadu_ps(node.bounds[pz])), d));
+		__m128 near = _mm_add_ps(
+			_mm_add_ps(_mm_mul_ps(a, _mm_loadu_ps(node.bounds[nx])), _mm_mul_ps(b, _mm_loadu_ps(node.bounds[ny]))),
+			_mm_add_ps(_mm_mul_ps(c, _mm_loadu_ps(node.bounds[nz])), d));
+		outside = _mm_or_ps(outside, _mm_cmplt_ps(far, zero));
+		intersect = _mm_or_ps(intersect, _mm_cmplt_ps(near, zero));
+	}
+	intersectMask = _mm_movemask_ps(intersect);
+	return _mm_movemask_ps(outside);
+}
+
+void CullingBvh::CullNode(const Frustum & frustum, Task task, std::vector<uint32_t>& visible) const
+{
+	const Node& node = nodes[task.node];
+	if (task.inside)
+	{
+		for (uint32_t lane = 0; lane < Width; ++lane)
+			AddAll(node, lane, visible);
+		return;
+	}
+
+	int intersectMask;
+	int outsideMask = TestNode(frustum, node, intersectMask);
+	for (uint32_t lane = 0; lane < Width; ++lane)
+	{
+		if (0 == node.count[lane] || 0 != (outsideMask & (1 << lane)))
+			continue;
+
+		if (node.leaf)
+			visible.push_back(node.children[lane]);
+		else if (0 == (intersectMask & (1 << lane)))
+			AddAll(node, lane, visible);
+		else
+			CullNode(frustum, Task{ node.children[lane], false }, visible);
+	}
+}
+
+void CullingBvh::AddAll(const Node & node, uint32_t lane, std::vector<uint32_t>& visible) const
+{
+	visible.insert(visible.end(), objects.begin() + node.first[lane], objects.begin() + node.first[lane] + node.count[lane]);
+}
@@ -0,0 +1,86 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+#include <vector>
+
+#include "TransformSystem.h"
+
+class ThreadPool;
+
+struct Aabb
+{
+	float	min[3];
+	float	max[3];
+};
+
+// Box around box transformed by the affine world transform.
+Aabb TransformAabb(const Aabb& box, const WorldTransform& transform);
+
+// Six planes facing inwards, ax + by + cz + d >= 0 inside.
+struct Frustum
+{
+	float	planes[6][4];
+
+	// viewProjection is view times projection, row-major for row vectors as
+	// XMFLOAT4X4 stores it, with D3D's 0 to w depth.
+	static Frustum FromViewProjection(const float* viewProjection);
+};
+
+// Bounding volume hierarchy over object boxes for frustum culling. Nodes
+// have four children whose boxes are kept as structure of arrays, so one
+// SSE pass tests a node's four boxes against a plane. Moving objects are
+// handled by Refit, which keeps the tree and only recomputes its boxes;
+// Build again when objects were added or have moved far.
+class CullingBvh
+{
+public:
+	void Build(const Aabb* bounds, size_t count);
+	// bounds holds the same objects as in Build, with new boxes.
+	void Refit(const Aabb* bounds, ThreadPool* pool);
+
+	// Replaces visible with the indices of the objects whose box touches the
+	// frustum, in tree order. Subtrees are culled in parallel when pool is
+	// not null.
+	void Cull(const Frustum& frustum, ThreadPool* pool, std::vector<uint32_t>& visible) const;
+
+	size_t GetObjectsCount() const { return objects.size(); }
+	size_t GetNodesCount() const { return nodes.size(); }
+
+private:
+	static const uint32_t Width = 4;
+	static const uint32_t NoChild = ~0u;
+
+	struct Node
+	{
+		// Child boxes as minX, minY, minZ, maxX, maxY, maxZ; empty lanes are inverted.
+		float		bounds[6][Width];
+		// A node index, or in a leaf an index into objects.
+		uint32_t	children[Width];
+		// Range of objects under each child, so fully visible subtrees are copied.
+		uint32_t	first[Width];
+		uint32_t	count[Width];
+		bool		leaf;
+	};
+
+	struct Task
+	{
+		uint32_t	node;
+		bool		inside;
+	};
+
+	uint32_t BuildNode(const Aabb* bounds, const std::vector<float>& centroids, uint32_t first, uint32_t count);
+	void SetChildBounds(Node& node, uint32_t lane, const Aabb& box);
+	Aabb GetNodeBounds(const Node& node) const;
+	// Returns the mask of lanes outside the frustum; intersectMask gets the
+	// lanes not fully inside.
+	static int TestNode(const Frustum& frustum, const Node& node, int& intersectMask);
+	void CullNode(const Frustum& frustum, Task task, std::vector<uint32_t>& visible) const;
+	void AddAll(const Node& node, uint32_t lane, std::vector<uint32_t>& visible) const;
+
+	std::vector<Node>		nodes;
+	// Object indices in tree order; each node's children cover consecutive ranges.
+	std::vector<uint32_t>	objects;
+	// Leaf nodes, refitted first.
+	std::vector<uint32_t>	leaves;
+};
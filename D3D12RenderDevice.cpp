@@ -0,0 +1,56 @@
+#include "D3D12RenderDevice.h"
+
+void D3D12RenderDevice::CommandList::SetMaterial(uint32_t material)
+{
+	list->SetGraphicsRootDescriptorTable(device->materialParameter, device->materialTables[material]);
+}
+
+void D3D12RenderDevice::CommandList::SetIndexBuffer(uint64_t address, uint32_t size, uint32_t indexSize)
+{
+	D3D12_INDEX_BUFFER_VIEW view = { address, size, 2 == indexSize ? DXGI_FORMAT_R16_UINT : DXGI_FORMAT_R32_UINT };
+	list->IASetIndexBuffer(&view);
+}
+
+void D3D12RenderDevice::CommandList::SetInstances(uint64_t address)
+{
+	// SV_InstanceID starts at 0 whatever the start instance, so the SRV starts at the batch.
+	list->SetGraphicsRootShaderResourceView(device->instancesParameter, address);
+}
+
+void D3D12RenderDevice::CommandList::DrawIndexedInstanced(uint32_t indexCount, uint32_t instancesCount, uint32_t firstIndex, int32_t baseVertex)
+{
+	list->DrawIndexedInstanced(indexCount, instancesCount, firstIndex, baseVertex, 0);
+}
+
+void D3D12RenderDevice::Init(CommandListPool * pool, UINT materialParameter, UINT instancesParameter)
+{
+	this->pool = pool;
+	this->materialParameter = materialParameter;
+	this->instancesParameter = instancesParameter;
+}
+
+void D3D12RenderDevice::BeginFrame(ID3D12PipelineState * pipeline, std::function<void(ID3D12GraphicsCommandList*)> setup, const D3D12_GPU_DESCRIPTOR_HANDLE * materialTables, uint32_t materialsCount)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	this->pipeline = pipeline;
+	this->setup = std::move(setup);
+	this->materialTables.assign(materialTables, materialTables + materialsCount);
+	usedCount = 0;
+}
+
+RenderCommandList * D3D12RenderDevice::AcquireList()
+{
+	ID3D12GraphicsCommandList* list = pool->Acquire(pipeline);
+	if (nullptr == list)
+		return nullptr;
+	if (setup)
+		setup(list);
+
+	std::lock_guard<std::mutex> lock(mutex);
+	if (usedCount == lists.size())
+		lists.emplace_back(new CommandList());
+	CommandList* commandList = lists[usedCount++].get();
+	commandList->device = this;
+	commandList->list = list;
+	return commandList;
+}
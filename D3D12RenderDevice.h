@@ -0,0 +1,61 @@
+#pragma once
+#include <d3d12.h>
+
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "CommandListPool.h"
+#include "RenderDevice.h"
+
+// RenderDevice over a CommandListPool. Lists come from the pool's current
+// slot with the frame's pipeline and whatever setup BeginFrame was given;
+// materials bind their descriptor table, instances their root SRV.
+class D3D12RenderDevice : public RenderDevice
+{
+public:
+	class CommandList : public RenderCommandList
+	{
+	public:
+		void SetMaterial(uint32_t material) override;
+		void SetIndexBuffer(uint64_t address, uint32_t size, uint32_t indexSize) override;
+		void SetInstances(uint64_t address) override;
+		void DrawIndexedInstanced(uint32_t indexCount, uint32_t instancesCount, uint32_t firstIndex, int32_t baseVertex) override;
+		void Close() override { list->Close(); }
+
+		ID3D12GraphicsCommandList* GetList() const { return list; }
+
+	private:
+		friend class D3D12RenderDevice;
+
+		const D3D12RenderDevice*	device = nullptr;
+		ID3D12GraphicsCommandList*	list = nullptr;
+	};
+
+	D3D12RenderDevice() : pool(nullptr), materialParameter(0), instancesParameter(0), pipeline(nullptr), usedCount(0) {}
+
+	// materialParameter is the root descriptor table materials bind,
+	// instancesParameter the root SRV of the instances.
+	void Init(CommandListPool* pool, UINT materialParameter, UINT instancesParameter);
+
+	// After the pool's BeginFrame. setup runs on every list acquired this
+	// frame; materialTables holds a table per material and must stay valid
+	// until the frame is recorded.
+	void BeginFrame(ID3D12PipelineState* pipeline, std::function<void(ID3D12GraphicsCommandList*)> setup, const D3D12_GPU_DESCRIPTOR_HANDLE* materialTables, uint32_t materialsCount);
+
+	RenderCommandList* AcquireList() override;
+
+	static ID3D12GraphicsCommandList* GetList(RenderCommandList* list) { return static_cast<CommandList*>(list)->GetList(); }
+
+private:
+	CommandListPool*				pool;
+	UINT							materialParameter;
+	UINT							instancesParameter;
+	ID3D12PipelineState*			pipeline;
+	std::function<void(ID3D12GraphicsCommandList*)>	setup;
+	std::vector<D3D12_GPU_DESCRIPTOR_HANDLE>	materialTables;
+	std::vector<std::unique_ptr<CommandList>>	lists;
+	size_t							usedCount;
+	std::mutex						mutex;
+};
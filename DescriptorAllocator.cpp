@@ -0,0 +1,86 @@
+#include "DescriptorAllocator.h"
+
+void DescriptorFreeList::Reset(uint32_t pageSize, uint32_t maxCount)
+{
+	generations.clear();
+	freeSlots.clear();
+	this->pageSize = pageSize > 0 ? pageSize : 1;
+	this->maxCount = maxCount;
+	pagesCount = 0;
+}
+
+DescriptorHandle DescriptorFreeList::Allocate()
+{
+	DescriptorHandle handle;
+
+	if (freeSlots.empty())
+	{
+		uint32_t capacity = GetCapacity();
+		if (capacity >= maxCount)
+			return handle;
+
+		uint32_t grow = maxCount - capacity < pageSize ? maxCount - capacity : pageSize;
+		generations.resize(capacity + grow, 0);
+		// Lowest index on top.
+		for (uint32_t i = grow; i > 0; --i)
+			freeSlots.push_back(capacity + i - 1);
+		pagesCount++;
+	}
+
+	handle.index = freeSlots.back();
+	freeSlots.pop_back();
+	handle.generation = ++generations[handle.index];
+	return handle;
+}
+
+bool DescriptorFreeList::Free(DescriptorHandle handle)
+{
+	if (!IsAlive(handle))
+		return false;
+
+	generations[handle.index]++;
+	freeSlots.push_back(handle.index);
+	return true;
+}
+
+bool DescriptorFreeList::IsAlive(DescriptorHandle handle) const
+{
+	return handle.index < generations.size() && generations[handle.index] == handle.generation && 0 != (handle.generation & 1);
+}
+
+void ShaderVisibleDescriptorAllocator::Reset(uint32_t persistentCount, uint32_t ringCount)
+{
+	this->persistentCount = persistentCount;
+	persistent.Reset(persistentCount, persistentCount);
+	pendingFrees.clear();
+	ring.Reset(ringCount);
+}
+
+void ShaderVisibleDescriptorAllocator::FreePersistent(DescriptorHandle handle, uint64_t lastUseFenceValue)
+{
+	if (!persistent.IsAlive(handle))
+		return;
+
+	PendingFree pending = { lastUseFenceValue, handle };
+	pendingFrees.push_back(pending);
+}
+
+uint32_t ShaderVisibleDescriptorAllocator::AllocateTable(uint32_t count)
+{
+	uint64_t offset = ring.Allocate(count, 1);
+	if (UploadRing::InvalidOffset == offset)
+		return DescriptorHandle::InvalidIndex;
+	return persistentCount + static_cast<uint32_t>(offset);
+}
+
+void ShaderVisibleDescriptorAllocator::Retire(uint64_t completedValue)
+{
+	ring.Retire(completedValue);
+
+	// Fence values only grow, so the queue is in completion order.
+	while (!pendingFrees.empty() && pendingFrees.front().fenceValue <= completedValue)
+	{
+		persistent.Free(pendingFrees.front().handle);
+		pendingFrees.pop_front();
+	}
+}
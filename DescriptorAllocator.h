@@ -0,0 +1,95 @@
+#pragma once
+#include <stdint.h>
+
+#include <deque>
+#include <vector>
+
+#include "UploadRing.h"
+
+// Descriptor bookkeeping that runs without a device. DescriptorHeaps.h maps
+// the indices handed out here onto D3D12 descriptor heaps.
+
+struct DescriptorHandle
+{
+	static const uint32_t InvalidIndex = ~0u;
+
+	uint32_t	index = InvalidIndex;
+	// Odd while the slot is allocated to this handle.
+	uint32_t	generation = 0;
+
+	bool IsValid() const { return InvalidIndex != index; }
+};
+
+// Free list of descriptor slots that grows a page at a time. Every slot has
+// a generation bumped on allocate and on free, so a handle kept after its
+// slot was freed (and maybe handed out again) is detected as stale.
+class DescriptorFreeList
+{
+public:
+	explicit DescriptorFreeList(uint32_t pageSize = 256, uint32_t maxCount = ~0u) { Reset(pageSize, maxCount); }
+
+	void Reset(uint32_t pageSize, uint32_t maxCount);
+
+	// Returns an invalid handle once maxCount slots are in use.
+	DescriptorHandle Allocate();
+	// False for stale handles and double frees.
+	bool Free(DescriptorHandle handle);
+	bool IsAlive(DescriptorHandle handle) const;
+
+	uint32_t GetPageSize() const { return pageSize; }
+	uint32_t GetPagesCount() const { return pagesCount; }
+	uint32_t GetCapacity() const { return static_cast<uint32_t>(generations.size()); }
+	uint32_t GetAllocatedCount() const { return GetCapacity() - static_cast<uint32_t>(freeSlots.size()); }
+
+private:
+	std::vector<uint32_t>	generations;
+	std::vector<uint32_t>	freeSlots;
+	uint32_t				pageSize;
+	uint32_t				pagesCount;
+	uint32_t				maxCount;
+};
+
+// Layout of the shader-visible heap: [0, persistentCount) holds bindless
+// descriptors that live until freed, the rest is a ring of transient tables
+// that are recycled once the fence value of the frame that used them has
+// completed. Persistent slots freed while the GPU may still read them are
+// also held back until then.
+class ShaderVisibleDescriptorAllocator
+{
+public:
+	ShaderVisibleDescriptorAllocator() { Reset(0, 0); }
+
+	void Reset(uint32_t persistentCount, uint32_t ringCount);
+
+	uint32_t GetDescriptorsCount() const { return persistentCount + static_cast<uint32_t>(ring.GetCapacity()); }
+
+	DescriptorHandle AllocatePersistent() { return persistent.Allocate(); }
+	// The slot is reused once lastUseFenceValue has completed.
+	void FreePersistent(DescriptorHandle handle, uint64_t lastUseFenceValue);
+	bool IsPersistentAlive(DescriptorHandle handle) const { return persistent.IsAlive(handle); }
+
+	// Index of count contiguous descriptors valid until the next Submit's
+	// fence value completes, or DescriptorHandle::InvalidIndex when the ring
+	// is full.
+	uint32_t AllocateTable(uint32_t count);
+
+	void Submit(uint64_t fenceValue) { ring.Submit(fenceValue); }
+	void Retire(uint64_t completedValue);
+
+	// Fence value that frees the oldest ring tables, 0 when none is pending.
+	uint64_t GetOldestFenceValue() const { return ring.GetOldestFenceValue(); }
+	uint32_t GetPersistentCount() const { return persistentCount; }
+	uint32_t GetRingUsedCount() const { return static_cast<uint32_t>(ring.GetUsedSize()); }
+
+private:
+	struct PendingFree
+	{
+		uint64_t			fenceValue;
+		DescriptorHandle	handle;
+	};
+
+	DescriptorFreeList		persistent;
+	std::deque<PendingFree>	pendingFrees;
+	UploadRing				ring;
+	uint32_t				persistentCount;
+};
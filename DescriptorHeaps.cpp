@@ -0,0 +1,142 @@
+#include "DescriptorHeaps.h"
+
+void StagingDescriptorHeap::Init(ID3D12Device * device, D3D12_DESCRIPTOR_HEAP_TYPE type, uint32_t pageSize)
+{
+	Release();
+
+	this->device = device;
+	this->type = type;
+	increment = device->GetDescriptorHandleIncrementSize(type);
+	freeList.Reset(pageSize, ~0u);
+}
+
+void StagingDescriptorHeap::Release()
+{
+	for (ID3D12DescriptorHeap* page : pages)
+		page->Release();
+	pages.clear();
+	freeList.Reset(freeList.GetPageSize(), ~0u);
+	device = nullptr;
+}
+
+DescriptorHandle StagingDescriptorHeap::Allocate()
+{
+	DescriptorHandle handle = freeList.Allocate();
+	if (!handle.IsValid())
+		return handle;
+
+	while (freeList.GetPagesCount() > pages.size())
+	{
+		D3D12_DESCRIPTOR_HEAP_DESC desc = {};
+		desc.Type = type;
+		desc.NumDescriptors = freeList.GetPageSize();
+
+		ID3D12DescriptorHeap* page = nullptr;
+		if (FAILED(device->CreateDescriptorHeap(&desc, IID_PPV_ARGS(&page))))
+		{
+			freeList.Free(handle);
+			return DescriptorHandle();
+		}
+		pages.push_back(page);
+	}
+	return handle;
+}
+
+D3D12_CPU_DESCRIPTOR_HANDLE StagingDescriptorHeap::GetCpuHandle(DescriptorHandle handle) const
+{
+	D3D12_CPU_DESCRIPTOR_HANDLE cpuHandle = {};
+	if (!freeList.IsAlive(handle))
+		return cpuHandle;
+
+	uint32_t pageSize = freeList.GetPageSize();
+	cpuHandle = pages[handle.index / pageSize]->GetCPUDescriptorHandleForHeapStart();
+	cpuHandle.ptr += (handle.index % pageSize) * increment;
+	return cpuHandle;
+}
+
+bool ShaderVisibleDescriptorHeap::Init(ID3D12Device * device, uint32_t persistentCount, uint32_t ringCount)
+{
+	Release();
+
+	allocator.Reset(persistentCount, ringCount);
+
+	D3D12_DESCRIPTOR_HEAP_DESC desc = {};
+	desc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV;
+	desc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE;
+	desc.NumDescriptors = allocator.GetDescriptorsCount();
+	if (FAILED(device->CreateDescriptorHeap(&desc, IID_PPV_ARGS(&heap))))
+		return false;
+
+	this->device = device;
+	increment = device->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+	lastCopyIndex = DescriptorHandle::InvalidIndex;
+	return true;
+}
+
+void ShaderVisibleDescriptorHeap::Release()
+{
+	if (nullptr != heap)
+		heap->Release();
+	heap = nullptr;
+	device = nullptr;
+	copyDestStarts.clear();
+	copyDestSizes.clear();
+	copySources.clear();
+	copySourceSizes.clear();
+}
+
+D3D12_CPU_DESCRIPTOR_HANDLE ShaderVisibleDescriptorHeap::GetCpuHandle(uint32_t index) const
+{
+	D3D12_CPU_DESCRIPTOR_HANDLE handle = heap->GetCPUDescriptorHandleForHeapStart();
+	handle.ptr += static_cast<SIZE_T>(index) * increment;
+	return handle;
+}
+
+D3D12_GPU_DESCRIPTOR_HANDLE ShaderVisibleDescriptorHeap::GetGpuHandle(uint32_t index) const
+{
+	D3D12_GPU_DESCRIPTOR_HANDLE handle = heap->GetGPUDescriptorHandleForHeapStart();
+	handle.ptr += static_cast<UINT64>(index) * increment;
+	return handle;
+}
+
+void ShaderVisibleDescriptorHeap::QueueCopy(uint32_t index, D3D12_CPU_DESCRIPTOR_HANDLE source)
+{
+	// Runs of consecutive destinations become one range.
+	if (!copyDestSizes.empty() && index == lastCopyIndex + 1)
+		copyDestSizes.back()++;
+	else
+	{
+		copyDestStarts.push_back(GetCpuHandle(index));
+		copyDestSizes.push_back(1);
+	}
+	copySources.push_back(source);
+	copySourceSizes.push_back(1);
+	lastCopyIndex = index;
+}
+
+void ShaderVisibleDescriptorHeap::FlushCopies()
+{
+	if (copySources.empty())
+		return;
+
+	// Sources are scattered over the staging pages, one range each.
+	device->CopyDescriptors(static_cast<UINT>(copyDestStarts.size()), copyDestStarts.data(), copyDestSizes.data(),
+		static_cast<UINT>(copySources.size()), copySources.data(), copySourceSizes.data(), D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+
+	copyDestStarts.clear();
+	copyDestSizes.clear();
+	copySources.clear();
+	copySourceSizes.clear();
+	lastCopyIndex = DescriptorHandle::InvalidIndex;
+}
+
+uint32_t ShaderVisibleDescriptorHeap::BuildTable(const D3D12_CPU_DESCRIPTOR_HANDLE * sources, uint32_t count)
+{
+	uint32_t index = allocator.AllocateTable(count);
+	if (DescriptorHandle::InvalidIndex == index)
+		return index;
+
+	for (uint32_t i = 0; i < count; ++i)
+		QueueCopy(index + i, sources[i]);
+	return index;
+}
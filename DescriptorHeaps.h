@@ -0,0 +1,79 @@
+#pragma once
+#include <d3d12.h>
+
+#include <vector>
+
+#include "DescriptorAllocator.h"
+
+// CPU-only descriptors of one type, where views are created and kept. Grows
+// by one heap page at a time; handles stay valid across growth.
+class StagingDescriptorHeap
+{
+public:
+	StagingDescriptorHeap() : device(nullptr), type(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV), increment(0) {}
+	~StagingDescriptorHeap() { Release(); }
+
+	StagingDescriptorHeap(const StagingDescriptorHeap&) = delete;
+	StagingDescriptorHeap& operator=(const StagingDescriptorHeap&) = delete;
+
+	void Init(ID3D12Device* device, D3D12_DESCRIPTOR_HEAP_TYPE type, uint32_t pageSize = 256);
+	void Release();
+
+	// Returns an invalid handle if a new page could not be created.
+	DescriptorHandle Allocate();
+	void Free(DescriptorHandle handle) { freeList.Free(handle); }
+
+	// ptr is 0 for stale handles.
+	D3D12_CPU_DESCRIPTOR_HANDLE GetCpuHandle(DescriptorHandle handle) const;
+
+private:
+	ID3D12Device*						device;
+	D3D12_DESCRIPTOR_HEAP_TYPE			type;
+	UINT								increment;
+	std::vector<ID3D12DescriptorHeap*>	pages;
+	DescriptorFreeList					freeList;
+};
+
+// The one CBV/SRV/UAV heap bound for drawing, laid out as described in
+// ShaderVisibleDescriptorAllocator. Descriptors are filled by copying from
+// staging heaps; the copies queued during a frame go out in one
+// CopyDescriptors call.
+class ShaderVisibleDescriptorHeap
+{
+public:
+	ShaderVisibleDescriptorHeap() : device(nullptr), heap(nullptr), increment(0), lastCopyIndex(DescriptorHandle::InvalidIndex) {}
+	~ShaderVisibleDescriptorHeap() { Release(); }
+
+	ShaderVisibleDescriptorHeap(const ShaderVisibleDescriptorHeap&) = delete;
+	ShaderVisibleDescriptorHeap& operator=(const ShaderVisibleDescriptorHeap&) = delete;
+
+	bool Init(ID3D12Device* device, uint32_t persistentCount, uint32_t ringCount);
+	void Release();
+
+	ID3D12DescriptorHeap* GetHeap() const { return heap; }
+	ShaderVisibleDescriptorAllocator& GetAllocator() { return allocator; }
+
+	D3D12_CPU_DESCRIPTOR_HANDLE GetCpuHandle(uint32_t index) const;
+	D3D12_GPU_DESCRIPTOR_HANDLE GetGpuHandle(uint32_t index) const;
+
+	// Queues a copy of one staging descriptor to index.
+	void QueueCopy(uint32_t index, D3D12_CPU_DESCRIPTOR_HANDLE source);
+	// Issues the queued copies; call before the lists using them execute.
+	void FlushCopies();
+
+	// Allocates a transient table in the ring and queues copies of sources
+	// into it. Returns the table's first index, or InvalidIndex.
+	uint32_t BuildTable(const D3D12_CPU_DESCRIPTOR_HANDLE* sources, uint32_t count);
+
+private:
+	ID3D12Device*								device;
+	ID3D12DescriptorHeap*						heap;
+	UINT										increment;
+	ShaderVisibleDescriptorAllocator			allocator;
+
+	std::vector<D3D12_CPU_DESCRIPTOR_HANDLE>	copyDestStarts;
+	std::vector<UINT>							copyDestSizes;
+	std::vector<D3D12_CPU_DESCRIPTOR_HANDLE>	copySources;
+	std::vector<UINT>							copySourceSizes;
+	uint32_t									lastCopyIndex;
+};
@@ -0,0 +1,22 @@
+#include "FrameScheduler.h"
+
+void FrameScheduler::Reset(uint32_t framesInFlight)
+{
+	slotFenceValues.assign(framesInFlight > 0 ? framesInFlight : 1, 0);
+	slot = static_cast<uint32_t>(slotFenceValues.size() - 1);
+	frameNumber = 0;
+	lastFenceValue = 0;
+}
+
+uint64_t FrameScheduler::BeginFrame()
+{
+	slot = static_cast<uint32_t>((slot + 1) % slotFenceValues.size());
+	frameNumber++;
+	return slotFenceValues[slot];
+}
+
+uint64_t FrameScheduler::EndFrame()
+{
+	slotFenceValues[slot] = NextFenceValue();
+	return slotFenceValues[slot];
+}
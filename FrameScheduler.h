@@ -0,0 +1,38 @@
+#pragma once
+#include <stdint.h>
+
+#include <vector>
+
+// Decides when the CPU may start recording a frame. Every frame slot (its
+// command allocator, constant region, ...) is reused framesInFlight frames
+// later, once the fence value signaled at the end of its last use has
+// completed. The fence itself stays with the caller, see BenchFrames.cpp for
+// a run against a simulated queue.
+class FrameScheduler
+{
+public:
+	explicit FrameScheduler(uint32_t framesInFlight = 2) { Reset(framesInFlight); }
+
+	void Reset(uint32_t framesInFlight);
+
+	// Moves to the next slot and returns the fence value to wait for before
+	// touching it, 0 when it has never been used.
+	uint64_t BeginFrame();
+
+	// Returns the fence value to signal once the frame has been submitted.
+	uint64_t EndFrame();
+
+	// Fence value for work outside the frame loop, such as a full flush.
+	uint64_t NextFenceValue() { return ++lastFenceValue; }
+
+	uint32_t GetFramesInFlight() const { return static_cast<uint32_t>(slotFenceValues.size()); }
+	uint32_t GetFrameSlot() const { return slot; }
+	uint64_t GetFrameNumber() const { return frameNumber; }
+	uint64_t GetLastFenceValue() const { return lastFenceValue; }
+
+private:
+	std::vector<uint64_t>	slotFenceValues;
+	uint32_t				slot;
+	uint64_t				frameNumber;
+	uint64_t				lastFenceValue;
+};
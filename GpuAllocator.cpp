@@ -0,0 +1,188 @@
+#include "GpuAllocator.h"
+
+#include <algorithm>
+
+void GpuAllocator::Init(ID3D12Device * device, uint64_t blockSize)
+{
+	Release();
+
+	this->device = device;
+	this->blockSize = blockSize;
+
+	D3D12_FEATURE_DATA_D3D12_OPTIONS options = {};
+	mixedHeaps = SUCCEEDED(device->CheckFeatureSupport(D3D12_FEATURE_D3D12_OPTIONS, &options, sizeof(options)))
+		&& options.ResourceHeapTier >= D3D12_RESOURCE_HEAP_TIER_2;
+}
+
+void GpuAllocator::Release()
+{
+	for (Pool& pool : pools)
+	{
+		for (Block& block : pool.blocks)
+		{
+			if (nullptr != block.heap)
+				block.heap->Release();
+		}
+	}
+	pools.clear();
+	device = nullptr;
+}
+
+HRESULT GpuAllocator::CreateResource(D3D12_HEAP_TYPE heapType, const D3D12_RESOURCE_DESC & desc, D3D12_RESOURCE_STATES initialState,
+	const D3D12_CLEAR_VALUE * clearValue, GpuAllocation & allocation)
+{
+	allocation = GpuAllocation();
+
+	// Small textures may use 4 KB placement if the driver agrees to it for this desc.
+	D3D12_RESOURCE_DESC placedDesc = desc;
+	D3D12_RESOURCE_ALLOCATION_INFO info = {};
+	bool renderTarget = 0 != (desc.Flags & (D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET | D3D12_RESOURCE_FLAG_ALLOW_DEPTH_STENCIL));
+	if (D3D12_RESOURCE_DIMENSION_BUFFER != desc.Dimension && !renderTarget && desc.SampleDesc.Count <= 1 && 0 == desc.Alignment)
+	{
+		placedDesc.Alignment = D3D12_SMALL_RESOURCE_PLACEMENT_ALIGNMENT;
+		info = device->GetResourceAllocationInfo(0, 1, &placedDesc);
+		if (D3D12_SMALL_RESOURCE_PLACEMENT_ALIGNMENT != info.Alignment)
+			placedDesc.Alignment = 0;
+	}
+	if (0 == placedDesc.Alignment)
+		info = device->GetResourceAllocationInfo(0, 1, &placedDesc);
+	if (UINT64_MAX == info.SizeInBytes)
+		return E_INVALIDARG;
+
+	uint32_t pool = GetPool(heapType, GetHeapFlags(desc));
+	if (!AllocateRange(pool, info.SizeInBytes, info.Alignment, allocation))
+		return E_OUTOFMEMORY;
+
+	const Block& block = pools[pool].blocks[allocation.block];
+	HRESULT hr = device->CreatePlacedResource(block.heap, allocation.range.offset, &placedDesc, initialState, clearValue, IID_PPV_ARGS(&allocation.resource));
+	if (FAILED(hr))
+	{
+		allocation.resource = nullptr;
+		Free(allocation);
+	}
+	return hr;
+}
+
+void GpuAllocator::Free(GpuAllocation & allocation)
+{
+	if (nullptr != allocation.resource)
+		allocation.resource->Release();
+
+	if (allocation.pool < pools.size() && allocation.block < pools[allocation.pool].blocks.size())
+	{
+		Block& block = pools[allocation.pool].blocks[allocation.block];
+		block.allocator.Free(allocation.range);
+
+		// The first regular block of a pool stays around, the others and
+		// dedicated blocks go back to the driver once empty.
+		bool keep = 0 == allocation.block && blockSize == block.allocator.GetSize();
+		if (!keep && nullptr != block.heap && block.allocator.IsEmpty())
+		{
+			block.heap->Release();
+			block.heap = nullptr;
+		}
+	}
+	allocation = GpuAllocation();
+}
+
+GpuAllocator::Stats GpuAllocator::GetStats() const
+{
+	Stats stats = {};
+	for (const Pool& pool : pools)
+	{
+		for (const Block& block : pool.blocks)
+		{
+			if (nullptr == block.heap)
+				continue;
+
+			TlsfAllocator::Stats blockStats = block.allocator.GetStats();
+			stats.blocksCount++;
+			stats.reservedSize += blockStats.size;
+			stats.usedSize += blockStats.usedSize;
+			stats.freeSize += blockStats.freeSize;
+			stats.largestFreeBlock = std::max(stats.largestFreeBlock, blockStats.largestFreeBlock);
+			stats.allocationsCount += blockStats.allocationsCount;
+		}
+	}
+	return stats;
+}
+
+uint32_t GpuAllocator::GetPool(D3D12_HEAP_TYPE heapType, D3D12_HEAP_FLAGS heapFlags)
+{
+	for (uint32_t i = 0; i < pools.size(); ++i)
+	{
+		if (pools[i].heapType == heapType && pools[i].heapFlags == heapFlags)
+			return i;
+	}
+
+	pools.emplace_back();
+	pools.back().heapType = heapType;
+	pools.back().heapFlags = heapFlags;
+	return static_cast<uint32_t>(pools.size() - 1);
+}
+
+D3D12_HEAP_FLAGS GpuAllocator::GetHeapFlags(const D3D12_RESOURCE_DESC & desc) const
+{
+	if (mixedHeaps)
+		return D3D12_HEAP_FLAG_ALLOW_ALL_BUFFERS_AND_TEXTURES;
+	if (D3D12_RESOURCE_DIMENSION_BUFFER == desc.Dimension)
+		return D3D12_HEAP_FLAG_ALLOW_ONLY_BUFFERS;
+	if (0 != (desc.Flags & (D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET | D3D12_RESOURCE_FLAG_ALLOW_DEPTH_STENCIL)))
+		return D3D12_HEAP_FLAG_ALLOW_ONLY_RT_DS_TEXTURES;
+	return D3D12_HEAP_FLAG_ALLOW_ONLY_NON_RT_DS_TEXTURES;
+}
+
+bool GpuAllocator::AllocateRange(uint32_t poolIndex, uint64_t size, uint64_t alignment, GpuAllocation & allocation)
+{
+	Pool& pool = pools[poolIndex];
+
+	// Multisampled resources need 4 MB alignment, which only their own heap guarantees.
+	bool dedicated = size > blockSize || alignment > D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT;
+	if (!dedicated)
+	{
+		for (uint32_t i = 0; i < pool.blocks.size(); ++i)
+		{
+			Block& block = pool.blocks[i];
+			if (nullptr != block.heap && block.allocator.Allocate(size, alignment, allocation.range))
+			{
+				allocation.pool = poolIndex;
+				allocation.block = i;
+				return true;
+			}
+		}
+	}
+
+	uint64_t heapAlignment = std::max<uint64_t>(alignment, D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT);
+	D3D12_HEAP_DESC desc = {};
+	desc.SizeInBytes = dedicated ? (size + heapAlignment - 1) & ~(heapAlignment - 1) : blockSize;
+	desc.Properties.Type = pool.heapType;
+	desc.Alignment = heapAlignment;
+	desc.Flags = pool.heapFlags;
+
+	ID3D12Heap* heap = nullptr;
+	if (FAILED(device->CreateHeap(&desc, IID_PPV_ARGS(&heap))))
+		return false;
+
+	// Reuses the slot of a block released earlier, so indices held by live
+	// allocations stay put.
+	uint32_t index = 0;
+	while (index < pool.blocks.size() && nullptr != pool.blocks[index].heap)
+		++index;
+	if (index == pool.blocks.size())
+		pool.blocks.emplace_back();
+
+	Block& block = pool.blocks[index];
+	block.heap = heap;
+	block.allocator.Reset(desc.SizeInBytes, D3D12_SMALL_RESOURCE_PLACEMENT_ALIGNMENT);
+	if (!block.allocator.Allocate(size, alignment, allocation.range))
+	{
+		// The empty heap goes back right away; the slot stays free for reuse.
+		heap->Release();
+		block.heap = nullptr;
+		return false;
+	}
+
+	allocation.pool = poolIndex;
+	allocation.block = index;
+	return true;
+}
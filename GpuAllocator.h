@@ -0,0 +1,81 @@
+#pragma once
+#include <d3d12.h>
+
+#include <vector>
+
+#include "TlsfAllocator.h"
+
+struct GpuAllocation
+{
+	ID3D12Resource*				resource = nullptr;
+	uint32_t					pool = ~0u;
+	uint32_t					block = ~0u;
+	TlsfAllocator::Allocation	range;
+
+	bool IsValid() const { return nullptr != resource; }
+};
+
+// Places resources in large ID3D12Heap blocks instead of giving each its own
+// implicit heap. Every block is carved up by a TlsfAllocator; resources too
+// big for a block get a dedicated one. On resource heap tier 1 buffers,
+// textures and render targets need heaps of their own, so each heap type
+// has up to three pools; tier 2 mixes them in one.
+class GpuAllocator
+{
+public:
+	struct Stats
+	{
+		uint32_t	blocksCount;
+		uint64_t	reservedSize;
+		uint64_t	usedSize;
+		uint64_t	freeSize;
+		uint64_t	largestFreeBlock;
+		uint32_t	allocationsCount;
+
+		double GetUtilization() const { return 0 == reservedSize ? 0.0 : static_cast<double>(usedSize) / reservedSize; }
+		double GetFragmentation() const { return 0 == freeSize ? 0.0 : 1.0 - static_cast<double>(largestFreeBlock) / freeSize; }
+	};
+
+	static const uint64_t DefaultBlockSize = 64 * 1024 * 1024;
+
+	GpuAllocator() : device(nullptr), blockSize(DefaultBlockSize), mixedHeaps(false) {}
+	~GpuAllocator() { Release(); }
+
+	GpuAllocator(const GpuAllocator&) = delete;
+	GpuAllocator& operator=(const GpuAllocator&) = delete;
+
+	void Init(ID3D12Device* device, uint64_t blockSize = DefaultBlockSize);
+	// All resources must have been freed.
+	void Release();
+
+	// Like CreateCommittedResource, with the resource placed in a block.
+	HRESULT CreateResource(D3D12_HEAP_TYPE heapType, const D3D12_RESOURCE_DESC& desc, D3D12_RESOURCE_STATES initialState,
+		const D3D12_CLEAR_VALUE* clearValue, GpuAllocation& allocation);
+	// Releases the resource; the GPU must be done with it.
+	void Free(GpuAllocation& allocation);
+
+	Stats GetStats() const;
+
+private:
+	struct Block
+	{
+		ID3D12Heap*		heap = nullptr;
+		TlsfAllocator	allocator;
+	};
+
+	struct Pool
+	{
+		D3D12_HEAP_TYPE		heapType;
+		D3D12_HEAP_FLAGS	heapFlags;
+		std::vector<Block>	blocks;
+	};
+
+	uint32_t GetPool(D3D12_HEAP_TYPE heapType, D3D12_HEAP_FLAGS heapFlags);
+	D3D12_HEAP_FLAGS GetHeapFlags(const D3D12_RESOURCE_DESC& desc) const;
+	bool AllocateRange(uint32_t pool, uint64_t size, uint64_t alignment, GpuAllocation& allocation);
+
+	ID3D12Device*		device;
+	uint64_t			blockSize;
+	bool				mixedHeaps;
+	std::vector<Pool>	pools;
+};
@@ -0,0 +1,122 @@
+#include "GpuProfiler.h"
+
+HRESULT GpuProfiler::Init(ID3D12Device * device, ID3D12CommandQueue * queue, Profiler & profiler, unsigned int framesInFlight, uint32_t scopesPerFrame)
+{
+	Release();
+
+	HRESULT hr = queue->GetTimestampFrequency(&frequency);
+	if (FAILED(hr))
+		return hr;
+
+	queriesPerSlot = scopesPerFrame * 2;
+	slots.resize(framesInFlight > 0 ? framesInFlight : 1);
+	for (Slot& s : slots)
+		s.names.resize(scopesPerFrame);
+
+	D3D12_QUERY_HEAP_DESC heapDesc = {};
+	heapDesc.Type = D3D12_QUERY_HEAP_TYPE_TIMESTAMP;
+	heapDesc.Count = queriesPerSlot * static_cast<UINT>(slots.size());
+	hr = device->CreateQueryHeap(&heapDesc, IID_PPV_ARGS(&queryHeap));
+	if (FAILED(hr))
+		return hr;
+
+	D3D12_RESOURCE_DESC desc = {};
+	desc.Dimension = D3D12_RESOURCE_DIMENSION_BUFFER;
+	desc.Width = heapDesc.Count * sizeof(UINT64);
+	desc.Height = 1;
+	desc.DepthOrArraySize = 1;
+	desc.MipLevels = 1;
+	desc.SampleDesc.Count = 1;
+	desc.Layout = D3D12_TEXTURE_LAYOUT_ROW_MAJOR;
+
+	D3D12_HEAP_PROPERTIES heapProperties = {};
+	heapProperties.Type = D3D12_HEAP_TYPE_READBACK;
+	hr = device->CreateCommittedResource(&heapProperties, D3D12_HEAP_FLAG_NONE, &desc, D3D12_RESOURCE_STATE_COPY_DEST, nullptr, IID_PPV_ARGS(&readback));
+	if (FAILED(hr))
+		return hr;
+
+	this->profiler = &profiler;
+	this->queue = queue;
+	slot = 0;
+	return S_OK;
+}
+
+void GpuProfiler::Release()
+{
+	if (nullptr != readback) readback->Release();
+	if (nullptr != queryHeap) queryHeap->Release();
+	readback = nullptr;
+	queryHeap = nullptr;
+	queue = nullptr;
+	profiler = nullptr;
+	slots.clear();
+}
+
+void GpuProfiler::BeginFrame(unsigned int slot)
+{
+	if (nullptr == queryHeap)
+		return;
+
+	this->slot = slot;
+	Slot& current = slots[slot];
+	if (current.resolved && 0 != current.queriesCount)
+	{
+		// Maps the GPU clock onto the CPU's, both sampled now.
+		UINT64 gpuTimestamp = 0, cpuTimestamp = 0;
+		const D3D12_RANGE range = { slot * queriesPerSlot * sizeof(UINT64), (slot * queriesPerSlot + current.queriesCount) * sizeof(UINT64) };
+		void* data = nullptr;
+		if (SUCCEEDED(queue->GetClockCalibration(&gpuTimestamp, &cpuTimestamp)) && SUCCEEDED(readback->Map(0, &range, &data)))
+		{
+			const UINT64* timestamps = reinterpret_cast<const UINT64*>(static_cast<const uint8_t*>(data) + range.Begin);
+			const double cpuTicksPerGpuTick = static_cast<double>(Profiler::GetTicksPerSecond()) / frequency;
+			auto ToCpu = [&](UINT64 timestamp)
+			{
+				return cpuTimestamp - static_cast<uint64_t>(static_cast<double>(gpuTimestamp - timestamp) * cpuTicksPerGpuTick);
+			};
+			for (uint32_t i = 0; i + 1 < current.queriesCount; i += 2)
+			{
+				// Scopes whose End never came keep their Begin twice.
+				if (timestamps[i + 1] > timestamps[i])
+					profiler->RecordGpu(current.names[i / 2], ToCpu(timestamps[i]), ToCpu(timestamps[i + 1]));
+			}
+			const D3D12_RANGE written = { 0, 0 };
+			readback->Unmap(0, &written);
+		}
+	}
+	current.queriesCount = 0;
+	current.resolved = false;
+}
+
+uint32_t GpuProfiler::Begin(ID3D12GraphicsCommandList * list, const char * name)
+{
+	if (nullptr == queryHeap)
+		return InvalidScope;
+
+	Slot& current = slots[slot];
+	if (current.queriesCount + 2 > queriesPerSlot)
+		return InvalidScope;
+
+	const uint32_t scope = current.queriesCount / 2;
+	current.names[scope] = profiler->Intern(name);
+	current.queriesCount += 2;
+	list->EndQuery(queryHeap, D3D12_QUERY_TYPE_TIMESTAMP, slot * queriesPerSlot + scope * 2);
+	list->EndQuery(queryHeap, D3D12_QUERY_TYPE_TIMESTAMP, slot * queriesPerSlot + scope * 2 + 1);
+	return scope;
+}
+
+void GpuProfiler::End(ID3D12GraphicsCommandList * list, uint32_t scope)
+{
+	if (InvalidScope != scope)
+		list->EndQuery(queryHeap, D3D12_QUERY_TYPE_TIMESTAMP, slot * queriesPerSlot + scope * 2 + 1);
+}
+
+void GpuProfiler::EndFrame(ID3D12GraphicsCommandList * list)
+{
+	if (nullptr == queryHeap)
+		return;
+
+	Slot& current = slots[slot];
+	if (0 != current.queriesCount)
+		list->ResolveQueryData(queryHeap, D3D12_QUERY_TYPE_TIMESTAMP, slot * queriesPerSlot, current.queriesCount, readback, slot * queriesPerSlot * sizeof(UINT64));
+	current.resolved = true;
+}
@@ -0,0 +1,54 @@
+#pragma once
+#include <d3d12.h>
+
+#include <vector>
+
+#include "Profiler.h"
+
+// Timestamp queries around GPU work, a region of the query heap and the
+// readback buffer per frame slot. A slot's timings are read back when the
+// slot comes around again, which the caller does only after its fence has
+// completed, and go to the profiler on the CPU clock.
+class GpuProfiler
+{
+public:
+	static const uint32_t InvalidScope = ~0u;
+
+	GpuProfiler() : profiler(nullptr), queue(nullptr), queryHeap(nullptr), readback(nullptr), queriesPerSlot(0), slot(0), frequency(0) {}
+	~GpuProfiler() { Release(); }
+
+	GpuProfiler(const GpuProfiler&) = delete;
+	GpuProfiler& operator=(const GpuProfiler&) = delete;
+
+	// scopesPerFrame Begin/End pairs fit in a frame, the rest are dropped.
+	HRESULT Init(ID3D12Device* device, ID3D12CommandQueue* queue, Profiler& profiler, unsigned int framesInFlight, uint32_t scopesPerFrame = 64);
+	void Release();
+
+	// Hands slot's last timings to the profiler, then starts recording into it.
+	void BeginFrame(unsigned int slot);
+
+	// name is interned, it need not outlive the call.
+	uint32_t Begin(ID3D12GraphicsCommandList* list, const char* name);
+	void End(ID3D12GraphicsCommandList* list, uint32_t scope);
+
+	// Resolves the frame's queries; list must execute after every list
+	// holding them.
+	void EndFrame(ID3D12GraphicsCommandList* list);
+
+private:
+	struct Slot
+	{
+		std::vector<const char*>	names;
+		uint32_t					queriesCount = 0;
+		bool						resolved = false;
+	};
+
+	Profiler*				profiler;
+	ID3D12CommandQueue*		queue;
+	ID3D12QueryHeap*		queryHeap;
+	ID3D12Resource*			readback;
+	std::vector<Slot>		slots;
+	uint32_t				queriesPerSlot;
+	unsigned int			slot;
+	UINT64					frequency;
+};
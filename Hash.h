@@ -0,0 +1,23 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+// 64-bit FNV-1a, stable across runs and platforms so it can be persisted.
+constexpr uint64_t HashSeed = 0xcbf29ce484222325ULL;
+
+inline uint64_t HashBytes(const void* data, size_t size, uint64_t hash = HashSeed)
+{
+	const uint8_t* bytes = reinterpret_cast<const uint8_t*>(data);
+	for (size_t i = 0; i < size; ++i)
+	{
+		hash ^= bytes[i];
+		hash *= 0x100000001b3ULL;
+	}
+	return hash;
+}
+
+template<typename T>
+inline uint64_t HashValue(const T& value, uint64_t hash = HashSeed)
+{
+	return HashBytes(&value, sizeof(T), hash);
+}
@@ -0,0 +1,110 @@
+#include "InstanceBuilder.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace
+{
+	// world is the full 4x4; m is its 3x3, row by row.
+	void Encode(const float* world, WorldTransform& out)
+	{
+		for (int c = 0; c < 3; ++c)
+		{
+			out.world[c][0] = world[0 + c];
+			out.world[c][1] = world[4 + c];
+			out.world[c][2] = world[8 + c];
+			out.world[c][3] = world[12 + c];
+		}
+
+		const float m[9] = { world[0], world[1], world[2], world[4], world[5], world[6], world[8], world[9], world[10] };
+
+		// Inverse of the 3x3 by cofactors; normals of a degenerate transform are left alone.
+		float c00 = m[4] * m[8] - m[5] * m[7];
+		float c01 = m[5] * m[6] - m[3] * m[8];
+		float c02 = m[3] * m[7] - m[4] * m[6];
+		float det = m[0] * c00 + m[1] * c01 + m[2] * c02;
+		if (std::fabs(det) > 1e-20f)
+		{
+			float inv = 1.0f / det;
+			float r[3][3] = {
+				{ c00 * inv, (m[2] * m[7] - m[1] * m[8]) * inv, (m[1] * m[5] - m[2] * m[4]) * inv },
+				{ c01 * inv, (m[0] * m[8] - m[2] * m[6]) * inv, (m[2] * m[3] - m[0] * m[5]) * inv },
+				{ c02 * inv, (m[1] * m[6] - m[0] * m[7]) * inv, (m[0] * m[4] - m[1] * m[3]) * inv },
+			};
+			for (int i = 0; i < 3; ++i)
+			{
+				out.normal[i][0] = r[i][0];
+				out.normal[i][1] = r[i][1];
+				out.normal[i][2] = r[i][2];
+				out.normal[i][3] = 0.0f;
+			}
+		}
+		else
+		{
+			for (int i = 0; i < 3; ++i)
+			{
+				for (int j = 0; j < 4; ++j)
+					out.normal[i][j] = i == j ? 1.0f : 0.0f;
+			}
+		}
+	}
+}
+
+void InstanceBuilder::Reset(uint32_t batchesCount)
+{
+	instances.clear();
+	counts.assign(batchesCount, 0);
+}
+
+void InstanceBuilder::Add(uint32_t key, const float * world, uint32_t materialIndex)
+{
+	Instance instance;
+	Encode(world, instance.transform);
+	instance.key = key;
+	instance.materialIndex = materialIndex;
+	instances.push_back(instance);
+	counts[key]++;
+}
+
+void InstanceBuilder::Add(uint32_t key, const WorldTransform & transform, uint32_t materialIndex)
+{
+	Instance instance;
+	instance.transform = transform;
+	instance.key = key;
+	instance.materialIndex = materialIndex;
+	instances.push_back(instance);
+	counts[key]++;
+}
+
+const std::vector<InstanceBuilder::Batch>& InstanceBuilder::Pack(InstanceData * dest)
+{
+	// Counting sort: batch starts from the counts, then one scatter.
+	batches.clear();
+	std::vector<uint32_t>& cursors = counts;
+	uint32_t first = 0;
+	for (uint32_t key = 0; key < cursors.size(); ++key)
+	{
+		uint32_t count = cursors[key];
+		if (count > 0)
+			batches.push_back({ key, first, count });
+		cursors[key] = first;
+		first += count;
+	}
+
+	for (const Instance& instance : instances)
+	{
+		// Built on the stack and copied whole, dest is written once, in full lines.
+		InstanceData data;
+		data.transform = instance.transform;
+		data.materialIndex = instance.materialIndex;
+		data.padding[0] = data.padding[1] = data.padding[2] = 0;
+		memcpy(dest + cursors[instance.key]++, &data, sizeof(data));
+	}
+
+	// Back to counts, so Pack can run again on the same instances.
+	std::fill(counts.begin(), counts.end(), 0);
+	for (const Batch& batch : batches)
+		counts[batch.key] = batch.instancesCount;
+	return batches;
+}
@@ -0,0 +1,56 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+#include <vector>
+
+#include "TransformSystem.h"
+
+// One entry of the vertex shader's StructuredBuffer<Instance>, 112 bytes.
+struct InstanceData
+{
+	WorldTransform	transform;
+	uint32_t		materialIndex;
+	uint32_t		padding[3];
+};
+
+// Collects the instances of a frame under batch keys, such as a mesh and
+// LOD pair, and packs them batch after batch so each batch is one instanced
+// draw over a contiguous range of the instance buffer.
+class InstanceBuilder
+{
+public:
+	struct Batch
+	{
+		uint32_t	key;
+		uint32_t	firstInstance;
+		uint32_t	instancesCount;
+	};
+
+	// Drops the previous frame's instances; keys must be below batchesCount.
+	void Reset(uint32_t batchesCount);
+
+	// world is a row-major 4x4 for row vectors, as in XMFLOAT4X4.
+	void Add(uint32_t key, const float* world, uint32_t materialIndex);
+	// Takes the normal matrix as is, as TransformSystem computes it.
+	void Add(uint32_t key, const WorldTransform& transform, uint32_t materialIndex);
+
+	size_t GetInstancesCount() const { return instances.size(); }
+
+	// Writes GetInstancesCount() entries to dest in batch order, in one
+	// forward pass per entry so write-combined memory is fine. Returns the
+	// non-empty batches, by ascending key.
+	const std::vector<Batch>& Pack(InstanceData* dest);
+
+private:
+	struct Instance
+	{
+		WorldTransform	transform;
+		uint32_t		key;
+		uint32_t		materialIndex;
+	};
+
+	std::vector<Instance>	instances;
+	std::vector<uint32_t>	counts;
+	std::vector<Batch>		batches;
+};
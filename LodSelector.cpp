@@ -0,0 +1,40 @@
+#include "LodSelector.h"
+
+#include <algorithm>
+#include <cmath>
+
+void LodSelector::Select(const LodInstance * instances, size_t count, const float * lodErrors, size_t lodCount, uint8_t * lods) const
+{
+	for (size_t i = 0; i < count; ++i)
+		lods[i] = Select(instances[i], lodErrors, lodCount);
+}
+
+uint8_t LodSelector::Select(const LodInstance & instance, const float * lodErrors, size_t lodCount) const
+{
+	float dx = instance.center[0] - camera[0];
+	float dy = instance.center[1] - camera[1];
+	float dz = instance.center[2] - camera[2];
+	float distance = std::sqrt(dx * dx + dy * dy + dz * dz) - instance.radius;
+	if (distance < nearDistance)
+		return 0;
+
+	// error * scale * pixelsPerUnit / distance <= threshold
+	float allowed = threshold * distance / (pixelsPerUnit * instance.scale);
+
+	size_t lod = lodCount;
+	while (lod-- > 1)
+	{
+		if (lodErrors[lod] <= allowed)
+			return static_cast<uint8_t>(lod);
+	}
+	return 0;
+}
+
+float LodSelector::GetScreenSize(const LodInstance & instance) const
+{
+	float dx = instance.center[0] - camera[0];
+	float dy = instance.center[1] - camera[1];
+	float dz = instance.center[2] - camera[2];
+	float distance = std::max(std::sqrt(dx * dx + dy * dy + dz * dz) - instance.radius, nearDistance);
+	return 2.0f * instance.radius * pixelsPerUnit / distance;
+}
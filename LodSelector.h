@@ -0,0 +1,40 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+struct LodInstance
+{
+	// World space bounding sphere.
+	float		center[3];
+	float		radius;
+	// Largest scale of the world transform, LOD errors are in mesh units.
+	float		scale;
+};
+
+// Picks mesh LODs by the screen-space size of their simplification error.
+class LodSelector
+{
+public:
+	LodSelector() : pixelsPerUnit(1.0f), threshold(1.0f), nearDistance(0.01f) { camera[0] = camera[1] = camera[2] = 0.0f; }
+
+	// projScaleY is _22 of the projection matrix, cot(fovY / 2).
+	void SetProjection(float projScaleY, float viewportHeight) { pixelsPerUnit = projScaleY * viewportHeight * 0.5f; }
+	void SetCameraPosition(float x, float y, float z) { camera[0] = x; camera[1] = y; camera[2] = z; }
+	// Largest error in pixels a LOD may show.
+	void SetThreshold(float pixels) { threshold = pixels; }
+
+	// Writes, for each instance, the coarsest LOD whose projected error stays
+	// within the threshold. lodErrors must be ascending, as Mesh produces them.
+	void Select(const LodInstance* instances, size_t count, const float* lodErrors, size_t lodCount, uint8_t* lods) const;
+
+	uint8_t Select(const LodInstance& instance, const float* lodErrors, size_t lodCount) const;
+
+	// Projected diameter of the instance's bounding sphere, in pixels.
+	float GetScreenSize(const LodInstance& instance) const;
+
+private:
+	float		camera[3];
+	float		pixelsPerUnit;
+	float		threshold;
+	float		nearDistance;
+};
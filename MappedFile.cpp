@@ -0,0 +1,110 @@
+#include "MappedFile.h"
+
+#if defined(_WIN32)
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::~MappedFile()
+{
+	Close();
+}
+
+#if defined(_WIN32)
+
+bool MappedFile::Open(const char * filename)
+{
+	Close();
+
+	HANDLE hFile = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (INVALID_HANDLE_VALUE == hFile)
+		return false;
+
+	LARGE_INTEGER fileSize = {};
+	if (!GetFileSizeEx(hFile, &fileSize) || fileSize.QuadPart == 0)
+	{
+		CloseHandle(hFile);
+		return false;
+	}
+
+	HANDLE hMapping = CreateFileMappingA(hFile, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (nullptr == hMapping)
+	{
+		CloseHandle(hFile);
+		return false;
+	}
+
+	const void* view = MapViewOfFile(hMapping, FILE_MAP_READ, 0, 0, 0);
+	if (nullptr == view)
+	{
+		CloseHandle(hMapping);
+		CloseHandle(hFile);
+		return false;
+	}
+
+	file = hFile;
+	mapping = hMapping;
+	data = view;
+	size = static_cast<size_t>(fileSize.QuadPart);
+	return true;
+}
+
+void MappedFile::Close()
+{
+	if (nullptr != data)
+		UnmapViewOfFile(data);
+	if (nullptr != mapping)
+		CloseHandle(reinterpret_cast<HANDLE>(mapping));
+	if (nullptr != file)
+		CloseHandle(reinterpret_cast<HANDLE>(file));
+
+	data = nullptr;
+	size = 0;
+	file = nullptr;
+	mapping = nullptr;
+}
+
+#else
+
+bool MappedFile::Open(const char * filename)
+{
+	Close();
+
+	int fd = open(filename, O_RDONLY);
+	if (fd < 0)
+		return false;
+
+	struct stat st = {};
+	if (fstat(fd, &st) != 0 || st.st_size == 0)
+	{
+		close(fd);
+		return false;
+	}
+
+	void* view = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+
+	if (MAP_FAILED == view)
+		return false;
+
+	data = view;
+	size = static_cast<size_t>(st.st_size);
+	return true;
+}
+
+void MappedFile::Close()
+{
+	if (nullptr != data)
+		munmap(const_cast<void*>(data), size);
+
+	data = nullptr;
+	size = 0;
+	file = nullptr;
+	mapping = nullptr;
+}
+
+#endif
@@ -0,0 +1,27 @@
+#pragma once
+#include <stddef.h>
+
+// Read-only memory mapping of a whole file.
+class MappedFile
+{
+public:
+	MappedFile() : data(nullptr), size(0), file(nullptr), mapping(nullptr) {}
+
+	~MappedFile();
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	bool Open(const char* filename);
+	void Close();
+
+	bool IsOpen() const { return nullptr != data; }
+	const void* GetData() const { return data; }
+	size_t GetSize() const { return size; }
+
+private:
+	const void*		data;
+	size_t			size;
+	void*			file;
+	void*			mapping;
+};
@@ -1,9 +1,90 @@
 #include "Mesh.h"
+#include "MeshCache.h"
+#include "Hash.h"
+#include "Meshlet.h"
+#include "MeshOptimizer.h"
+#include "MeshSimplifier.h"
+#include "ThreadPool.h"
+#include "VertexInterleave.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
 
 #include <assimp/Importer.hpp>
 #include <assimp/scene.h>
 #include <assimp/postprocess.h>
 
+namespace
+{
+	uint64_t AlignUp(uint64_t value, uint64_t alignment)
+	{
+		return (value + alignment - 1) & ~(alignment - 1);
+	}
+
+	bool IsBlobValid(const MeshCacheBlob& blob, uint64_t expectedSize, uint64_t fileSize)
+	{
+		return blob.size == expectedSize
+			&& blob.offset % MeshCacheAlignment == 0
+			&& blob.offset <= fileSize
+			&& blob.size <= fileSize - blob.offset;
+	}
+
+	constexpr unsigned int InvalidIndex = ~0u;
+
+	// Attribute values snapped to the weld epsilon.
+	struct WeldKey
+	{
+		int64_t		values[11];
+
+		bool operator==(const WeldKey& other) const { return 0 == memcmp(values, other.values, sizeof(values)); }
+	};
+
+	struct WeldKeyHash
+	{
+		size_t operator()(const WeldKey& key) const { return static_cast<size_t>(HashBytes(key.values, sizeof(key.values))); }
+	};
+
+	size_t CountTriangles(const aiMesh* mesh)
+	{
+		size_t count = 0;
+		for (unsigned int i = 0; i < mesh->mNumFaces; ++i)
+			count += 3 == mesh->mFaces[i].mNumIndices;
+		return count;
+	}
+
+	// Any unit vector perpendicular to the normal, for meshes without UVs.
+	Mesh::Vector3D MakeTangent(const Mesh::Vector3D& n)
+	{
+		Mesh::Vector3D axis = std::fabs(n.x) < 0.9f ? Mesh::Vector3D{ 1.0f, 0.0f, 0.0f } : Mesh::Vector3D{ 0.0f, 1.0f, 0.0f };
+		float d = axis.x * n.x + axis.y * n.y + axis.z * n.z;
+		Mesh::Vector3D t = { axis.x - n.x * d, axis.y - n.y * d, axis.z - n.z * d };
+		float length = std::sqrt(t.x * t.x + t.y * t.y + t.z * t.z);
+		if (length > 0.0f)
+			return { t.x / length, t.y / length, t.z / length };
+		return axis;
+	}
+
+	bool WriteBlob(FILE* fp, const void* data, uint64_t size, uint64_t& offset, MeshCacheBlob& blob)
+	{
+		static const char padding[MeshCacheAlignment] = {};
+
+		uint64_t aligned = AlignUp(offset, MeshCacheAlignment);
+		if (aligned != offset && fwrite(padding, 1, aligned - offset, fp) != aligned - offset)
+			return false;
+
+		blob.offset = aligned;
+		blob.size = size;
+		offset = aligned + size;
+
+		return size == 0 || fwrite(data, 1, size, fp) == size;
+	}
+}
+
 Mesh::~Mesh()
 {
 	Release();
@@ -11,14 +92,69 @@ Mesh::~Mesh()
 
 void Mesh::Release()
 {
-	delete[] vertices;
-	delete[] normals;
-	delete[] tangents;
-	delete[] uvs;
-	delete[] indices;
+	if (ownsData)
+	{
+		delete[] vertices;
+		delete[] normals;
+		delete[] tangents;
+		delete[] uvs;
+		delete[] interleaved;
+		delete[] indices;
+		delete[] submeshes;
+		delete[] lodErrors;
+		delete[] meshlets;
+		delete[] meshletVertices;
+		delete[] meshletTriangles;
+		delete[] meshletBounds;
+	}
+	cacheFile.Close();
+
+	vertices = nullptr;
+	normals = nullptr;
+	tangents = nullptr;
+	uvs = nullptr;
+	interleaved = nullptr;
+	indices = nullptr;
+	submeshes = nullptr;
+	lodErrors = nullptr;
+	meshlets = nullptr;
+	meshletVertices = nullptr;
+	meshletTriangles = nullptr;
+	meshletBounds = nullptr;
+	numVertices = 0;
+	numIndices = 0;
+	numSubmeshes = 0;
+	numLods = 1;
+	numMeshlets = 0;
+	numMeshletVertices = 0;
+	numMeshletTriangles = 0;
+	bounds = Bounds();
+	ownsData = false;
+}
+
+bool Mesh::LoadFromFile(const char * filename, unsigned int importFlags)
+{
+	char cacheFilename[260];
+	GetCacheFilename(filename, cacheFilename, sizeof(cacheFilename));
+
+	uint64_t sourceHash = 0;
+	if (!HashSourceFile(filename, sourceHash))
+	{
+		// No source to compare against, a cooked mesh is all there is.
+		return LoadFromCache(cacheFilename, 0);
+	}
+
+	if (LoadFromCache(cacheFilename, sourceHash))
+		return true;
+
+	if (!ImportFromFile(filename, importFlags))
+		return false;
+
+	Weld();
+	return true;
 }
 
-void Mesh::LoadFromFile(const char * filename)
+bool Mesh::ImportFromFile(const char * filename, unsigned int importFlags)
 {
 	Release();
 
@@ -26,77 +162,786 @@ void Mesh::LoadFromFile(const char * filename)
 	auto scene = importer.ReadFile(filename, aiProcess_Triangulate | aiProcess_GenSmoothNormals | aiProcess_CalcTangentSpace);
 
 	if (!scene)
-		return;
-
-	size_t vertsInTotal = 0, facesInTotal = 0;
+		return false;
 
-	for (size_t i = 0; i < scene->mNumMeshes; ++i)
+	// Every scene mesh becomes a submesh. Prefix sums of the vertex and face
+	// counts give each one a disjoint slice to convert into, lock free.
+	const size_t meshesInTotal = scene->mNumMeshes;
+	std::vector<size_t> firstVertex(meshesInTotal + 1, 0), firstFace(meshesInTotal + 1, 0);
+	ThreadPool::Shared().ParallelFor(meshesInTotal, [&](size_t i)
 	{
-		auto mesh = scene->mMeshes[i];
+		firstFace[i + 1] = CountTriangles(scene->mMeshes[i]);
+	});
+	for (size_t i = 0; i < meshesInTotal; ++i)
+	{
+		firstVertex[i + 1] = firstVertex[i] + scene->mMeshes[i]->mNumVertices;
+		firstFace[i + 1] += firstFace[i];
+	}
 
-		if (!mesh->HasNormals() || !mesh->HasTextureCoords(0) || !mesh->HasTangentsAndBitangents())
-			continue;
+	const size_t vertsInTotal = firstVertex[meshesInTotal];
+	const size_t facesInTotal = firstFace[meshesInTotal];
 
-		vertsInTotal += mesh->mNumVertices;
-		facesInTotal += mesh->mNumFaces;
+	if (importFlags & ImportInterleaved)
+	{
+		interleaved = new Vertex[vertsInTotal];
+	}
+	else
+	{
+		vertices = new Vector3D[vertsInTotal];
+		normals = new Vector3D[vertsInTotal];
+		tangents = new Vector3D[vertsInTotal];
+		uvs = new Vector2D[vertsInTotal];
 	}
-
-	vertices = new Vector3D[vertsInTotal];
-	normals = new Vector3D[vertsInTotal];
-	tangents = new Vector3D[vertsInTotal];
-	uvs = new Vector2D[vertsInTotal];
 	indices = new unsigned int[facesInTotal * 3];
+	submeshes = new Submesh[meshesInTotal];
+	ownsData = true;
 
-	unsigned int start_vertex_index = 0;
-	unsigned int  start_face_index = 0;
-
-	for (unsigned int i = 0; i < scene->mNumMeshes; ++i)
+	ThreadPool::Shared().ParallelFor(meshesInTotal, [&](size_t i)
 	{
-		auto mesh = scene->mMeshes[i];
+		const aiMesh* mesh = scene->mMeshes[i];
+		const unsigned int start_vertex_index = static_cast<unsigned int>(firstVertex[i]);
+		const size_t start_face_index = firstFace[i];
 
-		if (!mesh->HasNormals() || !mesh->HasTextureCoords(0) || !mesh->HasTangentsAndBitangents())
-			continue;
+		// Missing attributes are filled in rather than dropping the submesh.
+		const bool hasNormals = mesh->HasNormals();
+		const bool hasUVs = mesh->HasTextureCoords(0);
+		const bool hasTangents = mesh->HasTangentsAndBitangents();
 
 		for (unsigned int j = 0; j < mesh->mNumVertices; ++j)
 		{
-			aiVector3D& pos = reinterpret_cast<aiVector3D&>(vertices[start_vertex_index + j]);
-			aiVector3D& norm = reinterpret_cast<aiVector3D&>(normals[start_vertex_index + j]);
-			aiVector3D& tan = reinterpret_cast<aiVector3D&>(tangents[start_vertex_index + j]);
-			aiVector2D& uv = reinterpret_cast<aiVector2D&>(uvs[start_vertex_index + j]);
-
-			pos = mesh->mVertices[j];
-			norm = mesh->mNormals[j];
-			tan = mesh->mTangents[j];
-			auto uv3 = mesh->mTextureCoords[0][j];
-			uv.x = uv3.x;
-			uv.y = uv3.y;
+			auto pos = mesh->mVertices[j];
+			Vector3D norm = hasNormals ? Vector3D{ mesh->mNormals[j].x, mesh->mNormals[j].y, mesh->mNormals[j].z } : Vector3D{ 0.0f, 1.0f, 0.0f };
+			Vector3D tan = hasTangents ? Vector3D{ mesh->mTangents[j].x, mesh->mTangents[j].y, mesh->mTangents[j].z } : MakeTangent(norm);
+			Vector2D uv = hasUVs ? Vector2D{ mesh->mTextureCoords[0][j].x, mesh->mTextureCoords[0][j].y } : Vector2D{ 0.0f, 0.0f };
+
+			if (nullptr != interleaved)
+			{
+				Vertex& dest = interleaved[start_vertex_index + j];
+				dest.position = { pos.x, pos.y, pos.z };
+				dest.normal = norm;
+				dest.tangent = tan;
+				dest.uv = uv;
+			}
+			else
+			{
+				vertices[start_vertex_index + j] = { pos.x, pos.y, pos.z };
+				normals[start_vertex_index + j] = norm;
+				tangents[start_vertex_index + j] = tan;
+				uvs[start_vertex_index + j] = uv;
+			}
 		}
 
+		// Triangulate leaves point and line primitives alone, they are skipped.
+		unsigned int* pIndices = &indices[start_face_index * 3];
 		for (unsigned int j = 0; j < mesh->mNumFaces; ++j)
 		{
-			auto face = mesh->mFaces[j];
-			unsigned int* pIndices = &indices[(start_face_index + j) * 3];
+			const aiFace& face = mesh->mFaces[j];
+			if (3 != face.mNumIndices)
+				continue;
 			pIndices[0] = face.mIndices[0] + start_vertex_index;
 			pIndices[1] = face.mIndices[1] + start_vertex_index;
 			pIndices[2] = face.mIndices[2] + start_vertex_index;
+			pIndices += 3;
 		}
 
-		start_vertex_index += mesh->mNumVertices;
-		start_face_index += mesh->mNumFaces;
-	}
+		Submesh& submesh = submeshes[i];
+		submesh.indexOffset = static_cast<uint32_t>(start_face_index * 3);
+		submesh.indexCount = static_cast<uint32_t>((firstFace[i + 1] - start_face_index) * 3);
+		submesh.baseVertex = start_vertex_index;
+		submesh.materialIndex = mesh->mMaterialIndex;
+	});
 
 	numVertices = vertsInTotal;
 	numIndices = facesInTotal * 3;
+	numSubmeshes = meshesInTotal;
+	numLods = 1;
+	lodErrors = new float[1] { 0.0f };
+	ComputeBounds();
+
+	return true;
+}
+
+bool Mesh::LoadFromCache(const char * cacheFilename, uint64_t sourceHash)
+{
+	Release();
+
+	if (!cacheFile.Open(cacheFilename))
+		return false;
+
+	if (!AttachCache(cacheFile.GetData(), cacheFile.GetSize(), sourceHash))
+	{
+		cacheFile.Close();
+		return false;
+	}
+	return true;
+}
+
+bool Mesh::LoadFromMemory(const void * data, size_t size, uint64_t sourceHash)
+{
+	Release();
+	return AttachCache(data, size, sourceHash);
+}
+
+bool Mesh::AttachCache(const void * cacheData, size_t size, uint64_t sourceHash)
+{
+	const uint8_t* base = reinterpret_cast<const uint8_t*>(cacheData);
+	uint64_t fileSize = size;
+
+	// The arrays are used in place.
+	if (fileSize < sizeof(MeshCacheHeader) || 0 != reinterpret_cast<uintptr_t>(base) % MeshCacheAlignment)
+		return false;
+
+	const MeshCacheHeader* header = reinterpret_cast<const MeshCacheHeader*>(base);
+
+	bool valid = header->magic == MeshCacheMagic
+		&& header->version == MeshCacheVersion
+		&& header->fileSize == fileSize
+		&& (0 == sourceHash || header->sourceHash == sourceHash)
+		&& IsBlobValid(header->positions, header->numVertices * sizeof(Vector3D), fileSize)
+		&& IsBlobValid(header->normals, header->numVertices * sizeof(Vector3D), fileSize)
+		&& IsBlobValid(header->tangents, header->numVertices * sizeof(Vector3D), fileSize)
+		&& IsBlobValid(header->uvs, header->numVertices * sizeof(Vector2D), fileSize)
+		&& IsBlobValid(header->indices, header->numIndices * sizeof(unsigned int), fileSize)
+		&& header->numLods >= 1
+		&& IsBlobValid(header->submeshes, header->numSubmeshes * header->numLods * sizeof(Submesh), fileSize)
+		&& IsBlobValid(header->lodErrors, header->numLods * sizeof(float), fileSize)
+		&& IsBlobValid(header->meshlets, header->numMeshlets * sizeof(Meshlet), fileSize)
+		&& IsBlobValid(header->meshletVertices, header->numMeshletVertices * sizeof(unsigned int), fileSize)
+		&& IsBlobValid(header->meshletTriangles, header->numMeshletTriangles * 3, fileSize)
+		&& IsBlobValid(header->meshletBounds, header->numMeshlets * sizeof(MeshletBounds), fileSize);
+
+	if (!valid)
+		return false;
+
+	// The arrays point straight into the read-only mapping.
+	uint8_t* data = const_cast<uint8_t*>(base);
+	vertices = reinterpret_cast<Vector3D*>(data + header->positions.offset);
+	normals = reinterpret_cast<Vector3D*>(data + header->normals.offset);
+	tangents = reinterpret_cast<Vector3D*>(data + header->tangents.offset);
+	uvs = reinterpret_cast<Vector2D*>(data + header->uvs.offset);
+	indices = reinterpret_cast<unsigned int*>(data + header->indices.offset);
+	submeshes = reinterpret_cast<Submesh*>(data + header->submeshes.offset);
+	lodErrors = reinterpret_cast<float*>(data + header->lodErrors.offset);
+	meshlets = reinterpret_cast<Meshlet*>(data + header->meshlets.offset);
+	meshletVertices = reinterpret_cast<unsigned int*>(data + header->meshletVertices.offset);
+	meshletTriangles = data + header->meshletTriangles.offset;
+	meshletBounds = reinterpret_cast<MeshletBounds*>(data + header->meshletBounds.offset);
+	numVertices = static_cast<size_t>(header->numVertices);
+	numIndices = static_cast<size_t>(header->numIndices);
+	numSubmeshes = static_cast<size_t>(header->numSubmeshes);
+	numLods = static_cast<size_t>(header->numLods);
+	numMeshlets = static_cast<size_t>(header->numMeshlets);
+	numMeshletVertices = static_cast<size_t>(header->numMeshletVertices);
+	numMeshletTriangles = static_cast<size_t>(header->numMeshletTriangles);
+	ownsData = false;
+	ComputeBounds();
+
+	return true;
+}
+
+bool Mesh::SaveToCache(const char * cacheFilename, uint64_t sourceHash) const
+{
+	// The cache format is per-attribute, the interleaved import path is not cacheable.
+	if (IsInterleaved())
+		return false;
+
+	FILE* fp = fopen(cacheFilename, "wb");
+	if (nullptr == fp) return false;
+
+	MeshCacheHeader header = {};
+	header.magic = MeshCacheMagic;
+	header.version = MeshCacheVersion;
+	header.sourceHash = sourceHash;
+	header.numVertices = numVertices;
+	header.numIndices = numIndices;
+	header.numSubmeshes = numSubmeshes;
+	header.numLods = numLods;
+	header.numMeshlets = numMeshlets;
+	header.numMeshletVertices = numMeshletVertices;
+	header.numMeshletTriangles = numMeshletTriangles;
+
+	uint64_t offset = sizeof(MeshCacheHeader);
+	bool ok = fwrite(&header, sizeof(header), 1, fp) == 1
+		&& WriteBlob(fp, vertices, numVertices * sizeof(Vector3D), offset, header.positions)
+		&& WriteBlob(fp, normals, numVertices * sizeof(Vector3D), offset, header.normals)
+		&& WriteBlob(fp, tangents, numVertices * sizeof(Vector3D), offset, header.tangents)
+		&& WriteBlob(fp, uvs, numVertices * sizeof(Vector2D), offset, header.uvs)
+		&& WriteBlob(fp, indices, numIndices * sizeof(unsigned int), offset, header.indices)
+		&& WriteBlob(fp, submeshes, numSubmeshes * numLods * sizeof(Submesh), offset, header.submeshes)
+		&& WriteBlob(fp, lodErrors, numLods * sizeof(float), offset, header.lodErrors)
+		&& WriteBlob(fp, meshlets, numMeshlets * sizeof(Meshlet), offset, header.meshlets)
+		&& WriteBlob(fp, meshletVertices, numMeshletVertices * sizeof(unsigned int), offset, header.meshletVertices)
+		&& WriteBlob(fp, meshletTriangles, numMeshletTriangles * 3, offset, header.meshletTriangles)
+		&& WriteBlob(fp, meshletBounds, numMeshlets * sizeof(MeshletBounds), offset, header.meshletBounds);
+
+	// Patch the header now that the blob table and file size are known.
+	header.fileSize = offset;
+	ok = ok && fseek(fp, 0, SEEK_SET) == 0 && fwrite(&header, sizeof(header), 1, fp) == 1;
+
+	fclose(fp);
+
+	if (!ok)
+		remove(cacheFilename);
+
+	return ok;
+}
+
+void Mesh::Weld(float epsilon, WeldStats * stats)
+{
+	if (nullptr != stats)
+	{
+		stats->verticesBefore = numVertices;
+		stats->indexBytes32 = numIndices * sizeof(unsigned int);
+	}
+
+	if (0 == numIndices)
+	{
+		if (nullptr != stats)
+		{
+			stats->verticesAfter = numVertices;
+			stats->indexBytesPacked = GetPackedIndexRanges(nullptr);
+		}
+		return;
+	}
+
+	MakeOwned();
+
+	auto positions = GetPositions();
+	auto norms = GetNormals();
+	auto tans = GetTangents();
+	auto texcoords = GetUVs();
+
+	// In double and 64 bits, as coordinates past a few thousand units times
+	// 1 / epsilon do not fit 32. Values too large even for that only weld
+	// when they are the same bits, keyed past every snapped value.
+	const double scale = epsilon > 0.0f ? 1.0 / epsilon : 1.0;
+	auto Snap = [scale](float v)
+	{
+		const double MaxSnapped = 4611686018427387904.0;	// 2^62
+		double snapped = std::floor(v * scale + 0.5);
+		if (std::fabs(snapped) < MaxSnapped)
+			return static_cast<int64_t>(snapped);
+		uint32_t bits;
+		memcpy(&bits, &v, sizeof(bits));
+		return static_cast<int64_t>(MaxSnapped) + bits;
+	};
+
+	ClearLods();
+	ClearMeshlets();
+
+	std::vector<unsigned int> remap(numVertices, InvalidIndex);
+	std::unordered_map<WeldKey, unsigned int, WeldKeyHash> unique;
+	unsigned int next = 0;
+
+	for (size_t s = 0; s < numSubmeshes; ++s)
+	{
+		Submesh& submesh = submeshes[s];
+		unsigned int* range = indices + submesh.indexOffset;
+
+		// A fresh table per submesh keeps the submeshes' vertex ranges disjoint.
+		unique.clear();
+		unique.reserve(submesh.indexCount);
+
+		uint32_t baseVertex = next;
+		for (uint32_t i = 0; i < submesh.indexCount; ++i)
+		{
+			unsigned int v = range[i];
+			if (InvalidIndex == remap[v])
+			{
+				const Vector3D& p = positions[v];
+				const Vector3D& n = norms[v];
+				const Vector3D& t = tans[v];
+				const Vector2D& uv = texcoords[v];
+
+				WeldKey key = { {
+					Snap(p.x), Snap(p.y), Snap(p.z),
+					Snap(n.x), Snap(n.y), Snap(n.z),
+					Snap(t.x), Snap(t.y), Snap(t.z),
+					Snap(uv.x), Snap(uv.y),
+				} };
+
+				auto inserted = unique.insert({ key, next });
+				if (inserted.second)
+					next++;
+				remap[v] = inserted.first->second;
+			}
+			range[i] = remap[v];
+		}
+		submesh.baseVertex = baseVertex;
+	}
+
+	RemapVertices(remap.data(), next);
+
+	if (nullptr != stats)
+	{
+		stats->verticesAfter = numVertices;
+		stats->indexBytesPacked = GetPackedIndexRanges(nullptr);
+	}
+}
+
+void Mesh::Optimize(MeshOptimizeStats * stats)
+{
+	if (0 == numIndices)
+		return;
+
+	MakeOwned();
+	ClearLods();
+	ClearMeshlets();
+
+	if (nullptr != stats)
+	{
+		stats->cacheBefore = AnalyzeVertexCache(indices, numIndices, numVertices);
+		stats->fetchBefore = AnalyzeVertexFetch(indices, numIndices, numVertices, VertexSize);
+	}
+
+	std::vector<unsigned int> local, optimized;
+	auto positions = GetPositions();
+
+	for (size_t s = 0; s < numSubmeshes; ++s)
+	{
+		const Submesh& submesh = submeshes[s];
+		if (0 == submesh.indexCount)
+			continue;
+
+		unsigned int* range = indices + submesh.indexOffset;
+		unsigned int first, last;
+		GetVertexSpan(submesh, first, last);
+
+		// Work on submesh-local indices so the scratch tables stay small.
+		const size_t vertexCount = last - first + 1;
+		local.resize(submesh.indexCount);
+		optimized.resize(submesh.indexCount);
+		for (uint32_t i = 0; i < submesh.indexCount; ++i)
+			local[i] = range[i] - first;
+
+		AttributeView<Vector3D> localPositions = { positions.data + first * positions.stride, positions.stride };
+		OptimizeVertexCache(local.data(), local.data(), local.size(), vertexCount);
+		OptimizeOverdraw(optimized.data(), local.data(), local.size(), localPositions, vertexCount);
+
+		for (uint32_t i = 0; i < submesh.indexCount; ++i)
+			range[i] = optimized[i] + first;
+	}
+
+	// Submeshes come in vertex order, so ordering by first use keeps each
+	// submesh's vertices together.
+	std::vector<unsigned int> remap(numVertices);
+	OptimizeVertexFetchRemap(remap.data(), indices, numIndices, numVertices);
+	RemapVertices(remap.data(), numVertices);
+
+	for (size_t i = 0; i < numIndices; ++i)
+		indices[i] = remap[indices[i]];
+
+	for (size_t s = 0; s < numSubmeshes; ++s)
+	{
+		Submesh& submesh = submeshes[s];
+		if (submesh.indexCount > 0)
+			submesh.baseVertex = *std::min_element(indices + submesh.indexOffset, indices + submesh.indexOffset + submesh.indexCount);
+	}
+
+	if (nullptr != stats)
+	{
+		stats->cacheAfter = AnalyzeVertexCache(indices, numIndices, numVertices);
+		stats->fetchAfter = AnalyzeVertexFetch(indices, numIndices, numVertices, VertexSize);
+	}
+}
+
+void Mesh::GenerateLods(size_t lodCount, float reduction)
+{
+	if (0 == numIndices || lodCount < 2)
+		return;
+
+	MakeOwned();
+	ClearLods();
+
+	auto positions = GetPositions();
+	auto norms = GetNormals();
+	auto texcoords = GetUVs();
+
+	std::vector<unsigned int> allIndices(indices, indices + numIndices);
+	std::vector<Submesh> allSubmeshes(submeshes, submeshes + numSubmeshes);
+	std::vector<float> errors(1, 0.0f);
+	std::vector<unsigned int> local;
+
+	SimplifySettings settings = {};
+	settings.maxError = 1e30f;
+	settings.normalWeight = 0.01f;
+	settings.uvWeight = 0.01f;
+
+	for (size_t lod = 1; lod < lodCount; ++lod)
+	{
+		const Submesh* previous = &allSubmeshes[(lod - 1) * numSubmeshes];
+		size_t previousIndices = 0, lodIndices = 0;
+		float lodError = errors.back();
+
+		std::vector<Submesh> lodSubmeshes(numSubmeshes);
+		for (size_t s = 0; s < numSubmeshes; ++s)
+		{
+			// Copy out first, allIndices grows below.
+			Submesh source = previous[s];
+			previousIndices += source.indexCount;
+
+			// Every LOD uses a subset of the LOD 0 vertices.
+			unsigned int first, last;
+			GetVertexSpan(submeshes[s], first, last);
+			const size_t vertexCount = source.indexCount > 0 ? last - first + 1 : 0;
+
+			local.resize(source.indexCount);
+			for (uint32_t i = 0; i < source.indexCount; ++i)
+				local[i] = allIndices[source.indexOffset + i] - first;
+
+			settings.targetIndexCount = static_cast<size_t>(source.indexCount * reduction) / 3 * 3;
+
+			float error = 0.0f;
+			size_t count = SimplifyMesh(local.data(), local.data(), local.size(),
+				{ positions.data + first * positions.stride, positions.stride },
+				{ norms.data + first * norms.stride, norms.stride },
+				{ texcoords.data + first * texcoords.stride, texcoords.stride },
+				vertexCount, settings, &error);
+			OptimizeVertexCache(local.data(), local.data(), count, vertexCount);
+
+			lodSubmeshes[s] = { static_cast<uint32_t>(allIndices.size()), static_cast<uint32_t>(count), source.baseVertex, source.materialIndex };
+			for (size_t i = 0; i < count; ++i)
+				allIndices.push_back(local[i] + first);
+
+			lodIndices += count;
+			lodError = std::max(lodError, errors.back() + error);
+		}
+
+		// Stop once simplification stalls, the LOD would not pay for itself,
+		// or once nothing would be left to draw.
+		if (lodIndices > previousIndices * 9 / 10 || 0 == lodIndices)
+		{
+			allIndices.resize(allIndices.size() - lodIndices);
+			break;
+		}
+
+		allSubmeshes.insert(allSubmeshes.end(), lodSubmeshes.begin(), lodSubmeshes.end());
+		errors.push_back(lodError);
+	}
+
+	delete[] indices;
+	delete[] submeshes;
+	delete[] lodErrors;
+
+	numIndices = allIndices.size();
+	numLods = errors.size();
+	indices = new unsigned int[numIndices];
+	submeshes = new Submesh[allSubmeshes.size()];
+	lodErrors = new float[numLods];
+	std::copy(allIndices.begin(), allIndices.end(), indices);
+	std::copy(allSubmeshes.begin(), allSubmeshes.end(), submeshes);
+	std::copy(errors.begin(), errors.end(), lodErrors);
+}
+
+void Mesh::BuildMeshlets(size_t maxVertices, size_t maxTriangles)
+{
+	MakeOwned();
+	ClearMeshlets();
+
+	if (0 == numIndices)
+		return;
+
+	// Long submeshes are cut into chunks so one big submesh still spreads
+	// over every thread. Only the last meshlet of a chunk can be short.
+	const size_t chunkIndices = 16384 * 3;
+
+	struct Chunk
+	{
+		uint32_t		submesh;
+		size_t			indexOffset;
+		size_t			indexCount;
+		MeshletBuffer	buffer;
+	};
+
+	std::vector<Chunk> chunks;
+	for (size_t s = 0; s < numSubmeshes; ++s)
+	{
+		for (size_t i = 0; i < submeshes[s].indexCount; i += chunkIndices)
+		{
+			Chunk chunk;
+			chunk.submesh = static_cast<uint32_t>(s);
+			chunk.indexOffset = submeshes[s].indexOffset + i;
+			chunk.indexCount = std::min<size_t>(chunkIndices, submeshes[s].indexCount - i);
+			chunks.push_back(std::move(chunk));
+		}
+	}
+
+	ThreadPool::Shared().ParallelFor(chunks.size(), [&](size_t c)
+	{
+		Chunk& chunk = chunks[c];
+		::BuildMeshlets(chunk.buffer, indices + chunk.indexOffset, chunk.indexCount, chunk.submesh, maxVertices, maxTriangles);
+	});
+
+	// Prefix sums give every chunk its own slice of the final arrays.
+	std::vector<size_t> meshletStart(chunks.size()), vertexStart(chunks.size()), triangleStart(chunks.size());
+	for (size_t c = 0; c < chunks.size(); ++c)
+	{
+		meshletStart[c] = numMeshlets;
+		vertexStart[c] = numMeshletVertices;
+		triangleStart[c] = numMeshletTriangles * 3;
+		numMeshlets += chunks[c].buffer.meshlets.size();
+		numMeshletVertices += chunks[c].buffer.vertices.size();
+		numMeshletTriangles += chunks[c].buffer.triangles.size() / 3;
+	}
+
+	meshlets = new Meshlet[numMeshlets];
+	meshletVertices = new unsigned int[numMeshletVertices];
+	meshletTriangles = new uint8_t[numMeshletTriangles * 3];
+	meshletBounds = new MeshletBounds[numMeshlets];
+
+	auto positions = GetPositions();
+
+	ThreadPool::Shared().ParallelFor(chunks.size(), [&](size_t c)
+	{
+		const MeshletBuffer& buffer = chunks[c].buffer;
+		std::copy(buffer.vertices.begin(), buffer.vertices.end(), meshletVertices + vertexStart[c]);
+		std::copy(buffer.triangles.begin(), buffer.triangles.end(), meshletTriangles + triangleStart[c]);
+
+		for (size_t m = 0; m < buffer.meshlets.size(); ++m)
+		{
+			Meshlet& meshlet = meshlets[meshletStart[c] + m];
+			meshlet = buffer.meshlets[m];
+			meshlet.vertexOffset += static_cast<uint32_t>(vertexStart[c]);
+			meshlet.triangleOffset += static_cast<uint32_t>(triangleStart[c]);
+			meshletBounds[meshletStart[c] + m] = ComputeMeshletBounds(meshlet, meshletVertices, meshletTriangles, positions);
+		}
+	});
+}
+
+size_t Mesh::GetLodIndicesCount(size_t lod) const
+{
+	size_t count = 0;
+	for (size_t s = 0; s < numSubmeshes; ++s)
+		count += submeshes[lod * numSubmeshes + s].indexCount;
+	return count;
+}
+
+void Mesh::ClearLods()
+{
+	if (numLods <= 1)
+		return;
+
+	// LOD 0 comes first in the index buffer.
+	size_t end = 0;
+	for (size_t s = 0; s < numSubmeshes; ++s)
+		end = std::max(end, static_cast<size_t>(submeshes[s].indexOffset) + submeshes[s].indexCount);
+
+	numIndices = end;
+	numLods = 1;
+}
+
+void Mesh::ClearMeshlets()
+{
+	delete[] meshlets;
+	delete[] meshletVertices;
+	delete[] meshletTriangles;
+	delete[] meshletBounds;
+
+	meshlets = nullptr;
+	meshletVertices = nullptr;
+	meshletTriangles = nullptr;
+	meshletBounds = nullptr;
+	numMeshlets = 0;
+	numMeshletVertices = 0;
+	numMeshletTriangles = 0;
+}
+
+void Mesh::GetVertexSpan(const Submesh & submesh, unsigned int & first, unsigned int & last) const
+{
+	const unsigned int* range = indices + submesh.indexOffset;
+	first = submesh.indexCount > 0 ? range[0] : 0;
+	last = first;
+	for (uint32_t i = 1; i < submesh.indexCount; ++i)
+	{
+		if (range[i] < first) first = range[i];
+		if (range[i] > last) last = range[i];
+	}
+}
+
+void Mesh::MakeOwned()
+{
+	if (ownsData)
+		return;
+
+	auto Copy = [](auto* src, size_t count)
+	{
+		using T = typename std::remove_pointer<decltype(src)>::type;
+		if (nullptr == src)
+			return static_cast<T*>(nullptr);
+		T* dest = new T[count];
+		memcpy(dest, src, count * sizeof(T));
+		return dest;
+	};
+
+	vertices = Copy(vertices, numVertices);
+	normals = Copy(normals, numVertices);
+	tangents = Copy(tangents, numVertices);
+	uvs = Copy(uvs, numVertices);
+	interleaved = Copy(interleaved, numVertices);
+	indices = Copy(indices, numIndices);
+	submeshes = Copy(submeshes, numSubmeshes * numLods);
+	lodErrors = Copy(lodErrors, numLods);
+	meshlets = Copy(meshlets, numMeshlets);
+	meshletVertices = Copy(meshletVertices, numMeshletVertices);
+	meshletTriangles = Copy(meshletTriangles, numMeshletTriangles * 3);
+	meshletBounds = Copy(meshletBounds, numMeshlets);
+	ownsData = true;
+
+	cacheFile.Close();
+}
+
+void Mesh::RemapVertices(const unsigned int * remap, size_t newCount)
+{
+	auto Remap = [this, remap, newCount](auto*& data)
+	{
+		using T = typename std::remove_reference<decltype(*data)>::type;
+		if (nullptr == data)
+			return;
+		T* dest = new T[newCount];
+		// Backwards, so the first of several merged vertices is the one kept.
+		for (size_t i = numVertices; i-- > 0;)
+		{
+			if (InvalidIndex != remap[i])
+				dest[remap[i]] = data[i];
+		}
+		delete[] data;
+		data = dest;
+	};
+
+	Remap(vertices);
+	Remap(normals);
+	Remap(tangents);
+	Remap(uvs);
+	Remap(interleaved);
+
+	numVertices = newCount;
+	ComputeBounds();
+}
+
+void Mesh::ComputeBounds()
+{
+	bounds = Bounds();
+	if (0 == numVertices)
+		return;
+
+	auto positions = GetPositions();
+	bounds.min = bounds.max = positions[0];
+	for (size_t i = 1; i < numVertices; ++i)
+	{
+		const Vector3D& p = positions[i];
+		bounds.min = { std::min(bounds.min.x, p.x), std::min(bounds.min.y, p.y), std::min(bounds.min.z, p.z) };
+		bounds.max = { std::max(bounds.max.x, p.x), std::max(bounds.max.y, p.y), std::max(bounds.max.z, p.z) };
+	}
+
+	bounds.center = { (bounds.min.x + bounds.max.x) * 0.5f, (bounds.min.y + bounds.max.y) * 0.5f, (bounds.min.z + bounds.max.z) * 0.5f };
+	float radiusSquared = 0.0f;
+	for (size_t i = 0; i < numVertices; ++i)
+	{
+		const Vector3D& p = positions[i];
+		float dx = p.x - bounds.center.x, dy = p.y - bounds.center.y, dz = p.z - bounds.center.z;
+		radiusSquared = std::max(radiusSquared, dx * dx + dy * dy + dz * dz);
+	}
+	bounds.radius = std::sqrt(radiusSquared);
+}
+
+bool Mesh::HashSourceFile(const char * filename, uint64_t & hash)
+{
+	MappedFile source;
+	if (!source.Open(filename))
+		return false;
+
+	hash = HashBytes(source.GetData(), source.GetSize());
+	// Reserve zero for "no source hash".
+	if (0 == hash) hash = 1;
+	return true;
+}
+
+void Mesh::GetCacheFilename(const char * filename, char * cacheFilename, size_t size)
+{
+	snprintf(cacheFilename, size, "%s.mesh", filename);
+}
+
+size_t Mesh::GetPackedIndexRanges(IndexRange * ranges) const
+{
+	const size_t count = GetIndexRangesCount();
+
+	size_t offset = 0;
+	for (size_t s = 0; s < count; ++s)
+	{
+		const Submesh& submesh = submeshes[s];
+
+		unsigned int first, last;
+		GetVertexSpan(submesh, first, last);
+
+		uint32_t indexSize = last - first < 0xffff ? 2 : 4;
+		// Keep every range 4-byte aligned so it can start an index buffer view.
+		offset = (offset + 3) & ~size_t(3);
+
+		if (nullptr != ranges)
+			ranges[s] = { offset, submesh.indexCount, first, indexSize };
+
+		offset += static_cast<size_t>(submesh.indexCount) * indexSize;
+	}
+
+	return (offset + 3) & ~size_t(3);
+}
+
+void Mesh::FillInIndicesData(void * pDest, const IndexRange * ranges) const
+{
+	uint8_t* dest = reinterpret_cast<uint8_t*>(pDest);
+
+	for (size_t s = 0; s < GetIndexRangesCount(); ++s)
+	{
+		const IndexRange& range = ranges[s];
+		const unsigned int* src = indices + submeshes[s].indexOffset;
+
+		if (2 == range.indexSize)
+		{
+			uint16_t* out = reinterpret_cast<uint16_t*>(dest + range.byteOffset);
+			for (uint32_t i = 0; i < range.indexCount; ++i)
+				out[i] = static_cast<uint16_t>(src[i] - range.baseVertex);
+		}
+		else
+		{
+			uint32_t* out = reinterpret_cast<uint32_t*>(dest + range.byteOffset);
+			for (uint32_t i = 0; i < range.indexCount; ++i)
+				out[i] = src[i] - range.baseVertex;
+		}
+	}
+}
+
+Mesh::AttributeView<Mesh::Vector3D> Mesh::GetPositions() const
+{
+	if (IsInterleaved())
+		return { reinterpret_cast<const unsigned char*>(interleaved) + PositionOffset, VertexSize };
+	return { reinterpret_cast<const unsigned char*>(vertices), sizeof(Vector3D) };
+}
+
+Mesh::AttributeView<Mesh::Vector3D> Mesh::GetNormals() const
+{
+	if (IsInterleaved())
+		return { reinterpret_cast<const unsigned char*>(interleaved) + NormalOffset, VertexSize };
+	return { reinterpret_cast<const unsigned char*>(normals), sizeof(Vector3D) };
+}
+
+Mesh::AttributeView<Mesh::Vector3D> Mesh::GetTangents() const
+{
+	if (IsInterleaved())
+		return { reinterpret_cast<const unsigned char*>(interleaved) + TangentOffset, VertexSize };
+	return { reinterpret_cast<const unsigned char*>(tangents), sizeof(Vector3D) };
+}
+
+Mesh::AttributeView<Mesh::Vector2D> Mesh::GetUVs() const
+{
+	if (IsInterleaved())
+		return { reinterpret_cast<const unsigned char*>(interleaved) + UVOffset, VertexSize };
+	return { reinterpret_cast<const unsigned char*>(uvs), sizeof(Vector2D) };
 }
 
 void Mesh::FillInVerticesData(void * pDest) const
 {
-  Vertex* arr = reinterpret_cast<Vertex*>(pDest);
-  for (size_t i = 0; i < numVertices; i++)
-  {
-    arr[i].position = vertices[i];
-    arr[i].normal = normals[i];
-    arr[i].tangent = tangents[i];
-    arr[i].uv = uvs[i];
-  }
+	if (IsInterleaved())
+		StreamCopy(pDest, interleaved, numVertices * VertexSize);
+	else
+		InterleaveVertices(GetBestInterleaveKernel(), reinterpret_cast<Vertex*>(pDest), vertices, normals, tangents, uvs, numVertices);
 }
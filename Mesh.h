@@ -1,5 +1,13 @@
 #pragma once
 #include <stddef.h>
+#include <stdint.h>
+
+#include "MappedFile.h"
+
+struct MeshOptimizeStats;
+struct Meshlet;
+struct MeshletBounds;
+
 class Mesh
 {
 public:
@@ -22,6 +30,60 @@ public:
     Vector2D  uv;
   };
 
+  struct Submesh
+  {
+    uint32_t  indexOffset;
+    uint32_t  indexCount;
+    uint32_t  baseVertex;
+    uint32_t  materialIndex;
+  };
+
+  // Read-only view of one attribute, independent of whether the mesh keeps
+  // its vertices as separate arrays or as one interleaved stream.
+  template<typename T>
+  struct AttributeView
+  {
+    const unsigned char*  data;
+    size_t                stride;
+
+    const T& operator[](size_t i) const { return *reinterpret_cast<const T*>(data + i * stride); }
+  };
+
+  enum ImportFlags : unsigned int
+  {
+    ImportDefault = 0,
+    // Build the interleaved Vertex stream directly instead of the per-attribute arrays.
+    ImportInterleaved = 1 << 0,
+  };
+
+  // Where one submesh's indices live in the packed index buffer. Indices are
+  // relative to baseVertex and indexSize is 2 whenever they fit in 16 bits.
+  struct IndexRange
+  {
+    size_t    byteOffset;
+    uint32_t  indexCount;
+    uint32_t  baseVertex;
+    uint32_t  indexSize;
+  };
+
+  // Of the positions, computed whenever they are loaded or remapped.
+  struct Bounds
+  {
+    Vector3D  min;
+    Vector3D  max;
+    // Sphere around the box center, as tight as the vertices allow.
+    Vector3D  center;
+    float     radius;
+  };
+
+  struct WeldStats
+  {
+    size_t    verticesBefore;
+    size_t    verticesAfter;
+    size_t    indexBytes32;
+    size_t    indexBytesPacked;
+  };
+
   static constexpr size_t VertexSize = sizeof(Vertex);
   static constexpr unsigned int PositionOffset = offsetof(Vertex, position);
   static constexpr unsigned int NormalOffset = offsetof(Vertex, normal);
@@ -29,26 +91,123 @@ public:
   static constexpr unsigned int UVOffset = offsetof(Vertex, uv);
 
 public:
-	Mesh() : vertices(nullptr), normals(nullptr), tangents(nullptr), uvs(nullptr), indices(nullptr) {}
+	Mesh() : vertices(nullptr), normals(nullptr), tangents(nullptr), uvs(nullptr), interleaved(nullptr), indices(nullptr), submeshes(nullptr), lodErrors(nullptr), meshlets(nullptr), meshletVertices(nullptr), meshletTriangles(nullptr), meshletBounds(nullptr), numVertices(0), numIndices(0), numSubmeshes(0), numLods(1), numMeshlets(0), numMeshletVertices(0), numMeshletTriangles(0), bounds(), ownsData(false) {}
 	
 	~Mesh();
 
+	Mesh(const Mesh&) = delete;
+	Mesh& operator=(const Mesh&) = delete;
+
 	void Release();
 
-	void LoadFromFile(const char* filename);
+	// Loads the cooked cache next to filename when it matches the source,
+	// otherwise imports the source through Assimp.
+	bool LoadFromFile(const char* filename, unsigned int importFlags = ImportDefault);
+
+	bool ImportFromFile(const char* filename, unsigned int importFlags = ImportDefault);
+	bool LoadFromCache(const char* cacheFilename, uint64_t sourceHash);
+	// Uses a cooked mesh already in memory, such as an archive view, in place.
+	// data must stay valid while the mesh uses it; a sourceHash of 0 accepts any source.
+	bool LoadFromMemory(const void* data, size_t size, uint64_t sourceHash);
+	bool SaveToCache(const char* cacheFilename, uint64_t sourceHash) const;
+
+	// Merges vertices whose attributes all match within epsilon. Vertices are
+	// only merged inside a submesh, unreferenced vertices are dropped.
+	void Weld(float epsilon = 1e-6f, WeldStats* stats = nullptr);
+
+	// Reorders each submesh's triangles for the post-transform cache and
+	// overdraw, then the vertices for fetch locality.
+	void Optimize(MeshOptimizeStats* stats = nullptr);
+
+	// Appends up to lodCount - 1 simplified index sets, each with about
+	// reduction times the triangles of the previous one. All LODs share the
+	// vertex buffer. Weld and Optimize drop the chain, so this goes last.
+	void GenerateLods(size_t lodCount = 4, float reduction = 0.5f);
+
+	// Clusters LOD 0 into meshlets with culling bounds, in parallel. Weld and
+	// Optimize drop the meshlets.
+	void BuildMeshlets(size_t maxVertices = 64, size_t maxTriangles = 124);
+
+	static bool HashSourceFile(const char* filename, uint64_t& hash);
+	static void GetCacheFilename(const char* filename, char* cacheFilename, size_t size);
 
   void FillInVerticesData(void* pDest) const;
   size_t GetVerticesCount() const { return numVertices; }
 
+  bool IsInterleaved() const { return nullptr != interleaved; }
+  const Vertex* GetInterleavedVertices() const { return interleaved; }
+
+  AttributeView<Vector3D> GetPositions() const;
+  AttributeView<Vector3D> GetNormals() const;
+  AttributeView<Vector3D> GetTangents() const;
+  AttributeView<Vector2D> GetUVs() const;
+
+  const Bounds& GetBounds() const { return bounds; }
+
   const unsigned int* GetIndices() const { return indices; }
   size_t GetIndicesCount() const { return numIndices; }
 
+  // One range per submesh and LOD, LOD l's ranges start at l * GetSubmeshesCount().
+  size_t GetIndexRangesCount() const { return numSubmeshes * numLods; }
+  // Fills ranges (if not null) and returns the size of the packed index buffer.
+  size_t GetPackedIndexRanges(IndexRange* ranges) const;
+  void FillInIndicesData(void* pDest, const IndexRange* ranges) const;
+
+  const Submesh* GetSubmeshes() const { return submeshes; }
+  size_t GetSubmeshesCount() const { return numSubmeshes; }
+
+  size_t GetLodsCount() const { return numLods; }
+  // Largest geometric deviation from LOD 0, in mesh units: for each vertex,
+  // the sum of the distances its collapses moved it off their triangles.
+  float GetLodError(size_t lod) const { return nullptr != lodErrors ? lodErrors[lod] : 0.0f; }
+  const float* GetLodErrors() const { return lodErrors; }
+  size_t GetLodIndicesCount(size_t lod) const;
+
+  const Meshlet* GetMeshlets() const { return meshlets; }
+  const MeshletBounds* GetMeshletBounds() const { return meshletBounds; }
+  size_t GetMeshletsCount() const { return numMeshlets; }
+  const unsigned int* GetMeshletVertices() const { return meshletVertices; }
+  size_t GetMeshletVerticesCount() const { return numMeshletVertices; }
+  // 3 local vertex indices per triangle.
+  const uint8_t* GetMeshletTriangles() const { return meshletTriangles; }
+  size_t GetMeshletTrianglesCount() const { return numMeshletTriangles; }
+
+  bool IsMapped() const { return cacheFile.IsOpen(); }
+
 private:
+	// Copies data that still lives in the cache mapping so it can be modified.
+	void MakeOwned();
+	// Points the arrays into a cooked mesh after validating it.
+	bool AttachCache(const void* cacheData, size_t size, uint64_t sourceHash);
+	// Drops every LOD but the first.
+	void ClearLods();
+	void ClearMeshlets();
+	void GetVertexSpan(const Submesh& submesh, unsigned int& first, unsigned int& last) const;
+
+	// Moves vertex i to remap[i], dropping the ones mapped to ~0u.
+	void RemapVertices(const unsigned int* remap, size_t newCount);
+	void ComputeBounds();
+
   Vector3D*		vertices;
   Vector3D*		normals;
   Vector3D*		tangents;
   Vector2D*		uvs;
+	Vertex*			interleaved;
 	unsigned int*	indices;
+	Submesh*		submeshes;
+	float*			lodErrors;
+	Meshlet*		meshlets;
+	unsigned int*	meshletVertices;
+	uint8_t*		meshletTriangles;
+	MeshletBounds*	meshletBounds;
 	size_t			numVertices;
 	size_t			numIndices;
+	size_t			numSubmeshes;
+	size_t			numLods;
+	size_t			numMeshlets;
+	size_t			numMeshletVertices;
+	size_t			numMeshletTriangles;
+	Bounds			bounds;
+	bool			ownsData;
+	MappedFile		cacheFile;
 };
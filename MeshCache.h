@@ -0,0 +1,45 @@
+#pragma once
+#include <stdint.h>
+
+// On-disk layout of a cooked mesh (*.mesh), written by AssetCooker and
+// mapped directly by Mesh::LoadFromCache. Every blob is aligned to
+// MeshCacheAlignment so the arrays can be used in place.
+
+constexpr uint32_t MeshCacheMagic = 0x4853454d;	// 'MESH'
+constexpr uint32_t MeshCacheVersion = 4;
+constexpr uint64_t MeshCacheAlignment = 64;
+
+struct MeshCacheBlob
+{
+	uint64_t	offset;
+	uint64_t	size;
+};
+
+struct MeshCacheHeader
+{
+	uint32_t		magic;
+	uint32_t		version;
+	uint64_t		sourceHash;
+	uint64_t		fileSize;
+	uint64_t		numVertices;
+	uint64_t		numIndices;
+	// The submesh table holds numSubmeshes entries per LOD.
+	uint64_t		numSubmeshes;
+	uint64_t		numLods;
+	uint64_t		numMeshlets;
+	uint64_t		numMeshletVertices;
+	uint64_t		numMeshletTriangles;
+
+	MeshCacheBlob	positions;
+	MeshCacheBlob	normals;
+	MeshCacheBlob	tangents;
+	MeshCacheBlob	uvs;
+	MeshCacheBlob	indices;
+	MeshCacheBlob	submeshes;
+	MeshCacheBlob	lodErrors;
+	MeshCacheBlob	meshlets;
+	MeshCacheBlob	meshletVertices;
+	// 3 bytes per triangle.
+	MeshCacheBlob	meshletTriangles;
+	MeshCacheBlob	meshletBounds;
+};
@@ -0,0 +1,430 @@
+#include "MeshOptimizer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+namespace
+{
+	constexpr unsigned int InvalidIndex = ~0u;
+
+	// Forsyth scoring constants, from "Linear-Speed Vertex Cache Optimisation".
+	constexpr int ScoreCacheSize = 32;
+	constexpr float CacheDecayPower = 1.5f;
+	constexpr float LastTriangleScore = 0.75f;
+	constexpr float ValenceBoostScale = 2.0f;
+	constexpr float ValenceBoostPower = 0.5f;
+
+	float VertexScore(int cachePosition, unsigned int liveTriangles)
+	{
+		if (0 == liveTriangles)
+			return -1.0f;
+
+		float score = 0.0f;
+		if (cachePosition >= 0)
+		{
+			if (cachePosition < 3)
+			{
+				score = LastTriangleScore;
+			}
+			else
+			{
+				const float scaler = 1.0f / (ScoreCacheSize - 3);
+				score = std::pow(1.0f - (cachePosition - 3) * scaler, CacheDecayPower);
+			}
+		}
+
+		score += ValenceBoostScale * std::pow(static_cast<float>(liveTriangles), -ValenceBoostPower);
+		return score;
+	}
+
+	// Counts misses of a FIFO cache, resetting it at each cluster start.
+	class FifoCache
+	{
+	public:
+		FifoCache(size_t vertexCount, unsigned int size) : timestamps(vertexCount, 0), time(size + 1), size(size) {}
+
+		bool Touch(unsigned int v)
+		{
+			if (time - timestamps[v] > size)
+			{
+				timestamps[v] = time++;
+				return true;
+			}
+			return false;
+		}
+
+		void Flush() { time += size + 1; }
+
+	private:
+		std::vector<unsigned int>	timestamps;
+		unsigned int				time;
+		unsigned int				size;
+	};
+}
+
+VertexCacheStats AnalyzeVertexCache(const unsigned int * indices, size_t indexCount, size_t vertexCount, unsigned int cacheSize)
+{
+	VertexCacheStats stats = {};
+	if (indexCount < 3 || 0 == vertexCount)
+		return stats;
+
+	FifoCache cache(vertexCount, cacheSize);
+	std::vector<bool> used(vertexCount, false);
+	size_t misses = 0, unique = 0;
+
+	for (size_t i = 0; i < indexCount; ++i)
+	{
+		unsigned int v = indices[i];
+		if (cache.Touch(v))
+			misses++;
+		if (!used[v])
+		{
+			used[v] = true;
+			unique++;
+		}
+	}
+
+	stats.acmr = static_cast<double>(misses) / (indexCount / 3);
+	stats.atvr = static_cast<double>(misses) / unique;
+	return stats;
+}
+
+VertexFetchStats AnalyzeVertexFetch(const unsigned int * indices, size_t indexCount, size_t vertexCount, size_t vertexSize)
+{
+	const size_t LineSize = 64;
+	const unsigned int CacheLines = 64;
+
+	VertexFetchStats stats = {};
+	if (0 == indexCount || 0 == vertexCount)
+		return stats;
+
+	FifoCache cache((vertexCount * vertexSize + LineSize - 1) / LineSize, CacheLines);
+	std::vector<bool> used(vertexCount, false);
+	size_t fetchedLines = 0, unique = 0;
+
+	for (size_t i = 0; i < indexCount; ++i)
+	{
+		unsigned int v = indices[i];
+		if (!used[v])
+		{
+			used[v] = true;
+			unique++;
+		}
+
+		size_t first = v * vertexSize / LineSize;
+		size_t last = (v * vertexSize + vertexSize - 1) / LineSize;
+		for (size_t line = first; line <= last; ++line)
+		{
+			if (cache.Touch(static_cast<unsigned int>(line)))
+				fetchedLines++;
+		}
+	}
+
+	stats.overfetch = static_cast<double>(fetchedLines * LineSize) / (unique * vertexSize);
+	stats.efficiency = 1.0 / stats.overfetch;
+	return stats;
+}
+
+void OptimizeVertexCache(unsigned int * dest, const unsigned int * indices, size_t indexCount, size_t vertexCount)
+{
+	const size_t triangleCount = indexCount / 3;
+	if (0 == triangleCount)
+		return;
+
+	// Vertex to triangle adjacency, packed.
+	std::vector<unsigned int> liveTriangles(vertexCount, 0);
+	for (size_t i = 0; i < indexCount; ++i)
+		liveTriangles[indices[i]]++;
+
+	std::vector<unsigned int> adjacencyOffsets(vertexCount + 1, 0);
+	for (size_t v = 0; v < vertexCount; ++v)
+		adjacencyOffsets[v + 1] = adjacencyOffsets[v] + liveTriangles[v];
+
+	std::vector<unsigned int> adjacency(indexCount);
+	{
+		std::vector<unsigned int> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+		for (size_t t = 0; t < triangleCount; ++t)
+		{
+			for (int k = 0; k < 3; ++k)
+				adjacency[fill[indices[t * 3 + k]]++] = static_cast<unsigned int>(t);
+		}
+	}
+
+	std::vector<int> cachePosition(vertexCount, -1);
+	std::vector<float> vertexScores(vertexCount);
+	for (size_t v = 0; v < vertexCount; ++v)
+		vertexScores[v] = VertexScore(-1, liveTriangles[v]);
+
+	std::vector<float> triangleScores(triangleCount);
+	std::vector<bool> emitted(triangleCount, false);
+	for (size_t t = 0; t < triangleCount; ++t)
+	{
+		triangleScores[t] = vertexScores[indices[t * 3]] + vertexScores[indices[t * 3 + 1]] + vertexScores[indices[t * 3 + 2]];
+	}
+
+	std::vector<unsigned int> output(indexCount);
+	unsigned int cache[ScoreCacheSize + 3];
+	unsigned int newCache[ScoreCacheSize + 3];
+	int cacheCount = 0;
+
+	size_t cursor = 0;
+	unsigned int best = 0;
+	{
+		float bestScore = -1.0f;
+		for (size_t t = 0; t < triangleCount; ++t)
+		{
+			if (triangleScores[t] > bestScore)
+			{
+				bestScore = triangleScores[t];
+				best = static_cast<unsigned int>(t);
+			}
+		}
+	}
+
+	for (size_t emittedCount = 0; emittedCount < triangleCount; ++emittedCount)
+	{
+		const unsigned int* tri = &indices[best * 3];
+		output[emittedCount * 3 + 0] = tri[0];
+		output[emittedCount * 3 + 1] = tri[1];
+		output[emittedCount * 3 + 2] = tri[2];
+		emitted[best] = true;
+
+		// Drop the triangle from its vertices' live adjacency.
+		for (int k = 0; k < 3; ++k)
+		{
+			unsigned int v = tri[k];
+			unsigned int* begin = &adjacency[adjacencyOffsets[v]];
+			unsigned int* end = begin + liveTriangles[v];
+			unsigned int* it = std::find(begin, end, best);
+			if (it != end)
+			{
+				*it = *(end - 1);
+				liveTriangles[v]--;
+			}
+		}
+
+		// The triangle's vertices move to the front of the cache.
+		int newCount = 0;
+		for (int k = 0; k < 3; ++k)
+			newCache[newCount++] = tri[k];
+		for (int i = 0; i < cacheCount; ++i)
+		{
+			unsigned int v = cache[i];
+			if (v != tri[0] && v != tri[1] && v != tri[2])
+				newCache[newCount++] = v;
+		}
+
+		for (int i = ScoreCacheSize; i < newCount; ++i)
+			cachePosition[newCache[i]] = -1;
+		if (newCount > ScoreCacheSize)
+			newCount = ScoreCacheSize;
+
+		// Rescore every vertex whose cache position changed.
+		for (int i = 0; i < newCount; ++i)
+		{
+			unsigned int v = newCache[i];
+			cachePosition[v] = i;
+			float score = VertexScore(i, liveTriangles[v]);
+			float delta = score - vertexScores[v];
+			vertexScores[v] = score;
+
+			const unsigned int* adj = &adjacency[adjacencyOffsets[v]];
+			for (unsigned int j = 0; j < liveTriangles[v]; ++j)
+				triangleScores[adj[j]] += delta;
+		}
+
+		// Vertices that fell out of the cache lose their cache score.
+		for (int i = 0; i < cacheCount; ++i)
+		{
+			unsigned int v = cache[i];
+			if (cachePosition[v] >= 0)
+				continue;
+			float score = VertexScore(-1, liveTriangles[v]);
+			float delta = score - vertexScores[v];
+			vertexScores[v] = score;
+
+			const unsigned int* adj = &adjacency[adjacencyOffsets[v]];
+			for (unsigned int j = 0; j < liveTriangles[v]; ++j)
+				triangleScores[adj[j]] += delta;
+		}
+
+		std::copy(newCache, newCache + newCount, cache);
+		cacheCount = newCount;
+
+		// Only triangles around the cache can have gained, pick the best of them.
+		float bestScore = 0.0f;
+		unsigned int next = InvalidIndex;
+		for (int i = 0; i < cacheCount; ++i)
+		{
+			unsigned int v = cache[i];
+			const unsigned int* adj = &adjacency[adjacencyOffsets[v]];
+			for (unsigned int j = 0; j < liveTriangles[v]; ++j)
+			{
+				unsigned int t = adj[j];
+				if (triangleScores[t] > bestScore)
+				{
+					bestScore = triangleScores[t];
+					next = t;
+				}
+			}
+		}
+
+		if (InvalidIndex == next)
+		{
+			// Dead end, restart at the next triangle in input order.
+			while (cursor < triangleCount && emitted[cursor])
+				cursor++;
+			if (cursor == triangleCount)
+				break;
+			next = static_cast<unsigned int>(cursor);
+		}
+		best = next;
+	}
+
+	std::copy(output.begin(), output.end(), dest);
+}
+
+void OptimizeOverdraw(unsigned int * dest, const unsigned int * indices, size_t indexCount, Mesh::AttributeView<Mesh::Vector3D> positions, size_t vertexCount, float threshold)
+{
+	const size_t triangleCount = indexCount / 3;
+	const unsigned int CacheSize = 16;
+	const size_t MinClusterTriangles = 32;
+
+	if (0 == triangleCount)
+		return;
+
+	const double targetAcmr = AnalyzeVertexCache(indices, indexCount, vertexCount, CacheSize).acmr * threshold;
+
+	// Cut the list into clusters whose cold-start ACMR is within the target,
+	// so that reordering them costs at most the threshold.
+	std::vector<size_t> clusterStarts;
+	{
+		FifoCache cache(vertexCount, CacheSize);
+		size_t start = 0, misses = 0;
+		clusterStarts.push_back(0);
+
+		for (size_t t = 0; t < triangleCount; ++t)
+		{
+			for (int k = 0; k < 3; ++k)
+			{
+				if (cache.Touch(indices[t * 3 + k]))
+					misses++;
+			}
+
+			size_t triangles = t + 1 - start;
+			if (triangles >= MinClusterTriangles && static_cast<double>(misses) / triangles <= targetAcmr && t + 1 < triangleCount)
+			{
+				start = t + 1;
+				misses = 0;
+				cache.Flush();
+				clusterStarts.push_back(start);
+			}
+		}
+	}
+	clusterStarts.push_back(triangleCount);
+
+	const size_t clusterCount = clusterStarts.size() - 1;
+
+	double meshCentroid[3] = { 0.0, 0.0, 0.0 };
+	double meshArea = 0.0;
+
+	struct Cluster
+	{
+		double	centroid[3];
+		double	normal[3];
+		double	area;
+		double	sortKey;
+	};
+	std::vector<Cluster> clusters(clusterCount);
+
+	for (size_t c = 0; c < clusterCount; ++c)
+	{
+		Cluster& cluster = clusters[c];
+		cluster = {};
+
+		for (size_t t = clusterStarts[c]; t < clusterStarts[c + 1]; ++t)
+		{
+			const Mesh::Vector3D& a = positions[indices[t * 3 + 0]];
+			const Mesh::Vector3D& b = positions[indices[t * 3 + 1]];
+			const Mesh::Vector3D& d = positions[indices[t * 3 + 2]];
+
+			double e1[3] = { b.x - a.x, b.y - a.y, b.z - a.z };
+			double e2[3] = { d.x - a.x, d.y - a.y, d.z - a.z };
+			double n[3] = { e1[1] * e2[2] - e1[2] * e2[1], e1[2] * e2[0] - e1[0] * e2[2], e1[0] * e2[1] - e1[1] * e2[0] };
+			double area = 0.5 * std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+
+			double center[3] = { (a.x + b.x + d.x) / 3.0, (a.y + b.y + d.y) / 3.0, (a.z + b.z + d.z) / 3.0 };
+			for (int k = 0; k < 3; ++k)
+			{
+				cluster.centroid[k] += center[k] * area;
+				// The cross product length is twice the area, so this is an area weighted normal.
+				cluster.normal[k] += n[k];
+				meshCentroid[k] += center[k] * area;
+			}
+			cluster.area += area;
+			meshArea += area;
+		}
+
+		if (cluster.area > 0.0)
+		{
+			for (int k = 0; k < 3; ++k)
+				cluster.centroid[k] /= cluster.area;
+		}
+	}
+
+	if (meshArea > 0.0)
+	{
+		for (int k = 0; k < 3; ++k)
+			meshCentroid[k] /= meshArea;
+	}
+
+	for (Cluster& cluster : clusters)
+	{
+		double len = std::sqrt(cluster.normal[0] * cluster.normal[0] + cluster.normal[1] * cluster.normal[1] + cluster.normal[2] * cluster.normal[2]);
+		cluster.sortKey = 0.0;
+		if (len > 0.0)
+		{
+			for (int k = 0; k < 3; ++k)
+				cluster.sortKey += (cluster.centroid[k] - meshCentroid[k]) * cluster.normal[k] / len;
+		}
+	}
+
+	std::vector<size_t> order(clusterCount);
+	for (size_t c = 0; c < clusterCount; ++c)
+		order[c] = c;
+	std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) { return clusters[a].sortKey > clusters[b].sortKey; });
+
+	size_t out = 0;
+	for (size_t c : order)
+	{
+		for (size_t t = clusterStarts[c]; t < clusterStarts[c + 1]; ++t)
+		{
+			dest[out++] = indices[t * 3 + 0];
+			dest[out++] = indices[t * 3 + 1];
+			dest[out++] = indices[t * 3 + 2];
+		}
+	}
+}
+
+size_t OptimizeVertexFetchRemap(unsigned int * remap, const unsigned int * indices, size_t indexCount, size_t vertexCount)
+{
+	std::fill(remap, remap + vertexCount, InvalidIndex);
+
+	unsigned int next = 0;
+	for (size_t i = 0; i < indexCount; ++i)
+	{
+		unsigned int v = indices[i];
+		if (InvalidIndex == remap[v])
+			remap[v] = next++;
+	}
+
+	size_t referenced = next;
+	for (size_t v = 0; v < vertexCount; ++v)
+	{
+		if (InvalidIndex == remap[v])
+			remap[v] = next++;
+	}
+
+	return referenced;
+}
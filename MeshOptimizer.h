@@ -0,0 +1,50 @@
+#pragma once
+#include <stddef.h>
+
+#include "Mesh.h"
+
+// Index and vertex reordering for GPU locality. Every function works on a
+// plain triangle list, so they can be run per submesh.
+
+struct VertexCacheStats
+{
+	// Average cache miss ratio: transformed vertices per triangle, 0.5 is the ideal for large meshes.
+	double		acmr;
+	// Average transform to vertex ratio: transformed vertices per unique vertex, 1.0 is ideal.
+	double		atvr;
+};
+
+struct VertexFetchStats
+{
+	// Bytes pulled from memory divided by the bytes of the vertices referenced, 1.0 is ideal.
+	double		overfetch;
+	// Share of fetched bytes that belong to a referenced vertex, the inverse of overfetch.
+	double		efficiency;
+};
+
+struct MeshOptimizeStats
+{
+	VertexCacheStats	cacheBefore;
+	VertexCacheStats	cacheAfter;
+	VertexFetchStats	fetchBefore;
+	VertexFetchStats	fetchAfter;
+};
+
+// Simulates a FIFO post-transform cache.
+VertexCacheStats AnalyzeVertexCache(const unsigned int* indices, size_t indexCount, size_t vertexCount, unsigned int cacheSize = 16);
+
+// Simulates vertex fetch through a small cache of 64-byte lines.
+VertexFetchStats AnalyzeVertexFetch(const unsigned int* indices, size_t indexCount, size_t vertexCount, size_t vertexSize);
+
+// Forsyth's linear-speed vertex cache optimization. dest may alias indices.
+void OptimizeVertexCache(unsigned int* dest, const unsigned int* indices, size_t indexCount, size_t vertexCount);
+
+// Splits a cache optimized list into clusters that each keep their ACMR
+// within threshold of the whole list, then sorts the clusters so that the
+// ones facing outwards are drawn first and occlude the rest. dest may not
+// alias indices.
+void OptimizeOverdraw(unsigned int* dest, const unsigned int* indices, size_t indexCount, Mesh::AttributeView<Mesh::Vector3D> positions, size_t vertexCount, float threshold = 1.05f);
+
+// Fills remap with the new position of every vertex, ordered by first use.
+// Unreferenced vertices go last. Returns the number of referenced vertices.
+size_t OptimizeVertexFetchRemap(unsigned int* remap, const unsigned int* indices, size_t indexCount, size_t vertexCount);
@@ -0,0 +1,377 @@
+#include "MeshSimplifier.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <unordered_map>
+#include <vector>
+
+namespace
+{
+	constexpr unsigned int InvalidIndex = ~0u;
+
+	// Symmetric 4x4 matrix of a weighted sum of squared plane distances.
+	struct Quadric
+	{
+		double	a2, ab, ac, ad, b2, bc, bd, c2, cd, d2;
+		double	weight;
+
+		void AddPlane(double a, double b, double c, double d, double weight)
+		{
+			a2 += weight * a * a; ab += weight * a * b; ac += weight * a * c; ad += weight * a * d;
+			b2 += weight * b * b; bc += weight * b * c; bd += weight * b * d;
+			c2 += weight * c * c; cd += weight * c * d;
+			d2 += weight * d * d;
+			this->weight += weight;
+		}
+
+		void Add(const Quadric& q)
+		{
+			a2 += q.a2; ab += q.ab; ac += q.ac; ad += q.ad;
+			b2 += q.b2; bc += q.bc; bd += q.bd;
+			c2 += q.c2; cd += q.cd;
+			d2 += q.d2;
+			weight += q.weight;
+		}
+
+		// Weighted mean squared distance, so the result is in squared position units.
+		double Evaluate(const Mesh::Vector3D& p) const
+		{
+			if (weight <= 0.0)
+				return 0.0;
+
+			double x = p.x, y = p.y, z = p.z;
+			double r = a2 * x * x + 2 * ab * x * y + 2 * ac * x * z + 2 * ad * x
+				+ b2 * y * y + 2 * bc * y * z + 2 * bd * y
+				+ c2 * z * z + 2 * cd * z
+				+ d2;
+			return r < 0.0 ? 0.0 : r / weight;
+		}
+	};
+
+	// Moves every vertex at from's position onto to's position.
+	struct Collapse
+	{
+		unsigned int	from;
+		unsigned int	to;
+		// Quadric error plus the attribute penalty, used for ordering.
+		double			cost;
+	};
+
+	void Cross(const Mesh::Vector3D& a, const Mesh::Vector3D& b, const Mesh::Vector3D& c, double n[3])
+	{
+		double e1[3] = { b.x - a.x, b.y - a.y, b.z - a.z };
+		double e2[3] = { c.x - a.x, c.y - a.y, c.z - a.z };
+		n[0] = e1[1] * e2[2] - e1[2] * e2[1];
+		n[1] = e1[2] * e2[0] - e1[0] * e2[2];
+		n[2] = e1[0] * e2[1] - e1[1] * e2[0];
+	}
+
+	struct PositionKey
+	{
+		float	x, y, z;
+
+		bool operator==(const PositionKey& other) const { return x == other.x && y == other.y && z == other.z; }
+	};
+
+	struct PositionKeyHash
+	{
+		size_t operator()(const PositionKey& key) const
+		{
+			uint32_t h[3];
+			memcpy(h, &key, sizeof(h));
+			return (h[0] * 73856093u) ^ (h[1] * 19349663u) ^ (h[2] * 83492791u);
+		}
+	};
+}
+
+size_t SimplifyMesh(unsigned int * dest, const unsigned int * indices, size_t indexCount,
+	Mesh::AttributeView<Mesh::Vector3D> positions, Mesh::AttributeView<Mesh::Vector3D> normals, Mesh::AttributeView<Mesh::Vector2D> uvs,
+	size_t vertexCount, const SimplifySettings & settings, float * resultError)
+{
+	std::vector<unsigned int> result(indices, indices + indexCount);
+	double maxError = 0.0;
+
+	// Vertices sharing a position are attribute seams, they collapse together.
+	std::vector<unsigned int> positionId(vertexCount);
+	size_t positionCount = 0;
+	{
+		std::unordered_map<PositionKey, unsigned int, PositionKeyHash> ids;
+		ids.reserve(vertexCount);
+		for (size_t v = 0; v < vertexCount; ++v)
+		{
+			const Mesh::Vector3D& p = positions[v];
+			positionId[v] = ids.insert({ { p.x, p.y, p.z }, static_cast<unsigned int>(ids.size()) }).first->second;
+		}
+		positionCount = ids.size();
+	}
+
+	// The vertices at each position.
+	std::vector<unsigned int> positionOffsets(positionCount + 1, 0);
+	std::vector<unsigned int> positionVertices(vertexCount);
+	for (size_t v = 0; v < vertexCount; ++v)
+		positionOffsets[positionId[v] + 1]++;
+	for (size_t p = 0; p < positionCount; ++p)
+		positionOffsets[p + 1] += positionOffsets[p];
+	{
+		std::vector<unsigned int> fill(positionOffsets.begin(), positionOffsets.end() - 1);
+		for (size_t v = 0; v < vertexCount; ++v)
+			positionVertices[fill[positionId[v]]++] = static_cast<unsigned int>(v);
+	}
+
+	// Open borders, counted on positions so that seams are not borders.
+	std::vector<bool> locked(positionCount, false);
+	{
+		std::unordered_map<uint64_t, int> edges;
+		edges.reserve(indexCount);
+		for (size_t i = 0; i < indexCount; i += 3)
+		{
+			for (int k = 0; k < 3; ++k)
+			{
+				uint64_t a = positionId[result[i + k]], b = positionId[result[i + (k + 1) % 3]];
+				edges[a < b ? (a << 32) | b : (b << 32) | a]++;
+			}
+		}
+		for (size_t i = 0; i < indexCount; i += 3)
+		{
+			for (int k = 0; k < 3; ++k)
+			{
+				uint64_t a = positionId[result[i + k]], b = positionId[result[i + (k + 1) % 3]];
+				if (edges[a < b ? (a << 32) | b : (b << 32) | a] == 1)
+					locked[a] = locked[b] = true;
+			}
+		}
+	}
+
+	// Mesh extent scales the attribute penalties into position units.
+	double extent2 = 0.0;
+	if (vertexCount > 0)
+	{
+		double lo[3] = { positions[0].x, positions[0].y, positions[0].z }, hi[3] = { lo[0], lo[1], lo[2] };
+		for (size_t v = 1; v < vertexCount; ++v)
+		{
+			double p[3] = { positions[v].x, positions[v].y, positions[v].z };
+			for (int c = 0; c < 3; ++c)
+			{
+				lo[c] = std::min(lo[c], p[c]);
+				hi[c] = std::max(hi[c], p[c]);
+			}
+		}
+		extent2 = (hi[0] - lo[0]) * (hi[0] - lo[0]) + (hi[1] - lo[1]) * (hi[1] - lo[1]) + (hi[2] - lo[2]) * (hi[2] - lo[2]);
+	}
+
+	// Cost of giving vertex from the normal and UV of vertex to.
+	auto attributePenalty = [&](unsigned int from, unsigned int to)
+	{
+		const Mesh::Vector3D& na = normals[from];
+		const Mesh::Vector3D& nb = normals[to];
+		double dot = na.x * nb.x + na.y * nb.y + na.z * nb.z;
+		double du = uvs[from].x - uvs[to].x, dv = uvs[from].y - uvs[to].y;
+		return extent2 * (settings.normalWeight * (1.0 - dot) + settings.uvWeight * (du * du + dv * dv));
+	};
+
+	std::vector<Quadric> quadrics(positionCount, Quadric());
+	for (size_t i = 0; i < indexCount; i += 3)
+	{
+		double n[3];
+		Cross(positions[result[i]], positions[result[i + 1]], positions[result[i + 2]], n);
+		double len = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+		if (len <= 0.0)
+			continue;
+
+		double a = n[0] / len, b = n[1] / len, c = n[2] / len;
+		const Mesh::Vector3D& p = positions[result[i]];
+		double d = -(a * p.x + b * p.y + c * p.z);
+		for (int k = 0; k < 3; ++k)
+			quadrics[positionId[result[i + k]]].AddPlane(a, b, c, d, len * 0.5);
+	}
+
+	// How far each position may be from the original surface: a collapse
+	// adds how far it moves off the planes of the triangles it drags along.
+	std::vector<double> deviations(positionCount, 0.0);
+
+	std::vector<unsigned int> adjacencyOffsets(vertexCount + 1);
+	std::vector<unsigned int> adjacency;
+	std::vector<Collapse> collapses;
+	std::vector<unsigned int> remap(vertexCount);
+	std::vector<bool> touched(positionCount);
+
+	while (result.size() > settings.targetIndexCount)
+	{
+		const size_t triangleCount = result.size() / 3;
+
+		// Vertex to triangle adjacency of the current list.
+		std::fill(adjacencyOffsets.begin(), adjacencyOffsets.end(), 0);
+		for (unsigned int v : result)
+			adjacencyOffsets[v + 1]++;
+		for (size_t v = 0; v < vertexCount; ++v)
+			adjacencyOffsets[v + 1] += adjacencyOffsets[v];
+		adjacency.resize(result.size());
+		{
+			std::vector<unsigned int> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+			for (size_t t = 0; t < triangleCount; ++t)
+			{
+				for (int k = 0; k < 3; ++k)
+					adjacency[fill[result[t * 3 + k]]++] = static_cast<unsigned int>(t);
+			}
+		}
+
+		collapses.clear();
+		for (size_t i = 0; i < result.size(); i += 3)
+		{
+			for (int k = 0; k < 3; ++k)
+			{
+				unsigned int from = result[i + k], to = result[i + (k + 1) % 3];
+				for (int dir = 0; dir < 2; ++dir, std::swap(from, to))
+				{
+					if (locked[positionId[from]] || positionId[from] == positionId[to])
+						continue;
+
+					Quadric q = quadrics[positionId[from]];
+					q.Add(quadrics[positionId[to]]);
+					collapses.push_back({ from, to, q.Evaluate(positions[to]) + attributePenalty(from, to) });
+				}
+			}
+		}
+
+		if (collapses.empty())
+			break;
+
+		std::sort(collapses.begin(), collapses.end(), [](const Collapse& a, const Collapse& b) { return a.cost < b.cost; });
+
+		for (size_t v = 0; v < vertexCount; ++v)
+			remap[v] = static_cast<unsigned int>(v);
+		std::fill(touched.begin(), touched.end(), false);
+
+		// Every collapse removes about two triangles.
+		size_t trianglesLeft = triangleCount;
+		const size_t targetTriangles = settings.targetIndexCount / 3;
+		size_t applied = 0;
+
+		for (const Collapse& collapse : collapses)
+		{
+			if (trianglesLeft <= targetTriangles)
+				break;
+			const unsigned int from = positionId[collapse.from], to = positionId[collapse.to];
+			if (touched[from] || touched[to])
+				continue;
+
+			// Reject collapses that flip a triangle around the moving position,
+			// and measure how far the others move off their planes.
+			bool flips = false;
+			size_t removed = 0;
+			double distance = 0.0;
+			const Mesh::Vector3D& target = positions[collapse.to];
+			for (unsigned int i = positionOffsets[from]; i < positionOffsets[from + 1] && !flips; ++i)
+			{
+				const unsigned int v = positionVertices[i];
+				for (unsigned int j = adjacencyOffsets[v]; j < adjacencyOffsets[v + 1] && !flips; ++j)
+				{
+					const unsigned int* tri = &result[adjacency[j] * 3];
+					if (positionId[tri[0]] == to || positionId[tri[1]] == to || positionId[tri[2]] == to)
+					{
+						removed++;
+						continue;
+					}
+
+					Mesh::Vector3D moved[3] = { positions[tri[0]], positions[tri[1]], positions[tri[2]] };
+					for (int k = 0; k < 3; ++k)
+					{
+						if (positionId[tri[k]] == from)
+							moved[k] = target;
+					}
+
+					double before[3], after[3];
+					Cross(positions[tri[0]], positions[tri[1]], positions[tri[2]], before);
+					Cross(moved[0], moved[1], moved[2], after);
+					flips = before[0] * after[0] + before[1] * after[1] + before[2] * after[2] <= 0.0;
+
+					const double len = std::sqrt(before[0] * before[0] + before[1] * before[1] + before[2] * before[2]);
+					const Mesh::Vector3D& p = positions[tri[0]];
+					if (len > 0.0)
+						distance = std::max(distance, std::fabs(before[0] * (target.x - p.x) + before[1] * (target.y - p.y) + before[2] * (target.z - p.z)) / len);
+				}
+			}
+			if (flips)
+				continue;
+
+			const double error = deviations[from] + distance;
+			if (error > settings.maxError)
+				continue;
+
+			// Each vertex at the position goes to the target vertex it shares a
+			// triangle with, which keeps the seam closed, or failing that to
+			// the one with the closest attributes.
+			for (unsigned int i = positionOffsets[from]; i < positionOffsets[from + 1]; ++i)
+			{
+				const unsigned int v = positionVertices[i];
+				unsigned int best = InvalidIndex;
+				for (unsigned int j = adjacencyOffsets[v]; j < adjacencyOffsets[v + 1] && InvalidIndex == best; ++j)
+				{
+					const unsigned int* tri = &result[adjacency[j] * 3];
+					for (int k = 0; k < 3; ++k)
+					{
+						if (positionId[tri[k]] == to)
+							best = tri[k];
+					}
+				}
+				if (InvalidIndex == best)
+				{
+					double bestPenalty = 0.0;
+					for (unsigned int j = positionOffsets[to]; j < positionOffsets[to + 1]; ++j)
+					{
+						const unsigned int w = positionVertices[j];
+						const double penalty = attributePenalty(v, w);
+						if (InvalidIndex == best || penalty < bestPenalty)
+						{
+							best = w;
+							bestPenalty = penalty;
+						}
+					}
+				}
+				remap[v] = best;
+			}
+
+			quadrics[to].Add(quadrics[from]);
+			deviations[to] = std::max(deviations[to], error);
+			maxError = std::max(maxError, error);
+
+			// Freeze the whole neighbourhood so later collapses in this pass see valid geometry.
+			for (unsigned int i = positionOffsets[from]; i < positionOffsets[from + 1]; ++i)
+			{
+				const unsigned int v = positionVertices[i];
+				for (unsigned int j = adjacencyOffsets[v]; j < adjacencyOffsets[v + 1]; ++j)
+				{
+					const unsigned int* tri = &result[adjacency[j] * 3];
+					touched[positionId[tri[0]]] = touched[positionId[tri[1]]] = touched[positionId[tri[2]]] = true;
+				}
+			}
+			touched[from] = touched[to] = true;
+
+			trianglesLeft -= std::min(removed, trianglesLeft);
+			applied++;
+		}
+
+		if (0 == applied)
+			break;
+
+		// Seam vertices may land on different vertices of one position, so
+		// degenerate triangles are found by position.
+		size_t out = 0;
+		for (size_t i = 0; i < result.size(); i += 3)
+		{
+			unsigned int a = remap[result[i]], b = remap[result[i + 1]], c = remap[result[i + 2]];
+			if (positionId[a] == positionId[b] || positionId[b] == positionId[c] || positionId[a] == positionId[c])
+				continue;
+			result[out++] = a;
+			result[out++] = b;
+			result[out++] = c;
+		}
+		result.resize(out);
+	}
+
+	std::copy(result.begin(), result.end(), dest);
+	if (nullptr != resultError)
+		*resultError = static_cast<float>(maxError);
+	return result.size();
+}
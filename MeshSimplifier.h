@@ -0,0 +1,30 @@
+#pragma once
+#include <stddef.h>
+
+#include "Mesh.h"
+
+// Quadric error metric simplification with half-edge collapses: vertices
+// only ever move onto existing vertices, so no attribute is interpolated and
+// the vertex buffer is shared by every LOD. Collapses move positions, so the
+// vertices of an attribute seam (several vertices sharing one position) move
+// together and the seam stays closed. Vertices on open borders are locked,
+// and collapses across differing normals or UVs are penalized.
+
+struct SimplifySettings
+{
+	size_t		targetIndexCount;
+	// Collapses that would leave a vertex further than this from the
+	// original surface (in position units) are not done.
+	float		maxError;
+	// Scale the normal and UV differences against the squared mesh extent.
+	float		normalWeight;
+	float		uvWeight;
+};
+
+// Writes the simplified triangle list to dest (at most indexCount indices,
+// dest may alias indices) and returns its index count. resultError receives
+// the largest distance a vertex was moved off the surface, summed over the
+// collapses that moved it, in position units.
+size_t SimplifyMesh(unsigned int* dest, const unsigned int* indices, size_t indexCount,
+	Mesh::AttributeView<Mesh::Vector3D> positions, Mesh::AttributeView<Mesh::Vector3D> normals, Mesh::AttributeView<Mesh::Vector2D> uvs,
+	size_t vertexCount, const SimplifySettings& settings, float* resultError);
@@ -0,0 +1,210 @@
+#include "Meshlet.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+	float Dot(const float* a, const float* b)
+	{
+		return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+	}
+
+	void ComputeBoundingSphere(const Mesh::Vector3D* points, size_t count, float center[3], float& radius)
+	{
+		// Ritter: start from the two points furthest apart along an axis, then
+		// grow the sphere to take in every point outside it.
+		size_t minIndex[3] = {}, maxIndex[3] = {};
+		for (size_t i = 1; i < count; ++i)
+		{
+			const float* p = &points[i].x;
+			for (int axis = 0; axis < 3; ++axis)
+			{
+				if (p[axis] < (&points[minIndex[axis]].x)[axis]) minIndex[axis] = i;
+				if (p[axis] > (&points[maxIndex[axis]].x)[axis]) maxIndex[axis] = i;
+			}
+		}
+
+		int widest = 0;
+		float widestSpan = -1.0f;
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			const Mesh::Vector3D& a = points[minIndex[axis]];
+			const Mesh::Vector3D& b = points[maxIndex[axis]];
+			float span = (a.x - b.x) * (a.x - b.x) + (a.y - b.y) * (a.y - b.y) + (a.z - b.z) * (a.z - b.z);
+			if (span > widestSpan)
+			{
+				widest = axis;
+				widestSpan = span;
+			}
+		}
+
+		const Mesh::Vector3D& a = points[minIndex[widest]];
+		const Mesh::Vector3D& b = points[maxIndex[widest]];
+		center[0] = (a.x + b.x) * 0.5f;
+		center[1] = (a.y + b.y) * 0.5f;
+		center[2] = (a.z + b.z) * 0.5f;
+		radius = std::sqrt(widestSpan) * 0.5f;
+
+		for (size_t i = 0; i < count; ++i)
+		{
+			float d[3] = { points[i].x - center[0], points[i].y - center[1], points[i].z - center[2] };
+			float distance = std::sqrt(Dot(d, d));
+			if (distance > radius)
+			{
+				float grown = (radius + distance) * 0.5f;
+				float shift = (grown - radius) / distance;
+				center[0] += d[0] * shift;
+				center[1] += d[1] * shift;
+				center[2] += d[2] * shift;
+				radius = grown;
+			}
+		}
+	}
+}
+
+void BuildMeshlets(MeshletBuffer & buffer, const unsigned int * indices, size_t indexCount, uint32_t submesh, size_t maxVertices, size_t maxTriangles)
+{
+	// Triangles index the meshlet vertices with 8 bits.
+	maxVertices = std::min<size_t>(std::max<size_t>(maxVertices, 3), 256);
+	maxTriangles = std::max<size_t>(maxTriangles, 1);
+
+	Meshlet meshlet = { static_cast<uint32_t>(buffer.vertices.size()), static_cast<uint32_t>(buffer.triangles.size()), 0, 0, submesh };
+
+	auto Find = [&](unsigned int v)
+	{
+		const unsigned int* first = buffer.vertices.data() + meshlet.vertexOffset;
+		const unsigned int* last = first + meshlet.vertexCount;
+		const unsigned int* found = std::find(first, last, v);
+		return found != last ? static_cast<int>(found - first) : -1;
+	};
+
+	for (size_t i = 0; i + 2 < indexCount; i += 3)
+	{
+		const unsigned int* tri = indices + i;
+
+		size_t added = 0;
+		for (int k = 0; k < 3; ++k)
+		{
+			if (Find(tri[k]) < 0 && (k < 1 || tri[k] != tri[0]) && (k < 2 || tri[k] != tri[1]))
+				added++;
+		}
+
+		if (meshlet.vertexCount + added > maxVertices || meshlet.triangleCount + 1u > maxTriangles)
+		{
+			buffer.meshlets.push_back(meshlet);
+			meshlet = { static_cast<uint32_t>(buffer.vertices.size()), static_cast<uint32_t>(buffer.triangles.size()), 0, 0, submesh };
+		}
+
+		for (int k = 0; k < 3; ++k)
+		{
+			int local = Find(tri[k]);
+			if (local < 0)
+			{
+				local = meshlet.vertexCount++;
+				buffer.vertices.push_back(tri[k]);
+			}
+			buffer.triangles.push_back(static_cast<uint8_t>(local));
+		}
+		meshlet.triangleCount++;
+	}
+
+	if (meshlet.triangleCount > 0)
+		buffer.meshlets.push_back(meshlet);
+}
+
+MeshletBounds ComputeMeshletBounds(const Meshlet & meshlet, const unsigned int * meshletVertices, const uint8_t * meshletTriangles, Mesh::AttributeView<Mesh::Vector3D> positions)
+{
+	MeshletBounds bounds = {};
+
+	Mesh::Vector3D points[256];
+	const unsigned int* vertices = meshletVertices + meshlet.vertexOffset;
+	for (uint16_t i = 0; i < meshlet.vertexCount; ++i)
+		points[i] = positions[vertices[i]];
+
+	if (0 == meshlet.vertexCount)
+	{
+		bounds.coneCutoff = 1.0f;
+		return bounds;
+	}
+
+	ComputeBoundingSphere(points, meshlet.vertexCount, bounds.center, bounds.radius);
+
+	// Triangles wind counter-clockwise around their outward normal, as Assimp imports them.
+	const uint8_t* triangles = meshletTriangles + meshlet.triangleOffset;
+	auto TriangleNormal = [&](uint16_t t, float n[3])
+	{
+		const Mesh::Vector3D& p0 = points[triangles[t * 3 + 0]];
+		const Mesh::Vector3D& p1 = points[triangles[t * 3 + 1]];
+		const Mesh::Vector3D& p2 = points[triangles[t * 3 + 2]];
+
+		float e1[3] = { p1.x - p0.x, p1.y - p0.y, p1.z - p0.z };
+		float e2[3] = { p2.x - p0.x, p2.y - p0.y, p2.z - p0.z };
+		n[0] = e1[1] * e2[2] - e1[2] * e2[1];
+		n[1] = e1[2] * e2[0] - e1[0] * e2[2];
+		n[2] = e1[0] * e2[1] - e1[1] * e2[0];
+
+		float length = std::sqrt(Dot(n, n));
+		if (0.0f == length)
+			return false;
+
+		n[0] /= length; n[1] /= length; n[2] /= length;
+		return true;
+	};
+
+	float axis[3] = {};
+	for (uint16_t t = 0; t < meshlet.triangleCount; ++t)
+	{
+		float n[3];
+		if (TriangleNormal(t, n))
+		{
+			axis[0] += n[0]; axis[1] += n[1]; axis[2] += n[2];
+		}
+	}
+
+	float axisLength = std::sqrt(Dot(axis, axis));
+	if (axisLength < 1e-6f)
+	{
+		bounds.coneCutoff = 1.0f;
+		return bounds;
+	}
+
+	bounds.coneAxis[0] = axis[0] / axisLength;
+	bounds.coneAxis[1] = axis[1] / axisLength;
+	bounds.coneAxis[2] = axis[2] / axisLength;
+
+	float minDot = 1.0f;
+	for (uint16_t t = 0; t < meshlet.triangleCount; ++t)
+	{
+		float n[3];
+		if (TriangleNormal(t, n))
+			minDot = std::min(minDot, Dot(n, bounds.coneAxis));
+	}
+
+	// A cone of 90 degrees or more never faces away as a whole.
+	bounds.coneCutoff = minDot <= 0.0f ? 1.0f : std::sqrt(1.0f - minDot * minDot);
+	return bounds;
+}
+
+size_t CullMeshlets(const MeshletBounds * bounds, size_t count, const Frustum & frustum, const float cameraPosition[3], uint32_t * visible)
+{
+	size_t visibleCount = 0;
+	for (size_t i = 0; i < count; ++i)
+	{
+		const MeshletBounds& b = bounds[i];
+
+		bool inside = true;
+		for (int p = 0; p < 6 && inside; ++p)
+			inside = Dot(frustum.planes[p], b.center) + frustum.planes[p][3] >= -b.radius;
+		if (!inside)
+			continue;
+
+		// Backfacing when the whole sphere sees every normal from behind.
+		float d[3] = { b.center[0] - cameraPosition[0], b.center[1] - cameraPosition[1], b.center[2] - cameraPosition[2] };
+		if (Dot(d, b.coneAxis) > b.coneCutoff * std::sqrt(Dot(d, d)) + b.radius)
+			continue;
+
+		visible[visibleCount++] = static_cast<uint32_t>(i);
+	}
+	return visibleCount;
+}
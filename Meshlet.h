@@ -0,0 +1,57 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+#include <vector>
+
+#include "CullingBvh.h"
+#include "Mesh.h"
+
+// Meshlets split a triangle list into small clusters that can be culled as a
+// whole. A meshlet lists its unique vertices (indices into the mesh vertex
+// buffer) and its triangles as 8-bit indices into that list, 3 bytes each.
+
+constexpr size_t MeshletMaxVertices = 64;
+constexpr size_t MeshletMaxTriangles = 124;
+
+struct Meshlet
+{
+	// Into the meshlet vertex array.
+	uint32_t	vertexOffset;
+	// Into the meshlet triangle array, in bytes.
+	uint32_t	triangleOffset;
+	uint16_t	vertexCount;
+	uint16_t	triangleCount;
+	uint32_t	submesh;
+};
+
+struct MeshletBounds
+{
+	float		center[3];
+	float		radius;
+	// Every triangle normal lies within the cone around coneAxis. coneCutoff
+	// is the sine of its half angle, 1 when the cone is too wide to cull with.
+	float		coneAxis[3];
+	float		coneCutoff;
+};
+
+struct MeshletBuffer
+{
+	std::vector<Meshlet>		meshlets;
+	std::vector<unsigned int>	vertices;
+	std::vector<uint8_t>		triangles;
+};
+
+// Greedily appends meshlets for a triangle list to buffer, in index order, so
+// the list should be cache optimized first.
+void BuildMeshlets(MeshletBuffer& buffer, const unsigned int* indices, size_t indexCount, uint32_t submesh,
+	size_t maxVertices = MeshletMaxVertices, size_t maxTriangles = MeshletMaxTriangles);
+
+MeshletBounds ComputeMeshletBounds(const Meshlet& meshlet, const unsigned int* meshletVertices, const uint8_t* meshletTriangles,
+	Mesh::AttributeView<Mesh::Vector3D> positions);
+
+// Writes the indices of the meshlets that intersect the frustum and have a
+// triangle facing the camera, and returns how many there are. The frustum
+// and the camera position are in the same space as the bounds: build the
+// frustum from world * view * projection for mesh space.
+size_t CullMeshlets(const MeshletBounds* bounds, size_t count, const Frustum& frustum, const float cameraPosition[3], uint32_t* visible);
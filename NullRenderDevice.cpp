@@ -0,0 +1,71 @@
+#include "NullRenderDevice.h"
+
+#include "Hash.h"
+
+void NullRenderDevice::CommandList::SetMaterial(uint32_t material)
+{
+	words.push_back(CommandSetMaterial);
+	words.push_back(material);
+}
+
+void NullRenderDevice::CommandList::SetIndexBuffer(uint64_t address, uint32_t size, uint32_t indexSize)
+{
+	words.push_back(CommandSetIndexBuffer);
+	words.push_back(static_cast<uint32_t>(address));
+	words.push_back(static_cast<uint32_t>(address >> 32));
+	words.push_back(size);
+	words.push_back(indexSize);
+}
+
+void NullRenderDevice::CommandList::SetInstances(uint64_t address)
+{
+	words.push_back(CommandSetInstances);
+	words.push_back(static_cast<uint32_t>(address));
+	words.push_back(static_cast<uint32_t>(address >> 32));
+}
+
+void NullRenderDevice::CommandList::DrawIndexedInstanced(uint32_t indexCount, uint32_t instancesCount, uint32_t firstIndex, int32_t baseVertex)
+{
+	words.push_back(CommandDraw);
+	words.push_back(indexCount);
+	words.push_back(instancesCount);
+	words.push_back(firstIndex);
+	words.push_back(static_cast<uint32_t>(baseVertex));
+	++drawsCount;
+	this->instancesCount += instancesCount;
+}
+
+void NullRenderDevice::CommandList::Reset()
+{
+	words.clear();
+	drawsCount = 0;
+	instancesCount = 0;
+	closed = false;
+}
+
+RenderCommandList * NullRenderDevice::AcquireList()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	if (usedCount == lists.size())
+		lists.emplace_back(new CommandList());
+	CommandList* list = lists[usedCount++].get();
+	list->Reset();
+	return list;
+}
+
+void NullRenderDevice::BeginFrame()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	usedCount = 0;
+}
+
+uint64_t NullRenderDevice::Hash(RenderCommandList * const * lists, size_t count)
+{
+	uint64_t hash = HashSeed;
+	for (size_t i = 0; i < count; ++i)
+	{
+		const std::vector<uint32_t>& words = static_cast<const CommandList*>(lists[i])->GetWords();
+		hash = HashBytes(words.data(), words.size() * sizeof(uint32_t), hash);
+	}
+	return hash;
+}
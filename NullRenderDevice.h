@@ -0,0 +1,65 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "RenderDevice.h"
+
+// Records commands into memory instead of a GPU, a few words per command,
+// so everything up to the API costs what it does with a device. Lists are
+// recycled frame to frame.
+class NullRenderDevice : public RenderDevice
+{
+public:
+	enum Command : uint32_t
+	{
+		CommandSetMaterial = 1,
+		CommandSetIndexBuffer,
+		CommandSetInstances,
+		CommandDraw,
+	};
+
+	class CommandList : public RenderCommandList
+	{
+	public:
+		void SetMaterial(uint32_t material) override;
+		void SetIndexBuffer(uint64_t address, uint32_t size, uint32_t indexSize) override;
+		void SetInstances(uint64_t address) override;
+		void DrawIndexedInstanced(uint32_t indexCount, uint32_t instancesCount, uint32_t firstIndex, int32_t baseVertex) override;
+		void Close() override { closed = true; }
+
+		const std::vector<uint32_t>& GetWords() const { return words; }
+		bool IsClosed() const { return closed; }
+		size_t GetDrawsCount() const { return drawsCount; }
+		uint64_t GetInstancesCount() const { return instancesCount; }
+
+	private:
+		friend class NullRenderDevice;
+
+		void Reset();
+
+		std::vector<uint32_t>	words;
+		size_t					drawsCount = 0;
+		uint64_t				instancesCount = 0;
+		bool					closed = false;
+	};
+
+	RenderCommandList* AcquireList() override;
+
+	// Makes every list available again.
+	void BeginFrame();
+
+	size_t GetListsCount() const { return usedCount; }
+	const CommandList& GetList(size_t index) const { return *lists[index]; }
+
+	// Hash of the words of lists, in the order given, as a GPU would run them.
+	static uint64_t Hash(RenderCommandList* const* lists, size_t count);
+
+private:
+	std::vector<std::unique_ptr<CommandList>>	lists;
+	size_t					usedCount = 0;
+	std::mutex				mutex;
+};
@@ -0,0 +1,54 @@
+#pragma once
+#include <stddef.h>
+
+#include <algorithm>
+#include <chrono>
+
+#include "ThreadPool.h"
+
+struct RecordChunk
+{
+	size_t	begin;
+	size_t	end;
+	// Time spent in the record callback, in milliseconds.
+	double	ms;
+};
+
+// Number of chunks ParallelRecord splits count items into: as many as
+// maxChunks allows while each keeps at least minChunkSize items.
+inline size_t GetRecordChunksCount(size_t count, size_t minChunkSize, size_t maxChunks)
+{
+	size_t chunks = count / std::max<size_t>(minChunkSize, 1);
+	return std::max<size_t>(1, std::min(chunks, maxChunks));
+}
+
+// Splits [0, count) into GetRecordChunksCount contiguous chunks and calls
+// record(chunkIndex, begin, end) for each on the pool, the caller included,
+// or on the caller alone when pool is nullptr.
+// Chunks are ordered by index, so whatever chunk i records can be submitted
+// in index order. chunks must hold GetRecordChunksCount entries.
+template<typename F>
+size_t ParallelRecord(ThreadPool* pool, size_t count, size_t minChunkSize, size_t maxChunks, RecordChunk* chunks, F record)
+{
+	const size_t chunksCount = GetRecordChunksCount(count, minChunkSize, maxChunks);
+	for (size_t i = 0; i < chunksCount; ++i)
+	{
+		chunks[i].begin = count * i / chunksCount;
+		chunks[i].end = count * (i + 1) / chunksCount;
+	}
+
+	auto recordChunk = [&](size_t i)
+	{
+		auto start = std::chrono::high_resolution_clock::now();
+		record(i, chunks[i].begin, chunks[i].end);
+		chunks[i].ms = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+	};
+	if (nullptr == pool)
+	{
+		for (size_t i = 0; i < chunksCount; ++i)
+			recordChunk(i);
+	}
+	else
+		pool->ParallelFor(chunksCount, recordChunk);
+	return chunksCount;
+}
@@ -0,0 +1,150 @@
+#include "PipelineCache.h"
+#include "MappedFile.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+void PipelineKey::AddString(const char * text)
+{
+	Add(nullptr != text);
+	if (nullptr != text)
+		AddBytes(text, strlen(text));
+}
+
+bool PipelineDiskCache::Load(const char * filename, uint64_t deviceHash)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	this->deviceHash = deviceHash;
+	blobs.clear();
+	dirty = false;
+
+	MappedFile file;
+	if (!file.Open(filename))
+		return false;
+
+	const uint8_t* base = static_cast<const uint8_t*>(file.GetData());
+	const uint64_t fileSize = file.GetSize();
+
+	auto InFile = [fileSize](uint64_t offset, uint64_t size) { return offset <= fileSize && size <= fileSize - offset; };
+
+	const PipelineCacheHeader* h = reinterpret_cast<const PipelineCacheHeader*>(base);
+	bool valid = fileSize >= sizeof(PipelineCacheHeader)
+		&& h->magic == PipelineCacheMagic
+		&& h->version == PipelineCacheVersion
+		&& h->fileSize == fileSize
+		&& h->entriesCount <= (fileSize - sizeof(PipelineCacheHeader)) / sizeof(PipelineCacheEntry);
+
+	// A different adapter or driver would reject every blob; drop them all
+	// so the file gets rewritten.
+	if (!valid || h->deviceHash != deviceHash)
+	{
+		dirty = valid;
+		return false;
+	}
+
+	const PipelineCacheEntry* e = reinterpret_cast<const PipelineCacheEntry*>(base + sizeof(PipelineCacheHeader));
+	for (uint64_t i = 0; valid && i < h->entriesCount; ++i)
+		valid = InFile(e[i].offset, e[i].size) && 0 != e[i].size;
+	if (!valid)
+		return false;
+
+	for (uint64_t i = 0; i < h->entriesCount; ++i)
+		blobs[e[i].key].assign(base + e[i].offset, base + e[i].offset + e[i].size);
+	return true;
+}
+
+bool PipelineDiskCache::Save(const char * filename)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+
+	std::vector<uint64_t> keys;
+	keys.reserve(blobs.size());
+	for (const auto& blob : blobs)
+		keys.push_back(blob.first);
+	std::sort(keys.begin(), keys.end());
+
+	PipelineCacheHeader header = {};
+	header.magic = PipelineCacheMagic;
+	header.version = PipelineCacheVersion;
+	header.deviceHash = deviceHash;
+	header.entriesCount = keys.size();
+
+	std::vector<PipelineCacheEntry> entries(keys.size());
+	uint64_t offset = sizeof(PipelineCacheHeader) + entries.size() * sizeof(PipelineCacheEntry);
+	for (size_t i = 0; i < keys.size(); ++i)
+	{
+		entries[i].key = keys[i];
+		entries[i].offset = offset;
+		entries[i].size = blobs[keys[i]].size();
+		offset += entries[i].size;
+	}
+	header.fileSize = offset;
+
+	std::string temporary = std::string(filename) + ".tmp";
+	FILE* fp = fopen(temporary.c_str(), "wb");
+	if (nullptr == fp) return false;
+
+	bool ok = fwrite(&header, sizeof(header), 1, fp) == 1
+		&& (entries.empty() || fwrite(entries.data(), sizeof(PipelineCacheEntry), entries.size(), fp) == entries.size());
+	for (size_t i = 0; ok && i < keys.size(); ++i)
+	{
+		const std::vector<uint8_t>& blob = blobs[keys[i]];
+		ok = fwrite(blob.data(), 1, blob.size(), fp) == blob.size();
+	}
+	ok = 0 == fclose(fp) && ok;
+
+	// rename does not replace an existing file on Windows.
+	if (ok)
+	{
+		remove(filename);
+		ok = 0 == rename(temporary.c_str(), filename);
+	}
+	if (!ok)
+	{
+		remove(temporary.c_str());
+		return false;
+	}
+
+	dirty = false;
+	return true;
+}
+
+bool PipelineDiskCache::Find(uint64_t key, std::vector<uint8_t>& blob) const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	auto found = blobs.find(key);
+	if (blobs.end() == found)
+		return false;
+
+	blob = found->second;
+	return true;
+}
+
+void PipelineDiskCache::Store(uint64_t key, const void * data, size_t size)
+{
+	const uint8_t* bytes = static_cast<const uint8_t*>(data);
+
+	std::lock_guard<std::mutex> lock(mutex);
+	blobs[key].assign(bytes, bytes + size);
+	dirty = true;
+}
+
+void PipelineDiskCache::Remove(uint64_t key)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	dirty |= 0 != blobs.erase(key);
+}
+
+size_t PipelineDiskCache::GetEntriesCount() const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return blobs.size();
+}
+
+bool PipelineDiskCache::IsDirty() const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return dirty;
+}
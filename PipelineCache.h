@@ -0,0 +1,270 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+#include "Hash.h"
+#include "ThreadPool.h"
+
+// Pipeline descriptions, their keys and the on-disk cache of compiled
+// pipelines, all without a device. PipelineStates.h feeds D3D12 descriptions
+// through PipelineKey and compiles them for PipelineCache.
+
+constexpr uint32_t PipelineCacheMagic = 0x434f5350;	// 'PSOC'
+constexpr uint32_t PipelineCacheVersion = 1;
+
+struct PipelineCacheHeader
+{
+	uint32_t	magic;
+	uint32_t	version;
+	// Blobs only load on the adapter and driver they were compiled with.
+	uint64_t	deviceHash;
+	uint64_t	fileSize;
+	uint64_t	entriesCount;
+};
+
+// Entries follow the header, sorted by key, then the blobs.
+struct PipelineCacheEntry
+{
+	uint64_t	key;
+	uint64_t	offset;
+	uint64_t	size;
+};
+
+// Stable hash of a pipeline description, built field by field so that
+// neither padding nor pointers end up in it. Variable sized parts are hashed
+// with their size so that two of them never run into each other.
+class PipelineKey
+{
+public:
+	template<typename T>
+	void Add(const T& value)
+	{
+		static_assert(std::is_arithmetic<T>::value || std::is_enum<T>::value, "fields one at a time");
+		hash = HashValue(value, hash);
+	}
+
+	void AddBytes(const void* data, size_t size)
+	{
+		hash = HashValue(static_cast<uint64_t>(size), hash);
+		hash = HashBytes(data, size, hash);
+	}
+
+	// Null and "" differ.
+	void AddString(const char* text);
+
+	uint64_t Get() const { return hash; }
+
+private:
+	uint64_t	hash = HashSeed;
+};
+
+// Compiled pipeline blobs by key, loaded from and saved to one file.
+// Find and Store are safe to call from compile workers.
+class PipelineDiskCache
+{
+public:
+	PipelineDiskCache() : deviceHash(0), dirty(false) {}
+
+	// Starts empty when the file is missing, corrupt, or from another device.
+	// Returns whether entries were loaded.
+	bool Load(const char* filename, uint64_t deviceHash);
+	// Writes a temporary file first so a crash never leaves half a cache.
+	bool Save(const char* filename);
+
+	bool Find(uint64_t key, std::vector<uint8_t>& blob) const;
+	void Store(uint64_t key, const void* data, size_t size);
+	// For blobs the driver no longer accepts.
+	void Remove(uint64_t key);
+
+	size_t GetEntriesCount() const;
+	bool IsDirty() const;
+
+private:
+	mutable std::mutex										mutex;
+	uint64_t												deviceHash;
+	std::unordered_map<uint64_t, std::vector<uint8_t>>		blobs;
+	bool													dirty;
+};
+
+enum class PipelineStatus : uint8_t
+{
+	Missing,
+	Compiling,
+	Ready,
+	Failed,
+};
+
+// Pipelines by key, each compiled once on a ThreadPool however many times
+// it is requested. Compiles start from the disk cache's blob when it has
+// one and store what they produce back into it. Pipeline is a COM-style
+// object released with Release().
+template<typename Pipeline>
+class PipelineCache
+{
+public:
+	// Runs on a pool worker: creates the pipeline, from cached when it is not
+	// empty, and fills blob with what should be persisted. Returns null when
+	// compiling fails.
+	using CompileFunction = std::function<Pipeline*(const std::vector<uint8_t>& cached, std::vector<uint8_t>& blob)>;
+
+	struct Stats
+	{
+		uint32_t	requests;
+		uint32_t	compiles;
+		// Compiles that started from a blob the driver accepted.
+		uint32_t	diskHits;
+		uint32_t	failures;
+	};
+
+	explicit PipelineCache(ThreadPool& pool, PipelineDiskCache* disk = nullptr) : pool(pool), disk(disk), inFlight(0), stats() {}
+	~PipelineCache() { Clear(); }
+
+	PipelineCache(const PipelineCache&) = delete;
+	PipelineCache& operator=(const PipelineCache&) = delete;
+
+	// Starts compiling the first time key is requested; later requests only
+	// look it up. Returns the pipeline once it is ready, null until then.
+	Pipeline* Request(uint64_t key, CompileFunction compile);
+	// The pipeline if it is ready.
+	Pipeline* Find(uint64_t key) const;
+	PipelineStatus GetStatus(uint64_t key) const;
+	// Blocks until key has compiled, for pipelines needed right away.
+	Pipeline* Wait(uint64_t key);
+	void WaitAll();
+
+	// Waits for the compiles in flight and releases every pipeline.
+	void Clear();
+
+	Stats GetStats() const;
+
+private:
+	struct Entry
+	{
+		PipelineStatus	status;
+		Pipeline*		pipeline;
+	};
+
+	void Compile(uint64_t key, const CompileFunction& compile);
+
+	ThreadPool&									pool;
+	PipelineDiskCache*							disk;
+	mutable std::mutex							mutex;
+	std::condition_variable						compiled;
+	std::unordered_map<uint64_t, Entry>			entries;
+	size_t										inFlight;
+	Stats										stats;
+};
+
+template<typename Pipeline>
+Pipeline* PipelineCache<Pipeline>::Request(uint64_t key, CompileFunction compile)
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stats.requests++;
+		auto found = entries.find(key);
+		if (entries.end() != found)
+			return found->second.pipeline;
+
+		entries[key] = Entry{ PipelineStatus::Compiling, nullptr };
+		inFlight++;
+	}
+
+	// Not under the lock: a pool without workers runs the task right here.
+	pool.Submit([this, key, compile]() { Compile(key, compile); });
+	return Find(key);
+}
+
+template<typename Pipeline>
+Pipeline* PipelineCache<Pipeline>::Find(uint64_t key) const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	auto found = entries.find(key);
+	return entries.end() != found ? found->second.pipeline : nullptr;
+}
+
+template<typename Pipeline>
+PipelineStatus PipelineCache<Pipeline>::GetStatus(uint64_t key) const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	auto found = entries.find(key);
+	return entries.end() != found ? found->second.status : PipelineStatus::Missing;
+}
+
+template<typename Pipeline>
+Pipeline* PipelineCache<Pipeline>::Wait(uint64_t key)
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	compiled.wait(lock, [&]()
+	{
+		auto found = entries.find(key);
+		return entries.end() == found || PipelineStatus::Compiling != found->second.status;
+	});
+	auto found = entries.find(key);
+	return entries.end() != found ? found->second.pipeline : nullptr;
+}
+
+template<typename Pipeline>
+void PipelineCache<Pipeline>::WaitAll()
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	compiled.wait(lock, [this]() { return 0 == inFlight; });
+}
+
+template<typename Pipeline>
+void PipelineCache<Pipeline>::Clear()
+{
+	WaitAll();
+
+	std::lock_guard<std::mutex> lock(mutex);
+	for (auto& entry : entries)
+	{
+		if (nullptr != entry.second.pipeline)
+			entry.second.pipeline->Release();
+	}
+	entries.clear();
+}
+
+template<typename Pipeline>
+typename PipelineCache<Pipeline>::Stats PipelineCache<Pipeline>::GetStats() const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return stats;
+}
+
+template<typename Pipeline>
+void PipelineCache<Pipeline>::Compile(uint64_t key, const CompileFunction& compile)
+{
+	std::vector<uint8_t> cached, blob;
+	bool fromDisk = nullptr != disk && disk->Find(key, cached);
+	Pipeline* pipeline = compile(cached, blob);
+	if (nullptr == pipeline && fromDisk)
+	{
+		// Likely a driver update; compile from scratch and replace the blob.
+		disk->Remove(key);
+		cached.clear();
+		blob.clear();
+		fromDisk = false;
+		pipeline = compile(cached, blob);
+	}
+	if (nullptr != pipeline && nullptr != disk && !blob.empty() && blob != cached)
+		disk->Store(key, blob.data(), blob.size());
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		Entry& entry = entries[key];
+		entry.status = nullptr != pipeline ? PipelineStatus::Ready : PipelineStatus::Failed;
+		entry.pipeline = pipeline;
+		stats.compiles++;
+		stats.diskHits += nullptr != pipeline && fromDisk ? 1 : 0;
+		stats.failures += nullptr == pipeline ? 1 : 0;
+		inFlight--;
+	}
+	compiled.notify_all();
+}
@@ -0,0 +1,221 @@
+#include "PipelineStates.h"
+
+#include <deque>
+#include <memory>
+#include <string>
+
+namespace
+{
+	void AddShader(PipelineKey& key, const D3D12_SHADER_BYTECODE& shader)
+	{
+		key.AddBytes(shader.pShaderBytecode, nullptr != shader.pShaderBytecode ? shader.BytecodeLength : 0);
+	}
+
+	void AddStencilOp(PipelineKey& key, const D3D12_DEPTH_STENCILOP_DESC& op)
+	{
+		key.Add(op.StencilFailOp);
+		key.Add(op.StencilDepthFailOp);
+		key.Add(op.StencilPassOp);
+		key.Add(op.StencilFunc);
+	}
+
+	// A description and the copies of everything it points to.
+	struct GraphicsPipelineDesc
+	{
+		D3D12_GRAPHICS_PIPELINE_STATE_DESC			desc;
+		std::vector<uint8_t>						shaders[5];
+		std::vector<D3D12_INPUT_ELEMENT_DESC>		inputElements;
+		std::vector<D3D12_SO_DECLARATION_ENTRY>		soEntries;
+		std::vector<UINT>							soStrides;
+		// Deque so the names do not move as more are added.
+		std::deque<std::string>						names;
+
+		~GraphicsPipelineDesc()
+		{
+			if (nullptr != desc.pRootSignature)
+				desc.pRootSignature->Release();
+		}
+
+		const char* CopyName(const char* name)
+		{
+			if (nullptr == name)
+				return nullptr;
+			names.push_back(name);
+			return names.back().c_str();
+		}
+
+		void CopyShader(D3D12_SHADER_BYTECODE& shader, std::vector<uint8_t>& storage)
+		{
+			if (nullptr == shader.pShaderBytecode || 0 == shader.BytecodeLength)
+			{
+				shader = {};
+				return;
+			}
+			const uint8_t* bytes = static_cast<const uint8_t*>(shader.pShaderBytecode);
+			storage.assign(bytes, bytes + shader.BytecodeLength);
+			shader.pShaderBytecode = storage.data();
+		}
+	};
+}
+
+uint64_t HashGraphicsPipeline(const D3D12_GRAPHICS_PIPELINE_STATE_DESC & desc, uint64_t rootSignatureHash)
+{
+	PipelineKey key;
+	key.Add(rootSignatureHash);
+	AddShader(key, desc.VS);
+	AddShader(key, desc.PS);
+	AddShader(key, desc.DS);
+	AddShader(key, desc.HS);
+	AddShader(key, desc.GS);
+
+	const D3D12_STREAM_OUTPUT_DESC& so = desc.StreamOutput;
+	key.Add(so.NumEntries);
+	for (UINT i = 0; i < so.NumEntries; ++i)
+	{
+		const D3D12_SO_DECLARATION_ENTRY& entry = so.pSODeclaration[i];
+		key.Add(entry.Stream);
+		key.AddString(entry.SemanticName);
+		key.Add(entry.SemanticIndex);
+		key.Add(entry.StartComponent);
+		key.Add(entry.ComponentCount);
+		key.Add(entry.OutputSlot);
+	}
+	key.Add(so.NumStrides);
+	for (UINT i = 0; i < so.NumStrides; ++i)
+		key.Add(so.pBufferStrides[i]);
+	key.Add(so.RasterizedStream);
+
+	const D3D12_BLEND_DESC& blend = desc.BlendState;
+	key.Add(blend.AlphaToCoverageEnable);
+	key.Add(blend.IndependentBlendEnable);
+	for (const D3D12_RENDER_TARGET_BLEND_DESC& target : blend.RenderTarget)
+	{
+		key.Add(target.BlendEnable);
+		key.Add(target.LogicOpEnable);
+		key.Add(target.SrcBlend);
+		key.Add(target.DestBlend);
+		key.Add(target.BlendOp);
+		key.Add(target.SrcBlendAlpha);
+		key.Add(target.DestBlendAlpha);
+		key.Add(target.BlendOpAlpha);
+		key.Add(target.LogicOp);
+		key.Add(target.RenderTargetWriteMask);
+	}
+	key.Add(desc.SampleMask);
+
+	const D3D12_RASTERIZER_DESC& raster = desc.RasterizerState;
+	key.Add(raster.FillMode);
+	key.Add(raster.CullMode);
+	key.Add(raster.FrontCounterClockwise);
+	key.Add(raster.DepthBias);
+	key.Add(raster.DepthBiasClamp);
+	key.Add(raster.SlopeScaledDepthBias);
+	key.Add(raster.DepthClipEnable);
+	key.Add(raster.MultisampleEnable);
+	key.Add(raster.AntialiasedLineEnable);
+	key.Add(raster.ForcedSampleCount);
+	key.Add(raster.ConservativeRaster);
+
+	const D3D12_DEPTH_STENCIL_DESC& depth = desc.DepthStencilState;
+	key.Add(depth.DepthEnable);
+	key.Add(depth.DepthWriteMask);
+	key.Add(depth.DepthFunc);
+	key.Add(depth.StencilEnable);
+	key.Add(depth.StencilReadMask);
+	key.Add(depth.StencilWriteMask);
+	AddStencilOp(key, depth.FrontFace);
+	AddStencilOp(key, depth.BackFace);
+
+	key.Add(desc.InputLayout.NumElements);
+	for (UINT i = 0; i < desc.InputLayout.NumElements; ++i)
+	{
+		const D3D12_INPUT_ELEMENT_DESC& element = desc.InputLayout.pInputElementDescs[i];
+		key.AddString(element.SemanticName);
+		key.Add(element.SemanticIndex);
+		key.Add(element.Format);
+		key.Add(element.InputSlot);
+		key.Add(element.AlignedByteOffset);
+		key.Add(element.InputSlotClass);
+		key.Add(element.InstanceDataStepRate);
+	}
+
+	key.Add(desc.IBStripCutValue);
+	key.Add(desc.PrimitiveTopologyType);
+	key.Add(desc.NumRenderTargets);
+	for (UINT i = 0; i < desc.NumRenderTargets && i < D3D12_SIMULTANEOUS_RENDER_TARGET_COUNT; ++i)
+		key.Add(desc.RTVFormats[i]);
+	key.Add(desc.DSVFormat);
+	key.Add(desc.SampleDesc.Count);
+	key.Add(desc.SampleDesc.Quality);
+	key.Add(desc.NodeMask);
+	key.Add(desc.Flags);
+	return key.Get();
+}
+
+uint64_t HashDevice(IDXGIAdapter1 * adapter)
+{
+	PipelineKey key;
+	DXGI_ADAPTER_DESC1 desc = {};
+	if (SUCCEEDED(adapter->GetDesc1(&desc)))
+	{
+		// Not the LUID, it changes from boot to boot.
+		key.Add(desc.VendorId);
+		key.Add(desc.DeviceId);
+		key.Add(desc.SubSysId);
+		key.Add(desc.Revision);
+	}
+
+	LARGE_INTEGER driverVersion = {};
+	if (SUCCEEDED(adapter->CheckInterfaceSupport(__uuidof(IDXGIDevice), &driverVersion)))
+		key.Add(driverVersion.QuadPart);
+	return key.Get();
+}
+
+PipelineCache<ID3D12PipelineState>::CompileFunction CompileGraphicsPipeline(ID3D12Device * device, const D3D12_GRAPHICS_PIPELINE_STATE_DESC & desc)
+{
+	std::shared_ptr<GraphicsPipelineDesc> copy = std::make_shared<GraphicsPipelineDesc>();
+	copy->desc = desc;
+	copy->desc.CachedPSO = {};
+	if (nullptr != copy->desc.pRootSignature)
+		copy->desc.pRootSignature->AddRef();
+
+	copy->CopyShader(copy->desc.VS, copy->shaders[0]);
+	copy->CopyShader(copy->desc.PS, copy->shaders[1]);
+	copy->CopyShader(copy->desc.DS, copy->shaders[2]);
+	copy->CopyShader(copy->desc.HS, copy->shaders[3]);
+	copy->CopyShader(copy->desc.GS, copy->shaders[4]);
+
+	copy->inputElements.assign(desc.InputLayout.pInputElementDescs, desc.InputLayout.pInputElementDescs + desc.InputLayout.NumElements);
+	for (D3D12_INPUT_ELEMENT_DESC& element : copy->inputElements)
+		element.SemanticName = copy->CopyName(element.SemanticName);
+	copy->desc.InputLayout = { copy->inputElements.data(), desc.InputLayout.NumElements };
+
+	D3D12_STREAM_OUTPUT_DESC& so = copy->desc.StreamOutput;
+	copy->soEntries.assign(so.pSODeclaration, so.pSODeclaration + so.NumEntries);
+	for (D3D12_SO_DECLARATION_ENTRY& entry : copy->soEntries)
+		entry.SemanticName = copy->CopyName(entry.SemanticName);
+	copy->soStrides.assign(so.pBufferStrides, so.pBufferStrides + so.NumStrides);
+	so.pSODeclaration = copy->soEntries.data();
+	so.pBufferStrides = copy->soStrides.data();
+
+	return [device, copy](const std::vector<uint8_t>& cached, std::vector<uint8_t>& blob) -> ID3D12PipelineState*
+	{
+		D3D12_GRAPHICS_PIPELINE_STATE_DESC desc = copy->desc;
+		desc.CachedPSO = { cached.data(), cached.size() };
+
+		// A blob from another driver fails with D3D12_ERROR_DRIVER_VERSION_MISMATCH;
+		// the cache then compiles again without it.
+		ID3D12PipelineState* pipeline = nullptr;
+		if (FAILED(device->CreateGraphicsPipelineState(&desc, IID_PPV_ARGS(&pipeline))))
+			return nullptr;
+
+		ID3DBlob* cachedBlob = nullptr;
+		if (SUCCEEDED(pipeline->GetCachedBlob(&cachedBlob)))
+		{
+			const uint8_t* bytes = static_cast<const uint8_t*>(cachedBlob->GetBufferPointer());
+			blob.assign(bytes, bytes + cachedBlob->GetBufferSize());
+			cachedBlob->Release();
+		}
+		return pipeline;
+	};
+}
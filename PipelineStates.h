@@ -0,0 +1,21 @@
+#pragma once
+#include <d3d12.h>
+#include <dxgi1_5.h>
+
+#include "PipelineCache.h"
+
+// The D3D12 side of PipelineCache: keys for graphics pipeline descriptions
+// and the function that compiles them, starting from the driver's cached
+// blob when the disk cache has one.
+
+// Everything in desc that changes the compiled pipeline: shader bytecode and
+// semantic names by content, the root signature by rootSignatureHash, e.g.
+// HashBytes of its serialized blob. CachedPSO is not part of the key.
+uint64_t HashGraphicsPipeline(const D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc, uint64_t rootSignatureHash);
+
+// Adapter and user mode driver version, for PipelineDiskCache::Load.
+uint64_t HashDevice(IDXGIAdapter1* adapter);
+
+// Copies desc with everything it points to, so the description only has to
+// live until this returns. Keeps a reference on the root signature.
+PipelineCache<ID3D12PipelineState>::CompileFunction CompileGraphicsPipeline(ID3D12Device* device, const D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc);
@@ -13,9 +13,20 @@ struct V2P
 	float3 normal	: NORMAL;
 	float3 tangent	: TANGENT;
 	float2 uv		: TEXCOORD;
+	nointerpolation uint material : MATERIAL;
+};
+
+// Tints per material index until there are real materials, as many as the
+// viewer's SceneTintsCount.
+static const float4 materialTints[4] =
+{
+	float4(1.0, 1.0, 1.0, 1.0),
+	float4(1.0, 0.8, 0.6, 1.0),
+	float4(0.7, 0.9, 1.0, 1.0),
+	float4(0.8, 1.0, 0.7, 1.0),
 };
 
 float4 main(V2P input) : SV_TARGET
 {
-	return color * tex.Sample(smplr, input.uv);
+	return color * materialTints[input.material & 3] * tex.Sample(smplr, input.uv);
 }
\ No newline at end of file
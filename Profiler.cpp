@@ -0,0 +1,225 @@
+#include "Profiler.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#include <Windows.h>
+#endif
+
+namespace
+{
+	std::atomic<uint64_t> g_NextProfilerId(1);
+
+	float Percentile(const std::vector<float>& sorted, float p)
+	{
+		size_t rank = static_cast<size_t>(std::ceil(p * sorted.size()));
+		return sorted[std::min(std::max(rank, size_t(1)), sorted.size()) - 1];
+	}
+
+	void WriteEscaped(FILE* fp, const char* text)
+	{
+		for (; '\0' != *text; ++text)
+		{
+			if ('"' == *text || '\\' == *text)
+				fprintf(fp, "\\%c", *text);
+			else if (static_cast<unsigned char>(*text) < 0x20)
+				fprintf(fp, "\\u%04x", *text);
+			else
+				fputc(*text, fp);
+		}
+	}
+}
+
+void FrameStats::Add(float ms)
+{
+	times[next] = ms;
+	next = (next + 1) % times.size();
+	count = std::min(count + 1, times.size());
+}
+
+FrameStats::Summary FrameStats::GetSummary() const
+{
+	Summary summary = {};
+	if (0 == count)
+		return summary;
+
+	std::vector<float> sorted(times.begin(), times.begin() + count);
+	std::sort(sorted.begin(), sorted.end());
+	double sum = 0.0;
+	for (float time : sorted)
+		sum += time;
+
+	summary.count = static_cast<uint32_t>(count);
+	summary.mean = static_cast<float>(sum / count);
+	summary.min = sorted.front();
+	summary.max = sorted.back();
+	summary.p50 = Percentile(sorted, 0.50f);
+	summary.p95 = Percentile(sorted, 0.95f);
+	summary.p99 = Percentile(sorted, 0.99f);
+	return summary;
+}
+
+void FrameStats::GetHistogram(uint32_t (&buckets)[HistogramBuckets]) const
+{
+	std::fill(buckets, buckets + HistogramBuckets, 0u);
+	for (size_t i = 0; i < count; ++i)
+		++buckets[std::min(static_cast<uint32_t>(std::max(times[i], 0.0f)), HistogramBuckets - 1)];
+}
+
+Profiler::Profiler() : id(g_NextProfilerId++), lastFrame(0), framesCount(0)
+{
+	gpuBuffer = AddBuffer("GPU");
+}
+
+Profiler::~Profiler()
+{
+}
+
+uint64_t Profiler::Now()
+{
+#if defined(_WIN32)
+	LARGE_INTEGER counter;
+	QueryPerformanceCounter(&counter);
+	return static_cast<uint64_t>(counter.QuadPart);
+#else
+	return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+#endif
+}
+
+uint64_t Profiler::GetTicksPerSecond()
+{
+#if defined(_WIN32)
+	static const uint64_t frequency = []()
+	{
+		LARGE_INTEGER frequency;
+		QueryPerformanceFrequency(&frequency);
+		return static_cast<uint64_t>(frequency.QuadPart);
+	}();
+	return frequency;
+#else
+	return 1000000000ull;
+#endif
+}
+
+void Profiler::SetThreadName(const char * name)
+{
+	ThreadBuffer& buffer = GetThreadBuffer();
+	std::lock_guard<std::mutex> lock(mutex);
+	buffer.name = name;
+}
+
+void Profiler::Record(const char * name, uint64_t begin, uint64_t end)
+{
+	Write(GetThreadBuffer(), name, begin, end);
+}
+
+void Profiler::RecordGpu(const char * name, uint64_t begin, uint64_t end)
+{
+	Write(*gpuBuffer, name, begin, end);
+}
+
+const char * Profiler::Intern(const char * name)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return names.insert(name).first->c_str();
+}
+
+void Profiler::EndFrame()
+{
+	uint64_t now = Now();
+	if (0 != lastFrame)
+	{
+		frameStats.Add(static_cast<float>((now - lastFrame) * 1000.0 / GetTicksPerSecond()));
+		Record("frame", lastFrame, now);
+	}
+	lastFrame = now;
+	++framesCount;
+}
+
+bool Profiler::ExportChromeTrace(const char * filename)
+{
+	FILE* fp = fopen(filename, "w");
+	if (nullptr == fp)
+		return false;
+
+	std::lock_guard<std::mutex> lock(mutex);
+	std::vector<std::vector<Event>> threadEvents(buffers.size());
+	uint64_t origin = ~0ull;
+	for (size_t i = 0; i < buffers.size(); ++i)
+	{
+		const ThreadBuffer& buffer = *buffers[i];
+		uint64_t written = buffer.written.load(std::memory_order_acquire);
+		for (uint64_t j = written > EventsPerThread ? written - EventsPerThread : 0; j < written; ++j)
+		{
+			threadEvents[i].push_back(buffer.events[j % EventsPerThread]);
+			origin = std::min(origin, threadEvents[i].back().begin);
+		}
+	}
+
+	const double usPerTick = 1000000.0 / GetTicksPerSecond();
+	fprintf(fp, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+	bool first = true;
+	for (size_t i = 0; i < buffers.size(); ++i)
+	{
+		fprintf(fp, "%s\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%zu,\"args\":{\"name\":\"", first ? "" : ",", i);
+		if (buffers[i]->name.empty())
+			fprintf(fp, "thread %zu", i);
+		else
+			WriteEscaped(fp, buffers[i]->name.c_str());
+		fprintf(fp, "\"}}");
+		first = false;
+
+		for (const Event& event : threadEvents[i])
+		{
+			fprintf(fp, ",\n{\"name\":\"");
+			WriteEscaped(fp, event.name);
+			fprintf(fp, "\",\"cat\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%zu,\"ts\":%.3f,\"dur\":%.3f}",
+				buffers[i].get() == gpuBuffer ? "gpu" : "cpu", i, (event.begin - origin) * usPerTick, (event.end - event.begin) * usPerTick);
+		}
+	}
+	fprintf(fp, "\n]}\n");
+	return 0 == fclose(fp);
+}
+
+Profiler & Profiler::Shared()
+{
+	static Profiler profiler;
+	return profiler;
+}
+
+Profiler::ThreadBuffer & Profiler::GetThreadBuffer()
+{
+	// Cached per thread for the last profiler used; ids are never reused, so
+	// a cache left by a destroyed profiler is never taken for this one's.
+	static thread_local uint64_t cachedId = 0;
+	static thread_local ThreadBuffer* cachedBuffer = nullptr;
+	if (cachedId != id)
+	{
+		cachedBuffer = AddBuffer("");
+		cachedId = id;
+	}
+	return *cachedBuffer;
+}
+
+Profiler::ThreadBuffer * Profiler::AddBuffer(const char * name)
+{
+	std::unique_ptr<ThreadBuffer> buffer(new ThreadBuffer());
+	buffer->name = name;
+	buffer->events.reset(new Event[EventsPerThread]);
+	buffer->written.store(0, std::memory_order_relaxed);
+
+	std::lock_guard<std::mutex> lock(mutex);
+	buffers.push_back(std::move(buffer));
+	return buffers.back().get();
+}
+
+void Profiler::Write(ThreadBuffer & buffer, const char * name, uint64_t begin, uint64_t end)
+{
+	uint64_t index = buffer.written.load(std::memory_order_relaxed);
+	buffer.events[index % EventsPerThread] = Event{ name, begin, end };
+	buffer.written.store(index + 1, std::memory_order_release);
+}
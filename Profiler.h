@@ -0,0 +1,139 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+// Define PROFILER_ENABLED to 0 to compile every PROFILE_SCOPE out. The
+// profiler itself stays, for frame statistics and GPU timings.
+#if !defined(PROFILER_ENABLED)
+#define PROFILER_ENABLED 1
+#endif
+
+#define PROFILE_CONCAT_(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_(a, b)
+#if PROFILER_ENABLED
+// Times the rest of the enclosing block. name must outlive the profiler, a
+// string literal or something Profiler::Intern returned.
+#define PROFILE_SCOPE(name) ProfileScope PROFILE_CONCAT(profileScope, __LINE__)(name)
+#else
+#define PROFILE_SCOPE(name) do {} while (false)
+#endif
+
+// Rolling frame times over the last window frames.
+class FrameStats
+{
+public:
+	// Buckets are 1 ms wide, the last one takes everything slower.
+	static const uint32_t HistogramBuckets = 34;
+
+	struct Summary
+	{
+		uint32_t	count;
+		float		mean;
+		float		min;
+		float		max;
+		float		p50;
+		float		p95;
+		float		p99;
+	};
+
+	explicit FrameStats(size_t window = 240) : times(window > 0 ? window : 1), count(0), next(0) {}
+
+	void Add(float ms);
+	void Clear() { count = 0; next = 0; }
+
+	Summary GetSummary() const;
+	void GetHistogram(uint32_t (&buckets)[HistogramBuckets]) const;
+
+private:
+	std::vector<float>	times;
+	size_t				count;
+	size_t				next;
+};
+
+// Collects timed scopes from any thread into a ring per thread, so recording
+// one takes no lock, plus GPU timings from whoever reads them back, and
+// writes them out as a Chrome trace, which chrome://tracing and Perfetto
+// open. Each ring keeps its thread's last EventsPerThread scopes. Times are
+// in ticks of Now(), QueryPerformanceCounter's on Windows.
+class Profiler
+{
+public:
+	static const size_t EventsPerThread = 64 * 1024;
+
+	Profiler();
+	~Profiler();
+
+	Profiler(const Profiler&) = delete;
+	Profiler& operator=(const Profiler&) = delete;
+
+	static uint64_t Now();
+	static uint64_t GetTicksPerSecond();
+
+	// The calling thread's name in traces; threads without one are numbered.
+	void SetThreadName(const char* name);
+	void Record(const char* name, uint64_t begin, uint64_t end);
+	// From the render thread, with times already on the CPU clock.
+	void RecordGpu(const char* name, uint64_t begin, uint64_t end);
+	// A copy of name that lives as long as the profiler.
+	const char* Intern(const char* name);
+
+	// Ends the frame that began at the previous call.
+	void EndFrame();
+	const FrameStats& GetFrameStats() const { return frameStats; }
+	uint64_t GetFramesCount() const { return framesCount; }
+
+	// Scopes recorded while this runs may be missing or torn.
+	bool ExportChromeTrace(const char* filename);
+
+	// The profiler PROFILE_SCOPE records to.
+	static Profiler& Shared();
+
+private:
+	struct Event
+	{
+		const char*	name;
+		uint64_t	begin;
+		uint64_t	end;
+	};
+
+	struct ThreadBuffer
+	{
+		std::string				name;
+		std::unique_ptr<Event[]>	events;
+		std::atomic<uint64_t>	written;
+	};
+
+	ThreadBuffer& GetThreadBuffer();
+	ThreadBuffer* AddBuffer(const char* name);
+	static void Write(ThreadBuffer& buffer, const char* name, uint64_t begin, uint64_t end);
+
+	const uint64_t				id;
+	std::mutex					mutex;
+	std::vector<std::unique_ptr<ThreadBuffer>>	buffers;
+	ThreadBuffer*				gpuBuffer;
+	std::unordered_set<std::string>	names;
+	FrameStats					frameStats;
+	uint64_t					lastFrame;
+	uint64_t					framesCount;
+};
+
+class ProfileScope
+{
+public:
+	explicit ProfileScope(const char* name) : name(name), begin(Profiler::Now()) {}
+	~ProfileScope() { Profiler::Shared().Record(name, begin, Profiler::Now()); }
+
+	ProfileScope(const ProfileScope&) = delete;
+	ProfileScope& operator=(const ProfileScope&) = delete;
+
+private:
+	const char*	name;
+	uint64_t	begin;
+};
@@ -0,0 +1,32 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+// The commands the scene records, apart from the API they go to. The D3D12
+// backend forwards them to a command list; NullRenderDevice keeps them, so
+// the frame's CPU side runs, and is measured, without a GPU. Addresses are
+// GPU virtual addresses, or whatever the backend hands out.
+class RenderCommandList
+{
+public:
+	virtual ~RenderCommandList() {}
+
+	// Binds what a material's draws read.
+	virtual void SetMaterial(uint32_t material) = 0;
+	virtual void SetIndexBuffer(uint64_t address, uint32_t size, uint32_t indexSize) = 0;
+	// The draw's StructuredBuffer of InstanceData.
+	virtual void SetInstances(uint64_t address) = 0;
+	virtual void DrawIndexedInstanced(uint32_t indexCount, uint32_t instancesCount, uint32_t firstIndex, int32_t baseVertex) = 0;
+	virtual void Close() = 0;
+};
+
+class RenderDevice
+{
+public:
+	virtual ~RenderDevice() {}
+
+	// Thread safe. Returns a list open for recording, with the frame's
+	// pipeline, targets and constants set, or nullptr. Lists stay valid until
+	// the backend starts a new frame.
+	virtual RenderCommandList* AcquireList() = 0;
+};
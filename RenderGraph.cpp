@@ -0,0 +1,307 @@
+#include "RenderGraph.h"
+
+#include <algorithm>
+
+namespace
+{
+	const uint32_t WriteStates = ResourceStateRenderTarget | ResourceStateUnorderedAccess | ResourceStateDepthWrite | ResourceStateCopyDest;
+
+	uint64_t AlignUp(uint64_t value, uint64_t alignment)
+	{
+		return (value + alignment - 1) & ~(alignment - 1);
+	}
+
+	bool Overlap(uint32_t firstA, uint32_t lastA, uint32_t firstB, uint32_t lastB)
+	{
+		return firstA <= lastB && firstB <= lastA;
+	}
+}
+
+void RenderGraph::Reset()
+{
+	passes.clear();
+	resources.clear();
+	steps.clear();
+	barriers.clear();
+	heapSize = 0;
+	splitBarriersCount = 0;
+}
+
+uint32_t RenderGraph::Import(const char * name, uint32_t initialState, uint32_t finalState)
+{
+	Resource resource = {};
+	resource.name = name;
+	resource.initialState = initialState;
+	resource.requestedState = finalState;
+	resource.output = AnyState != finalState;
+	resources.push_back(resource);
+	return static_cast<uint32_t>(resources.size() - 1);
+}
+
+uint32_t RenderGraph::CreateTransient(const char * name, uint64_t size, uint64_t alignment)
+{
+	Resource resource = {};
+	resource.name = name;
+	resource.size = size;
+	resource.alignment = std::max<uint64_t>(alignment, 1);
+	resource.requestedState = AnyState;
+	resource.transient = true;
+	resources.push_back(resource);
+	return static_cast<uint32_t>(resources.size() - 1);
+}
+
+void RenderGraph::MarkOutput(uint32_t resource)
+{
+	resources[resource].output = true;
+}
+
+uint32_t RenderGraph::AddPass(const char * name, std::function<void()> execute)
+{
+	Pass pass;
+	pass.name = name;
+	pass.execute = std::move(execute);
+	pass.culled = false;
+	passes.push_back(std::move(pass));
+	return static_cast<uint32_t>(passes.size() - 1);
+}
+
+void RenderGraph::Read(uint32_t pass, uint32_t resource, uint32_t state)
+{
+	AddAccess(pass, resource, state, false);
+}
+
+void RenderGraph::Write(uint32_t pass, uint32_t resource, uint32_t state)
+{
+	AddAccess(pass, resource, state, true);
+}
+
+void RenderGraph::AddAccess(uint32_t pass, uint32_t resource, uint32_t state, bool write)
+{
+	std::vector<Access>& accesses = passes[pass].accesses;
+	for (Access& access : accesses)
+	{
+		if (access.resource == resource)
+		{
+			access.state |= state;
+			access.write |= write;
+			return;
+		}
+	}
+	accesses.push_back(Access{ resource, state, write });
+}
+
+bool RenderGraph::Compile()
+{
+	steps.clear();
+	barriers.clear();
+	heapSize = 0;
+	splitBarriersCount = 0;
+
+	// A write is one write state on its own, reads are read states only.
+	for (const Pass& pass : passes)
+	{
+		for (const Access& access : pass.accesses)
+		{
+			uint32_t writeBits = access.state & WriteStates;
+			if (access.write ? (access.state != writeBits || 0 != (writeBits & (writeBits - 1))) : 0 != writeBits)
+				return false;
+		}
+	}
+
+	CullPasses();
+
+	for (Resource& resource : resources)
+	{
+		resource.firstUse = NoPass;
+		resource.lastUse = NoPass;
+		resource.heapOffset = 0;
+	}
+	for (uint32_t i = 0; i < passes.size(); ++i)
+	{
+		if (passes[i].culled)
+			continue;
+
+		uint32_t step = static_cast<uint32_t>(steps.size());
+		steps.push_back(Step{ i, 0, 0 });
+		for (const Access& access : passes[i].accesses)
+		{
+			Resource& resource = resources[access.resource];
+			if (NoPass == resource.firstUse)
+				resource.firstUse = step;
+			resource.lastUse = step;
+		}
+	}
+	steps.push_back(Step{ NoPass, 0, 0 });
+
+	PlaceTransients();
+	AddBarriers();
+	return true;
+}
+
+void RenderGraph::CullPasses()
+{
+	// Backwards: a pass is live when it writes something a live pass after it
+	// reads, or an output. Writes may be partial, so they keep earlier writers.
+	std::vector<bool> needed(resources.size());
+	for (size_t i = 0; i < resources.size(); ++i)
+		needed[i] = resources[i].output;
+
+	for (size_t i = passes.size(); i-- > 0;)
+	{
+		Pass& pass = passes[i];
+		pass.culled = true;
+		for (const Access& access : pass.accesses)
+		{
+			if (access.write && needed[access.resource])
+				pass.culled = false;
+		}
+		if (pass.culled)
+			continue;
+
+		for (const Access& access : pass.accesses)
+			needed[access.resource] = true;
+	}
+}
+
+void RenderGraph::PlaceTransients()
+{
+	std::vector<uint32_t> order;
+	for (uint32_t i = 0; i < resources.size(); ++i)
+	{
+		if (resources[i].transient && NoPass != resources[i].firstUse)
+			order.push_back(i);
+	}
+	std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) { return resources[a].size > resources[b].size; });
+
+	// Largest first, each at the lowest offset clear of the placed transients
+	// alive at the same time.
+	std::vector<uint32_t> placed, conflicts;
+	for (uint32_t index : order)
+	{
+		Resource& resource = resources[index];
+		conflicts.clear();
+		for (uint32_t other : placed)
+		{
+			if (Overlap(resource.firstUse, resource.lastUse, resources[other].firstUse, resources[other].lastUse))
+				conflicts.push_back(other);
+		}
+		std::sort(conflicts.begin(), conflicts.end(), [&](uint32_t a, uint32_t b) { return resources[a].heapOffset < resources[b].heapOffset; });
+
+		uint64_t offset = 0;
+		for (uint32_t other : conflicts)
+		{
+			const Resource& conflict = resources[other];
+			if (AlignUp(offset, resource.alignment) + resource.size <= conflict.heapOffset)
+				break;
+			offset = std::max(offset, conflict.heapOffset + conflict.size);
+		}
+		resource.heapOffset = AlignUp(offset, resource.alignment);
+		heapSize = std::max(heapSize, resource.heapOffset + resource.size);
+		placed.push_back(index);
+	}
+}
+
+void RenderGraph::AddBarriers()
+{
+	// The uses of every resource in step order, with consecutive reads merged
+	// into one use in all their states so they need one transition.
+	struct Use
+	{
+		uint32_t	first;
+		uint32_t	last;
+		uint32_t	state;
+		bool		write;
+	};
+	std::vector<std::vector<Use>> uses(resources.size());
+	for (uint32_t step = 0; step + 1 < steps.size(); ++step)
+	{
+		for (const Access& access : passes[steps[step].pass].accesses)
+		{
+			std::vector<Use>& resourceUses = uses[access.resource];
+			if (!access.write && !resourceUses.empty() && !resourceUses.back().write)
+			{
+				resourceUses.back().last = step;
+				resourceUses.back().state |= access.state;
+			}
+			else
+				resourceUses.push_back(Use{ step, step, access.state, access.write });
+		}
+	}
+
+	std::vector<std::vector<Barrier>> stepBarriers(steps.size());
+	auto transition = [&](uint32_t resource, uint32_t before, uint32_t after, uint32_t begin, uint32_t end)
+	{
+		if (begin < end)
+		{
+			stepBarriers[begin].push_back(Barrier{ resource, before, after, BarrierType::Transition, BarrierSplit::Begin });
+			stepBarriers[end].push_back(Barrier{ resource, before, after, BarrierType::Transition, BarrierSplit::End });
+			++splitBarriersCount;
+		}
+		else
+			stepBarriers[end].push_back(Barrier{ resource, before, after, BarrierType::Transition, BarrierSplit::None });
+	};
+
+	const uint32_t finalStep = static_cast<uint32_t>(steps.size() - 1);
+	for (uint32_t i = 0; i < resources.size(); ++i)
+	{
+		Resource& resource = resources[i];
+		const std::vector<Use>& resourceUses = uses[i];
+		if (resourceUses.empty())
+		{
+			resource.finalState = resource.transient || AnyState == resource.requestedState ? resource.initialState : resource.requestedState;
+			if (!resource.transient && resource.finalState != resource.initialState)
+				transition(i, resource.initialState, resource.finalState, 0, finalStep);
+			continue;
+		}
+
+		// Transients start each frame as the previous one left them.
+		uint32_t state = resource.transient ? resourceUses.back().state : resource.initialState;
+		uint32_t available = 0;
+		if (resource.transient)
+		{
+			for (uint32_t other = 0; other < resources.size(); ++other)
+			{
+				const Resource& overlapped = resources[other];
+				if (other != i && overlapped.transient && NoPass != overlapped.firstUse &&
+					resource.heapOffset < overlapped.heapOffset + overlapped.size && overlapped.heapOffset < resource.heapOffset + resource.size)
+				{
+					// Memory shared with another transient: no split into
+					// the time the other one still owns it.
+					stepBarriers[resourceUses.front().first].push_back(Barrier{ i, 0, 0, BarrierType::Aliasing, BarrierSplit::None });
+					available = resourceUses.front().first;
+					break;
+				}
+			}
+		}
+
+		for (const Use& use : resourceUses)
+		{
+			if (state != use.state)
+				transition(i, state, use.state, available, use.first);
+			else if (use.write && ResourceStateUnorderedAccess == use.state && use.first != resourceUses.front().first)
+				stepBarriers[use.first].push_back(Barrier{ i, state, state, BarrierType::UnorderedAccess, BarrierSplit::None });
+			state = use.state;
+			available = use.last + 1;
+		}
+
+		if (!resource.transient && AnyState != resource.requestedState && state != resource.requestedState)
+		{
+			transition(i, state, resource.requestedState, available, finalStep);
+			state = resource.requestedState;
+		}
+		resource.finalState = state;
+	}
+
+	for (size_t step = 0; step < steps.size(); ++step)
+	{
+		steps[step].firstBarrier = static_cast<uint32_t>(barriers.size());
+		steps[step].barriersCount = static_cast<uint32_t>(stepBarriers[step].size());
+		barriers.insert(barriers.end(), stepBarriers[step].begin(), stepBarriers[step].end());
+	}
+}
+
+void RenderGraph::Execute(const Step & step) const
+{
+	if (NoPass != step.pass && passes[step.pass].execute)
+		passes[step.pass].execute();
+}
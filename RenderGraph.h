@@ -0,0 +1,163 @@
+#pragma once
+#include <stdint.h>
+
+#include <functional>
+#include <string>
+#include <vector>
+
+// Values from D3D12_RESOURCE_STATES, so states cast both ways.
+enum ResourceState : uint32_t
+{
+	ResourceStateCommon = 0,
+	ResourceStateVertexAndConstantBuffer = 0x1,
+	ResourceStateIndexBuffer = 0x2,
+	ResourceStateRenderTarget = 0x4,
+	ResourceStateUnorderedAccess = 0x8,
+	ResourceStateDepthWrite = 0x10,
+	ResourceStateDepthRead = 0x20,
+	ResourceStateNonPixelShaderResource = 0x40,
+	ResourceStatePixelShaderResource = 0x80,
+	ResourceStateCopyDest = 0x400,
+	ResourceStateCopySource = 0x800,
+	ResourceStatePresent = 0,
+};
+
+// One frame of passes declaring the resources they read and write. Compile
+// drops the passes nothing depends on, places the transient resources in
+// one heap so those whose lifetimes do not overlap share memory, and works
+// out the barriers each pass needs. The result only deals in indices,
+// offsets and states, so it runs without a device; RenderGraphResources.h
+// maps it onto D3D12 and BenchRenderGraph.cpp times it.
+class RenderGraph
+{
+public:
+	static const uint32_t NoPass = ~0u;
+	static const uint32_t NoResource = ~0u;
+	// Final state of an imported resource left wherever its last use put it.
+	static const uint32_t AnyState = ~0u;
+
+	enum class BarrierType : uint8_t
+	{
+		Transition,
+		// resource starts using memory another transient used before.
+		Aliasing,
+		// Orders unordered access writes of consecutive passes.
+		UnorderedAccess,
+	};
+
+	// Transitions whose passes are apart begin after the last use and end
+	// before the next, so the GPU can do the work in between.
+	enum class BarrierSplit : uint8_t
+	{
+		None,
+		Begin,
+		End,
+	};
+
+	struct Barrier
+	{
+		uint32_t		resource;
+		uint32_t		before;
+		uint32_t		after;
+		BarrierType		type;
+		BarrierSplit	split;
+	};
+
+	// Run in order: the barriers, then the pass. The last step has no pass
+	// and holds the transitions to the final states.
+	struct Step
+	{
+		uint32_t	pass;
+		uint32_t	firstBarrier;
+		uint32_t	barriersCount;
+	};
+
+	// Drops every pass and resource.
+	void Reset();
+
+	// A resource that lives outside the graph, in initialState when the frame
+	// starts. Graphs with an imported resource in a finalState other than
+	// AnyState keep the passes writing it.
+	uint32_t Import(const char* name, uint32_t initialState, uint32_t finalState = AnyState);
+	// A resource that only lives during the frame; its contents do not carry
+	// over from one frame to the next.
+	uint32_t CreateTransient(const char* name, uint64_t size, uint64_t alignment);
+	// Keeps the passes writing resource.
+	void MarkOutput(uint32_t resource);
+
+	// Passes run in the order they are added.
+	uint32_t AddPass(const char* name, std::function<void()> execute = nullptr);
+	// The states of one pass combine; a write state cannot be combined.
+	void Read(uint32_t pass, uint32_t resource, uint32_t state);
+	void Write(uint32_t pass, uint32_t resource, uint32_t state);
+
+	// False when a pass uses a resource in conflicting states.
+	bool Compile();
+
+	const std::vector<Step>& GetSteps() const { return steps; }
+	const Barrier* GetBarriers(const Step& step) const { return barriers.data() + step.firstBarrier; }
+	void Execute(const Step& step) const;
+
+	bool IsCulled(uint32_t pass) const { return passes[pass].culled; }
+	uint32_t GetPassesCount() const { return static_cast<uint32_t>(passes.size()); }
+	// The final step's NoPass is named too.
+	const char* GetPassName(uint32_t pass) const { return NoPass != pass ? passes[pass].name.c_str() : "final barriers"; }
+
+	uint32_t GetResourcesCount() const { return static_cast<uint32_t>(resources.size()); }
+	const char* GetResourceName(uint32_t resource) const { return resources[resource].name.c_str(); }
+	bool IsTransient(uint32_t resource) const { return resources[resource].transient; }
+	// Transients no live pass uses are not placed.
+	bool IsUsed(uint32_t resource) const { return NoPass != resources[resource].firstUse; }
+	uint64_t GetHeapOffset(uint32_t resource) const { return resources[resource].heapOffset; }
+	uint64_t GetHeapSize() const { return heapSize; }
+	// Of a transient, the state of its last use: the state it should be
+	// created in, and the one it is in when the next frame starts.
+	// Of an imported resource, the state it is left in.
+	uint32_t GetFinalState(uint32_t resource) const { return resources[resource].finalState; }
+	uint32_t GetSplitBarriersCount() const { return splitBarriersCount; }
+
+private:
+	struct Access
+	{
+		uint32_t	resource;
+		uint32_t	state;
+		bool		write;
+	};
+
+	struct Pass
+	{
+		std::string				name;
+		std::function<void()>	execute;
+		std::vector<Access>		accesses;
+		bool					culled;
+	};
+
+	struct Resource
+	{
+		std::string	name;
+		uint64_t	size;
+		uint64_t	alignment;
+		uint64_t	heapOffset;
+		uint32_t	initialState;
+		// As imported, then as compiled.
+		uint32_t	requestedState;
+		uint32_t	finalState;
+		// Indices into steps of the first and last live pass using it.
+		uint32_t	firstUse;
+		uint32_t	lastUse;
+		bool		transient;
+		bool		output;
+	};
+
+	void AddAccess(uint32_t pass, uint32_t resource, uint32_t state, bool write);
+	void CullPasses();
+	void PlaceTransients();
+	void AddBarriers();
+
+	std::vector<Pass>		passes;
+	std::vector<Resource>	resources;
+	std::vector<Step>		steps;
+	std::vector<Barrier>	barriers;
+	uint64_t				heapSize = 0;
+	uint32_t				splitBarriersCount = 0;
+};
@@ -0,0 +1,216 @@
+#include "RenderGraphResources.h"
+
+#include <cstring>
+
+namespace
+{
+	bool SameDesc(const D3D12_RESOURCE_DESC& a, const D3D12_RESOURCE_DESC& b)
+	{
+		return a.Dimension == b.Dimension && a.Alignment == b.Alignment && a.Width == b.Width && a.Height == b.Height &&
+			a.DepthOrArraySize == b.DepthOrArraySize && a.MipLevels == b.MipLevels && a.Format == b.Format &&
+			a.SampleDesc.Count == b.SampleDesc.Count && a.SampleDesc.Quality == b.SampleDesc.Quality &&
+			a.Layout == b.Layout && a.Flags == b.Flags;
+	}
+
+	bool SameClearValue(const D3D12_CLEAR_VALUE& a, const D3D12_CLEAR_VALUE& b)
+	{
+		return a.Format == b.Format && 0 == memcmp(a.Color, b.Color, sizeof(a.Color));
+	}
+}
+
+void RenderGraphResources::Init(ID3D12Device * device)
+{
+	Release();
+
+	this->device = device;
+
+	// Tier 2 heaps take anything, tier 1 ones a single kind of resource.
+	D3D12_FEATURE_DATA_D3D12_OPTIONS options = {};
+	bool mixedHeaps = SUCCEEDED(device->CheckFeatureSupport(D3D12_FEATURE_D3D12_OPTIONS, &options, sizeof(options)))
+		&& options.ResourceHeapTier >= D3D12_RESOURCE_HEAP_TIER_2;
+	heapFlags = mixedHeaps ? D3D12_HEAP_FLAG_ALLOW_ALL_BUFFERS_AND_TEXTURES : D3D12_HEAP_FLAG_ALLOW_ONLY_RT_DS_TEXTURES;
+}
+
+void RenderGraphResources::Release()
+{
+	for (Transient& transient : transients)
+		transient.resource->Release();
+	transients.clear();
+	for (ID3D12Pageable* object : pendingRetired)
+		object->Release();
+	pendingRetired.clear();
+	for (Retired& entry : retired)
+		entry.object->Release();
+	retired.clear();
+
+	if (nullptr != heap)
+		heap->Release();
+	heap = nullptr;
+	heapSize = 0;
+
+	frameResources.clear();
+	declared.clear();
+	declaredIndices.clear();
+	device = nullptr;
+}
+
+uint32_t RenderGraphResources::Import(RenderGraph & graph, const char * name, ID3D12Resource * resource, D3D12_RESOURCE_STATES initialState, uint32_t finalState)
+{
+	// Indices start over with every graph, so this also drops last frame's.
+	uint32_t index = graph.Import(name, static_cast<uint32_t>(initialState), finalState);
+	frameResources.resize(index + 1);
+	frameResources[index] = resource;
+	return index;
+}
+
+uint32_t RenderGraphResources::CreateTransient(RenderGraph & graph, const char * name, const D3D12_RESOURCE_DESC & desc, const D3D12_CLEAR_VALUE * clearValue)
+{
+	D3D12_RESOURCE_ALLOCATION_INFO info = device->GetResourceAllocationInfo(0, 1, &desc);
+	uint32_t index = graph.CreateTransient(name, info.SizeInBytes, info.Alignment);
+	frameResources.resize(index + 1);
+	frameResources[index] = nullptr;
+
+	Transient transient = {};
+	transient.name = name;
+	transient.desc = desc;
+	transient.hasClearValue = nullptr != clearValue;
+	if (nullptr != clearValue)
+		transient.clearValue = *clearValue;
+	declared.push_back(transient);
+	declaredIndices.push_back(index);
+	return index;
+}
+
+HRESULT RenderGraphResources::Place(const RenderGraph & graph, UINT64 completedValue)
+{
+	while (!retired.empty() && retired.front().fenceValue <= completedValue)
+	{
+		retired.front().object->Release();
+		retired.pop_front();
+	}
+
+	HRESULT hr = S_OK;
+	if (graph.GetHeapSize() > heapSize)
+	{
+		// Everything in the old heap goes with it.
+		for (Transient& transient : transients)
+			Retire(transient.resource);
+		transients.clear();
+		if (nullptr != heap)
+			Retire(heap);
+		heap = nullptr;
+		heapSize = 0;
+
+		D3D12_HEAP_DESC desc = {};
+		desc.SizeInBytes = (graph.GetHeapSize() + D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT - 1) & ~static_cast<UINT64>(D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT - 1);
+		desc.Properties.Type = D3D12_HEAP_TYPE_DEFAULT;
+		desc.Alignment = D3D12_DEFAULT_MSAA_RESOURCE_PLACEMENT_ALIGNMENT;
+		desc.Flags = heapFlags;
+		hr = device->CreateHeap(&desc, IID_PPV_ARGS(&heap));
+		if (FAILED(hr))
+		{
+			heap = nullptr;
+			declared.clear();
+			declaredIndices.clear();
+			return hr;
+		}
+		heapSize = desc.SizeInBytes;
+	}
+
+	std::vector<Transient> placed;
+	for (size_t i = 0; i < declared.size() && SUCCEEDED(hr); ++i)
+	{
+		uint32_t index = declaredIndices[i];
+		if (!graph.IsUsed(index))
+			continue;
+
+		// Transients start the frame in the state of their last use.
+		Transient transient = declared[i];
+		transient.heapOffset = graph.GetHeapOffset(index);
+		transient.state = graph.GetFinalState(index);
+		transient.resource = nullptr;
+
+		for (Transient& previous : transients)
+		{
+			if (nullptr != previous.resource && previous.name == transient.name && SameDesc(previous.desc, transient.desc) &&
+				previous.hasClearValue == transient.hasClearValue && (!transient.hasClearValue || SameClearValue(previous.clearValue, transient.clearValue)) &&
+				previous.heapOffset == transient.heapOffset && previous.state == transient.state)
+			{
+				transient.resource = previous.resource;
+				previous.resource = nullptr;
+				break;
+			}
+		}
+
+		if (nullptr == transient.resource)
+		{
+			hr = device->CreatePlacedResource(heap, transient.heapOffset, &transient.desc, static_cast<D3D12_RESOURCE_STATES>(transient.state),
+				transient.hasClearValue ? &transient.clearValue : nullptr, IID_PPV_ARGS(&transient.resource));
+			if (FAILED(hr))
+				break;
+		}
+		frameResources[index] = transient.resource;
+		placed.push_back(transient);
+	}
+
+	for (Transient& previous : transients)
+	{
+		if (nullptr != previous.resource)
+			Retire(previous.resource);
+	}
+	transients.swap(placed);
+	declared.clear();
+	declaredIndices.clear();
+	return hr;
+}
+
+void RenderGraphResources::RecordBarriers(const RenderGraph & graph, const RenderGraph::Step & step, ID3D12GraphicsCommandList * list)
+{
+	if (0 == step.barriersCount)
+		return;
+
+	barriers.clear();
+	const RenderGraph::Barrier* stepBarriers = graph.GetBarriers(step);
+	for (uint32_t i = 0; i < step.barriersCount; ++i)
+	{
+		const RenderGraph::Barrier& source = stepBarriers[i];
+		D3D12_RESOURCE_BARRIER barrier = {};
+		switch (source.type)
+		{
+		case RenderGraph::BarrierType::Aliasing:
+			// No resource before: whichever used the memory last.
+			barrier.Type = D3D12_RESOURCE_BARRIER_TYPE_ALIASING;
+			barrier.Aliasing.pResourceAfter = frameResources[source.resource];
+			break;
+		case RenderGraph::BarrierType::UnorderedAccess:
+			barrier.Type = D3D12_RESOURCE_BARRIER_TYPE_UAV;
+			barrier.UAV.pResource = frameResources[source.resource];
+			break;
+		default:
+			barrier.Type = D3D12_RESOURCE_BARRIER_TYPE_TRANSITION;
+			if (RenderGraph::BarrierSplit::Begin == source.split)
+				barrier.Flags = D3D12_RESOURCE_BARRIER_FLAG_BEGIN_ONLY;
+			else if (RenderGraph::BarrierSplit::End == source.split)
+				barrier.Flags = D3D12_RESOURCE_BARRIER_FLAG_END_ONLY;
+			barrier.Transition.pResource = frameResources[source.resource];
+			barrier.Transition.Subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES;
+			barrier.Transition.StateBefore = static_cast<D3D12_RESOURCE_STATES>(source.before);
+			barrier.Transition.StateAfter = static_cast<D3D12_RESOURCE_STATES>(source.after);
+			break;
+		}
+		barriers.push_back(barrier);
+	}
+	list->ResourceBarrier(static_cast<UINT>(barriers.size()), barriers.data());
+}
+
+void RenderGraphResources::Submit(UINT64 fenceValue)
+{
+	for (ID3D12Pageable* object : pendingRetired)
+		retired.push_back(Retired{ fenceValue, object });
+	pendingRetired.clear();
+}
+
+void RenderGraphResources::Retire(ID3D12Pageable * object)
+{
+	pendingRetired.push_back(object);
+}
@@ -0,0 +1,81 @@
+#pragma once
+#include <d3d12.h>
+
+#include <deque>
+#include <string>
+#include <vector>
+
+#include "RenderGraph.h"
+
+// The D3D12 side of a RenderGraph: transient resources placed at the graph's
+// offsets in one heap, so they alias, and its barriers recorded a step at a
+// time. Transients are kept from frame to frame while their desc, offset and
+// state stay the same; replaced ones are released once the GPU is done with
+// the frames that used them. On resource heap tier 1 the heap only holds
+// render target and depth stencil textures.
+class RenderGraphResources
+{
+public:
+	RenderGraphResources() : device(nullptr), heap(nullptr), heapSize(0), heapFlags(D3D12_HEAP_FLAG_NONE) {}
+	~RenderGraphResources() { Release(); }
+
+	RenderGraphResources(const RenderGraphResources&) = delete;
+	RenderGraphResources& operator=(const RenderGraphResources&) = delete;
+
+	void Init(ID3D12Device* device);
+	// The GPU must be done with every frame.
+	void Release();
+
+	// Declare a frame's resources with these, between RenderGraph::Reset and
+	// RenderGraph::Compile.
+	uint32_t Import(RenderGraph& graph, const char* name, ID3D12Resource* resource, D3D12_RESOURCE_STATES initialState,
+		uint32_t finalState = RenderGraph::AnyState);
+	uint32_t CreateTransient(RenderGraph& graph, const char* name, const D3D12_RESOURCE_DESC& desc, const D3D12_CLEAR_VALUE* clearValue = nullptr);
+
+	// After RenderGraph::Compile: creates the transients that changed since
+	// the last frame and releases what completedValue says is done with.
+	HRESULT Place(const RenderGraph& graph, UINT64 completedValue);
+	ID3D12Resource* GetResource(uint32_t resource) const { return frameResources[resource]; }
+
+	// All the barriers before step in one ResourceBarrier call.
+	void RecordBarriers(const RenderGraph& graph, const RenderGraph::Step& step, ID3D12GraphicsCommandList* list);
+
+	// Ties what was replaced this frame to fenceValue.
+	void Submit(UINT64 fenceValue);
+
+private:
+	struct Transient
+	{
+		std::string			name;
+		D3D12_RESOURCE_DESC	desc;
+		D3D12_CLEAR_VALUE	clearValue;
+		bool				hasClearValue;
+		uint64_t			heapOffset;
+		uint32_t			state;
+		ID3D12Resource*		resource;
+	};
+
+	struct Retired
+	{
+		UINT64				fenceValue;
+		ID3D12Pageable*		object;
+	};
+
+	void Retire(ID3D12Pageable* object);
+
+	ID3D12Device*						device;
+	ID3D12Heap*							heap;
+	uint64_t							heapSize;
+	D3D12_HEAP_FLAGS					heapFlags;
+
+	// Per graph resource of the current frame.
+	std::vector<ID3D12Resource*>		frameResources;
+	std::vector<Transient>				declared;
+	std::vector<uint32_t>				declaredIndices;
+	// Placed, from the frames before.
+	std::vector<Transient>				transients;
+
+	std::vector<ID3D12Pageable*>		pendingRetired;
+	std::deque<Retired>					retired;
+	std::vector<D3D12_RESOURCE_BARRIER>	barriers;
+};
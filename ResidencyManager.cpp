@@ -0,0 +1,191 @@
+#include "ResidencyManager.h"
+
+#include <algorithm>
+#include <cmath>
+
+ResidencyManager::ResidencyManager(uint64_t budget, uint32_t maxPendingLoads)
+	: budget(budget), maxPendingLoads(std::max(maxPendingLoads, 1u)), pendingLoads(0), frame(0), stats()
+{
+}
+
+uint32_t ResidencyManager::AddTexture(const uint64_t * mipSizes, uint32_t mipsCount, uint32_t tailMips)
+{
+	if (0 == mipsCount)
+		return InvalidTexture;
+
+	Texture texture;
+	texture.mipSizes.assign(mipSizes, mipSizes + mipsCount);
+	texture.tailMip = mipsCount - std::min(std::max(tailMips, 1u), mipsCount);
+	texture.residentMip = texture.tailMip;
+	texture.desiredMip = texture.tailMip;
+	texture.priority = 0;
+	texture.lastUsedFrame = frame;
+	texture.loading = false;
+	texture.alive = true;
+	for (uint32_t mip = texture.tailMip; mip < mipsCount; ++mip)
+		stats.residentBytes += mipSizes[mip];
+	stats.peakBytes = std::max(stats.peakBytes, stats.residentBytes + stats.pendingBytes);
+
+	if (freeTextures.empty())
+	{
+		textures.push_back(std::move(texture));
+		return static_cast<uint32_t>(textures.size() - 1);
+	}
+	uint32_t index = freeTextures.back();
+	freeTextures.pop_back();
+	textures[index] = std::move(texture);
+	return index;
+}
+
+void ResidencyManager::RemoveTexture(uint32_t index)
+{
+	Texture& texture = textures[index];
+	if (!texture.alive)
+		return;
+
+	for (uint32_t mip = texture.residentMip; mip < texture.mipSizes.size(); ++mip)
+		stats.residentBytes -= texture.mipSizes[mip];
+	if (texture.loading)
+	{
+		stats.pendingBytes -= texture.mipSizes[texture.residentMip - 1];
+		--pendingLoads;
+	}
+	texture.alive = false;
+	texture.loading = false;
+	texture.mipSizes.clear();
+	freeTextures.push_back(index);
+}
+
+void ResidencyManager::BeginFrame()
+{
+	++frame;
+	for (Texture& texture : textures)
+		texture.desiredMip = texture.tailMip;
+}
+
+void ResidencyManager::Request(uint32_t index, uint32_t mip, uint32_t priority)
+{
+	Texture& texture = textures[index];
+	mip = std::min(mip, texture.tailMip);
+	if (texture.residentMip <= mip)
+		++stats.hits;
+	else
+		++stats.misses;
+
+	texture.desiredMip = std::min(texture.desiredMip, mip);
+	// Kept once the texture goes out of use, for eviction order.
+	texture.priority = texture.lastUsedFrame == frame ? std::max(texture.priority, priority) : priority;
+	texture.lastUsedFrame = frame;
+}
+
+const std::vector<ResidencyManager::Action>& ResidencyManager::Update()
+{
+	actions.clear();
+	loadOrder.clear();
+	evictOrder.clear();
+	for (uint32_t i = 0; i < textures.size(); ++i)
+	{
+		const Texture& texture = textures[i];
+		if (!texture.alive || texture.loading)
+			continue;
+		if (texture.residentMip > texture.desiredMip)
+			loadOrder.push_back(i);
+		else if (texture.residentMip < texture.desiredMip)
+			evictOrder.push_back(i);
+	}
+
+	std::sort(loadOrder.begin(), loadOrder.end(), [this](uint32_t a, uint32_t b)
+	{
+		const Texture& ta = textures[a];
+		const Texture& tb = textures[b];
+		if (ta.priority != tb.priority)
+			return ta.priority > tb.priority;
+		uint32_t missingA = ta.residentMip - ta.desiredMip, missingB = tb.residentMip - tb.desiredMip;
+		return missingA != missingB ? missingA > missingB : a < b;
+	});
+	std::sort(evictOrder.begin(), evictOrder.end(), [this](uint32_t a, uint32_t b)
+	{
+		const Texture& ta = textures[a];
+		const Texture& tb = textures[b];
+		if (ta.lastUsedFrame != tb.lastUsedFrame)
+			return ta.lastUsedFrame < tb.lastUsedFrame;
+		return ta.priority != tb.priority ? ta.priority < tb.priority : a < b;
+	});
+
+	// Only mips beyond what their texture needs this frame are evicted, so
+	// the budget may stay exceeded when everything resident is in use.
+	size_t nextEvicted = 0;
+	auto MakeRoom = [&](uint64_t size)
+	{
+		while (stats.residentBytes + stats.pendingBytes + size > budget && nextEvicted < evictOrder.size())
+		{
+			uint32_t index = evictOrder[nextEvicted];
+			Evict(index);
+			if (textures[index].residentMip >= textures[index].desiredMip)
+				++nextEvicted;
+		}
+		return stats.residentBytes + stats.pendingBytes + size <= budget;
+	};
+
+	// A budget that shrank is caught up with first.
+	MakeRoom(0);
+	for (size_t i = 0; i < loadOrder.size() && pendingLoads < maxPendingLoads; ++i)
+	{
+		Texture& texture = textures[loadOrder[i]];
+		uint32_t mip = texture.residentMip - 1;
+		if (!MakeRoom(texture.mipSizes[mip]))
+		{
+			// Lower priorities wait rather than take what is left.
+			stats.deferredLoads += loadOrder.size() - i;
+			break;
+		}
+
+		actions.push_back(Action{ loadOrder[i], mip, ActionType::Load });
+		texture.loading = true;
+		stats.pendingBytes += texture.mipSizes[mip];
+		++pendingLoads;
+	}
+
+	stats.peakBytes = std::max(stats.peakBytes, stats.residentBytes + stats.pendingBytes);
+	return actions;
+}
+
+void ResidencyManager::OnLoaded(uint32_t index, uint32_t mip)
+{
+	Texture& texture = textures[index];
+	if (!texture.alive || !texture.loading || mip + 1 != texture.residentMip)
+		return;
+
+	uint64_t size = texture.mipSizes[mip];
+	texture.loading = false;
+	texture.residentMip = mip;
+	--pendingLoads;
+	stats.pendingBytes -= size;
+	stats.residentBytes += size;
+	++stats.loads;
+	stats.loadedBytes += size;
+}
+
+uint32_t ResidencyManager::SelectMip(uint32_t width, uint32_t height, uint32_t mipsCount, float screenSize)
+{
+	if (0 == mipsCount)
+		return 0;
+	if (!(screenSize > 0.0f))
+		return mipsCount - 1;
+
+	float texelsPerPixel = std::max(width, height) / screenSize;
+	if (texelsPerPixel <= 1.0f)
+		return 0;
+	return std::min(static_cast<uint32_t>(std::log2(texelsPerPixel)), mipsCount - 1);
+}
+
+void ResidencyManager::Evict(uint32_t index)
+{
+	Texture& texture = textures[index];
+	uint64_t size = texture.mipSizes[texture.residentMip];
+	actions.push_back(Action{ index, texture.residentMip, ActionType::Evict });
+	++texture.residentMip;
+	stats.residentBytes -= size;
+	++stats.evictions;
+	stats.evictedBytes += size;
+}
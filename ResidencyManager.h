@@ -0,0 +1,107 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+#include <vector>
+
+// Which texture mips stay in video memory under a budget. Every texture
+// keeps a contiguous chain resident, from its resident mip down to the
+// smallest one; the tail mips are resident from the start and never evicted.
+// Each frame the renderer requests the finest mip every texture needs, by
+// screen-space texel density, and Update decides what to stream in and what
+// to drop: finer mips for the highest priority, furthest off textures first,
+// making room by evicting mips no request needs, least recently used and
+// lowest priority first. Loads take frames, so they count against the budget
+// until the renderer reports them done. Nothing here touches a device, so
+// the policy runs as well from a recorded trace.
+class ResidencyManager
+{
+public:
+	static const uint32_t InvalidTexture = ~0u;
+
+	enum class ActionType : uint8_t
+	{
+		Load,
+		Evict,
+	};
+
+	// Loads are one mip finer than the texture's resident mip, evictions the
+	// resident mip itself.
+	struct Action
+	{
+		uint32_t	texture;
+		uint32_t	mip;
+		ActionType	type;
+	};
+
+	struct Stats
+	{
+		// Requests whose mip was resident, and those that had to make do
+		// with a coarser one.
+		uint64_t	hits;
+		uint64_t	misses;
+		uint64_t	loads;
+		uint64_t	evictions;
+		uint64_t	loadedBytes;
+		uint64_t	evictedBytes;
+		// Loads Update could not fit in the budget.
+		uint64_t	deferredLoads;
+		uint64_t	residentBytes;
+		uint64_t	pendingBytes;
+		uint64_t	peakBytes;
+	};
+
+	explicit ResidencyManager(uint64_t budget = 0, uint32_t maxPendingLoads = 8);
+
+	void SetBudget(uint64_t budget) { this->budget = budget; }
+	uint64_t GetBudget() const { return budget; }
+
+	// mipSizes[0] is the finest mip. The last tailMips mips count as loaded
+	// already; the renderer creates the texture with them.
+	uint32_t AddTexture(const uint64_t* mipSizes, uint32_t mipsCount, uint32_t tailMips = 1);
+	// Loads still in flight for it are forgotten.
+	void RemoveTexture(uint32_t texture);
+
+	void BeginFrame();
+	// Higher priorities load first and are evicted last.
+	void Request(uint32_t texture, uint32_t mip, uint32_t priority = 0);
+	// What the renderer should do this frame. Evictions apply at once; loads
+	// once OnLoaded reports them.
+	const std::vector<Action>& Update();
+	void OnLoaded(uint32_t texture, uint32_t mip);
+
+	uint32_t GetResidentMip(uint32_t texture) const { return textures[texture].residentMip; }
+	bool IsLoading(uint32_t texture) const { return textures[texture].loading; }
+	const Stats& GetStats() const { return stats; }
+
+	// The mip whose texels are about one per pixel when the texture covers
+	// screenSize pixels across.
+	static uint32_t SelectMip(uint32_t width, uint32_t height, uint32_t mipsCount, float screenSize);
+
+private:
+	struct Texture
+	{
+		std::vector<uint64_t>	mipSizes;
+		uint32_t				tailMip;
+		uint32_t				residentMip;
+		// Finest mip requested this frame, or tailMip.
+		uint32_t				desiredMip;
+		uint32_t				priority;
+		uint64_t				lastUsedFrame;
+		bool					loading;
+		bool					alive;
+	};
+
+	void Evict(uint32_t texture);
+
+	std::vector<Texture>	textures;
+	std::vector<uint32_t>	freeTextures;
+	std::vector<Action>		actions;
+	std::vector<uint32_t>	loadOrder;
+	std::vector<uint32_t>	evictOrder;
+	uint64_t				budget;
+	uint32_t				maxPendingLoads;
+	uint32_t				pendingLoads;
+	uint64_t				frame;
+	Stats					stats;
+};
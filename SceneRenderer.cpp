@@ -0,0 +1,162 @@
+#include "SceneRenderer.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+#include "Profiler.h"
+
+void SceneRenderer::Init(size_t objectsCount, uint32_t materialsCount, uint32_t tintsCount, float spacing)
+{
+	this->materialsCount = std::max(materialsCount, 1u);
+	tintsCount = std::max(tintsCount, 1u);
+	size_t side = 1;
+	while (side * side * side < objectsCount)
+		++side;
+
+	// Each object spins at its own phase under a root that slowly turns the whole grid.
+	transforms.Clear();
+	sceneRoot = transforms.Add();
+	objects.resize(objectsCount);
+	for (size_t i = 0; i < objects.size(); ++i)
+	{
+		const float half = (side - 1) * 0.5f;
+		Object& object = objects[i];
+		object.transform = transforms.Add(sceneRoot);
+		transforms.SetTranslation(object.transform,
+			(i % side - half) * spacing,
+			(i / side % side - half) * spacing,
+			(i / (side * side) - half) * spacing);
+		object.phase = static_cast<float>(i % 97) * 0.1f;
+		object.material = static_cast<uint32_t>(i % this->materialsCount);
+		object.tint = static_cast<uint32_t>(i % tintsCount);
+	}
+	objectBoxes.resize(objects.size());
+	lodInstances.resize(objects.size());
+	lods.resize(objects.size());
+	visibleObjects.clear();
+	draws.clear();
+	stats = Stats();
+}
+
+void SceneRenderer::SetMesh(const SceneMesh & mesh)
+{
+	this->mesh = mesh;
+	hasMesh = true;
+}
+
+void SceneRenderer::Update(float time, ThreadPool * pool)
+{
+	// Nothing is drawn until Pack lists this frame's instances.
+	draws.clear();
+	if (!hasMesh)
+		return;
+
+	float rootAngle = time * 0.05f;
+	transforms.SetRotation(sceneRoot, 0.0f, std::sin(rootAngle), 0.0f, std::cos(rootAngle));
+	for (const Object& object : objects)
+	{
+		float angle = (time + object.phase) * 0.5f;
+		transforms.SetRotation(object.transform, 0.0f, std::sin(angle), 0.0f, std::cos(angle));
+	}
+	transforms.Update(pool);
+
+	// The tree is built once and refitted as the objects turn.
+	for (size_t i = 0; i < objects.size(); ++i)
+		objectBoxes[i] = TransformAabb(mesh.box, transforms.GetWorld(objects[i].transform));
+	if (cullingBvh.GetObjectsCount() != objectBoxes.size())
+		cullingBvh.Build(objectBoxes.data(), objectBoxes.size());
+	else
+		cullingBvh.Refit(objectBoxes.data(), pool);
+	{
+		PROFILE_SCOPE("Cull");
+		cullingBvh.Cull(frustum, pool, visibleObjects);
+	}
+
+	// LODs and instances only for what is in view, in visibleObjects order.
+	maxScreenSize = 0.0f;
+	for (size_t i = 0; i < visibleObjects.size(); ++i)
+	{
+		const WorldTransform& world = transforms.GetWorld(objects[visibleObjects[i]].transform);
+		LodInstance& lodInstance = lodInstances[i];
+		for (int c = 0; c < 3; ++c)
+			lodInstance.center[c] = mesh.center[0] * world.world[c][0] + mesh.center[1] * world.world[c][1] + mesh.center[2] * world.world[c][2] + world.world[c][3];
+		lodInstance.radius = mesh.radius;
+		lodInstance.scale = 1.0f;
+		maxScreenSize = std::max(maxScreenSize, lodSelector.GetScreenSize(lodInstance));
+	}
+	lodSelector.Select(lodInstances.data(), visibleObjects.size(), mesh.lodErrors, mesh.lodsCount, lods.data());
+
+	// One batch per LOD and material.
+	instanceBuilder.Reset(static_cast<uint32_t>(mesh.lodsCount * materialsCount));
+	for (size_t i = 0; i < visibleObjects.size(); ++i)
+	{
+		const Object& object = objects[visibleObjects[i]];
+		instanceBuilder.Add(lods[i] * materialsCount + object.material, transforms.GetWorld(object.transform), object.tint);
+	}
+	stats.visibleCount = visibleObjects.size();
+}
+
+void SceneRenderer::Pack(InstanceData * dest, uint64_t destAddress)
+{
+	draws.clear();
+	stats.instancesCount = instanceBuilder.GetInstancesCount();
+	const std::vector<InstanceBuilder::Batch>& batches = instanceBuilder.Pack(dest);
+	for (const InstanceBuilder::Batch& batch : batches)
+	{
+		const uint32_t lod = batch.key / materialsCount;
+		for (size_t submesh = 0; submesh < mesh.submeshesCount; ++submesh)
+		{
+			Draw draw;
+			draw.material = batch.key % materialsCount;
+			draw.indexRange = static_cast<uint32_t>(lod * mesh.submeshesCount + submesh);
+			draw.instancesCount = batch.instancesCount;
+			draw.instancesAddress = destAddress + batch.firstInstance * sizeof(InstanceData);
+			draws.push_back(draw);
+		}
+	}
+	stats.drawsCount = draws.size();
+}
+
+size_t SceneRenderer::Record(RenderDevice & device, ThreadPool * pool, RenderCommandList ** lists)
+{
+	stats.listsCount = 0;
+	stats.recordMs = 0.0;
+	stats.maxListMs = 0.0;
+	if (draws.empty())
+		return 0;
+
+	// Draws are split in contiguous chunks, one list each, executed in chunk order.
+	auto start = std::chrono::high_resolution_clock::now();
+	size_t listsCount = ParallelRecord(pool, draws.size(), MinDrawsPerList, MaxLists, recordChunks,
+		[&](size_t chunk, size_t begin, size_t end)
+		{
+			PROFILE_SCOPE("Record draws");
+			RenderCommandList* list = device.AcquireList();
+			lists[chunk] = list;
+			if (nullptr == list)
+				return;
+
+			uint32_t material = ~0u;
+			for (size_t i = begin; i < end; ++i)
+			{
+				const Draw& draw = draws[i];
+				const Mesh::IndexRange& indexRange = mesh.indexRanges[draw.indexRange];
+				if (draw.material != material)
+				{
+					material = draw.material;
+					list->SetMaterial(material);
+				}
+				list->SetIndexBuffer(mesh.indexBufferAddress + indexRange.byteOffset, indexRange.indexCount * indexRange.indexSize, indexRange.indexSize);
+				list->SetInstances(draw.instancesAddress);
+				list->DrawIndexedInstanced(indexRange.indexCount, draw.instancesCount, 0, static_cast<int32_t>(indexRange.baseVertex));
+			}
+			list->Close();
+		});
+	stats.recordMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+
+	stats.listsCount = listsCount;
+	for (size_t i = 0; i < listsCount; ++i)
+		stats.maxListMs = std::max(stats.maxListMs, recordChunks[i].ms);
+	return listsCount;
+}
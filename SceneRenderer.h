@@ -0,0 +1,119 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+#include <vector>
+
+#include "CullingBvh.h"
+#include "InstanceBuilder.h"
+#include "LodSelector.h"
+#include "Mesh.h"
+#include "ParallelRecord.h"
+#include "RenderDevice.h"
+#include "ThreadPool.h"
+#include "TransformSystem.h"
+
+// What the scene draws every object with, LOD by LOD.
+struct SceneMesh
+{
+	Aabb					box;
+	// Bounding sphere, for LOD selection.
+	float					center[3];
+	float					radius;
+	// Ascending, one per LOD.
+	const float*			lodErrors;
+	size_t					lodsCount;
+	size_t					submeshesCount;
+	// lodsCount * submeshesCount ranges, LOD after LOD.
+	const Mesh::IndexRange*	indexRanges;
+	uint64_t				indexBufferAddress;
+};
+
+// The CPU side of drawing a cube of spinning objects: transforms, culling,
+// LOD selection, instance packing and recording the instanced draws on the
+// pool, a batch per LOD and material. It records through a RenderDevice, so
+// the same frame runs with D3D12 or headless.
+class SceneRenderer
+{
+public:
+	// A list per chunk of at least MinDrawsPerList draws.
+	static const size_t MaxLists = 8;
+	static const size_t MinDrawsPerList = 64;
+
+	struct Stats
+	{
+		size_t	visibleCount;
+		size_t	instancesCount;
+		size_t	drawsCount;
+		size_t	listsCount;
+		double	recordMs;
+		double	maxListMs;
+	};
+
+	SceneRenderer() : sceneRoot(0), materialsCount(1), mesh(), hasMesh(false), frustum(), maxScreenSize(0.0f), stats() {}
+
+	// objectsCount objects on a grid spacing apart, centered on the origin,
+	// with materials and tints assigned in turn. Materials are what draws
+	// bind; tints only go to the instances' materialIndex, for the shader.
+	void Init(size_t objectsCount, uint32_t materialsCount, uint32_t tintsCount, float spacing);
+	// The arrays it points to must outlive the renderer.
+	void SetMesh(const SceneMesh& mesh);
+	void SetFrustum(const Frustum& frustum) { this->frustum = frustum; }
+	LodSelector& GetLodSelector() { return lodSelector; }
+
+	size_t GetObjectsCount() const { return objects.size(); }
+	uint32_t GetMaterialsCount() const { return materialsCount; }
+
+	// Animates to time, in seconds, then culls and collects the instances.
+	// Work goes to pool, or stays on the caller when it is nullptr.
+	void Update(float time, ThreadPool* pool);
+	// Largest projected diameter of a visible object, in pixels.
+	float GetMaxScreenSize() const { return maxScreenSize; }
+
+	size_t GetInstancesCount() const { return instanceBuilder.GetInstancesCount(); }
+	// Writes GetInstancesCount() instances to dest, at destAddress on the
+	// GPU, and lists the frame's draws.
+	void Pack(InstanceData* dest, uint64_t destAddress);
+	// Records the draws into lists, which must hold MaxLists, in the order
+	// they are to execute. Returns how many; failed lists are nullptr.
+	size_t Record(RenderDevice& device, ThreadPool* pool, RenderCommandList** lists);
+
+	const Stats& GetStats() const { return stats; }
+
+private:
+	struct Object
+	{
+		uint32_t	transform;
+		float		phase;
+		uint32_t	material;
+		uint32_t	tint;
+	};
+
+	// One batch of one submesh.
+	struct Draw
+	{
+		uint32_t	material;
+		uint32_t	indexRange;
+		uint32_t	instancesCount;
+		uint64_t	instancesAddress;
+	};
+
+	TransformSystem			transforms;
+	uint32_t				sceneRoot;
+	std::vector<Object>		objects;
+	uint32_t				materialsCount;
+	SceneMesh				mesh;
+	bool					hasMesh;
+	Frustum					frustum;
+	std::vector<Aabb>		objectBoxes;
+	CullingBvh				cullingBvh;
+	std::vector<uint32_t>	visibleObjects;
+	LodSelector				lodSelector;
+	std::vector<LodInstance>	lodInstances;
+	std::vector<uint8_t>	lods;
+	float					maxScreenSize;
+	InstanceBuilder			instanceBuilder;
+	std::vector<Draw>		draws;
+	RecordChunk				recordChunks[MaxLists];
+	Stats					stats;
+};
@@ -0,0 +1,319 @@
+#include "Texture.h"
+#include "MappedFile.h"
+#include "TextureCompression.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+#include <emmintrin.h>
+
+#if defined(_WIN32)
+#include <Windows.h>
+#include <wincodec.h>
+#pragma comment(lib, "windowscodecs.lib")
+#endif
+
+namespace
+{
+	uint64_t AlignUp(uint64_t value, uint64_t alignment)
+	{
+		return (value + alignment - 1) & ~(alignment - 1);
+	}
+
+	// sRGB to linear for every byte, linear to sRGB for 4096 steps of
+	// linear, fine enough that every byte is reachable.
+	struct ColorTables
+	{
+		float	toLinear[256];
+		uint8_t	toSrgb[4096];
+
+		ColorTables()
+		{
+			for (int i = 0; i < 256; ++i)
+			{
+				float c = i / 255.0f;
+				toLinear[i] = c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+			}
+			for (int i = 0; i < 4096; ++i)
+			{
+				float c = i / 4095.0f;
+				float s = c <= 0.0031308f ? c * 12.92f : 1.055f * std::pow(c, 1.0f / 2.4f) - 0.055f;
+				toSrgb[i] = static_cast<uint8_t>(std::min(std::max(s * 255.0f + 0.5f, 0.0f), 255.0f));
+			}
+		}
+	};
+
+	const ColorTables& GetColorTables()
+	{
+		static const ColorTables tables;
+		return tables;
+	}
+
+	// RGBA floats in [0, 1] back to bytes.
+	void StoreRow(const float* source, uint32_t width, bool srgb, uint8_t* texels)
+	{
+		const ColorTables& tables = GetColorTables();
+		const __m128 zero = _mm_setzero_ps();
+		const __m128 one = _mm_set1_ps(1.0f);
+		const __m128 scale = srgb ? _mm_setr_ps(4095.0f, 4095.0f, 4095.0f, 255.0f) : _mm_set1_ps(255.0f);
+		for (uint32_t x = 0; x < width; ++x)
+		{
+			__m128 value = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(source + x * 4), zero), one);
+			__m128i scaled = _mm_cvtps_epi32(_mm_mul_ps(value, scale));
+			int32_t channels[4];
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(channels), scaled);
+			for (int c = 0; c < 3; ++c)
+				texels[x * 4 + c] = srgb ? tables.toSrgb[channels[c]] : static_cast<uint8_t>(channels[c]);
+			texels[x * 4 + 3] = static_cast<uint8_t>(channels[3]);
+		}
+	}
+
+	// "P6 <width> <height> 255", then RGB bytes.
+	bool DecodePpm(const uint8_t* data, size_t size, Image& image)
+	{
+		if (size < 2 || 'P' != data[0] || '6' != data[1])
+			return false;
+
+		size_t position = 2;
+		uint64_t values[3];
+		for (uint64_t& value : values)
+		{
+			while (position < size)
+			{
+				if ('#' == data[position])
+				{
+					while (position < size && '\n' != data[position])
+						++position;
+				}
+				else if (isspace(data[position]))
+					++position;
+				else
+					break;
+			}
+
+			size_t start = position;
+			value = 0;
+			while (position < size && isdigit(data[position]) && value < (1u << 20))
+				value = value * 10 + (data[position++] - '0');
+			if (start == position)
+				return false;
+		}
+
+		// One whitespace character before the texels.
+		++position;
+		if (0 == values[0] || 0 == values[1] || 255 != values[2] || position > size || (size - position) / 3 < values[0] * values[1])
+			return false;
+
+		image.width = static_cast<uint32_t>(values[0]);
+		image.height = static_cast<uint32_t>(values[1]);
+		image.texels.resize(static_cast<size_t>(values[0] * values[1]) * 4);
+		for (size_t i = 0; i < values[0] * values[1]; ++i)
+		{
+			memcpy(&image.texels[i * 4], data + position + i * 3, 3);
+			image.texels[i * 4 + 3] = 255;
+		}
+		return true;
+	}
+}
+
+#if defined(_WIN32)
+
+bool DecodeImage(const void * data, size_t size, Image & image)
+{
+	if (DecodePpm(static_cast<const uint8_t*>(data), size, image))
+		return true;
+
+	// Once per thread; S_FALSE or a thread already in another mode is fine too.
+	CoInitializeEx(nullptr, COINIT_MULTITHREADED);
+
+	IWICImagingFactory* factory = nullptr;
+	IWICStream* stream = nullptr;
+	IWICBitmapDecoder* decoder = nullptr;
+	IWICBitmapFrameDecode* frame = nullptr;
+	IWICFormatConverter* converter = nullptr;
+	UINT width = 0, height = 0;
+	bool ok = SUCCEEDED(CoCreateInstance(CLSID_WICImagingFactory, nullptr, CLSCTX_INPROC_SERVER, IID_PPV_ARGS(&factory)))
+		&& SUCCEEDED(factory->CreateStream(&stream))
+		&& SUCCEEDED(stream->InitializeFromMemory(static_cast<BYTE*>(const_cast<void*>(data)), static_cast<DWORD>(size)))
+		&& SUCCEEDED(factory->CreateDecoderFromStream(stream, nullptr, WICDecodeMetadataCacheOnDemand, &decoder))
+		&& SUCCEEDED(decoder->GetFrame(0, &frame))
+		&& SUCCEEDED(factory->CreateFormatConverter(&converter))
+		&& SUCCEEDED(converter->Initialize(frame, GUID_WICPixelFormat32bppRGBA, WICBitmapDitherTypeNone, nullptr, 0.0, WICBitmapPaletteTypeCustom))
+		&& SUCCEEDED(converter->GetSize(&width, &height))
+		&& width > 0 && height > 0;
+	if (ok)
+	{
+		image.width = width;
+		image.height = height;
+		image.texels.resize(static_cast<size_t>(width) * height * 4);
+		ok = SUCCEEDED(converter->CopyPixels(nullptr, width * 4, static_cast<UINT>(image.texels.size()), image.texels.data()));
+	}
+
+	if (nullptr != converter) converter->Release();
+	if (nullptr != frame) frame->Release();
+	if (nullptr != decoder) decoder->Release();
+	if (nullptr != stream) stream->Release();
+	if (nullptr != factory) factory->Release();
+	return ok;
+}
+
+#else
+
+bool DecodeImage(const void * data, size_t size, Image & image)
+{
+	return DecodePpm(static_cast<const uint8_t*>(data), size, image);
+}
+
+#endif
+
+bool LoadImageFile(const char * filename, Image & image)
+{
+	MappedFile file;
+	return file.Open(filename) && DecodeImage(file.GetData(), file.GetSize(), image);
+}
+
+void GenerateMips(const Image & image, bool srgb, ThreadPool & pool, std::vector<Image>& mips)
+{
+	mips.clear();
+	mips.push_back(image);
+	if (0 == image.width || 0 == image.height)
+		return;
+
+	// Kept in float from level to level so rounding does not add up.
+	const ColorTables& tables = GetColorTables();
+	uint32_t width = image.width, height = image.height;
+	std::vector<float> source(static_cast<size_t>(width) * height * 4), target;
+	pool.ParallelFor(height, [&](size_t y)
+	{
+		const uint8_t* texels = &image.texels[y * width * 4];
+		float* row = &source[y * width * 4];
+		for (uint32_t i = 0; i < width * 4; ++i)
+			row[i] = srgb && 3 != (i & 3) ? tables.toLinear[texels[i]] : texels[i] / 255.0f;
+	});
+
+	const __m128 quarter = _mm_set1_ps(0.25f);
+	while (width > 1 || height > 1)
+	{
+		uint32_t mipWidth = std::max(width / 2, 1u), mipHeight = std::max(height / 2, 1u);
+		target.resize(static_cast<size_t>(mipWidth) * mipHeight * 4);
+
+		Image mip;
+		mip.width = mipWidth;
+		mip.height = mipHeight;
+		mip.texels.resize(target.size());
+		pool.ParallelFor(mipHeight, [&](size_t y)
+		{
+			const float* row0 = &source[std::min<size_t>(y * 2, height - 1) * width * 4];
+			const float* row1 = &source[std::min<size_t>(y * 2 + 1, height - 1) * width * 4];
+			float* out = &target[y * mipWidth * 4];
+			for (uint32_t x = 0; x < mipWidth; ++x)
+			{
+				uint32_t x0 = std::min(x * 2, width - 1) * 4, x1 = std::min(x * 2 + 1, width - 1) * 4;
+				__m128 top = _mm_add_ps(_mm_loadu_ps(row0 + x0), _mm_loadu_ps(row0 + x1));
+				__m128 bottom = _mm_add_ps(_mm_loadu_ps(row1 + x0), _mm_loadu_ps(row1 + x1));
+				_mm_storeu_ps(out + x * 4, _mm_mul_ps(_mm_add_ps(top, bottom), quarter));
+			}
+			StoreRow(out, mipWidth, srgb, &mip.texels[y * mipWidth * 4]);
+		});
+
+		mips.push_back(std::move(mip));
+		source.swap(target);
+		width = mipWidth;
+		height = mipHeight;
+	}
+}
+
+bool CookTexture(const Image & image, TextureFormat format, bool srgb, uint64_t sourceHash, ThreadPool & pool, std::vector<uint8_t>& cooked)
+{
+	const uint32_t blockSize = GetBlockSize(format);
+	if (0 == image.width || 0 == image.height || (0 == blockSize && TextureFormatRGBA8 != format))
+		return false;
+	// D3D12 wants the top level of block compressed textures in whole blocks.
+	if (0 != blockSize && (0 != image.width % 4 || 0 != image.height % 4))
+		return false;
+
+	std::vector<Image> mips;
+	GenerateMips(image, srgb, pool, mips);
+	if (mips.size() > TextureCacheMaxMips)
+		mips.resize(TextureCacheMaxMips);
+
+	TextureCacheHeader header = {};
+	header.magic = TextureCacheMagic;
+	header.version = TextureCacheVersion;
+	header.sourceHash = sourceHash;
+	header.format = format;
+	header.flags = srgb ? static_cast<uint32_t>(TextureCacheSrgb) : 0;
+	header.width = image.width;
+	header.height = image.height;
+	header.mipsCount = static_cast<uint32_t>(mips.size());
+
+	uint64_t offset = AlignUp(sizeof(TextureCacheHeader), TextureCacheAlignment);
+	for (size_t i = 0; i < mips.size(); ++i)
+	{
+		TextureCacheMip& mip = header.mips[i];
+		mip.width = mips[i].width;
+		mip.height = mips[i].height;
+		mip.rowSize = 0 != blockSize ? (mip.width + 3) / 4 * blockSize : mip.width * 4;
+		mip.rowsCount = 0 != blockSize ? (mip.height + 3) / 4 : mip.height;
+		mip.rowPitch = static_cast<uint32_t>(AlignUp(mip.rowSize, TextureCachePitchAlignment));
+		mip.offset = offset;
+		mip.size = static_cast<uint64_t>(mip.rowPitch) * mip.rowsCount;
+		offset = AlignUp(offset + mip.size, TextureCacheAlignment);
+	}
+	header.fileSize = offset;
+
+	cooked.assign(static_cast<size_t>(header.fileSize), 0);
+	memcpy(cooked.data(), &header, sizeof(header));
+	for (size_t i = 0; i < mips.size(); ++i)
+	{
+		const TextureCacheMip& mip = header.mips[i];
+		uint8_t* data = &cooked[static_cast<size_t>(mip.offset)];
+		if (0 != blockSize)
+			CompressTexture(format, mips[i].texels.data(), mip.width, mip.height, data, mip.rowPitch, pool);
+		else
+		{
+			for (uint32_t row = 0; row < mip.rowsCount; ++row)
+				memcpy(data + static_cast<size_t>(row) * mip.rowPitch, &mips[i].texels[static_cast<size_t>(row) * mip.rowSize], mip.rowSize);
+		}
+	}
+	return true;
+}
+
+bool CookedTexture::Open(const void * data, size_t size)
+{
+	header = nullptr;
+
+	auto InFile = [size](uint64_t offset, uint64_t length) { return offset <= size && length <= size - offset; };
+
+	const TextureCacheHeader* h = static_cast<const TextureCacheHeader*>(data);
+	const TextureFormat format = static_cast<TextureFormat>(size >= sizeof(TextureCacheHeader) ? h->format : TextureFormatUnknown);
+	bool valid = size >= sizeof(TextureCacheHeader)
+		&& h->magic == TextureCacheMagic
+		&& h->version == TextureCacheVersion
+		&& h->fileSize == size
+		&& (TextureFormatRGBA8 == format || 0 != GetBlockSize(format))
+		&& h->width > 0 && h->height > 0
+		&& h->mipsCount > 0 && h->mipsCount <= TextureCacheMaxMips;
+
+	for (uint32_t i = 0; valid && i < h->mipsCount; ++i)
+	{
+		const TextureCacheMip& mip = h->mips[i];
+		valid = mip.rowSize <= mip.rowPitch
+			&& mip.size == static_cast<uint64_t>(mip.rowPitch) * mip.rowsCount
+			&& 0 == mip.offset % TextureCacheAlignment
+			&& InFile(mip.offset, mip.size);
+	}
+
+	if (valid)
+		header = h;
+	return valid;
+}
+
+void CookedTexture::GetCacheFilename(const char * filename, char * cacheFilename, size_t size)
+{
+	snprintf(cacheFilename, size, "%s.tex", filename);
+}
@@ -0,0 +1,55 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+#include <vector>
+
+#include "TextureCache.h"
+
+class ThreadPool;
+
+// RGBA8 texels, row by row.
+struct Image
+{
+	uint32_t				width = 0;
+	uint32_t				height = 0;
+	std::vector<uint8_t>	texels;
+};
+
+// WIC on Windows, which takes JPEG, PNG, BMP and the like; elsewhere only
+// binary PPM, enough to cook and benchmark off Windows.
+bool DecodeImage(const void* data, size_t size, Image& image);
+bool LoadImageFile(const char* filename, Image& image);
+
+// The full chain down to 1x1, image included. A 2x2 box filter, in linear
+// space when srgb is set; alpha is always linear. Odd sizes drop their last
+// row or column.
+void GenerateMips(const Image& image, bool srgb, ThreadPool& pool, std::vector<Image>& mips);
+
+// Mips and compression into a whole .tex file, see TextureCache.h. Block
+// compressed formats need sizes in multiples of 4.
+bool CookTexture(const Image& image, TextureFormat format, bool srgb, uint64_t sourceHash, ThreadPool& pool, std::vector<uint8_t>& cooked);
+
+// A cooked texture in memory, usually a file mapping or an archive view,
+// used in place.
+class CookedTexture
+{
+public:
+	CookedTexture() : header(nullptr) {}
+
+	// Checks the layout; data must outlive this.
+	bool Open(const void* data, size_t size);
+
+	TextureFormat GetFormat() const { return static_cast<TextureFormat>(header->format); }
+	bool IsSrgb() const { return 0 != (header->flags & TextureCacheSrgb); }
+	uint32_t GetWidth() const { return header->width; }
+	uint32_t GetHeight() const { return header->height; }
+	uint32_t GetMipsCount() const { return header->mipsCount; }
+	const TextureCacheMip& GetMip(uint32_t mip) const { return header->mips[mip]; }
+	const uint8_t* GetMipData(uint32_t mip) const { return reinterpret_cast<const uint8_t*>(header) + header->mips[mip].offset; }
+
+	static void GetCacheFilename(const char* filename, char* cacheFilename, size_t size);
+
+private:
+	const TextureCacheHeader*	header;
+};
@@ -0,0 +1,59 @@
+#pragma once
+#include <stdint.h>
+
+// On-disk layout of a cooked texture (*.tex), written by AssetCooker and
+// mapped directly by CookedTexture. Every mip is stored the way
+// GetCopyableFootprints lays it out in an upload buffer: rows padded to
+// TextureCachePitchAlignment and mips starting on TextureCacheAlignment, so
+// staging a mip is a single memcpy.
+
+constexpr uint32_t TextureCacheMagic = 0x43584554;	// 'TEXC'
+constexpr uint32_t TextureCacheVersion = 1;
+// D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT and D3D12_TEXTURE_DATA_PITCH_ALIGNMENT.
+constexpr uint64_t TextureCacheAlignment = 512;
+constexpr uint32_t TextureCachePitchAlignment = 256;
+constexpr uint32_t TextureCacheMaxMips = 16;
+
+// Same values as DXGI_FORMAT.
+enum TextureFormat : uint32_t
+{
+	TextureFormatUnknown = 0,
+	TextureFormatRGBA8 = 28,
+	TextureFormatBC1 = 71,
+	TextureFormatBC3 = 77,
+	TextureFormatBC7 = 98,
+};
+
+enum TextureCacheFlags : uint32_t
+{
+	// Texels are sRGB encoded; the mips were filtered in linear space.
+	TextureCacheSrgb = 0x1,
+};
+
+struct TextureCacheMip
+{
+	uint32_t	width;
+	uint32_t	height;
+	// Rows of blocks for compressed formats.
+	uint32_t	rowsCount;
+	uint32_t	rowSize;
+	uint32_t	rowPitch;
+	uint32_t	padding;
+	uint64_t	offset;
+	uint64_t	size;
+};
+
+struct TextureCacheHeader
+{
+	uint32_t		magic;
+	uint32_t		version;
+	uint64_t		sourceHash;
+	uint64_t		fileSize;
+	uint32_t		format;
+	uint32_t		flags;
+	uint32_t		width;
+	uint32_t		height;
+	uint32_t		mipsCount;
+	uint32_t		padding;
+	TextureCacheMip	mips[TextureCacheMaxMips];
+};
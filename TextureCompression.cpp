@@ -0,0 +1,536 @@
+#include "TextureCompression.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace
+{
+	typedef float Texels[16][4];
+
+	const int Bc7Weights[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+	void ToFloat(const uint8_t* texels, Texels& out)
+	{
+		for (int i = 0; i < 16; ++i)
+		{
+			for (int c = 0; c < 4; ++c)
+				out[i][c] = texels[i * 4 + c];
+		}
+	}
+
+	int Clamp(int value, int low, int high)
+	{
+		return std::min(std::max(value, low), high);
+	}
+
+	// Mean and direction of largest variance of the first channels, by power
+	// iteration on the covariance. The axis is zero for flat blocks.
+	void PrincipalAxis(const Texels& texels, int channels, float* mean, float* axis)
+	{
+		for (int c = 0; c < channels; ++c)
+		{
+			mean[c] = 0.0f;
+			for (int i = 0; i < 16; ++i)
+				mean[c] += texels[i][c];
+			mean[c] /= 16.0f;
+		}
+
+		float covariance[4][4] = {};
+		for (int i = 0; i < 16; ++i)
+		{
+			for (int a = 0; a < channels; ++a)
+			{
+				for (int b = 0; b < channels; ++b)
+					covariance[a][b] += (texels[i][a] - mean[a]) * (texels[i][b] - mean[b]);
+			}
+		}
+
+		int largest = 0;
+		for (int c = 1; c < channels; ++c)
+			largest = covariance[c][c] > covariance[largest][largest] ? c : largest;
+		for (int c = 0; c < channels; ++c)
+			axis[c] = covariance[largest][c];
+
+		for (int iteration = 0; iteration < 8; ++iteration)
+		{
+			float next[4] = {};
+			float length = 0.0f;
+			for (int a = 0; a < channels; ++a)
+			{
+				for (int b = 0; b < channels; ++b)
+					next[a] += covariance[a][b] * axis[b];
+				length += next[a] * next[a];
+			}
+			if (length < 1e-12f)
+				break;
+			length = 1.0f / std::sqrt(length);
+			for (int c = 0; c < channels; ++c)
+				axis[c] = next[c] * length;
+		}
+	}
+
+	// Endpoints at the extremes of the texels along the principal axis.
+	void AxisEndpoints(const Texels& texels, int channels, float* e0, float* e1)
+	{
+		float mean[4], axis[4] = {};
+		PrincipalAxis(texels, channels, mean, axis);
+
+		float low = 0.0f, high = 0.0f;
+		for (int i = 0; i < 16; ++i)
+		{
+			float t = 0.0f;
+			for (int c = 0; c < channels; ++c)
+				t += (texels[i][c] - mean[c]) * axis[c];
+			low = std::min(low, t);
+			high = std::max(high, t);
+		}
+		for (int c = 0; c < channels; ++c)
+		{
+			e0[c] = mean[c] + axis[c] * high;
+			e1[c] = mean[c] + axis[c] * low;
+		}
+	}
+
+	// Endpoints minimizing the squared error for fixed weights of e1, or
+	// false when the weights are all the same.
+	bool LeastSquares(const Texels& texels, int channels, const float* weights, float* e0, float* e1)
+	{
+		float aa = 0.0f, bb = 0.0f, ab = 0.0f;
+		float ax[4] = {}, bx[4] = {};
+		for (int i = 0; i < 16; ++i)
+		{
+			float b = weights[i], a = 1.0f - b;
+			aa += a * a;
+			bb += b * b;
+			ab += a * b;
+			for (int c = 0; c < channels; ++c)
+			{
+				ax[c] += a * texels[i][c];
+				bx[c] += b * texels[i][c];
+			}
+		}
+
+		float determinant = aa * bb - ab * ab;
+		if (std::fabs(determinant) < 1e-6f)
+			return false;
+		for (int c = 0; c < channels; ++c)
+		{
+			e0[c] = (ax[c] * bb - bx[c] * ab) / determinant;
+			e1[c] = (bx[c] * aa - ax[c] * ab) / determinant;
+		}
+		return true;
+	}
+
+	uint16_t To565(const float* color)
+	{
+		int r = Clamp(static_cast<int>(color[0] * 31.0f / 255.0f + 0.5f), 0, 31);
+		int g = Clamp(static_cast<int>(color[1] * 63.0f / 255.0f + 0.5f), 0, 63);
+		int b = Clamp(static_cast<int>(color[2] * 31.0f / 255.0f + 0.5f), 0, 31);
+		return static_cast<uint16_t>(r << 11 | g << 5 | b);
+	}
+
+	void From565(uint16_t value, int* color)
+	{
+		int r = value >> 11 & 31, g = value >> 5 & 63, b = value & 31;
+		color[0] = r << 3 | r >> 2;
+		color[1] = g << 2 | g >> 4;
+		color[2] = b << 3 | b >> 2;
+	}
+
+	// Four color mode indices for c0 and c1; returns the squared error.
+	float FitColorIndices(const Texels& texels, uint16_t c0, uint16_t c1, uint32_t& indices)
+	{
+		int e0[3], e1[3];
+		From565(c0, e0);
+		From565(c1, e1);
+		float palette[4][3];
+		for (int c = 0; c < 3; ++c)
+		{
+			palette[0][c] = static_cast<float>(e0[c]);
+			palette[1][c] = static_cast<float>(e1[c]);
+			palette[2][c] = static_cast<float>((2 * e0[c] + e1[c]) / 3);
+			palette[3][c] = static_cast<float>((e0[c] + 2 * e1[c]) / 3);
+		}
+
+		float error = 0.0f;
+		indices = 0;
+		for (int i = 0; i < 16; ++i)
+		{
+			float best = 1e30f;
+			uint32_t bestIndex = 0;
+			for (uint32_t p = 0; p < 4; ++p)
+			{
+				float d = 0.0f;
+				for (int c = 0; c < 3; ++c)
+					d += (texels[i][c] - palette[p][c]) * (texels[i][c] - palette[p][c]);
+				if (d < best)
+				{
+					best = d;
+					bestIndex = p;
+				}
+			}
+			indices |= bestIndex << (2 * i);
+			error += best;
+		}
+		return error;
+	}
+
+	// The BC1 block, also the color half of BC3.
+	void EncodeColor(const Texels& texels, uint8_t* block)
+	{
+		float e0[4], e1[4];
+		AxisEndpoints(texels, 3, e0, e1);
+		uint16_t c0 = To565(e0), c1 = To565(e1);
+		uint32_t indices = 0;
+		float error = FitColorIndices(texels, c0, c1, indices);
+
+		// Weight of c1 for each index.
+		const float IndexWeights[4] = { 0.0f, 1.0f, 1.0f / 3.0f, 2.0f / 3.0f };
+		for (int iteration = 0; iteration < 2; ++iteration)
+		{
+			float weights[16];
+			for (int i = 0; i < 16; ++i)
+				weights[i] = IndexWeights[indices >> (2 * i) & 3];
+			if (!LeastSquares(texels, 3, weights, e0, e1))
+				break;
+
+			uint16_t r0 = To565(e0), r1 = To565(e1);
+			uint32_t refined = 0;
+			float refinedError = FitColorIndices(texels, r0, r1, refined);
+			if (refinedError >= error)
+				break;
+			c0 = r0;
+			c1 = r1;
+			indices = refined;
+			error = refinedError;
+		}
+
+		// c0 > c1 selects four color mode; equal endpoints only work with index 0.
+		if (c0 < c1)
+		{
+			std::swap(c0, c1);
+			indices ^= 0x55555555;
+		}
+		if (c0 == c1)
+			indices = 0;
+
+		block[0] = static_cast<uint8_t>(c0);
+		block[1] = static_cast<uint8_t>(c0 >> 8);
+		block[2] = static_cast<uint8_t>(c1);
+		block[3] = static_cast<uint8_t>(c1 >> 8);
+		for (int i = 0; i < 4; ++i)
+			block[4 + i] = static_cast<uint8_t>(indices >> (8 * i));
+	}
+
+	// BC4 style: two 8-bit endpoints, six values between them.
+	void EncodeAlpha(const uint8_t* texels, uint8_t* block)
+	{
+		int a0 = 0, a1 = 255;
+		for (int i = 0; i < 16; ++i)
+		{
+			a0 = std::max<int>(a0, texels[i * 4 + 3]);
+			a1 = std::min<int>(a1, texels[i * 4 + 3]);
+		}
+
+		int palette[8] = { a0, a1 };
+		for (int i = 1; i < 7; ++i)
+			palette[i + 1] = ((7 - i) * a0 + i * a1) / 7;
+
+		uint64_t indices = 0;
+		for (int i = 0; a0 != a1 && i < 16; ++i)
+		{
+			int best = 0;
+			for (int p = 1; p < 8; ++p)
+			{
+				if (std::abs(palette[p] - texels[i * 4 + 3]) < std::abs(palette[best] - texels[i * 4 + 3]))
+					best = p;
+			}
+			indices |= static_cast<uint64_t>(best) << (3 * i);
+		}
+
+		block[0] = static_cast<uint8_t>(a0);
+		block[1] = static_cast<uint8_t>(a1);
+		for (int i = 0; i < 6; ++i)
+			block[2 + i] = static_cast<uint8_t>(indices >> (8 * i));
+	}
+
+	// A 7-bit endpoint and the p-bit that brings it closest to e.
+	void QuantizeBC7(const float* e, int* quantized, int& pbit)
+	{
+		float bestError = 1e30f;
+		for (int p = 0; p < 2; ++p)
+		{
+			int q[4];
+			float error = 0.0f;
+			for (int c = 0; c < 4; ++c)
+			{
+				q[c] = Clamp(static_cast<int>(std::floor((e[c] - p) * 0.5f + 0.5f)), 0, 127);
+				float d = static_cast<float>(q[c] * 2 + p) - e[c];
+				error += d * d;
+			}
+			if (error < bestError)
+			{
+				bestError = error;
+				pbit = p;
+				memcpy(quantized, q, sizeof(q));
+			}
+		}
+	}
+
+	float FitIndicesBC7(const Texels& texels, const int* q0, int p0, const int* q1, int p1, uint8_t* indices)
+	{
+		int palette[16][4];
+		for (int w = 0; w < 16; ++w)
+		{
+			for (int c = 0; c < 4; ++c)
+				palette[w][c] = ((64 - Bc7Weights[w]) * (q0[c] * 2 + p0) + Bc7Weights[w] * (q1[c] * 2 + p1) + 32) >> 6;
+		}
+
+		float error = 0.0f;
+		for (int i = 0; i < 16; ++i)
+		{
+			float best = 1e30f;
+			for (int w = 0; w < 16; ++w)
+			{
+				float d = 0.0f;
+				for (int c = 0; c < 4; ++c)
+					d += (texels[i][c] - palette[w][c]) * (texels[i][c] - palette[w][c]);
+				if (d < best)
+				{
+					best = d;
+					indices[i] = static_cast<uint8_t>(w);
+				}
+			}
+			error += best;
+		}
+		return error;
+	}
+
+	struct BitWriter
+	{
+		uint8_t*	data;
+		uint32_t	position;
+
+		void Write(uint32_t value, uint32_t count)
+		{
+			for (uint32_t i = 0; i < count; ++i, ++position)
+				data[position >> 3] |= static_cast<uint8_t>((value >> i & 1) << (position & 7));
+		}
+	};
+
+	struct BitReader
+	{
+		const uint8_t*	data;
+		uint32_t		position;
+
+		uint32_t Read(uint32_t count)
+		{
+			uint32_t value = 0;
+			for (uint32_t i = 0; i < count; ++i, ++position)
+				value |= static_cast<uint32_t>(data[position >> 3] >> (position & 7) & 1) << i;
+			return value;
+		}
+	};
+
+	void DecodeColor(const uint8_t* block, uint8_t* texels, bool allowThreeColors)
+	{
+		uint16_t c0 = static_cast<uint16_t>(block[0] | block[1] << 8), c1 = static_cast<uint16_t>(block[2] | block[3] << 8);
+		int palette[4][4];
+		From565(c0, palette[0]);
+		From565(c1, palette[1]);
+		bool fourColors = !allowThreeColors || c0 > c1;
+		for (int c = 0; c < 3; ++c)
+		{
+			palette[2][c] = fourColors ? (2 * palette[0][c] + palette[1][c]) / 3 : (palette[0][c] + palette[1][c]) / 2;
+			palette[3][c] = fourColors ? (palette[0][c] + 2 * palette[1][c]) / 3 : 0;
+		}
+		for (int p = 0; p < 4; ++p)
+			palette[p][3] = fourColors || p < 3 ? 255 : 0;
+
+		uint32_t indices = block[4] | block[5] << 8 | block[6] << 16 | static_cast<uint32_t>(block[7]) << 24;
+		for (int i = 0; i < 16; ++i)
+		{
+			for (int c = 0; c < 4; ++c)
+				texels[i * 4 + c] = static_cast<uint8_t>(palette[indices >> (2 * i) & 3][c]);
+		}
+	}
+}
+
+uint32_t GetBlockSize(TextureFormat format)
+{
+	switch (format)
+	{
+	case TextureFormatBC1:
+		return 8;
+	case TextureFormatBC3:
+	case TextureFormatBC7:
+		return 16;
+	default:
+		return 0;
+	}
+}
+
+void EncodeBlockBC1(const uint8_t * texels, uint8_t * block)
+{
+	Texels values;
+	ToFloat(texels, values);
+	EncodeColor(values, block);
+}
+
+void EncodeBlockBC3(const uint8_t * texels, uint8_t * block)
+{
+	Texels values;
+	ToFloat(texels, values);
+	EncodeAlpha(texels, block);
+	EncodeColor(values, block + 8);
+}
+
+void EncodeBlockBC7(const uint8_t * texels, uint8_t * block)
+{
+	Texels values;
+	ToFloat(texels, values);
+
+	float e0[4], e1[4];
+	AxisEndpoints(values, 4, e0, e1);
+	int q0[4], q1[4], p0 = 0, p1 = 0;
+	QuantizeBC7(e0, q0, p0);
+	QuantizeBC7(e1, q1, p1);
+	uint8_t indices[16];
+	float error = FitIndicesBC7(values, q0, p0, q1, p1, indices);
+
+	for (int iteration = 0; iteration < 2; ++iteration)
+	{
+		float weights[16];
+		for (int i = 0; i < 16; ++i)
+			weights[i] = Bc7Weights[indices[i]] / 64.0f;
+		if (!LeastSquares(values, 4, weights, e0, e1))
+			break;
+
+		int r0[4], r1[4], rp0 = 0, rp1 = 0;
+		QuantizeBC7(e0, r0, rp0);
+		QuantizeBC7(e1, r1, rp1);
+		uint8_t refined[16];
+		float refinedError = FitIndicesBC7(values, r0, rp0, r1, rp1, refined);
+		if (refinedError >= error)
+			break;
+		memcpy(q0, r0, sizeof(q0));
+		memcpy(q1, r1, sizeof(q1));
+		p0 = rp0;
+		p1 = rp1;
+		memcpy(indices, refined, sizeof(indices));
+		error = refinedError;
+	}
+
+	// The first index is stored without its top bit.
+	if (indices[0] >= 8)
+	{
+		std::swap(q0, q1);
+		std::swap(p0, p1);
+		for (int i = 0; i < 16; ++i)
+			indices[i] = static_cast<uint8_t>(15 - indices[i]);
+	}
+
+	memset(block, 0, 16);
+	BitWriter writer = { block, 0 };
+	writer.Write(1 << 6, 7);
+	for (int c = 0; c < 4; ++c)
+	{
+		writer.Write(q0[c], 7);
+		writer.Write(q1[c], 7);
+	}
+	writer.Write(p0, 1);
+	writer.Write(p1, 1);
+	writer.Write(indices[0], 3);
+	for (int i = 1; i < 16; ++i)
+		writer.Write(indices[i], 4);
+}
+
+void DecodeBlock(TextureFormat format, const uint8_t * block, uint8_t * texels)
+{
+	switch (format)
+	{
+	case TextureFormatBC1:
+		DecodeColor(block, texels, true);
+		break;
+
+	case TextureFormatBC3:
+	{
+		DecodeColor(block + 8, texels, false);
+		int a0 = block[0], a1 = block[1];
+		int palette[8] = { a0, a1 };
+		for (int i = 1; i < 7; ++i)
+			palette[i + 1] = a0 > a1 ? ((7 - i) * a0 + i * a1) / 7 : 0;
+		if (a0 <= a1)
+		{
+			for (int i = 1; i < 5; ++i)
+				palette[i + 1] = ((5 - i) * a0 + i * a1) / 5;
+			palette[6] = 0;
+			palette[7] = 255;
+		}
+		BitReader reader = { block + 2, 0 };
+		for (int i = 0; i < 16; ++i)
+			texels[i * 4 + 3] = static_cast<uint8_t>(palette[reader.Read(3)]);
+		break;
+	}
+
+	case TextureFormatBC7:
+	{
+		memset(texels, 0, 64);
+		if (0x40 != (block[0] & 0x7f))
+			break;
+
+		BitReader reader = { block, 7 };
+		int e0[4], e1[4];
+		for (int c = 0; c < 4; ++c)
+		{
+			e0[c] = reader.Read(7) << 1;
+			e1[c] = reader.Read(7) << 1;
+		}
+		uint32_t p0 = reader.Read(1), p1 = reader.Read(1);
+		for (int c = 0; c < 4; ++c)
+		{
+			e0[c] |= p0;
+			e1[c] |= p1;
+		}
+		for (int i = 0; i < 16; ++i)
+		{
+			int w = Bc7Weights[reader.Read(0 == i ? 3 : 4)];
+			for (int c = 0; c < 4; ++c)
+				texels[i * 4 + c] = static_cast<uint8_t>(((64 - w) * e0[c] + w * e1[c] + 32) >> 6);
+		}
+		break;
+	}
+
+	default:
+		memcpy(texels, block, 64);
+		break;
+	}
+}
+
+void CompressTexture(TextureFormat format, const uint8_t * rgba, uint32_t width, uint32_t height, uint8_t * blocks, uint32_t rowPitch, ThreadPool & pool)
+{
+	void(*encode)(const uint8_t*, uint8_t*) = TextureFormatBC1 == format ? EncodeBlockBC1 : TextureFormatBC3 == format ? EncodeBlockBC3 : EncodeBlockBC7;
+	const uint32_t blockSize = GetBlockSize(format);
+	const uint32_t blocksX = (width + 3) / 4;
+	const uint32_t blocksY = (height + 3) / 4;
+
+	pool.ParallelFor(blocksY, [&](size_t by)
+	{
+		uint8_t texels[64];
+		for (uint32_t bx = 0; bx < blocksX; ++bx)
+		{
+			for (uint32_t y = 0; y < 4; ++y)
+			{
+				uint32_t sy = std::min(static_cast<uint32_t>(by) * 4 + y, height - 1);
+				for (uint32_t x = 0; x < 4; ++x)
+				{
+					uint32_t sx = std::min(bx * 4 + x, width - 1);
+					memcpy(texels + (y * 4 + x) * 4, rgba + (static_cast<size_t>(sy) * width + sx) * 4, 4);
+				}
+			}
+			encode(texels, blocks + by * rowPitch + bx * blockSize);
+		}
+	});
+}
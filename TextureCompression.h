@@ -0,0 +1,27 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+#include "TextureCache.h"
+
+class ThreadPool;
+
+// BC1, BC3 and BC7 encoding of 4x4 blocks of RGBA8 texels, given row by row.
+// BC1 ignores alpha; BC7 only uses mode 6, one subset with RGBA endpoints,
+// which is fast to search and good enough for color textures.
+
+// Bytes per 4x4 block, or 0 for formats that are not block compressed.
+uint32_t GetBlockSize(TextureFormat format);
+
+void EncodeBlockBC1(const uint8_t* texels, uint8_t* block);
+void EncodeBlockBC3(const uint8_t* texels, uint8_t* block);
+void EncodeBlockBC7(const uint8_t* texels, uint8_t* block);
+
+// Back to RGBA8, to measure the error. For BC7 only mode 6 blocks decode,
+// other modes come out black.
+void DecodeBlock(TextureFormat format, const uint8_t* block, uint8_t* texels);
+
+// Encodes width by height texels into rows of blocks rowPitch bytes apart,
+// block rows spread over the pool. Partial blocks at the edges repeat the
+// last row and column.
+void CompressTexture(TextureFormat format, const uint8_t* rgba, uint32_t width, uint32_t height, uint8_t* blocks, uint32_t rowPitch, ThreadPool& pool);
@@ -0,0 +1,65 @@
+#include "ThreadPool.h"
+
+ThreadPool::ThreadPool(size_t threadsCount) : stopping(false)
+{
+	if (0 == threadsCount)
+	{
+		unsigned int hardware = std::thread::hardware_concurrency();
+		threadsCount = hardware > 1 ? hardware - 1 : 0;
+	}
+
+	threads.reserve(threadsCount);
+	for (size_t i = 0; i < threadsCount; ++i)
+		threads.emplace_back(&ThreadPool::WorkerLoop, this);
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	wake.notify_all();
+
+	for (std::thread& thread : threads)
+		thread.join();
+}
+
+void ThreadPool::Submit(std::function<void()> task)
+{
+	if (threads.empty())
+	{
+		task();
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		tasks.push_back(std::move(task));
+	}
+	wake.notify_one();
+}
+
+ThreadPool & ThreadPool::Shared()
+{
+	static ThreadPool pool;
+	return pool;
+}
+
+void ThreadPool::WorkerLoop()
+{
+	for (;;)
+	{
+		std::function<void()> task;
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			wake.wait(lock, [this]() { return stopping || !tasks.empty(); });
+			// Drain the queue before stopping, submitted work is never dropped.
+			if (tasks.empty())
+				return;
+			task = std::move(tasks.front());
+			tasks.pop_front();
+		}
+		task();
+	}
+}
@@ -0,0 +1,92 @@
+#pragma once
+#include <stddef.h>
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed set of worker threads pulling tasks from one FIFO queue.
+class ThreadPool
+{
+public:
+	// 0 starts one worker per hardware thread but the caller's.
+	explicit ThreadPool(size_t threadsCount = 0);
+	~ThreadPool();
+
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+	void Submit(std::function<void()> task);
+
+	// Runs fn(i) for every i in [0, count) and returns once all are done. The
+	// calling thread takes items too, so this may be called from a task.
+	template<typename F>
+	void ParallelFor(size_t count, F fn);
+
+	size_t GetThreadsCount() const { return threads.size(); }
+
+	// Pool shared by the asset pipeline.
+	static ThreadPool& Shared();
+
+private:
+	void WorkerLoop();
+
+	std::vector<std::thread>			threads;
+	std::deque<std::function<void()>>	tasks;
+	std::mutex							mutex;
+	std::condition_variable				wake;
+	bool								stopping;
+};
+
+template<typename F>
+void ThreadPool::ParallelFor(size_t count, F fn)
+{
+	if (count <= 1 || threads.empty())
+	{
+		for (size_t i = 0; i < count; ++i)
+			fn(i);
+		return;
+	}
+
+	// Helpers that start after the loop is over still touch the state, so it
+	// is shared rather than on this stack.
+	struct State
+	{
+		std::atomic<size_t>		next;
+		std::atomic<size_t>		done;
+		std::mutex				mutex;
+		std::condition_variable	finished;
+	};
+	std::shared_ptr<State> state = std::make_shared<State>();
+	state->next = 0;
+	state->done = 0;
+
+	auto run = [state, count, &fn]()
+	{
+		size_t completed = 0;
+		for (size_t i = state->next++; i < count; i = state->next++)
+		{
+			fn(i);
+			completed++;
+		}
+		if (completed > 0 && state->done.fetch_add(completed) + completed == count)
+		{
+			std::lock_guard<std::mutex> lock(state->mutex);
+			state->finished.notify_all();
+		}
+	};
+
+	size_t helpers = std::min(threads.size(), count - 1);
+	for (size_t t = 0; t < helpers; ++t)
+		Submit(run);
+	run();
+
+	std::unique_lock<std::mutex> lock(state->mutex);
+	state->finished.wait(lock, [&]() { return state->done == count; });
+}
@@ -0,0 +1,293 @@
+#include "TlsfAllocator.h"
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace
+{
+	uint32_t HighestBit(uint64_t value)
+	{
+#if defined(_MSC_VER)
+		unsigned long index;
+		_BitScanReverse64(&index, value);
+		return index;
+#else
+		return 63 - __builtin_clzll(value);
+#endif
+	}
+
+	uint32_t LowestBit(uint64_t value)
+	{
+#if defined(_MSC_VER)
+		unsigned long index;
+		_BitScanForward64(&index, value);
+		return index;
+#else
+		return __builtin_ctzll(value);
+#endif
+	}
+
+	uint64_t AlignUp(uint64_t value, uint64_t alignment)
+	{
+		return (value + alignment - 1) & ~(alignment - 1);
+	}
+}
+
+void TlsfAllocator::Reset(uint64_t size, uint64_t granularity)
+{
+	this->granularity = granularity;
+	this->size = size & ~(granularity - 1);
+	usedSize = 0;
+	allocationsCount = 0;
+
+	nodes.clear();
+	unusedNodes.clear();
+	firstLevelBitmap = 0;
+	for (uint32_t fl = 0; fl < FirstLevelCount; ++fl)
+	{
+		secondLevelBitmaps[fl] = 0;
+		for (uint32_t sl = 0; sl < SecondLevelCount; ++sl)
+			heads[fl][sl] = NoNode;
+	}
+
+	if (this->size > 0)
+		InsertFree(NewNode(0, this->size));
+}
+
+void TlsfAllocator::Mapping(uint64_t size, uint32_t & firstLevel, uint32_t & secondLevel)
+{
+	if (size < SecondLevelCount)
+	{
+		firstLevel = 0;
+		secondLevel = static_cast<uint32_t>(size);
+		return;
+	}
+	firstLevel = HighestBit(size);
+	secondLevel = static_cast<uint32_t>(size >> (firstLevel - SecondLevelLog2)) - SecondLevelCount;
+}
+
+bool TlsfAllocator::Fits(uint32_t node, uint64_t size, uint64_t alignment) const
+{
+	const Node& n = nodes[node];
+	return AlignUp(n.offset, alignment) + size <= n.offset + n.size;
+}
+
+uint32_t TlsfAllocator::FindFree(uint64_t size, uint64_t alignment) const
+{
+	// Worst case padding, as every offset is a multiple of the granularity.
+	uint64_t searchSize = size + (alignment > granularity ? alignment - granularity : 0);
+
+	// Rounded up to the next size class, any block of the class found fits.
+	uint64_t rounded = searchSize;
+	if (rounded >= SecondLevelCount)
+		rounded += (1ull << (HighestBit(rounded) - SecondLevelLog2)) - 1;
+
+	uint32_t fl, sl;
+	Mapping(rounded, fl, sl);
+	if (fl < FirstLevelCount)
+	{
+		uint32_t slMap = secondLevelBitmaps[fl] & (~0u << sl);
+		if (0 == slMap)
+		{
+			uint64_t flMap = fl + 1 < FirstLevelCount ? firstLevelBitmap & (~0ull << (fl + 1)) : 0;
+			if (0 != flMap)
+			{
+				fl = LowestBit(flMap);
+				slMap = secondLevelBitmaps[fl];
+			}
+		}
+		if (0 != slMap)
+			return heads[fl][LowestBit(slMap)];
+	}
+
+	// Rounding skips blocks of the classes in between that may still fit,
+	// like a block made for exactly this allocation.
+	uint32_t firstFl, firstSl, lastFl, lastSl;
+	Mapping(size, firstFl, firstSl);
+	Mapping(searchSize, lastFl, lastSl);
+	for (uint32_t c = firstFl * SecondLevelCount + firstSl; c <= lastFl * SecondLevelCount + lastSl && c < FirstLevelCount * SecondLevelCount; ++c)
+	{
+		for (uint32_t node = heads[c / SecondLevelCount][c % SecondLevelCount]; NoNode != node; node = nodes[node].nextFree)
+		{
+			if (Fits(node, size, alignment))
+				return node;
+		}
+	}
+	return NoNode;
+}
+
+bool TlsfAllocator::Allocate(uint64_t size, uint64_t alignment, Allocation & allocation)
+{
+	size = AlignUp(size, granularity);
+	if (alignment < granularity)
+		alignment = granularity;
+	if (0 == size || size > this->size)
+		return false;
+
+	uint32_t node = FindFree(size, alignment);
+	if (NoNode == node)
+		return false;
+	RemoveFree(node);
+
+	// Padding in front of the aligned offset stays free.
+	uint64_t aligned = AlignUp(nodes[node].offset, alignment);
+	if (aligned > nodes[node].offset)
+	{
+		uint32_t front = NewNode(nodes[node].offset, aligned - nodes[node].offset);
+		Node& n = nodes[node];
+		nodes[front].prevPhysical = n.prevPhysical;
+		nodes[front].nextPhysical = node;
+		if (NoNode != n.prevPhysical)
+			nodes[n.prevPhysical].nextPhysical = front;
+		n.prevPhysical = front;
+		n.offset = aligned;
+		n.size -= nodes[front].size;
+		InsertFree(front);
+	}
+
+	if (nodes[node].size > size)
+	{
+		uint32_t back = NewNode(nodes[node].offset + size, nodes[node].size - size);
+		Node& n = nodes[node];
+		nodes[back].prevPhysical = node;
+		nodes[back].nextPhysical = n.nextPhysical;
+		if (NoNode != n.nextPhysical)
+			nodes[n.nextPhysical].prevPhysical = back;
+		n.nextPhysical = back;
+		n.size = size;
+		InsertFree(back);
+	}
+
+	nodes[node].free = false;
+	usedSize += size;
+	allocationsCount++;
+
+	allocation.offset = aligned;
+	allocation.size = size;
+	allocation.node = node;
+	return true;
+}
+
+void TlsfAllocator::Free(const Allocation & allocation)
+{
+	if (!allocation.IsValid() || allocation.node >= nodes.size())
+		return;
+	if (nodes[allocation.node].free || nodes[allocation.node].offset != allocation.offset || nodes[allocation.node].size != allocation.size)
+		return;
+
+	uint32_t node = allocation.node;
+	usedSize -= nodes[node].size;
+	allocationsCount--;
+
+	uint32_t prev = nodes[node].prevPhysical;
+	if (NoNode != prev && nodes[prev].free)
+	{
+		RemoveFree(prev);
+		nodes[prev].size += nodes[node].size;
+		nodes[prev].nextPhysical = nodes[node].nextPhysical;
+		if (NoNode != nodes[node].nextPhysical)
+			nodes[nodes[node].nextPhysical].prevPhysical = prev;
+		DeleteNode(node);
+		node = prev;
+	}
+
+	uint32_t next = nodes[node].nextPhysical;
+	if (NoNode != next && nodes[next].free)
+	{
+		RemoveFree(next);
+		nodes[node].size += nodes[next].size;
+		nodes[node].nextPhysical = nodes[next].nextPhysical;
+		if (NoNode != nodes[next].nextPhysical)
+			nodes[nodes[next].nextPhysical].prevPhysical = node;
+		DeleteNode(next);
+	}
+
+	InsertFree(node);
+}
+
+TlsfAllocator::Stats TlsfAllocator::GetStats() const
+{
+	Stats stats = {};
+	stats.size = size;
+	stats.usedSize = usedSize;
+	stats.freeSize = size - usedSize;
+	stats.allocationsCount = allocationsCount;
+
+	for (uint32_t fl = 0; fl < FirstLevelCount; ++fl)
+	{
+		for (uint32_t sl = 0; sl < SecondLevelCount; ++sl)
+		{
+			for (uint32_t node = heads[fl][sl]; NoNode != node; node = nodes[node].nextFree)
+			{
+				stats.freeBlocksCount++;
+				if (nodes[node].size > stats.largestFreeBlock)
+					stats.largestFreeBlock = nodes[node].size;
+			}
+		}
+	}
+	return stats;
+}
+
+void TlsfAllocator::InsertFree(uint32_t node)
+{
+	uint32_t fl, sl;
+	Mapping(nodes[node].size, fl, sl);
+
+	Node& n = nodes[node];
+	n.free = true;
+	n.prevFree = NoNode;
+	n.nextFree = heads[fl][sl];
+	if (NoNode != n.nextFree)
+		nodes[n.nextFree].prevFree = node;
+	heads[fl][sl] = node;
+
+	firstLevelBitmap |= 1ull << fl;
+	secondLevelBitmaps[fl] |= 1u << sl;
+}
+
+void TlsfAllocator::RemoveFree(uint32_t node)
+{
+	Node& n = nodes[node];
+	if (NoNode != n.prevFree)
+		nodes[n.prevFree].nextFree = n.nextFree;
+	if (NoNode != n.nextFree)
+		nodes[n.nextFree].prevFree = n.prevFree;
+
+	uint32_t fl, sl;
+	Mapping(n.size, fl, sl);
+	if (heads[fl][sl] == node)
+	{
+		heads[fl][sl] = n.nextFree;
+		if (NoNode == n.nextFree)
+		{
+			secondLevelBitmaps[fl] &= ~(1u << sl);
+			if (0 == secondLevelBitmaps[fl])
+				firstLevelBitmap &= ~(1ull << fl);
+		}
+	}
+	n.free = false;
+	n.prevFree = NoNode;
+	n.nextFree = NoNode;
+}
+
+uint32_t TlsfAllocator::NewNode(uint64_t offset, uint64_t size)
+{
+	Node n = { offset, size, NoNode, NoNode, NoNode, NoNode, false };
+	if (!unusedNodes.empty())
+	{
+		uint32_t node = unusedNodes.back();
+		unusedNodes.pop_back();
+		nodes[node] = n;
+		return node;
+	}
+	nodes.push_back(n);
+	return static_cast<uint32_t>(nodes.size() - 1);
+}
+
+void TlsfAllocator::DeleteNode(uint32_t node)
+{
+	nodes[node].free = false;
+	nodes[node].size = 0;
+	unusedNodes.push_back(node);
+}
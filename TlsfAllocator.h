@@ -0,0 +1,85 @@
+#pragma once
+#include <stdint.h>
+
+#include <vector>
+
+// Two-level segregated fit allocator over an abstract range of offsets, such
+// as one ID3D12Heap. Free blocks are kept in size classes of 16 per power of
+// two, so allocate and free are constant time; neighbours are merged on free.
+// Block bookkeeping lives outside the range, which is never touched.
+class TlsfAllocator
+{
+public:
+	static const uint64_t InvalidOffset = ~0ull;
+
+	struct Allocation
+	{
+		uint64_t	offset = InvalidOffset;
+		uint64_t	size = 0;
+		uint32_t	node = ~0u;
+
+		bool IsValid() const { return InvalidOffset != offset; }
+	};
+
+	struct Stats
+	{
+		uint64_t	size;
+		// Includes the rounding of sizes to the granularity.
+		uint64_t	usedSize;
+		uint64_t	freeSize;
+		uint64_t	largestFreeBlock;
+		uint32_t	allocationsCount;
+		uint32_t	freeBlocksCount;
+
+		// 0 when all free space is one block, towards 1 as it splinters.
+		double GetFragmentation() const { return 0 == freeSize ? 0.0 : 1.0 - static_cast<double>(largestFreeBlock) / freeSize; }
+	};
+
+	// granularity must be a power of two; sizes and offsets are multiples of it.
+	explicit TlsfAllocator(uint64_t size = 0, uint64_t granularity = 256) { Reset(size, granularity); }
+
+	void Reset(uint64_t size, uint64_t granularity = 256);
+
+	// alignment must be a power of two. False when no free block fits.
+	bool Allocate(uint64_t size, uint64_t alignment, Allocation& allocation);
+	void Free(const Allocation& allocation);
+
+	Stats GetStats() const;
+	uint64_t GetSize() const { return size; }
+	bool IsEmpty() const { return 0 == allocationsCount; }
+
+private:
+	static const uint32_t NoNode = ~0u;
+	static const uint32_t SecondLevelLog2 = 4;
+	static const uint32_t SecondLevelCount = 1 << SecondLevelLog2;
+	static const uint32_t FirstLevelCount = 64;
+
+	struct Node
+	{
+		uint64_t	offset;
+		uint64_t	size;
+		uint32_t	prevPhysical;
+		uint32_t	nextPhysical;
+		uint32_t	prevFree;
+		uint32_t	nextFree;
+		bool		free;
+	};
+
+	static void Mapping(uint64_t size, uint32_t& firstLevel, uint32_t& secondLevel);
+	uint32_t FindFree(uint64_t size, uint64_t alignment) const;
+	bool Fits(uint32_t node, uint64_t size, uint64_t alignment) const;
+	void InsertFree(uint32_t node);
+	void RemoveFree(uint32_t node);
+	uint32_t NewNode(uint64_t offset, uint64_t size);
+	void DeleteNode(uint32_t node);
+
+	std::vector<Node>		nodes;
+	std::vector<uint32_t>	unusedNodes;
+	uint32_t				heads[FirstLevelCount][SecondLevelCount];
+	uint64_t				firstLevelBitmap;
+	uint32_t				secondLevelBitmaps[FirstLevelCount];
+	uint64_t				size;
+	uint64_t				granularity;
+	uint64_t				usedSize;
+	uint32_t				allocationsCount;
+};
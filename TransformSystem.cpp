@@ -0,0 +1,258 @@
+#include "TransformSystem.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include <xmmintrin.h>
+
+#include "ThreadPool.h"
+
+const uint32_t TransformSystem::NoParent;
+
+namespace
+{
+	const uint32_t NoHandle = ~0u;
+
+	const WorldTransform IdentityTransform = {
+		{ { 1.0f, 0.0f, 0.0f, 0.0f }, { 0.0f, 1.0f, 0.0f, 0.0f }, { 0.0f, 0.0f, 1.0f, 0.0f } },
+		{ { 1.0f, 0.0f, 0.0f, 0.0f }, { 0.0f, 1.0f, 0.0f, 0.0f }, { 0.0f, 0.0f, 1.0f, 0.0f } },
+	};
+
+	inline __m128 MulAdd(__m128 a, __m128 b, __m128 c) { return _mm_add_ps(_mm_mul_ps(a, b), c); }
+	inline __m128 Select(__m128 mask, __m128 a, __m128 b) { return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b)); }
+}
+
+uint32_t TransformSystem::Add(uint32_t parent)
+{
+	uint32_t handle = static_cast<uint32_t>(handleToSlot.size());
+	uint32_t slot = static_cast<uint32_t>(tx.size());
+	parents.push_back(parent);
+	handleToSlot.push_back(slot);
+
+	tx.push_back(0.0f); ty.push_back(0.0f); tz.push_back(0.0f);
+	qx.push_back(0.0f); qy.push_back(0.0f); qz.push_back(0.0f); qw.push_back(1.0f);
+	sx.push_back(1.0f); sy.push_back(1.0f); sz.push_back(1.0f);
+	parentSlots.push_back(NoParent == parent ? NoParent : handleToSlot[parent]);
+	dirty.push_back(1);
+	worlds.push_back(IdentityTransform);
+
+	sorted = false;
+	return handle;
+}
+
+void TransformSystem::Clear()
+{
+	parents.clear();
+	tx.clear(); ty.clear(); tz.clear();
+	qx.clear(); qy.clear(); qz.clear(); qw.clear();
+	sx.clear(); sy.clear(); sz.clear();
+	parentSlots.clear();
+	dirty.clear();
+	worlds.clear();
+	levels.clear();
+	handleToSlot.clear();
+	sorted = true;
+}
+
+void TransformSystem::SetTranslation(uint32_t handle, float x, float y, float z)
+{
+	uint32_t slot = handleToSlot[handle];
+	tx[slot] = x; ty[slot] = y; tz[slot] = z;
+	dirty[slot] = 1;
+}
+
+void TransformSystem::SetRotation(uint32_t handle, float x, float y, float z, float w)
+{
+	uint32_t slot = handleToSlot[handle];
+	qx[slot] = x; qy[slot] = y; qz[slot] = z; qw[slot] = w;
+	dirty[slot] = 1;
+}
+
+void TransformSystem::SetScale(uint32_t handle, float x, float y, float z)
+{
+	uint32_t slot = handleToSlot[handle];
+	sx[slot] = x; sy[slot] = y; sz[slot] = z;
+	dirty[slot] = 1;
+}
+
+void TransformSystem::Sort()
+{
+	// Parents are added before their children, so depths come in one pass.
+	const size_t count = handleToSlot.size();
+	std::vector<uint32_t> depths(count);
+	uint32_t maxDepth = 0;
+	for (size_t h = 0; h < count; ++h)
+	{
+		depths[h] = NoParent == parents[h] ? 0 : depths[parents[h]] + 1;
+		maxDepth = std::max(maxDepth, depths[h]);
+	}
+
+	// Counting sort of the handles by depth, keeping their order within a level.
+	std::vector<size_t> levelCounts(maxDepth + 1, 0);
+	for (uint32_t depth : depths)
+		levelCounts[depth]++;
+
+	levels.assign(maxDepth + 2, 0);
+	for (uint32_t depth = 0; depth <= maxDepth; ++depth)
+		levels[depth + 1] = levels[depth] + ((levelCounts[depth] + 3) & ~static_cast<size_t>(3));
+
+	std::vector<uint32_t> slotToHandle(levels.back(), NoHandle);
+	std::vector<size_t> cursors(levels.begin(), levels.end() - 1);
+	for (uint32_t h = 0; h < count; ++h)
+		slotToHandle[cursors[depths[h]]++] = h;
+
+	auto permute = [&](std::vector<float>& values, float padding)
+	{
+		std::vector<float> result(slotToHandle.size(), padding);
+		for (size_t slot = 0; slot < slotToHandle.size(); ++slot)
+		{
+			if (NoHandle != slotToHandle[slot])
+				result[slot] = values[handleToSlot[slotToHandle[slot]]];
+		}
+		values.swap(result);
+	};
+	permute(tx, 0.0f); permute(ty, 0.0f); permute(tz, 0.0f);
+	permute(qx, 0.0f); permute(qy, 0.0f); permute(qz, 0.0f); permute(qw, 1.0f);
+	permute(sx, 1.0f); permute(sy, 1.0f); permute(sz, 1.0f);
+
+	for (size_t slot = 0; slot < slotToHandle.size(); ++slot)
+	{
+		if (NoHandle != slotToHandle[slot])
+			handleToSlot[slotToHandle[slot]] = static_cast<uint32_t>(slot);
+	}
+
+	parentSlots.assign(slotToHandle.size(), NoParent);
+	for (size_t slot = 0; slot < slotToHandle.size(); ++slot)
+	{
+		uint32_t handle = slotToHandle[slot];
+		if (NoHandle != handle && NoParent != parents[handle])
+			parentSlots[slot] = handleToSlot[parents[handle]];
+	}
+
+	dirty.assign(slotToHandle.size(), 1);
+	worlds.assign(slotToHandle.size(), IdentityTransform);
+	sorted = true;
+}
+
+void TransformSystem::Update(ThreadPool * pool)
+{
+	if (!sorted)
+		Sort();
+
+	for (size_t level = 0; level + 1 < levels.size(); ++level)
+	{
+		const size_t begin = levels[level];
+		const size_t end = levels[level + 1];
+		const size_t tasksCount = (end - begin + TaskSize - 1) / TaskSize;
+		auto task = [&](size_t task)
+		{
+			size_t taskEnd = std::min(end, begin + (task + 1) * TaskSize);
+			for (size_t slot = begin + task * TaskSize; slot < taskEnd; slot += 4)
+				UpdateBatch(slot);
+		};
+
+		if (nullptr != pool)
+			pool->ParallelFor(tasksCount, task);
+		else
+		{
+			for (size_t t = 0; t < tasksCount; ++t)
+				task(t);
+		}
+	}
+
+	std::fill(dirty.begin(), dirty.end(), static_cast<uint8_t>(0));
+}
+
+void TransformSystem::UpdateBatch(size_t slot)
+{
+	// A lane is recomputed when it changed or its parent did; its children see it through dirty.
+	const WorldTransform* parentWorlds[4];
+	bool needed = false;
+	for (size_t lane = 0; lane < 4; ++lane)
+	{
+		uint32_t parent = parentSlots[slot + lane];
+		parentWorlds[lane] = NoParent == parent ? &IdentityTransform : &worlds[parent];
+		if (NoParent != parent && 0 != dirty[parent])
+			dirty[slot + lane] = 1;
+		needed |= 0 != dirty[slot + lane];
+	}
+	if (!needed)
+		return;
+
+	const __m128 one = _mm_set1_ps(1.0f);
+	const __m128 two = _mm_set1_ps(2.0f);
+
+	// Local 3x3 rows, rotation by the quaternion then scale, for row vectors.
+	__m128 x = _mm_loadu_ps(&qx[slot]), y = _mm_loadu_ps(&qy[slot]), z = _mm_loadu_ps(&qz[slot]), w = _mm_loadu_ps(&qw[slot]);
+	__m128 xx = _mm_mul_ps(x, x), yy = _mm_mul_ps(y, y), zz = _mm_mul_ps(z, z);
+	__m128 xy = _mm_mul_ps(x, y), xz = _mm_mul_ps(x, z), yz = _mm_mul_ps(y, z);
+	__m128 xw = _mm_mul_ps(x, w), yw = _mm_mul_ps(y, w), zw = _mm_mul_ps(z, w);
+
+	__m128 scaleX = _mm_loadu_ps(&sx[slot]), scaleY = _mm_loadu_ps(&sy[slot]), scaleZ = _mm_loadu_ps(&sz[slot]);
+	__m128 l[3][3];
+	l[0][0] = _mm_mul_ps(scaleX, _mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(yy, zz))));
+	l[0][1] = _mm_mul_ps(scaleX, _mm_mul_ps(two, _mm_add_ps(xy, zw)));
+	l[0][2] = _mm_mul_ps(scaleX, _mm_mul_ps(two, _mm_sub_ps(xz, yw)));
+	l[1][0] = _mm_mul_ps(scaleY, _mm_mul_ps(two, _mm_sub_ps(xy, zw)));
+	l[1][1] = _mm_mul_ps(scaleY, _mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, zz))));
+	l[1][2] = _mm_mul_ps(scaleY, _mm_mul_ps(two, _mm_add_ps(yz, xw)));
+	l[2][0] = _mm_mul_ps(scaleZ, _mm_mul_ps(two, _mm_add_ps(xz, yw)));
+	l[2][1] = _mm_mul_ps(scaleZ, _mm_mul_ps(two, _mm_sub_ps(yz, xw)));
+	l[2][2] = _mm_mul_ps(scaleZ, _mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, yy))));
+	__m128 t[3] = { _mm_loadu_ps(&tx[slot]), _mm_loadu_ps(&ty[slot]), _mm_loadu_ps(&tz[slot]) };
+
+	// World columns, local times parent: the parents' columns are gathered and
+	// transposed so each register holds one element of four parents.
+	__m128 world[3][4];
+	for (int c = 0; c < 3; ++c)
+	{
+		__m128 p0 = _mm_loadu_ps(parentWorlds[0]->world[c]);
+		__m128 p1 = _mm_loadu_ps(parentWorlds[1]->world[c]);
+		__m128 p2 = _mm_loadu_ps(parentWorlds[2]->world[c]);
+		__m128 p3 = _mm_loadu_ps(parentWorlds[3]->world[c]);
+		_MM_TRANSPOSE4_PS(p0, p1, p2, p3);
+
+		for (int r = 0; r < 3; ++r)
+			world[c][r] = MulAdd(l[r][0], p0, MulAdd(l[r][1], p1, _mm_mul_ps(l[r][2], p2)));
+		world[c][3] = MulAdd(t[0], p0, MulAdd(t[1], p1, MulAdd(t[2], p2, p3)));
+	}
+
+	// Inverse of the world 3x3 a[r][c] = world[c][r] by its adjugate; rows of
+	// the inverse are the columns of the cofactors over the determinant.
+	__m128 cof[3][3];
+	cof[0][0] = _mm_sub_ps(_mm_mul_ps(world[1][1], world[2][2]), _mm_mul_ps(world[2][1], world[1][2]));
+	cof[0][1] = _mm_sub_ps(_mm_mul_ps(world[2][1], world[0][2]), _mm_mul_ps(world[0][1], world[2][2]));
+	cof[0][2] = _mm_sub_ps(_mm_mul_ps(world[0][1], world[1][2]), _mm_mul_ps(world[1][1], world[0][2]));
+	cof[1][0] = _mm_sub_ps(_mm_mul_ps(world[2][0], world[1][2]), _mm_mul_ps(world[1][0], world[2][2]));
+	cof[1][1] = _mm_sub_ps(_mm_mul_ps(world[0][0], world[2][2]), _mm_mul_ps(world[2][0], world[0][2]));
+	cof[1][2] = _mm_sub_ps(_mm_mul_ps(world[1][0], world[0][2]), _mm_mul_ps(world[0][0], world[1][2]));
+	cof[2][0] = _mm_sub_ps(_mm_mul_ps(world[1][0], world[2][1]), _mm_mul_ps(world[2][0], world[1][1]));
+	cof[2][1] = _mm_sub_ps(_mm_mul_ps(world[2][0], world[0][1]), _mm_mul_ps(world[0][0], world[2][1]));
+	cof[2][2] = _mm_sub_ps(_mm_mul_ps(world[0][0], world[1][1]), _mm_mul_ps(world[1][0], world[0][1]));
+	__m128 det = MulAdd(world[0][0], cof[0][0], MulAdd(world[1][0], cof[0][1], _mm_mul_ps(world[2][0], cof[0][2])));
+
+	// Degenerate transforms keep identity normals, like InstanceBuilder's scalar path.
+	__m128 absDet = _mm_andnot_ps(_mm_set1_ps(-0.0f), det);
+	__m128 degenerate = _mm_cmple_ps(absDet, _mm_set1_ps(1e-20f));
+	__m128 invDet = _mm_div_ps(one, Select(degenerate, one, det));
+
+	__m128 normal[3][4];
+	for (int i = 0; i < 3; ++i)
+	{
+		for (int j = 0; j < 3; ++j)
+			normal[i][j] = Select(degenerate, i == j ? one : _mm_setzero_ps(), _mm_mul_ps(cof[j][i], invDet));
+		normal[i][3] = _mm_setzero_ps();
+	}
+
+	// Back to one WorldTransform per lane.
+	for (int c = 0; c < 3; ++c)
+	{
+		_MM_TRANSPOSE4_PS(world[c][0], world[c][1], world[c][2], world[c][3]);
+		_MM_TRANSPOSE4_PS(normal[c][0], normal[c][1], normal[c][2], normal[c][3]);
+		for (int lane = 0; lane < 4; ++lane)
+		{
+			_mm_storeu_ps(worlds[slot + lane].world[c], world[c][lane]);
+			_mm_storeu_ps(worlds[slot + lane].normal[c], normal[c][lane]);
+		}
+	}
+}
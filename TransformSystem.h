@@ -0,0 +1,71 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+#include <vector>
+
+class ThreadPool;
+
+// Affine world transform in the layout the vertex shader reads, see
+// InstanceData.
+struct WorldTransform
+{
+	// Columns of the row-vector world matrix.
+	float	world[3][4];
+	// Rows of the inverse of the world 3x3; w is 0.
+	float	normal[3][4];
+};
+
+// Hierarchy of translation, rotation and scale transforms stored as
+// structure of arrays, in slots sorted by depth so a level only reads the
+// one above it. Update recomputes dirty transforms and their descendants,
+// four at a time with SSE, a level at a time, spreading each level over a
+// ThreadPool. Normal matrices come from the affine 3x3 adjugate rather than
+// a 4x4 inverse.
+class TransformSystem
+{
+public:
+	static const uint32_t NoParent = ~0u;
+
+	TransformSystem() : sorted(true) {}
+
+	// Returns the handle of a new identity transform; parent must exist.
+	uint32_t Add(uint32_t parent = NoParent);
+	void Clear();
+
+	size_t GetCount() const { return handleToSlot.size(); }
+
+	void SetTranslation(uint32_t handle, float x, float y, float z);
+	// Unit quaternion.
+	void SetRotation(uint32_t handle, float x, float y, float z, float w);
+	void SetScale(uint32_t handle, float x, float y, float z);
+
+	// pool may be null to run on the calling thread.
+	void Update(ThreadPool* pool);
+
+	// Valid after Update.
+	const WorldTransform& GetWorld(uint32_t handle) const { return worlds[handleToSlot[handle]]; }
+
+private:
+	// Transforms per task; a multiple of 4.
+	static const size_t TaskSize = 4096;
+
+	void Sort();
+	void UpdateBatch(size_t slot);
+
+	// Per handle, until sorted.
+	std::vector<uint32_t>		parents;
+
+	// Per slot, each level padded to a multiple of 4 with unused slots.
+	std::vector<float>			tx, ty, tz;
+	std::vector<float>			qx, qy, qz, qw;
+	std::vector<float>			sx, sy, sz;
+	std::vector<uint32_t>		parentSlots;
+	std::vector<uint8_t>		dirty;
+	std::vector<WorldTransform>	worlds;
+	// levels[i] is the first slot of depth i, levels.back() the slots count.
+	std::vector<size_t>			levels;
+
+	std::vector<uint32_t>		handleToSlot;
+	bool						sorted;
+};
@@ -0,0 +1,73 @@
+#include "UploadRing.h"
+
+void UploadRing::Reset(uint64_t capacity)
+{
+	submissions.clear();
+	this->capacity = capacity;
+	head = 0;
+	tail = 0;
+	used = 0;
+	pending = 0;
+}
+
+uint64_t UploadRing::Allocate(uint64_t size, uint64_t alignment)
+{
+	if (0 == size || size > capacity || used == capacity)
+		return InvalidOffset;
+
+	if (0 == used)
+	{
+		// Nothing alive, start over at the front so big blocks fit.
+		head = 0;
+		tail = 0;
+	}
+
+	uint64_t offset = (head + alignment - 1) & ~(alignment - 1);
+	uint64_t consumed = 0;
+
+	if (head >= tail)
+	{
+		// Free space is [head, capacity) then [0, tail).
+		if (offset + size <= capacity)
+			consumed = offset + size - head;
+		else if (size <= tail)
+		{
+			consumed = capacity - head + size;
+			offset = 0;
+		}
+		else
+			return InvalidOffset;
+	}
+	else
+	{
+		// Free space is [head, tail).
+		if (offset + size > tail)
+			return InvalidOffset;
+		consumed = offset + size - head;
+	}
+
+	head = offset + size;
+	used += consumed;
+	pending += consumed;
+	return offset;
+}
+
+void UploadRing::Submit(uint64_t fenceValue)
+{
+	if (0 == pending)
+		return;
+
+	Submission submission = { fenceValue, head, pending };
+	submissions.push_back(submission);
+	pending = 0;
+}
+
+void UploadRing::Retire(uint64_t completedValue)
+{
+	while (!submissions.empty() && submissions.front().fenceValue <= completedValue)
+	{
+		tail = submissions.front().head;
+		used -= submissions.front().size;
+		submissions.pop_front();
+	}
+}
@@ -0,0 +1,54 @@
+#pragma once
+#include <stdint.h>
+
+#include <deque>
+
+// Sub-allocates staging space from one fixed-size upload buffer. Everything
+// allocated between two Submit calls is tied to the fence value given there
+// and comes back once Retire sees that value completed. The ring only deals
+// in offsets, so it runs without a device; see BenchUpload.cpp.
+class UploadRing
+{
+public:
+	static const uint64_t InvalidOffset = ~0ull;
+
+	explicit UploadRing(uint64_t capacity = 0) { Reset(capacity); }
+
+	// Drops every allocation, in flight or not.
+	void Reset(uint64_t capacity);
+
+	// alignment must be a power of two. Returns InvalidOffset when the space
+	// is still in use by the GPU; Retire and try again.
+	uint64_t Allocate(uint64_t size, uint64_t alignment);
+
+	// Ties the allocations made since the last Submit to fenceValue. Fence
+	// values must increase.
+	void Submit(uint64_t fenceValue);
+
+	// Frees the submissions whose fence value is <= completedValue.
+	void Retire(uint64_t completedValue);
+
+	// Fence value that frees the oldest submission, 0 when none is pending.
+	uint64_t GetOldestFenceValue() const { return submissions.empty() ? 0 : submissions.front().fenceValue; }
+
+	uint64_t GetCapacity() const { return capacity; }
+	// Includes alignment padding and the bytes skipped when wrapping.
+	uint64_t GetUsedSize() const { return used; }
+	uint64_t GetPendingSize() const { return pending; }
+
+private:
+	struct Submission
+	{
+		uint64_t	fenceValue;
+		uint64_t	head;
+		uint64_t	size;
+	};
+
+	std::deque<Submission>	submissions;
+	uint64_t				capacity;
+	uint64_t				head;
+	uint64_t				tail;
+	uint64_t				used;
+	// Allocated since the last Submit.
+	uint64_t				pending;
+};
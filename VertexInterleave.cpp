@@ -0,0 +1,223 @@
+#include "VertexInterleave.h"
+
+#include <cstdint>
+#include <cstring>
+
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+#if defined(_MSC_VER)
+#define TARGET_AVX
+#else
+#define TARGET_AVX __attribute__((target("avx")))
+#endif
+
+// Four vertices are 44 floats, eleven vectors in and eleven out. With
+// p, n, t and u the vectors of 4 positions, normals, tangents and uvs:
+//   p0 = px0 py0 pz0 px1   n0, t0 alike      u0 = u0 v0 u1 v1
+//   p1 = py1 pz1 px2 py2   n1, t1 alike      u1 = u2 v2 u3 v3
+//   p2 = pz2 px3 py3 pz3   n2, t2 alike
+// and out[k] the k-th 4 floats of the interleaved vertices. Every step
+// stays within 128-bit lanes, so the AVX kernel runs the same shuffles on
+// two groups of four at once.
+#define INTERLEAVE_4(VEC, SHUFFLE, p0, p1, p2, n0, n1, n2, t0, t1, t2, u0, u1, out) \
+{ \
+	VEC a, b; \
+	a = SHUFFLE(p0, n0, _MM_SHUFFLE(0, 0, 2, 2)); \
+	out[0] = SHUFFLE(p0, a, _MM_SHUFFLE(2, 0, 1, 0));		/* px0 py0 pz0 nx0 */ \
+	out[1] = SHUFFLE(n0, t0, _MM_SHUFFLE(1, 0, 2, 1));		/* ny0 nz0 tx0 ty0 */ \
+	a = SHUFFLE(t0, u0, _MM_SHUFFLE(0, 0, 2, 2)); \
+	b = SHUFFLE(u0, p0, _MM_SHUFFLE(3, 3, 1, 1)); \
+	out[2] = SHUFFLE(a, b, _MM_SHUFFLE(2, 0, 2, 0));		/* tz0 u0 v0 px1 */ \
+	b = SHUFFLE(n0, n1, _MM_SHUFFLE(0, 0, 3, 3)); \
+	out[3] = SHUFFLE(p1, b, _MM_SHUFFLE(2, 0, 1, 0));		/* py1 pz1 nx1 ny1 */ \
+	a = SHUFFLE(n1, t0, _MM_SHUFFLE(3, 3, 1, 1)); \
+	out[4] = SHUFFLE(a, t1, _MM_SHUFFLE(1, 0, 2, 0));		/* nz1 tx1 ty1 tz1 */ \
+	out[5] = SHUFFLE(u0, p1, _MM_SHUFFLE(3, 2, 3, 2));		/* u1 v1 px2 py2 */ \
+	a = SHUFFLE(p2, n1, _MM_SHUFFLE(2, 2, 0, 0)); \
+	b = SHUFFLE(n1, n2, _MM_SHUFFLE(0, 0, 3, 3)); \
+	out[6] = SHUFFLE(a, b, _MM_SHUFFLE(2, 0, 2, 0));		/* pz2 nx2 ny2 nz2 */ \
+	a = SHUFFLE(t2, u1, _MM_SHUFFLE(0, 0, 0, 0)); \
+	out[7] = SHUFFLE(t1, a, _MM_SHUFFLE(2, 0, 3, 2));		/* tx2 ty2 tz2 u2 */ \
+	a = SHUFFLE(u1, p2, _MM_SHUFFLE(1, 1, 1, 1)); \
+	out[8] = SHUFFLE(a, p2, _MM_SHUFFLE(3, 2, 2, 0));		/* v2 px3 py3 pz3 */ \
+	a = SHUFFLE(n2, t2, _MM_SHUFFLE(1, 1, 3, 3)); \
+	out[9] = SHUFFLE(n2, a, _MM_SHUFFLE(2, 0, 2, 1));		/* nx3 ny3 nz3 tx3 */ \
+	out[10] = SHUFFLE(t2, u1, _MM_SHUFFLE(3, 2, 3, 2));		/* ty3 tz3 u3 v3 */ \
+}
+
+namespace
+{
+	static_assert(sizeof(Mesh::Vertex) == 11 * sizeof(float), "four vertices must be eleven vectors");
+
+	// Eight floats from lo and hi, four each.
+	TARGET_AVX inline __m256 Load2(const float* lo, const float* hi)
+	{
+		return _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(lo)), _mm_loadu_ps(hi), 1);
+	}
+
+	bool IsAligned(const void* ptr, size_t alignment)
+	{
+		return (reinterpret_cast<uintptr_t>(ptr) & (alignment - 1)) == 0;
+	}
+
+	bool CpuSupportsAVX()
+	{
+#if defined(_MSC_VER)
+		int info[4];
+		__cpuid(info, 1);
+		bool osxsave = (info[2] & (1 << 27)) != 0;
+		bool avx = (info[2] & (1 << 28)) != 0;
+		if (!osxsave || !avx)
+			return false;
+		// The OS has to save the upper halves of the ymm registers.
+		return (_xgetbv(0) & 0x6) == 0x6;
+#else
+		return __builtin_cpu_supports("avx");
+#endif
+	}
+}
+
+void InterleaveVerticesScalar(Mesh::Vertex * dest, const Mesh::Vector3D * positions, const Mesh::Vector3D * normals, const Mesh::Vector3D * tangents, const Mesh::Vector2D * uvs, size_t count)
+{
+	for (size_t i = 0; i < count; i++)
+	{
+		dest[i].position = positions[i];
+		dest[i].normal = normals[i];
+		dest[i].tangent = tangents[i];
+		dest[i].uv = uvs[i];
+	}
+}
+
+void InterleaveVerticesSSE(Mesh::Vertex * dest, const Mesh::Vector3D * positions, const Mesh::Vector3D * normals, const Mesh::Vector3D * tangents, const Mesh::Vector2D * uvs, size_t count)
+{
+	if (!IsAligned(dest, 16))
+	{
+		InterleaveVerticesScalar(dest, positions, normals, tangents, uvs, count);
+		return;
+	}
+
+	// Four vertices are 176 bytes, so every group stays 16-byte aligned.
+	size_t i = 0;
+	for (; i + 4 <= count; i += 4)
+	{
+		const float* p = &positions[i].x;
+		const float* n = &normals[i].x;
+		const float* t = &tangents[i].x;
+		const float* u = &uvs[i].x;
+		const __m128 p0 = _mm_loadu_ps(p), p1 = _mm_loadu_ps(p + 4), p2 = _mm_loadu_ps(p + 8);
+		const __m128 n0 = _mm_loadu_ps(n), n1 = _mm_loadu_ps(n + 4), n2 = _mm_loadu_ps(n + 8);
+		const __m128 t0 = _mm_loadu_ps(t), t1 = _mm_loadu_ps(t + 4), t2 = _mm_loadu_ps(t + 8);
+		const __m128 u0 = _mm_loadu_ps(u), u1 = _mm_loadu_ps(u + 4);
+		__m128 out[11];
+		INTERLEAVE_4(__m128, _mm_shuffle_ps, p0, p1, p2, n0, n1, n2, t0, t1, t2, u0, u1, out);
+
+		float* dst = reinterpret_cast<float*>(dest + i);
+		for (size_t j = 0; j < 11; ++j)
+			_mm_stream_ps(dst + j * 4, out[j]);
+	}
+
+	_mm_sfence();
+
+	InterleaveVerticesScalar(dest + i, positions + i, normals + i, tangents + i, uvs + i, count - i);
+}
+
+TARGET_AVX void InterleaveVerticesAVX(Mesh::Vertex * dest, const Mesh::Vector3D * positions, const Mesh::Vector3D * normals, const Mesh::Vector3D * tangents, const Mesh::Vector2D * uvs, size_t count)
+{
+	if (!IsAligned(dest, 32))
+	{
+		InterleaveVerticesSSE(dest, positions, normals, tangents, uvs, count);
+		return;
+	}
+
+	// Vertices 0-3 go in the low lanes and 4-7 in the high ones, so out[k]
+	// holds the k-th vector of both groups. Eight vertices are 352 bytes, so
+	// every group stays 32-byte aligned.
+	size_t i = 0;
+	for (; i + 8 <= count; i += 8)
+	{
+		const float* p = &positions[i].x;
+		const float* n = &normals[i].x;
+		const float* t = &tangents[i].x;
+		const float* u = &uvs[i].x;
+		const __m256 p0 = Load2(p, p + 12), p1 = Load2(p + 4, p + 16), p2 = Load2(p + 8, p + 20);
+		const __m256 n0 = Load2(n, n + 12), n1 = Load2(n + 4, n + 16), n2 = Load2(n + 8, n + 20);
+		const __m256 t0 = Load2(t, t + 12), t1 = Load2(t + 4, t + 16), t2 = Load2(t + 8, t + 20);
+		const __m256 u0 = Load2(u, u + 8), u1 = Load2(u + 4, u + 12);
+		__m256 out[11];
+		INTERLEAVE_4(__m256, _mm256_shuffle_ps, p0, p1, p2, n0, n1, n2, t0, t1, t2, u0, u1, out);
+
+		// The first group's eleven vectors, then the second's.
+		float* dst = reinterpret_cast<float*>(dest + i);
+		_mm256_stream_ps(dst, _mm256_permute2f128_ps(out[0], out[1], 0x20));
+		_mm256_stream_ps(dst + 8, _mm256_permute2f128_ps(out[2], out[3], 0x20));
+		_mm256_stream_ps(dst + 16, _mm256_permute2f128_ps(out[4], out[5], 0x20));
+		_mm256_stream_ps(dst + 24, _mm256_permute2f128_ps(out[6], out[7], 0x20));
+		_mm256_stream_ps(dst + 32, _mm256_permute2f128_ps(out[8], out[9], 0x20));
+		_mm256_stream_ps(dst + 40, _mm256_permute2f128_ps(out[10], out[0], 0x30));
+		_mm256_stream_ps(dst + 48, _mm256_permute2f128_ps(out[1], out[2], 0x31));
+		_mm256_stream_ps(dst + 56, _mm256_permute2f128_ps(out[3], out[4], 0x31));
+		_mm256_stream_ps(dst + 64, _mm256_permute2f128_ps(out[5], out[6], 0x31));
+		_mm256_stream_ps(dst + 72, _mm256_permute2f128_ps(out[7], out[8], 0x31));
+		_mm256_stream_ps(dst + 80, _mm256_permute2f128_ps(out[9], out[10], 0x31));
+	}
+
+	_mm256_zeroupper();
+
+	// The last group of four, if any, and the rest; this fences the stores.
+	InterleaveVerticesSSE(dest + i, positions + i, normals + i, tangents + i, uvs + i, count - i);
+}
+
+InterleaveKernel GetBestInterleaveKernel()
+{
+	static const InterleaveKernel best = CpuSupportsAVX() ? InterleaveKernel::AVX : InterleaveKernel::SSE;
+	return best;
+}
+
+void InterleaveVertices(InterleaveKernel kernel, Mesh::Vertex * dest, const Mesh::Vector3D * positions, const Mesh::Vector3D * normals, const Mesh::Vector3D * tangents, const Mesh::Vector2D * uvs, size_t count)
+{
+	switch (kernel)
+	{
+	case InterleaveKernel::AVX:
+		InterleaveVerticesAVX(dest, positions, normals, tangents, uvs, count);
+		break;
+	case InterleaveKernel::SSE:
+		InterleaveVerticesSSE(dest, positions, normals, tangents, uvs, count);
+		break;
+	default:
+		InterleaveVerticesScalar(dest, positions, normals, tangents, uvs, count);
+		break;
+	}
+}
+
+void StreamCopy(void * dest, const void * src, size_t size)
+{
+	uint8_t* out = reinterpret_cast<uint8_t*>(dest);
+	const uint8_t* in = reinterpret_cast<const uint8_t*>(src);
+
+	// Bring the destination to a 16-byte boundary with a plain copy.
+	size_t head = (16 - (reinterpret_cast<uintptr_t>(out) & 15)) & 15;
+	if (head > size) head = size;
+	memcpy(out, in, head);
+	out += head;
+	in += head;
+	size -= head;
+
+	size_t body = size & ~size_t(63);
+	for (size_t i = 0; i < body; i += 64)
+	{
+		__m128 a = _mm_loadu_ps(reinterpret_cast<const float*>(in + i));
+		__m128 b = _mm_loadu_ps(reinterpret_cast<const float*>(in + i + 16));
+		__m128 c = _mm_loadu_ps(reinterpret_cast<const float*>(in + i + 32));
+		__m128 d = _mm_loadu_ps(reinterpret_cast<const float*>(in + i + 48));
+		_mm_stream_ps(reinterpret_cast<float*>(out + i), a);
+		_mm_stream_ps(reinterpret_cast<float*>(out + i + 16), b);
+		_mm_stream_ps(reinterpret_cast<float*>(out + i + 32), c);
+		_mm_stream_ps(reinterpret_cast<float*>(out + i + 48), d);
+	}
+	_mm_sfence();
+
+	memcpy(out + body, in + body, size - body);
+}
@@ -0,0 +1,28 @@
+#pragma once
+#include <stddef.h>
+
+#include "Mesh.h"
+
+// Kernels that turn the SoA attribute arrays of a Mesh into the interleaved
+// Mesh::Vertex stream. The streaming variants write whole cache lines with
+// non-temporal stores, which is what write-combined upload heaps want: no
+// read-for-ownership and no pollution of the cache with data the CPU never
+// reads back.
+
+enum class InterleaveKernel
+{
+	Scalar,
+	SSE,
+	AVX,
+};
+
+void InterleaveVerticesScalar(Mesh::Vertex* dest, const Mesh::Vector3D* positions, const Mesh::Vector3D* normals, const Mesh::Vector3D* tangents, const Mesh::Vector2D* uvs, size_t count);
+void InterleaveVerticesSSE(Mesh::Vertex* dest, const Mesh::Vector3D* positions, const Mesh::Vector3D* normals, const Mesh::Vector3D* tangents, const Mesh::Vector2D* uvs, size_t count);
+void InterleaveVerticesAVX(Mesh::Vertex* dest, const Mesh::Vector3D* positions, const Mesh::Vector3D* normals, const Mesh::Vector3D* tangents, const Mesh::Vector2D* uvs, size_t count);
+
+// Picks the widest kernel the CPU supports.
+InterleaveKernel GetBestInterleaveKernel();
+void InterleaveVertices(InterleaveKernel kernel, Mesh::Vertex* dest, const Mesh::Vector3D* positions, const Mesh::Vector3D* normals, const Mesh::Vector3D* tangents, const Mesh::Vector2D* uvs, size_t count);
+
+// memcpy replacement for already interleaved data going into write-combined memory.
+void StreamCopy(void* dest, const void* src, size_t size);
@@ -0,0 +1,416 @@
+#include "VertexLayout.h"
+#include "VertexInterleave.h"
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+namespace
+{
+	const char* const g_Semantics[] = { "POSITION", "NORMAL", "TANGENT", "TEXCOORD" };
+
+	constexpr size_t AttributeCount = static_cast<size_t>(VertexAttribute::Count);
+
+	uint16_t FloatToHalf(float value)
+	{
+		uint32_t x;
+		memcpy(&x, &value, sizeof(x));
+
+		uint32_t sign = (x >> 16) & 0x8000;
+		uint32_t exponent = (x >> 23) & 0xff;
+		uint32_t mantissa = x & 0x7fffff;
+
+		if (exponent == 0xff)
+			return static_cast<uint16_t>(sign | 0x7c00 | (mantissa ? 0x200 : 0));
+
+		int32_t e = static_cast<int32_t>(exponent) - 127 + 15;
+		if (e >= 31)
+			return static_cast<uint16_t>(sign | 0x7c00);
+
+		if (e <= 0)
+		{
+			if (e < -10)
+				return static_cast<uint16_t>(sign);
+
+			mantissa |= 0x800000;
+			uint32_t shift = static_cast<uint32_t>(14 - e);
+			uint32_t h = mantissa >> shift;
+			uint32_t rest = mantissa & ((1u << shift) - 1);
+			uint32_t halfway = 1u << (shift - 1);
+			if (rest > halfway || (rest == halfway && (h & 1)))
+				h++;
+			return static_cast<uint16_t>(sign | h);
+		}
+
+		// Round to nearest even, a carry out of the mantissa correctly bumps the exponent.
+		uint32_t h = (static_cast<uint32_t>(e) << 10) | (mantissa >> 13);
+		uint32_t rest = mantissa & 0x1fff;
+		if (rest > 0x1000 || (rest == 0x1000 && (h & 1)))
+			h++;
+		return static_cast<uint16_t>(sign | h);
+	}
+
+	float HalfToFloat(uint16_t h)
+	{
+		uint32_t sign = static_cast<uint32_t>(h & 0x8000) << 16;
+		uint32_t exponent = (h >> 10) & 0x1f;
+		uint32_t mantissa = h & 0x3ff;
+
+		uint32_t x;
+		if (exponent == 0)
+		{
+			float f = std::ldexp(static_cast<float>(mantissa), -24);
+			return sign ? -f : f;
+		}
+		else if (exponent == 31)
+		{
+			x = sign | 0x7f800000 | (mantissa << 13);
+		}
+		else
+		{
+			x = sign | ((exponent + 112) << 23) | (mantissa << 13);
+		}
+
+		float f;
+		memcpy(&f, &x, sizeof(f));
+		return f;
+	}
+
+	float SignNotZero(float v)
+	{
+		return v >= 0.0f ? 1.0f : -1.0f;
+	}
+
+	Mesh::Vector3D Normalize(Mesh::Vector3D v)
+	{
+		float len = std::sqrt(v.x * v.x + v.y * v.y + v.z * v.z);
+		if (len <= 0.0f)
+			return { 0.0f, 0.0f, 1.0f };
+		return { v.x / len, v.y / len, v.z / len };
+	}
+
+	Mesh::Vector3D OctDecode(float u, float v)
+	{
+		Mesh::Vector3D n = { u, v, 1.0f - std::fabs(u) - std::fabs(v) };
+		if (n.z < 0.0f)
+		{
+			float x = n.x;
+			n.x = (1.0f - std::fabs(n.y)) * SignNotZero(x);
+			n.y = (1.0f - std::fabs(x)) * SignNotZero(n.y);
+		}
+		return Normalize(n);
+	}
+
+	float SNormToFloat(int32_t q, int32_t maxValue)
+	{
+		float f = static_cast<float>(q) / maxValue;
+		return f < -1.0f ? -1.0f : f;
+	}
+
+	// Octahedral encoding that tries every rounding direction and keeps the
+	// one that decodes closest to the input. Returns the cosine between the
+	// two.
+	float OctEncode(Mesh::Vector3D n, int32_t maxValue, int32_t& qu, int32_t& qv)
+	{
+		n = Normalize(n);
+		float l1 = std::fabs(n.x) + std::fabs(n.y) + std::fabs(n.z);
+		float u = n.x / l1;
+		float v = n.y / l1;
+		if (n.z < 0.0f)
+		{
+			float x = u;
+			u = (1.0f - std::fabs(v)) * SignNotZero(x);
+			v = (1.0f - std::fabs(x)) * SignNotZero(v);
+		}
+
+		int32_t baseU = static_cast<int32_t>(std::floor(u * maxValue));
+		int32_t baseV = static_cast<int32_t>(std::floor(v * maxValue));
+
+		float best = -2.0f;
+		for (int32_t i = 0; i < 2; ++i)
+		{
+			for (int32_t j = 0; j < 2; ++j)
+			{
+				int32_t cu = baseU + i, cv = baseV + j;
+				if (cu > maxValue || cv > maxValue)
+					continue;
+
+				Mesh::Vector3D d = OctDecode(SNormToFloat(cu, maxValue), SNormToFloat(cv, maxValue));
+				float dot = d.x * n.x + d.y * n.y + d.z * n.z;
+				if (dot > best)
+				{
+					best = dot;
+					qu = cu;
+					qv = cv;
+				}
+			}
+		}
+		return best;
+	}
+
+	double AngleDegrees(double dot)
+	{
+		if (dot > 1.0) dot = 1.0;
+		if (dot < -1.0) dot = -1.0;
+		return std::acos(dot) * 57.29577951308232;
+	}
+
+	double Distance(Mesh::Vector3D a, Mesh::Vector3D b)
+	{
+		double x = a.x - b.x, y = a.y - b.y, z = a.z - b.z;
+		return std::sqrt(x * x + y * y + z * z);
+	}
+
+	struct ErrorAccumulator
+	{
+		double	maxError = 0.0;
+		double	sumError = 0.0;
+
+		void Add(double e)
+		{
+			if (e > maxError) maxError = e;
+			sumError += e;
+		}
+	};
+
+	// Writes a unit vector and returns the cosine of the angular error.
+	float WriteVector(uint8_t* out, VertexFormat format, Mesh::Vector3D v)
+	{
+		switch (format)
+		{
+		case VertexFormat::Oct16:
+		{
+			int32_t qu = 0, qv = 0;
+			float cosine = OctEncode(v, 32767, qu, qv);
+			int16_t q[2] = { static_cast<int16_t>(qu), static_cast<int16_t>(qv) };
+			memcpy(out, q, sizeof(q));
+			return cosine;
+		}
+		case VertexFormat::Oct8:
+		{
+			int32_t qu = 0, qv = 0;
+			float cosine = OctEncode(v, 127, qu, qv);
+			int8_t q[2] = { static_cast<int8_t>(qu), static_cast<int8_t>(qv) };
+			memcpy(out, q, sizeof(q));
+			return cosine;
+		}
+		default:
+			memcpy(out, &v, sizeof(v));
+			return 1.0f;
+		}
+	}
+}
+
+VertexLayout::VertexLayout()
+{
+	formats[static_cast<size_t>(VertexAttribute::Position)] = VertexFormat::Float3;
+	formats[static_cast<size_t>(VertexAttribute::Normal)] = VertexFormat::Float3;
+	formats[static_cast<size_t>(VertexAttribute::Tangent)] = VertexFormat::Float3;
+	formats[static_cast<size_t>(VertexAttribute::UV)] = VertexFormat::Float2;
+	UpdateOffsets();
+}
+
+VertexLayout VertexLayout::Full()
+{
+	return VertexLayout();
+}
+
+VertexLayout VertexLayout::Compressed()
+{
+	VertexLayout layout;
+	layout.SetFormat(VertexAttribute::Position, VertexFormat::UNorm16x4);
+	layout.SetFormat(VertexAttribute::Normal, VertexFormat::Oct16);
+	layout.SetFormat(VertexAttribute::Tangent, VertexFormat::Oct16);
+	layout.SetFormat(VertexAttribute::UV, VertexFormat::Half2);
+	return layout;
+}
+
+bool VertexLayout::SetFormat(VertexAttribute attribute, VertexFormat format)
+{
+	bool valid = false;
+	switch (attribute)
+	{
+	case VertexAttribute::Position:
+		valid = format == VertexFormat::Float3 || format == VertexFormat::UNorm16x4;
+		break;
+	case VertexAttribute::Normal:
+	case VertexAttribute::Tangent:
+		valid = format == VertexFormat::Float3 || format == VertexFormat::Oct16 || format == VertexFormat::Oct8;
+		break;
+	case VertexAttribute::UV:
+		valid = format == VertexFormat::Float2 || format == VertexFormat::Half2;
+		break;
+	default:
+		break;
+	}
+
+	if (!valid)
+		return false;
+
+	formats[static_cast<size_t>(attribute)] = format;
+	UpdateOffsets();
+	return true;
+}
+
+bool VertexLayout::UsesOctahedralVectors() const
+{
+	return GetFormat(VertexAttribute::Normal) != VertexFormat::Float3
+		|| GetFormat(VertexAttribute::Tangent) != VertexFormat::Float3;
+}
+
+VertexLayout::Element VertexLayout::GetElement(size_t index) const
+{
+	DXGI_FORMAT format = DXGI_FORMAT_R32G32B32_FLOAT;
+	switch (formats[index])
+	{
+	case VertexFormat::Float2: format = DXGI_FORMAT_R32G32_FLOAT; break;
+	case VertexFormat::Float3: format = DXGI_FORMAT_R32G32B32_FLOAT; break;
+	case VertexFormat::Half2: format = DXGI_FORMAT_R16G16_FLOAT; break;
+	case VertexFormat::UNorm16x4: format = DXGI_FORMAT_R16G16B16A16_UNORM; break;
+	case VertexFormat::Oct16: format = DXGI_FORMAT_R16G16_SNORM; break;
+	case VertexFormat::Oct8: format = DXGI_FORMAT_R8G8_SNORM; break;
+	}
+
+	return { g_Semantics[index], format, offsets[index] };
+}
+
+unsigned int VertexLayout::GetFormatSize(VertexFormat format)
+{
+	switch (format)
+	{
+	case VertexFormat::Float2: return 8;
+	case VertexFormat::Float3: return 12;
+	case VertexFormat::Half2: return 4;
+	case VertexFormat::UNorm16x4: return 8;
+	case VertexFormat::Oct16: return 4;
+	case VertexFormat::Oct8: return 2;
+	}
+	return 0;
+}
+
+void VertexLayout::UpdateOffsets()
+{
+	stride = 0;
+	for (size_t i = 0; i < AttributeCount; ++i)
+	{
+		offsets[i] = stride;
+		stride += GetFormatSize(formats[i]);
+	}
+	// Keep every vertex 4-byte aligned, Oct8 alone would break that.
+	stride = (stride + 3) & ~3u;
+}
+
+void VertexLayout::GetPositionTransform(const Mesh & mesh, float * scale, float * bias) const
+{
+	const Mesh::Bounds& bounds = mesh.GetBounds();
+	const float boundsMin[3] = { bounds.min.x, bounds.min.y, bounds.min.z };
+	const float boundsMax[3] = { bounds.max.x, bounds.max.y, bounds.max.z };
+	const bool quantizePosition = GetFormat(VertexAttribute::Position) == VertexFormat::UNorm16x4;
+	for (int c = 0; c < 3; ++c)
+	{
+		scale[c] = quantizePosition ? boundsMax[c] - boundsMin[c] : 1.0f;
+		bias[c] = quantizePosition ? boundsMin[c] : 0.0f;
+	}
+}
+
+void VertexLayout::Pack(const Mesh & mesh, void * pDest, VertexPackInfo * info) const
+{
+	const size_t count = mesh.GetVerticesCount();
+	auto positions = mesh.GetPositions();
+	auto normals = mesh.GetNormals();
+	auto tangents = mesh.GetTangents();
+	auto uvs = mesh.GetUVs();
+
+	const bool quantizePosition = GetFormat(VertexAttribute::Position) == VertexFormat::UNorm16x4;
+	float scale[3], bias[3];
+	GetPositionTransform(mesh, scale, bias);
+
+	// Only the cooker and the benchmarks want the errors.
+	const bool measure = nullptr != info;
+	ErrorAccumulator errors[AttributeCount];
+
+	// Pack into a small cached buffer and stream it out, so the destination
+	// only ever sees full sequential writes.
+	alignas(64) uint8_t chunk[4096];
+	const size_t chunkVertices = sizeof(chunk) / stride;
+	uint8_t* dest = reinterpret_cast<uint8_t*>(pDest);
+
+	for (size_t first = 0; first < count; first += chunkVertices)
+	{
+		size_t last = first + chunkVertices < count ? first + chunkVertices : count;
+		uint8_t* out = chunk;
+
+		for (size_t i = first; i < last; ++i, out += stride)
+		{
+			const Mesh::Vector3D& p = positions[i];
+			uint8_t* pos = out + GetOffset(VertexAttribute::Position);
+			if (quantizePosition)
+			{
+				const float v[3] = { p.x, p.y, p.z };
+				uint16_t q[4] = { 0, 0, 0, 65535 };
+				for (int c = 0; c < 3; ++c)
+				{
+					float t = scale[c] > 0.0f ? (v[c] - bias[c]) / scale[c] : 0.0f;
+					t = t < 0.0f ? 0.0f : (t > 1.0f ? 1.0f : t);
+					q[c] = static_cast<uint16_t>(t * 65535.0f + 0.5f);
+				}
+				memcpy(pos, q, sizeof(q));
+				if (measure)
+				{
+					Mesh::Vector3D decoded = { q[0] / 65535.0f * scale[0] + bias[0], q[1] / 65535.0f * scale[1] + bias[1], q[2] / 65535.0f * scale[2] + bias[2] };
+					errors[static_cast<size_t>(VertexAttribute::Position)].Add(Distance(p, decoded));
+				}
+			}
+			else
+			{
+				memcpy(pos, &p, sizeof(p));
+			}
+
+			const float normalCosine = WriteVector(out + GetOffset(VertexAttribute::Normal), GetFormat(VertexAttribute::Normal), normals[i]);
+			const float tangentCosine = WriteVector(out + GetOffset(VertexAttribute::Tangent), GetFormat(VertexAttribute::Tangent), tangents[i]);
+			if (measure)
+			{
+				errors[static_cast<size_t>(VertexAttribute::Normal)].Add(AngleDegrees(normalCosine));
+				errors[static_cast<size_t>(VertexAttribute::Tangent)].Add(AngleDegrees(tangentCosine));
+			}
+
+			const Mesh::Vector2D& uv = uvs[i];
+			uint8_t* uvOut = out + GetOffset(VertexAttribute::UV);
+			if (GetFormat(VertexAttribute::UV) == VertexFormat::Half2)
+			{
+				uint16_t h[2] = { FloatToHalf(uv.x), FloatToHalf(uv.y) };
+				memcpy(uvOut, h, sizeof(h));
+				if (measure)
+				{
+					double du = HalfToFloat(h[0]) - uv.x, dv = HalfToFloat(h[1]) - uv.y;
+					errors[static_cast<size_t>(VertexAttribute::UV)].Add(std::sqrt(du * du + dv * dv));
+				}
+			}
+			else
+			{
+				memcpy(uvOut, &uv, sizeof(uv));
+			}
+
+			// Padding bytes, if any.
+			size_t used = GetOffset(VertexAttribute::UV) + GetFormatSize(GetFormat(VertexAttribute::UV));
+			if (used < stride)
+				memset(out + used, 0, stride - used);
+		}
+
+		StreamCopy(dest + first * stride, chunk, (last - first) * stride);
+	}
+
+	if (measure)
+	{
+		for (int c = 0; c < 3; ++c)
+		{
+			info->positionScale[c] = scale[c];
+			info->positionBias[c] = bias[c];
+		}
+		for (size_t i = 0; i < AttributeCount; ++i)
+		{
+			info->errors[i].maxError = errors[i].maxError;
+			info->errors[i].meanError = count > 0 ? errors[i].sumError / count : 0.0;
+		}
+	}
+}
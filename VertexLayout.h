@@ -0,0 +1,104 @@
+#pragma once
+#include <stddef.h>
+
+#if defined(_WIN32)
+#include <dxgiformat.h>
+#else
+// Values from dxgiformat.h so layouts can be built and checked off Windows.
+enum DXGI_FORMAT
+{
+	DXGI_FORMAT_R32G32B32_FLOAT = 6,
+	DXGI_FORMAT_R16G16B16A16_UNORM = 11,
+	DXGI_FORMAT_R32G32_FLOAT = 16,
+	DXGI_FORMAT_R16G16_FLOAT = 34,
+	DXGI_FORMAT_R16G16_SNORM = 37,
+	DXGI_FORMAT_R8G8_SNORM = 51,
+};
+#endif
+
+#include "Mesh.h"
+
+enum class VertexAttribute
+{
+	Position,
+	Normal,
+	Tangent,
+	UV,
+	Count,
+};
+
+enum class VertexFormat
+{
+	Float2,
+	Float3,
+	Half2,
+	// Normalized against the mesh bounds, w is always 1.
+	UNorm16x4,
+	// Octahedral unit vectors.
+	Oct16,
+	Oct8,
+};
+
+struct VertexAttributeError
+{
+	double		maxError;
+	double		meanError;
+};
+
+struct VertexPackInfo
+{
+	// position = packed * positionScale + positionBias
+	float					positionScale[3];
+	float					positionBias[3];
+
+	// Position and UV errors are absolute, normal and tangent errors are in degrees.
+	VertexAttributeError	errors[static_cast<size_t>(VertexAttribute::Count)];
+};
+
+// Describes how each vertex attribute is stored. The same description drives
+// packing the vertex stream and the input layout the pipeline is created with.
+class VertexLayout
+{
+public:
+	struct Element
+	{
+		const char*		semantic;
+		DXGI_FORMAT		format;
+		unsigned int	offset;
+	};
+
+	VertexLayout();
+
+	// 44 bytes, every attribute as 32-bit floats.
+	static VertexLayout Full();
+	// 20 bytes: 16-bit positions, 16-bit octahedral normal and tangent, half UVs.
+	static VertexLayout Compressed();
+
+	bool SetFormat(VertexAttribute attribute, VertexFormat format);
+	VertexFormat GetFormat(VertexAttribute attribute) const { return formats[static_cast<size_t>(attribute)]; }
+	unsigned int GetOffset(VertexAttribute attribute) const { return offsets[static_cast<size_t>(attribute)]; }
+	unsigned int GetStride() const { return stride; }
+
+	// Octahedral normals and tangents need the packed vertex shader.
+	bool UsesOctahedralVectors() const;
+
+	size_t GetElementsCount() const { return static_cast<size_t>(VertexAttribute::Count); }
+	Element GetElement(size_t index) const;
+
+	// position = packed * scale + bias, from the mesh bounds.
+	void GetPositionTransform(const Mesh& mesh, float* scale, float* bias) const;
+
+	// Writes GetStride() * mesh.GetVerticesCount() bytes to pDest. pDest may
+	// be write-combined memory, it is only ever written sequentially. The
+	// errors are only measured when info is given.
+	void Pack(const Mesh& mesh, void* pDest, VertexPackInfo* info = nullptr) const;
+
+	static unsigned int GetFormatSize(VertexFormat format);
+
+private:
+	void UpdateOffsets();
+
+	VertexFormat	formats[static_cast<size_t>(VertexAttribute::Count)];
+	unsigned int	offsets[static_cast<size_t>(VertexAttribute::Count)];
+	unsigned int	stride;
+};
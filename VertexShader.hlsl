@@ -5,12 +5,23 @@ cbuffer ConstantsPerCamera : register(b0)
   matrix matProj;
 }
 
-cbuffer ConstantsPerInstance : register(b1)
+cbuffer ConstantsPerMesh : register(b1)
 {
-  matrix matWorld;
-  matrix matWorld_IT;
+  // Identity unless the layout quantizes positions.
+  matrix matDequantize;
 }
 
+// InstanceBuilder's InstanceData; the draw's root SRV starts at its batch.
+struct Instance
+{
+  float4 world[3];
+  float4 normal[3];
+  uint materialIndex;
+  uint3 padding;
+};
+
+StructuredBuffer<Instance> instances : register(t1);
+
 struct Input
 {
 	float4 position : POSITION;
@@ -25,17 +36,30 @@ struct V2P
 	float3 normal	: NORMAL;
 	float3 tangent	: TANGENT;
 	float2 uv		: TEXCOORD;
+	nointerpolation uint material : MATERIAL;
 };
 
-V2P main(Input v)
+float3 TransformPosition(float4 position, Instance instance)
+{
+	float4 p = mul(position, matDequantize);
+	return float3(dot(p, instance.world[0]), dot(p, instance.world[1]), dot(p, instance.world[2]));
+}
+
+float3 TransformNormal(float3 n, Instance instance)
+{
+	return float3(dot(n, instance.normal[0].xyz), dot(n, instance.normal[1].xyz), dot(n, instance.normal[2].xyz));
+}
+
+V2P main(Input v, uint instanceID : SV_InstanceID)
 {
 	V2P v2p;
-	float4x4 matMVP = mul(mul(matWorld, matView), matProj);
+	Instance instance = instances[instanceID];
 
-	v2p.position = mul(v.position, matMVP);
-	v2p.normal = mul(v.normal, (float3x3)matWorld_IT);
-	v2p.tangent = mul(v.tangent, (float3x3)matWorld_IT);
+	v2p.position = mul(mul(float4(TransformPosition(v.position, instance), 1.0), matView), matProj);
+	v2p.normal = TransformNormal(v.normal, instance);
+	v2p.tangent = TransformNormal(v.tangent, instance);
 	v2p.uv = v.uv;
+	v2p.material = instance.materialIndex;
 
 	return v2p;
 }
\ No newline at end of file
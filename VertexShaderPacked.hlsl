@@ -0,0 +1,74 @@
+cbuffer ConstantsPerCamera : register(b0)
+{
+	matrix matView;
+  matrix matProj;
+}
+
+cbuffer ConstantsPerMesh : register(b1)
+{
+  // Mesh bounds dequantization of the position.
+  matrix matDequantize;
+}
+
+// InstanceBuilder's InstanceData; the draw's root SRV starts at its batch.
+struct Instance
+{
+  float4 world[3];
+  float4 normal[3];
+  uint materialIndex;
+  uint3 padding;
+};
+
+StructuredBuffer<Instance> instances : register(t1);
+
+// VertexLayout::Compressed(): positions are UNORM16 against the mesh bounds,
+// normal and tangent are octahedral encoded, UVs are half floats.
+struct Input
+{
+	float4 position : POSITION;
+	float2 normal	: NORMAL;
+	float2 tangent	: TANGENT;
+	float2 uv		: TEXCOORD;
+};
+
+struct V2P
+{
+	float4 position	: SV_POSITION;
+	float3 normal	: NORMAL;
+	float3 tangent	: TANGENT;
+	float2 uv		: TEXCOORD;
+	nointerpolation uint material : MATERIAL;
+};
+
+float3 OctDecode(float2 e)
+{
+	float3 n = float3(e.x, e.y, 1.0 - abs(e.x) - abs(e.y));
+	float t = saturate(-n.z);
+	n.xy += n.xy >= 0.0 ? -t : t;
+	return normalize(n);
+}
+
+float3 TransformPosition(float4 position, Instance instance)
+{
+	float4 p = mul(position, matDequantize);
+	return float3(dot(p, instance.world[0]), dot(p, instance.world[1]), dot(p, instance.world[2]));
+}
+
+float3 TransformNormal(float3 n, Instance instance)
+{
+	return float3(dot(n, instance.normal[0].xyz), dot(n, instance.normal[1].xyz), dot(n, instance.normal[2].xyz));
+}
+
+V2P main(Input v, uint instanceID : SV_InstanceID)
+{
+	V2P v2p;
+	Instance instance = instances[instanceID];
+
+	v2p.position = mul(mul(float4(TransformPosition(v.position, instance), 1.0), matView), matProj);
+	v2p.normal = TransformNormal(OctDecode(v.normal), instance);
+	v2p.tangent = TransformNormal(OctDecode(v.tangent), instance);
+	v2p.uv = v.uv;
+	v2p.material = instance.materialIndex;
+
+	return v2p;
+}
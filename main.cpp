@@ -1,5 +1,8 @@
 #include <Windows.h>
+#include <cmath>
 #include <cstdio>
+#include <vector>
+#include <algorithm>
 #include <dxgi1_5.h>
 #include <d3d12.h>
 #include <DirectXMath.h>
@@ -13,6 +16,27 @@
 #define CHECKED(x) if (!SUCCEEDED(x)) { return false; }
 
 #include "Mesh.h"
+#include "VertexLayout.h"
+#include "VertexInterleave.h"
+#include "LodSelector.h"
+#include "AssetStreamer.h"
+#include "AssetArchive.h"
+#include "UploadRing.h"
+#include "ConstantAllocator.h"
+#include "FrameScheduler.h"
+#include "CommandListPool.h"
+#include "DescriptorHeaps.h"
+#include "GpuAllocator.h"
+#include "RenderGraphResources.h"
+#include "InstanceBuilder.h"
+#include "PipelineStates.h"
+#include "MappedFile.h"
+#include "Texture.h"
+#include "ResidencyManager.h"
+#include "Profiler.h"
+#include "GpuProfiler.h"
+#include "SceneRenderer.h"
+#include "D3D12RenderDevice.h"
 
 namespace
 {
@@ -20,25 +44,31 @@ namespace
 	{
 		void*	ptr;
 		size_t	size;
+		bool	owned;
 
-		Memory() : ptr(nullptr), size(0) {}
-		Memory(size_t size) : ptr(nullptr), size(size) { ptr = reinterpret_cast<void*>(new char[size]); }
+		Memory() : ptr(nullptr), size(0), owned(true) {}
+		Memory(size_t size) : ptr(nullptr), size(size), owned(true) { ptr = reinterpret_cast<void*>(new char[size]); }
 
-		~Memory() { if (nullptr != ptr) delete[] reinterpret_cast<char*>(ptr); }
+		~Memory() { Free(); }
 
 		Memory(const Memory&) = delete;
-		Memory(Memory&& m) : ptr(m.ptr), size(m.size) { m.ptr = nullptr; m.size = 0; }
+		Memory(Memory&& m) : ptr(m.ptr), size(m.size), owned(m.owned) { m.ptr = nullptr; m.size = 0; }
+
+		void Free()
+		{
+			if (owned && nullptr != ptr)
+				delete[] reinterpret_cast<char*>(ptr);
+			ptr = nullptr;
+			size = 0;
+			owned = true;
+		}
 
 		void LoadFromFile(const char* filename)
 		{
 			FILE* fp = fopen(filename, "rb");
 			if (nullptr == fp) return;
 
-			if (nullptr != ptr)
-			{
-				delete[] reinterpret_cast<char*>(ptr);
-				size = 0;
-			}
+			Free();
 
 			fseek(fp, 0, SEEK_END);
 			size_t length = ftell(fp);
@@ -50,13 +80,43 @@ namespace
 			fclose(fp);
 
 			if (length != length_read)
+				Free();
+		}
+
+		// Points straight into the archive mapping when the entry is stored raw,
+		// decompresses into an owned buffer otherwise.
+		bool LoadFromArchive(const AssetArchive& archive, const char* name)
+		{
+			const ArchiveEntry* entry = archive.Find(name);
+			if (nullptr == entry)
+				return false;
+
+			Free();
+
+			if (const void* view = archive.GetView(*entry))
 			{
-				delete[] reinterpret_cast<char*>(ptr);
-				size = 0;
+				ptr = const_cast<void*>(view);
+				size = static_cast<size_t>(entry->size);
+				owned = false;
+				return true;
 			}
+
+			size = static_cast<size_t>(entry->size);
+			ptr = reinterpret_cast<void*>(new char[size]);
+			if (!archive.Read(*entry, ptr))
+			{
+				Free();
+				return false;
+			}
+			return true;
 		}
 	};
 
+	// Compiled pipelines, in the working directory next to Assets.
+	const char* const PipelineCacheFilename = "pipelines.cache";
+	// The last seconds of markers, written on exit.
+	const char* const ProfileTraceFilename = "profile.json";
+
 	class Application
 	{
 	public:
@@ -67,6 +127,8 @@ namespace
 			this->width = width;
 			this->height = height;
 
+			QueryPerformanceCounter(&initCounter);
+
 			if (!InitDirect3D()) return false;
 			if (!InitAssets()) return false;
 
@@ -75,7 +137,12 @@ namespace
 
 		void Release()
 		{
+			streamer.Stop();
 			WaitForGPU();
+#if PROFILER_ENABLED
+			gpuProfiler.BeginFrame(frameScheduler.GetFrameSlot());
+			Profiler::Shared().ExportChromeTrace(ProfileTraceFilename);
+#endif
 			ReleaseAssets();
 			ReleaseDirect3D();
 		}
@@ -92,10 +159,17 @@ namespace
 
 			lastCounter = currentCounter;
 
+			// Twice a second, setting the title is not free.
+			Profiler& profiler = Profiler::Shared();
+			profiler.EndFrame();
+			if (currentCounter.QuadPart - titleCounter.QuadPart >= counterFreq.QuadPart / 2)
 			{
+				titleCounter = currentCounter;
+				FrameStats::Summary frames = profiler.GetFrameStats().GetSummary();
 				wchar_t title[256] = {};
-				int fps = static_cast<int>(1.0f / timeDelta);
-				wsprintf(title, L"D3D12_Study       FPS: %i", fps);
+				wsprintf(title, L"D3D12_Study       frame: %i us p50, %i us p95, %i us p99       %i instances, %i draws       record: %i us, %i lists, %i us slowest",
+					static_cast<int>(frames.p50 * 1000.0f), static_cast<int>(frames.p95 * 1000.0f), static_cast<int>(frames.p99 * 1000.0f),
+					recordStats.instancesCount, recordStats.drawsCount, recordStats.wallUs, recordStats.listsCount, recordStats.maxListUs);
 				SetWindowText(hWnd, title);
 			}
 
@@ -162,6 +236,18 @@ namespace
 			}
 
 			CHECKED(D3D12CreateDevice(adaptor, D3D_FEATURE_LEVEL_12_0, IID_PPV_ARGS(&device)));
+			pipelineDisk.Load(PipelineCacheFilename, HashDevice(adaptor));
+			{
+				// A quarter of the video memory the OS grants us goes to streamed textures.
+				IDXGIAdapter3* adapter3 = nullptr;
+				DXGI_QUERY_VIDEO_MEMORY_INFO memoryInfo = {};
+				if (SUCCEEDED(adaptor->QueryInterface(IID_PPV_ARGS(&adapter3))))
+				{
+					if (SUCCEEDED(adapter3->QueryVideoMemoryInfo(0, DXGI_MEMORY_SEGMENT_GROUP_LOCAL, &memoryInfo)) && 0 != memoryInfo.Budget)
+						texResidency.SetBudget(memoryInfo.Budget / 4);
+					adapter3->Release();
+				}
+			}
 			adaptor->Release();
 
 			{
@@ -169,11 +255,15 @@ namespace
 				desc.Type = D3D12_COMMAND_LIST_TYPE_DIRECT;
 				CHECKED(device->CreateCommandQueue(&desc, IID_PPV_ARGS(&cmdQueue)));
 			}
+#if PROFILER_ENABLED
+			// Without timestamps the frame still runs, only its GPU timings are missing.
+			gpuProfiler.Init(device, cmdQueue, Profiler::Shared(), FramesInFlight);
+#endif
 
 			{
 				IDXGISwapChain1* swapChain_ = nullptr;
 				DXGI_SWAP_CHAIN_DESC1 desc = {};
-				desc.BufferCount = 2;
+				desc.BufferCount = FramesInFlight;
 				desc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
 				desc.Width = width;
 				desc.Height = height;
@@ -191,37 +281,30 @@ namespace
 			factory->MakeWindowAssociation(hWnd, DXGI_MWA_NO_ALT_ENTER);
 			factory->Release();
 
-			{
-				D3D12_DESCRIPTOR_HEAP_DESC desc = {};
-				desc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_RTV;
-				desc.NumDescriptors = 2;
-				CHECKED(device->CreateDescriptorHeap(&desc, IID_PPV_ARGS(&rtvHeap)));
-				rtvHeapInc = device->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_RTV);
-			}
+			rtvHeap.Init(device, D3D12_DESCRIPTOR_HEAP_TYPE_RTV, 16);
+			dsvHeap.Init(device, D3D12_DESCRIPTOR_HEAP_TYPE_DSV, 16);
+			srvHeap.Init(device, D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
 
+			for (UINT i = 0; i < FramesInFlight; ++i)
 			{
-				auto handle = rtvHeap->GetCPUDescriptorHandleForHeapStart();
-
-				for (UINT i = 0; i < 2; ++i)
-				{
-					CHECKED(swapChain->GetBuffer(i, IID_PPV_ARGS(&backBuffers[i])));
-					device->CreateRenderTargetView(backBuffers[i], nullptr, handle);
-					handle.ptr += rtvHeapInc;
-				}
+				CHECKED(swapChain->GetBuffer(i, IID_PPV_ARGS(&backBuffers[i])));
+				rtvHandles[i] = rtvHeap.Allocate();
+				if (!rtvHandles[i].IsValid())
+					return false;
+				device->CreateRenderTargetView(backBuffers[i], nullptr, rtvHeap.GetCpuHandle(rtvHandles[i]));
 			}
 
-			{
-				D3D12_DESCRIPTOR_HEAP_DESC desc = {};
-				desc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_DSV;
-				desc.NumDescriptors = 1;
-				CHECKED(device->CreateDescriptorHeap(&desc, IID_PPV_ARGS(&dsvHeap)));
-			}
+			dsvHandle = dsvHeap.Allocate();
+			if (!dsvHandle.IsValid())
+				return false;
 
-			{
-				D3D12_HEAP_PROPERTIES prop = {};
-				prop.Type = D3D12_HEAP_TYPE_DEFAULT;
+			gpuAllocator.Init(device);
+			graphResources.Init(device);
 
-				D3D12_RESOURCE_DESC desc = {};
+			{
+				// A transient of the frame graph, placed in its heap on the first frame.
+				D3D12_RESOURCE_DESC& desc = depthDesc;
+				desc = {};
 				desc.Dimension = D3D12_RESOURCE_DIMENSION_TEXTURE2D;
 				desc.Format = DXGI_FORMAT_D24_UNORM_S8_UINT;
 				desc.Width = width;
@@ -231,23 +314,14 @@ namespace
 				desc.SampleDesc.Count = 1;
 				desc.Flags = D3D12_RESOURCE_FLAG_ALLOW_DEPTH_STENCIL;
 
-				D3D12_CLEAR_VALUE clearValue[1];
-				clearValue[0].Format = DXGI_FORMAT_D24_UNORM_S8_UINT;
-				clearValue[0].DepthStencil.Depth = 1.0f;
-				clearValue[0].DepthStencil.Stencil = 0;
-
-				CHECKED(device->CreateCommittedResource(&prop, D3D12_HEAP_FLAG_NONE, &desc, D3D12_RESOURCE_STATE_DEPTH_WRITE, clearValue, IID_PPV_ARGS(&depthBuffer)));
-
-				device->CreateDepthStencilView(depthBuffer, nullptr, dsvHeap->GetCPUDescriptorHandleForHeapStart());
+				depthClearValue = {};
+				depthClearValue.Format = DXGI_FORMAT_D24_UNORM_S8_UINT;
+				depthClearValue.DepthStencil.Depth = 1.0f;
+				depthClearValue.DepthStencil.Stencil = 0;
 			}
 
-			CHECKED(device->CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_DIRECT, IID_PPV_ARGS(&cmdAlloc)));
-
-			CHECKED(device->CreateCommandList(0, D3D12_COMMAND_LIST_TYPE_DIRECT, cmdAlloc, nullptr, IID_PPV_ARGS(&cmdList)));
-
-			cmdList->Close();
-
-			frameIndex = 1;
+			cmdListPool.Init(device, FramesInFlight);
+			frameScheduler.Reset(FramesInFlight);
 			CHECKED(device->CreateFence(0, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(&fence)));
 			fenceEvent = CreateEvent(nullptr, FALSE, FALSE, nullptr);
 
@@ -263,13 +337,15 @@ namespace
 			CloseHandle(fenceEvent);
 
 			fence->Release();
-			cmdList->Release();
-			cmdAlloc->Release();
-			rtvHeap->Release();
-			backBuffers[0]->Release();
-			backBuffers[1]->Release();
-			dsvHeap->Release();
-			depthBuffer->Release();
+			gpuProfiler.Release();
+			cmdListPool.Release();
+			rtvHeap.Release();
+			for (UINT i = 0; i < FramesInFlight; ++i)
+				backBuffers[i]->Release();
+			dsvHeap.Release();
+			srvHeap.Release();
+			graphResources.Release();
+			gpuAllocator.Release();
 			swapChain->Release();
 			cmdQueue->Release();
 			device->Release();
@@ -277,17 +353,21 @@ namespace
 
 		void WaitForGPU()
 		{
-			UINT64 v = frameIndex;
-			cmdQueue->Signal(fence, frameIndex);
-			frameIndex++;
+			UINT64 v = frameScheduler.NextFenceValue();
+			cmdQueue->Signal(fence, v);
+
+			WaitForFence(v);
 
+			backBufferIndex = swapChain->GetCurrentBackBufferIndex();
+		}
+
+		void WaitForFence(UINT64 v)
+		{
 			if (fence->GetCompletedValue() < v)
 			{
 				fence->SetEventOnCompletion(v, fenceEvent);
 				WaitForSingleObject(fenceEvent, INFINITE);
 			}
-
-			backBufferIndex = swapChain->GetCurrentBackBufferIndex();
 		}
 
 	private:
@@ -297,31 +377,48 @@ namespace
 		LARGE_INTEGER				counterFreq;
 		LARGE_INTEGER				lastCounter;
 		LARGE_INTEGER				currentCounter;
+		LARGE_INTEGER				initCounter;
+		LARGE_INTEGER				titleCounter = {};
 
 		float						timeElapsed;
 		float						timeDelta;
 
 		ID3D12Device*				device;
 		ID3D12CommandQueue*			cmdQueue;
+		GpuProfiler					gpuProfiler;
 
 		IDXGISwapChain4*			swapChain;
 
-		ID3D12Resource*				backBuffers[2];
+		// 2 or 3: how far the CPU may run ahead of the GPU, also the swap chain length.
+		static const UINT			FramesInFlight = 2;
+
+		ID3D12Resource*				backBuffers[FramesInFlight];
+
+		// Views are created in these CPU-only heaps and copied to descriptorHeap.
+		StagingDescriptorHeap		rtvHeap;
+		StagingDescriptorHeap		dsvHeap;
+		StagingDescriptorHeap		srvHeap;
+		DescriptorHandle			rtvHandles[FramesInFlight];
+		DescriptorHandle			dsvHandle;
 
-		ID3D12DescriptorHeap*		rtvHeap;
-		UINT						rtvHeapInc;
+		// Placed resources: one 64 MB heap per pool instead of a heap per resource.
+		GpuAllocator				gpuAllocator;
 
-		ID3D12Resource*				depthBuffer;
-		ID3D12DescriptorHeap*		dsvHeap;
+		// Rebuilt every frame; transients such as depth alias in graphResources' heap.
+		RenderGraph					frameGraph;
+		RenderGraphResources		graphResources;
+		D3D12_RESOURCE_DESC			depthDesc;
+		D3D12_CLEAR_VALUE			depthClearValue;
 
-		ID3D12CommandAllocator*		cmdAlloc;
-		ID3D12GraphicsCommandList*	cmdList;
+		CommandListPool				cmdListPool;
+		// The frame's first list: uploads, clears and barriers.
+		ID3D12GraphicsCommandList*	cmdList = nullptr;
 
 		ID3D12Fence*				fence;
 		HANDLE						fenceEvent;
 
 		UINT						backBufferIndex;
-		UINT64						frameIndex;
+		FrameScheduler				frameScheduler;
 
 	private:
 
@@ -331,96 +428,145 @@ namespace
 			DirectX::XMFLOAT4X4		matProj;
 		};
 
-		struct ConstantsPerInstance
+		struct ConstantsPerMesh
 		{
-			DirectX::XMFLOAT4X4		matWorld;
-			DirectX::XMFLOAT4X4		matWorldIT;
+			DirectX::XMFLOAT4X4		matDequantize;
 		};
 
-		bool InitAssets()
+		// Filled in on a streaming worker, uploaded on the render thread. The
+		// vertices are packed on the render thread, straight into the upload ring.
+		struct MeshData
 		{
-			{
-				mesh.LoadFromFile("Assets/cube.fbx");
+			std::vector<uint8_t>			indices;
+			std::vector<Mesh::IndexRange>	indexRanges;
+			float							positionScale[3];
+			float							positionBias[3];
+			Mesh::Bounds					bounds;
+		};
 
-				D3D12_HEAP_PROPERTIES prop = {};
-				prop.Type = D3D12_HEAP_TYPE_UPLOAD;
+		struct TextureData
+		{
+			// Committed by WIC, placed by gpuAllocator for cooked mips.
+			GpuAllocation				tex;
+			DXGI_FORMAT					format = DXGI_FORMAT_R8G8B8A8_UNORM;
+			// WIC decodes into pixels; cooked mips point into the archive or file.
+			std::unique_ptr<uint8_t[]>	pixels;
+			std::unique_ptr<MappedFile>	file;
+			std::vector<D3D12_SUBRESOURCE_DATA>	subresources;
+			// Cooked textures stream their mips finer than firstMip.
+			CookedTexture				cooked;
+			uint32_t					firstMip = 0;
+			bool						streamed = false;
+
+			// UploadTexture takes or frees tex, only a WIC texture that never
+			// reached the render thread is left to release here.
+			~TextureData() { if (nullptr != tex.resource) tex.resource->Release(); }
+		};
 
+		bool InitAssets()
+		{
+			{
 				D3D12_RESOURCE_DESC desc = {};
 				desc.Dimension = D3D12_RESOURCE_DIMENSION_BUFFER;
-				desc.DepthOrArraySize = 1;
+				desc.Width = UploadRingSize;
 				desc.Height = 1;
+				desc.DepthOrArraySize = 1;
 				desc.MipLevels = 1;
 				desc.SampleDesc.Count = 1;
 				desc.Layout = D3D12_TEXTURE_LAYOUT_ROW_MAJOR;
-				desc.Width = mesh.GetVerticesCount() * Mesh::VertexSize;
 
-				CHECKED(device->CreateCommittedResource(&prop, D3D12_HEAP_FLAG_NONE, &desc, D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, IID_PPV_ARGS(&vbRes)));
+				CHECKED(gpuAllocator.CreateResource(D3D12_HEAP_TYPE_UPLOAD, desc, D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, uploadBuffer));
 
-				D3D12_RANGE range = {};
+				// Stays mapped, upload heaps are write-combined and never read back.
+				D3D12_RANGE range = { 0, 0 };
 				void* pData = nullptr;
-
-				CHECKED(vbRes->Map(0, &range, &pData));
-				mesh.FillInVerticesData(pData);
-				vbRes->Unmap(0, nullptr);
-
-				vbView = { vbRes->GetGPUVirtualAddress(), static_cast<UINT>(desc.Width), Mesh::VertexSize };
-
-				desc.Width = sizeof(unsigned int) * mesh.GetIndicesCount();
-				CHECKED(device->CreateCommittedResource(&prop, D3D12_HEAP_FLAG_NONE, &desc, D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, IID_PPV_ARGS(&ibRes)));
-
-				CHECKED(ibRes->Map(0, &range, &pData));
-				memcpy(pData, mesh.GetIndices(), desc.Width);
-				ibRes->Unmap(0, nullptr);
-
-				ibView = { ibRes->GetGPUVirtualAddress(), static_cast<UINT>(desc.Width), DXGI_FORMAT_R32_UINT };
+				CHECKED(uploadBuffer.resource->Map(0, &range, &pData));
+				uploadData = reinterpret_cast<uint8_t*>(pData);
+				uploadRing.Reset(UploadRingSize);
 			}
 
+			// Optional: cooked assets come from the pack, anything missing from loose files.
+			archive.Open("Assets/assets.pak");
+
+			// Nothing here waits on a file: the mesh, shaders and texture stream in
+			// and Render draws once all three are on the GPU.
+			streamer.Request<MeshData>(AssetPriority::Critical,
+				[this](MeshData& data) { return LoadMesh(data); },
+				[this](MeshData& data, bool succeeded) { if (!succeeded || !OnMeshLoaded(data)) OutputDebugStringA("error: cannot load Assets/cube.fbx\n"); });
+			streamer.Request(AssetPriority::Critical,
+				[this]() { return LoadShaders(); },
+				[this](bool succeeded) { if (!succeeded || !OnShadersLoaded()) OutputDebugStringA("error: cannot load the shaders\n"); });
+			streamer.Request<TextureData>(AssetPriority::High,
+				[this](TextureData& data) { return LoadTexture(data); },
+				[this](TextureData& data, bool succeeded) { if (!succeeded || !OnTextureLoaded(data)) OutputDebugStringA("error: cannot load Assets/wood.jpg\n"); });
+
 			{
-				D3D12_HEAP_PROPERTIES prop = {};
-				prop.Type = D3D12_HEAP_TYPE_UPLOAD;
+				constantAllocator.Reset(FrameConstantsSize, FramesInFlight);
 
 				D3D12_RESOURCE_DESC desc = {};
 				desc.Dimension = D3D12_RESOURCE_DIMENSION_BUFFER;
-				desc.Width = sizeof(ConstantsPerCamera);
+				desc.Width = constantAllocator.GetBufferSize();
 				desc.Height = 1;
 				desc.DepthOrArraySize = 1;
 				desc.MipLevels = 1;
 				desc.SampleDesc.Count = 1;
 				desc.Layout = D3D12_TEXTURE_LAYOUT_ROW_MAJOR;
 
-				CHECKED(device->CreateCommittedResource(&prop, D3D12_HEAP_FLAG_NONE, &desc, D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, IID_PPV_ARGS(&cbRes1)));
-				CHECKED(device->CreateCommittedResource(&prop, D3D12_HEAP_FLAG_NONE, &desc, D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, IID_PPV_ARGS(&cbRes2)));
+				CHECKED(gpuAllocator.CreateResource(D3D12_HEAP_TYPE_UPLOAD, desc, D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, constantBuffer));
+
+				D3D12_RANGE range = { 0, 0 };
+				void* pData = nullptr;
+				CHECKED(constantBuffer.resource->Map(0, &range, &pData));
+				constantData = reinterpret_cast<uint8_t*>(pData);
 			}
 
 			{
-				ConstantsPerCamera data;
+				ConstantsPerCamera& data = cameraConstants;
 				DirectX::XMStoreFloat4x4(
 					&(data.matView),
-					DirectX::XMMatrixTranspose(DirectX::XMMatrixTranslation(0.0f, 0.0f, 2.0f))
+					DirectX::XMMatrixTranspose(DirectX::XMMatrixTranslation(0.0f, 0.0f, CameraDistance))
 				);
 				DirectX::XMStoreFloat4x4(
 					&(data.matProj),
 					DirectX::XMMatrixTranspose(
-						DirectX::XMMatrixPerspectiveFovLH(DirectX::XM_PIDIV2, (float)width / height, 0.5f, 3.0f)
+						DirectX::XMMatrixPerspectiveFovLH(DirectX::XM_PIDIV2, (float)width / height, 0.5f, CameraDistance * 3.0f)
 					)
 				);
 
-				D3D12_RANGE range = { 0, 0 };
-				void* pData = nullptr;
-				CHECKED(cbRes1->Map(0, &range, &pData));
-				memcpy(pData, &data, sizeof(ConstantsPerCamera));
-				cbRes1->Unmap(0, nullptr);
+				scene.GetLodSelector().SetProjection(data.matProj._22, static_cast<float>(height));
+				scene.GetLodSelector().SetCameraPosition(0.0f, 0.0f, -CameraDistance);
+
+				DirectX::XMFLOAT4X4 viewProjection;
+				DirectX::XMStoreFloat4x4(&viewProjection, DirectX::XMMatrixMultiply(
+					DirectX::XMMatrixTranspose(DirectX::XMLoadFloat4x4(&data.matView)),
+					DirectX::XMMatrixTranspose(DirectX::XMLoadFloat4x4(&data.matProj))));
+				scene.SetFrustum(Frustum::FromViewProjection(&viewProjection.m[0][0]));
 			}
+			DirectX::XMStoreFloat4x4(&meshConstants.matDequantize, DirectX::XMMatrixIdentity());
+
+			// A cube of cubes around the origin.
+			scene.Init(InstanceGridSide * InstanceGridSide * InstanceGridSide, 1, SceneTintsCount, InstanceSpacing);
+			// The material table and the instances' SRV, as the root signature lays them out.
+			renderDevice.Init(&cmdListPool, 1, 4);
+
 			{
-				ConstantsPerInstance data;
-				DirectX::XMStoreFloat4x4(&(data.matWorld), DirectX::XMMatrixIdentity());
-				DirectX::XMStoreFloat4x4(&(data.matWorldIT), DirectX::XMMatrixIdentity());
+				instanceAllocator.Reset(scene.GetObjectsCount() * sizeof(InstanceData), FramesInFlight);
+
+				D3D12_RESOURCE_DESC desc = {};
+				desc.Dimension = D3D12_RESOURCE_DIMENSION_BUFFER;
+				desc.Width = instanceAllocator.GetBufferSize();
+				desc.Height = 1;
+				desc.DepthOrArraySize = 1;
+				desc.MipLevels = 1;
+				desc.SampleDesc.Count = 1;
+				desc.Layout = D3D12_TEXTURE_LAYOUT_ROW_MAJOR;
+
+				CHECKED(gpuAllocator.CreateResource(D3D12_HEAP_TYPE_UPLOAD, desc, D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, instanceBuffer));
 
 				D3D12_RANGE range = { 0, 0 };
 				void* pData = nullptr;
-				CHECKED(cbRes2->Map(0, &range, &pData));
-				memcpy(pData, &data, sizeof(ConstantsPerInstance));
-				cbRes2->Unmap(0, nullptr);
+				CHECKED(instanceBuffer.resource->Map(0, &range, &pData));
+				instanceData = reinterpret_cast<uint8_t*>(pData);
 			}
 
 			{
@@ -429,7 +575,7 @@ namespace
 				D3D12_ROOT_SIGNATURE_DESC desc = {};
 				desc.Flags = D3D12_ROOT_SIGNATURE_FLAG_ALLOW_INPUT_ASSEMBLER_INPUT_LAYOUT;
 
-				D3D12_ROOT_PARAMETER param[4];
+				D3D12_ROOT_PARAMETER param[5];
 				param[0] = {};
 				param[0].ParameterType = D3D12_ROOT_PARAMETER_TYPE_32BIT_CONSTANTS;
 				param[0].ShaderVisibility = D3D12_SHADER_VISIBILITY_PIXEL;
@@ -455,8 +601,13 @@ namespace
 				param[3].ShaderVisibility = D3D12_SHADER_VISIBILITY_VERTEX;
 				param[3].Descriptor = { 1, 0 };
 
+				// The instance batch of each draw, a StructuredBuffer read by SV_InstanceID.
+				param[4] = {};
+				param[4].ParameterType = D3D12_ROOT_PARAMETER_TYPE_SRV;
+				param[4].ShaderVisibility = D3D12_SHADER_VISIBILITY_VERTEX;
+				param[4].Descriptor = { 1, 0 };
 
-				desc.NumParameters = 4;
+				desc.NumParameters = 5;
 				desc.pParameters = param;
 
 				D3D12_STATIC_SAMPLER_DESC sampler_desc[1];
@@ -473,245 +624,815 @@ namespace
 
 				CHECKED(D3D12SerializeRootSignature(&desc, D3D_ROOT_SIGNATURE_VERSION_1_0, &blob, nullptr));
 				CHECKED(device->CreateRootSignature(0, blob->GetBufferPointer(), blob->GetBufferSize(), IID_PPV_ARGS(&rootSig)));
+				rootSignatureHash = HashBytes(blob->GetBufferPointer(), blob->GetBufferSize());
 				blob->Release();
 			}
 
-			vs_mem.LoadFromFile("Assets/VertexShader.cso");
-			ps_mem.LoadFromFile("Assets/PixelShader.cso");
 
+			if (!descriptorHeap.Init(device, BindlessDescriptorsCount, TransientDescriptorsCount))
+				return false;
+
+			viewports[0] = { 0, 0, static_cast<FLOAT>(width), static_cast<FLOAT>(height), 0.0f, 1.0f };
+			scissorRects[0] = { 0, 0, static_cast<LONG>(width), static_cast<LONG>(height) };
+
+			return true;
+		}
+
+		// Worker thread: import or map the mesh and pack its indices in memory.
+		bool LoadMesh(MeshData& data)
+		{
+			const ArchiveEntry* entry = archive.Find("Assets/cube.fbx.mesh");
+			const void* view = nullptr != entry ? archive.GetView(*entry) : nullptr;
+			bool loaded = nullptr != view && mesh.LoadFromMemory(view, static_cast<size_t>(entry->size), 0);
+			if (!loaded)
+				loaded = mesh.LoadFromFile("Assets/cube.fbx");
+			if (!loaded || 0 == mesh.GetVerticesCount())
+				return false;
+
+			data.bounds = mesh.GetBounds();
+
+			vertexLayout.GetPositionTransform(mesh, data.positionScale, data.positionBias);
+
+			data.indexRanges.resize(mesh.GetIndexRangesCount());
+			data.indices.resize(mesh.GetPackedIndexRanges(data.indexRanges.data()));
+			mesh.FillInIndicesData(data.indices.data(), data.indexRanges.data());
+			return true;
+		}
+
+		bool OnMeshLoaded(MeshData& data)
+		{
+			// Pack only writes sequentially, with non-temporal stores.
+			const size_t verticesSize = mesh.GetVerticesCount() * vertexLayout.GetStride();
+			UINT64 verticesOffset = 0;
+			uint8_t* pVertices = Stage(verticesSize, 16, verticesOffset);
+			if (nullptr == pVertices)
+				return false;
+			vertexLayout.Pack(mesh, pVertices);
+			if (!CopyStagedBuffer(verticesOffset, verticesSize, D3D12_RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER, vbRes))
+				return false;
+			if (!UploadBuffer(data.indices.data(), data.indices.size(), D3D12_RESOURCE_STATE_INDEX_BUFFER, ibRes))
+				return false;
+
+			// Shared by all instances, applied before their world transform.
+			DirectX::XMStoreFloat4x4(&meshConstants.matDequantize, DirectX::XMMatrixTranspose(DirectX::XMMatrixMultiply(
+				DirectX::XMMatrixScaling(data.positionScale[0], data.positionScale[1], data.positionScale[2]),
+				DirectX::XMMatrixTranslation(data.positionBias[0], data.positionBias[1], data.positionBias[2])
+			)));
+
+			vbView = { vbRes.resource->GetGPUVirtualAddress(), static_cast<UINT>(verticesSize), vertexLayout.GetStride() };
+
+			indexRanges = std::move(data.indexRanges);
+			const Mesh::Bounds& bounds = data.bounds;
+			SceneMesh sceneMesh = {};
+			sceneMesh.box = { { bounds.min.x, bounds.min.y, bounds.min.z }, { bounds.max.x, bounds.max.y, bounds.max.z } };
+			sceneMesh.center[0] = bounds.center.x;
+			sceneMesh.center[1] = bounds.center.y;
+			sceneMesh.center[2] = bounds.center.z;
+			sceneMesh.radius = bounds.radius;
+			sceneMesh.lodErrors = mesh.GetLodErrors();
+			sceneMesh.lodsCount = mesh.GetLodsCount();
+			sceneMesh.submeshesCount = mesh.GetSubmeshesCount();
+			sceneMesh.indexRanges = indexRanges.data();
+			sceneMesh.indexBufferAddress = ibRes.resource->GetGPUVirtualAddress();
+			scene.SetMesh(sceneMesh);
+
+			meshReady = true;
+			return true;
+		}
+
+		// Worker thread.
+		bool LoadShaders()
+		{
+			const char* vsFilename = vertexLayout.UsesOctahedralVectors() ? "Assets/VertexShaderPacked.cso" : "Assets/VertexShader.cso";
+			if (!vs_mem.LoadFromArchive(archive, vsFilename))
+				vs_mem.LoadFromFile(vsFilename);
+			if (!ps_mem.LoadFromArchive(archive, "Assets/PixelShader.cso"))
+				ps_mem.LoadFromFile("Assets/PixelShader.cso");
+			return vs_mem.size > 0 && ps_mem.size > 0;
+		}
+
+		bool OnShadersLoaded()
+		{
+			D3D12_INPUT_ELEMENT_DESC inputElements[static_cast<size_t>(VertexAttribute::Count)];
+			for (size_t i = 0; i < vertexLayout.GetElementsCount(); ++i)
 			{
-				D3D12_INPUT_ELEMENT_DESC inputElements[] =
-				{
-				  { "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, Mesh::PositionOffset, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
-				  { "NORMAL", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, Mesh::NormalOffset, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
-				  { "TANGENT", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, Mesh::TangentOffset, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
-				  { "TEXCOORD", 0, DXGI_FORMAT_R32G32_FLOAT, 0, Mesh::UVOffset, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
-				};
-
-				D3D12_GRAPHICS_PIPELINE_STATE_DESC desc = {};
-
-				desc.VS = { vs_mem.ptr, vs_mem.size };
-				desc.PS = { ps_mem.ptr, ps_mem.size };
-				desc.pRootSignature = rootSig;
-				desc.InputLayout = { inputElements, 4 };
-				desc.NumRenderTargets = 1;
-				desc.PrimitiveTopologyType = D3D12_PRIMITIVE_TOPOLOGY_TYPE_TRIANGLE;
-				desc.RasterizerState.FillMode = D3D12_FILL_MODE_SOLID;
-				desc.RasterizerState.CullMode = D3D12_CULL_MODE_BACK;
-				desc.BlendState.RenderTarget[0].RenderTargetWriteMask = D3D12_COLOR_WRITE_ENABLE_ALL;
-				desc.NumRenderTargets = 1;
-				desc.RTVFormats[0] = DXGI_FORMAT_R8G8B8A8_UNORM;
-				desc.DSVFormat = DXGI_FORMAT_D24_UNORM_S8_UINT;
-				desc.SampleDesc.Count = 1;
-				desc.SampleMask = UINT_MAX;
+				VertexLayout::Element element = vertexLayout.GetElement(i);
+				inputElements[i] = { element.semantic, 0, element.format, 0, element.offset, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 };
+			}
 
-				desc.DepthStencilState.DepthEnable = TRUE;
-				desc.DepthStencilState.DepthFunc = D3D12_COMPARISON_FUNC_LESS;
-				desc.DepthStencilState.DepthWriteMask = D3D12_DEPTH_WRITE_MASK_ALL;
+			D3D12_GRAPHICS_PIPELINE_STATE_DESC desc = {};
+
+			desc.VS = { vs_mem.ptr, vs_mem.size };
+			desc.PS = { ps_mem.ptr, ps_mem.size };
+			desc.pRootSignature = rootSig;
+			desc.InputLayout = { inputElements, static_cast<UINT>(vertexLayout.GetElementsCount()) };
+			desc.NumRenderTargets = 1;
+			desc.PrimitiveTopologyType = D3D12_PRIMITIVE_TOPOLOGY_TYPE_TRIANGLE;
+			desc.RasterizerState.FillMode = D3D12_FILL_MODE_SOLID;
+			desc.RasterizerState.CullMode = D3D12_CULL_MODE_BACK;
+			desc.BlendState.RenderTarget[0].RenderTargetWriteMask = D3D12_COLOR_WRITE_ENABLE_ALL;
+			desc.NumRenderTargets = 1;
+			desc.RTVFormats[0] = DXGI_FORMAT_R8G8B8A8_UNORM;
+			desc.DSVFormat = DXGI_FORMAT_D24_UNORM_S8_UINT;
+			desc.SampleDesc.Count = 1;
+			desc.SampleMask = UINT_MAX;
+
+			desc.DepthStencilState.DepthEnable = TRUE;
+			desc.DepthStencilState.DepthFunc = D3D12_COMPARISON_FUNC_LESS;
+			desc.DepthStencilState.DepthWriteMask = D3D12_DEPTH_WRITE_MASK_ALL;
+
+			// Compiles on the pool; Render starts drawing once it is ready.
+			psoKey = HashGraphicsPipeline(desc, rootSignatureHash);
+			pso = pipelines.Request(psoKey, CompileGraphicsPipeline(device, desc));
+			return true;
+		}
 
-				CHECKED(device->CreateGraphicsPipelineState(&desc, IID_PPV_ARGS(&pso)));
+		// Worker thread: opens the cooked mips, whose texture the render thread
+		// places, or has WIC decode the source when nothing was cooked. The
+		// device is free threaded, gpuAllocator is not.
+		bool LoadTexture(TextureData& data)
+		{
+			char cookedFilename[260];
+			CookedTexture::GetCacheFilename("Assets/wood.jpg", cookedFilename, sizeof(cookedFilename));
+			const ArchiveEntry* entry = archive.Find(cookedFilename);
+			const void* view = nullptr != entry ? archive.GetView(*entry) : nullptr;
+			data.file.reset(new MappedFile());
+			if ((nullptr != view && data.cooked.Open(view, static_cast<size_t>(entry->size))) ||
+				(data.file->Open(cookedFilename) && data.cooked.Open(data.file->GetData(), data.file->GetSize())))
+			{
+				data.streamed = true;
+				data.firstMip = GetTailMip(data.cooked);
+				return true;
 			}
 
+			// Once per worker thread, later calls only return S_FALSE.
+			CHECKED(CoInitializeEx(nullptr, COINITBASE_MULTITHREADED));
+			D3D12_SUBRESOURCE_DATA subresource = {};
+			Memory image;
+			if (image.LoadFromArchive(archive, "Assets/wood.jpg"))
+			{
+				CHECKED(DirectX::LoadWICTextureFromMemory(device, reinterpret_cast<const uint8_t*>(image.ptr), image.size, &data.tex.resource, data.pixels, subresource));
+			}
+			else
 			{
-				D3D12_DESCRIPTOR_HEAP_DESC desc = {};
-				desc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE;
-				desc.NumDescriptors = 1;
-				desc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV;
-				CHECKED(device->CreateDescriptorHeap(&desc, IID_PPV_ARGS(&srvHeap)));
+				CHECKED(DirectX::LoadWICTextureFromFile(device, L"Assets/wood.jpg", &data.tex.resource, data.pixels, subresource));
+			}
+			data.subresources.push_back(subresource);
+			return true;
+		}
 
-				D3D12_SUBRESOURCE_DATA data = {};
-				std::unique_ptr<uint8_t[]> ptr;
+		// The mips a cooked texture starts with and never drops: those of
+		// TextureTailSize and under, as long as the first of them is a whole
+		// number of blocks, which block compressed textures need of mip 0.
+		static uint32_t GetTailMip(const CookedTexture& cooked)
+		{
+			uint32_t tailMip = 0;
+			while (tailMip + 1 < cooked.GetMipsCount() && cooked.GetMip(tailMip).size > TextureTailSize)
+			{
+				const TextureCacheMip& next = cooked.GetMip(tailMip + 1);
+				if (TextureFormatRGBA8 != cooked.GetFormat() && (0 != next.width % 4 || 0 != next.height % 4))
+					break;
+				++tailMip;
+			}
+			return tailMip;
+		}
 
-				CHECKED(CoInitializeEx(nullptr, COINITBASE_MULTITHREADED));
-				CHECKED(DirectX::LoadWICTextureFromFile(device, L"Assets/wood.jpg", &tex, ptr, data));
+		// Render thread: a texture of the cooked mips from firstMip on. The cooked texels stay sRGB encoded in a UNORM format so they
+		// look the same as WIC's R8G8B8A8_UNORM.
+		bool CreateCookedTexture(const CookedTexture& cooked, uint32_t firstMip, TextureData& data)
+		{
+			D3D12_RESOURCE_DESC desc = {};
+			desc.Dimension = D3D12_RESOURCE_DIMENSION_TEXTURE2D;
+			desc.Width = cooked.GetMip(firstMip).width;
+			desc.Height = cooked.GetMip(firstMip).height;
+			desc.DepthOrArraySize = 1;
+			desc.MipLevels = static_cast<UINT16>(cooked.GetMipsCount() - firstMip);
+			desc.Format = static_cast<DXGI_FORMAT>(cooked.GetFormat());
+			desc.SampleDesc.Count = 1;
+			desc.Layout = D3D12_TEXTURE_LAYOUT_UNKNOWN;
+
+			CHECKED(gpuAllocator.CreateResource(D3D12_HEAP_TYPE_DEFAULT, desc, D3D12_RESOURCE_STATE_COPY_DEST, nullptr, data.tex));
+
+			data.format = desc.Format;
+			for (uint32_t i = firstMip; i < cooked.GetMipsCount(); ++i)
+			{
+				const TextureCacheMip& mip = cooked.GetMip(i);
+				data.subresources.push_back({ cooked.GetMipData(i), static_cast<LONG_PTR>(mip.rowPitch), static_cast<LONG_PTR>(mip.size) });
+			}
+			return true;
+		}
 
-				D3D12_RESOURCE_DESC resDesc = tex->GetDesc();
-				UINT64 requiredSize = 0;
-				device->GetCopyableFootprints(&resDesc, 0, 1, 0, nullptr, nullptr, nullptr, &requiredSize);
-				//
+		// Render thread, with cmdList open for the frame.
+		bool OnTextureLoaded(TextureData& data)
+		{
+			if (data.streamed && !CreateCookedTexture(data.cooked, data.firstMip, data))
+				return false;
+			if (!UploadTexture(data))
+				return false;
 
-				D3D12_HEAP_PROPERTIES prop = {};
-				prop.Type = D3D12_HEAP_TYPE_UPLOAD;
+			if (data.streamed)
+			{
+				std::vector<uint64_t> mipSizes;
+				for (uint32_t i = 0; i < data.cooked.GetMipsCount(); ++i)
+					mipSizes.push_back(data.cooked.GetMip(i).size);
+				texFile = std::move(data.file);
+				texCooked = data.cooked;
+				texFirstMip = data.firstMip;
+				texResidencyIndex = texResidency.AddTexture(mipSizes.data(), texCooked.GetMipsCount(), texCooked.GetMipsCount() - texFirstMip);
+			}
+			textureReady = true;
+			return true;
+		}
 
-				D3D12_RESOURCE_DESC uploadDesc = {};
-				uploadDesc.Dimension = D3D12_RESOURCE_DIMENSION_BUFFER;
-				uploadDesc.Width = requiredSize;
-				uploadDesc.Height = 1;
-				uploadDesc.DepthOrArraySize = 1;
-				uploadDesc.MipLevels = 1;
-				uploadDesc.SampleDesc.Count = 1;
-				uploadDesc.Layout = D3D12_TEXTURE_LAYOUT_ROW_MAJOR;
+		// Render thread, with cmdList open for the frame: makes data's texture
+		// the one drawn with, retiring the previous one. On failure the
+		// previous texture stays and data's is freed.
+		bool UploadTexture(TextureData& data)
+		{
+			DescriptorHandle bindless;
+			if (!CopyTexture(data, bindless))
+			{
+				gpuAllocator.Free(data.tex);
+				return false;
+			}
 
-				CHECKED(device->CreateCommittedResource(&prop, D3D12_HEAP_FLAG_NONE, &uploadDesc, D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, IID_PPV_ARGS(&uploadHeap)));
+			// Only now that the copy is recorded does the new texture replace the old.
+			if (tex.IsValid())
+				retiredTextures.push_back(RetiredTexture{ 0, tex, texBindless });
+			tex = data.tex;
+			data.tex = GpuAllocation();
+			texBindless = bindless;
+			// The frame graph moves it on once a pass reads it.
+			texState = D3D12_RESOURCE_STATE_COPY_DEST;
+			return true;
+		}
 
-				cmdAlloc->Reset();
-				cmdList->Reset(cmdAlloc, nullptr);
+		// Render thread, with cmdList open: records the copies of data's
+		// subresources and points a new bindless slot at its view.
+		bool CopyTexture(TextureData& data, DescriptorHandle& bindless)
+		{
+			D3D12_RESOURCE_DESC resDesc = data.tex.resource->GetDesc();
+			const UINT subresourcesCount = static_cast<UINT>(data.subresources.size());
+			D3D12_PLACED_SUBRESOURCE_FOOTPRINT footprints[TextureCacheMaxMips] = {};
+			UINT rowsCounts[TextureCacheMaxMips] = {};
+			UINT64 rowSizes[TextureCacheMaxMips] = {};
+			UINT64 requiredSize = 0;
+			if (subresourcesCount > TextureCacheMaxMips)
+				return false;
+			device->GetCopyableFootprints(&resDesc, 0, subresourcesCount, 0, footprints, rowsCounts, rowSizes, &requiredSize);
 
-				void* pDestData = nullptr;
-				D3D12_RANGE range = { 0, 0 };
-				uploadHeap->Map(0, &range, &pDestData);
-				memcpy(pDestData, reinterpret_cast<void*>(ptr.get()), data.SlicePitch);
-				uploadHeap->Unmap(0, nullptr);
-
-				D3D12_TEXTURE_COPY_LOCATION srcLoc = {};
-				D3D12_TEXTURE_COPY_LOCATION destLoc = {};
-
-				srcLoc.pResource = uploadHeap;
-				srcLoc.Type = D3D12_TEXTURE_COPY_TYPE_PLACED_FOOTPRINT;
-				srcLoc.PlacedFootprint = { 0, {
-					resDesc.Format, 
-					static_cast<UINT>(resDesc.Width), 
-					resDesc.Height, 
-					static_cast<UINT>(resDesc.DepthOrArraySize), 
-					static_cast<UINT>(data.RowPitch)
-				} };
-
-				destLoc.pResource = tex;
-				destLoc.Type = D3D12_TEXTURE_COPY_TYPE_SUBRESOURCE_INDEX;
-				destLoc.SubresourceIndex = 0;
+			UINT64 baseOffset = 0;
+			uint8_t* pDestData = Stage(requiredSize, D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT, baseOffset);
+			if (nullptr == pDestData)
+				return false;
+
+			// The view lives in staging, a copy of it in a bindless slot. The
+			// copy is flushed before this frame's lists execute, so the staging
+			// descriptor can be rewritten for the next texture.
+			if (!texSrv.IsValid())
+				texSrv = srvHeap.Allocate();
+			if (!texSrv.IsValid())
+				return false;
+			bindless = descriptorHeap.GetAllocator().AllocatePersistent();
+			if (!bindless.IsValid())
+				return false;
 
+			D3D12_TEXTURE_COPY_LOCATION srcLoc = {};
+			D3D12_TEXTURE_COPY_LOCATION destLoc = {};
+
+			srcLoc.pResource = uploadBuffer.resource;
+			srcLoc.Type = D3D12_TEXTURE_COPY_TYPE_PLACED_FOOTPRINT;
+
+			destLoc.pResource = data.tex.resource;
+			destLoc.Type = D3D12_TEXTURE_COPY_TYPE_SUBRESOURCE_INDEX;
+
+			for (UINT i = 0; i < subresourcesCount; ++i)
+			{
+				// The footprint pads rows to D3D12_TEXTURE_DATA_PITCH_ALIGNMENT;
+				// cooked mips already are, so they go in one copy.
+				const D3D12_PLACED_SUBRESOURCE_FOOTPRINT& footprint = footprints[i];
+				const uint8_t* pSrcData = reinterpret_cast<const uint8_t*>(data.subresources[i].pData);
+				uint8_t* pDest = pDestData + footprint.Offset;
+				if (static_cast<LONG_PTR>(footprint.Footprint.RowPitch) == data.subresources[i].RowPitch)
+					memcpy(pDest, pSrcData, static_cast<size_t>(footprint.Footprint.RowPitch * (rowsCounts[i] - 1) + rowSizes[i]));
+				else
+				{
+					for (UINT row = 0; row < rowsCounts[i]; ++row)
+						memcpy(pDest + row * footprint.Footprint.RowPitch, pSrcData + row * data.subresources[i].RowPitch, static_cast<size_t>(rowSizes[i]));
+				}
+
+				srcLoc.PlacedFootprint = footprint;
+				srcLoc.PlacedFootprint.Offset += baseOffset;
+				destLoc.SubresourceIndex = i;
 				cmdList->CopyTextureRegion(&destLoc, 0, 0, 0, &srcLoc, nullptr);
+			}
 
-				D3D12_RESOURCE_BARRIER barrier = {};
-				barrier.Type = D3D12_RESOURCE_BARRIER_TYPE_TRANSITION;
-				barrier.Flags = D3D12_RESOURCE_BARRIER_FLAG_NONE;
-				barrier.Transition.pResource = tex;
-				barrier.Transition.Subresource = 0;
-				barrier.Transition.StateBefore = D3D12_RESOURCE_STATE_COPY_DEST;
-				barrier.Transition.StateAfter = D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE;
-				cmdList->ResourceBarrier(1, &barrier);
+			D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
+			srvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2D;
+			srvDesc.Format = data.format;
+			srvDesc.Texture2D.MipLevels = subresourcesCount;
+			srvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+			device->CreateShaderResourceView(data.tex.resource, &srvDesc, srvHeap.GetCpuHandle(texSrv));
+			descriptorHeap.QueueCopy(bindless.index, srvHeap.GetCpuHandle(texSrv));
+			return true;
+		}
 
-				cmdList->Close();
+		// Render thread, with cmdList open for the frame: requests the mip the
+		// largest cube in view needs and follows what the residency manager
+		// decides. Without reserved resources a new resident chain is a new
+		// texture, uploaded whole from the cooked file; the copy is ordered
+		// before this frame's draws, so the load is done once it is recorded.
+		void StreamTextureMips()
+		{
+			if (ResidencyManager::InvalidTexture == texResidencyIndex)
+				return;
 
-				ID3D12CommandList* lists[] = { cmdList };
-				cmdQueue->ExecuteCommandLists(1, lists);
+			texResidency.BeginFrame();
+			if (scene.GetMaxScreenSize() > 0.0f)
+			{
+				// The texture spans a face; the sphere around a cube is sqrt(3) faces across.
+				const TextureCacheMip& top = texCooked.GetMip(0);
+				texResidency.Request(texResidencyIndex, ResidencyManager::SelectMip(top.width, top.height, texCooked.GetMipsCount(), scene.GetMaxScreenSize() / std::sqrt(3.0f)));
 			}
 
+			uint32_t firstMip = texFirstMip;
+			bool loading = false;
+			for (const ResidencyManager::Action& action : texResidency.Update())
 			{
-				D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
-				srvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2D;
-				srvDesc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
-				srvDesc.Texture2D.MipLevels = 1;
-				srvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
-				device->CreateShaderResourceView(tex, &srvDesc, srvHeap->GetCPUDescriptorHandleForHeapStart());
+				loading = ResidencyManager::ActionType::Load == action.type;
+				firstMip = loading ? action.mip : texResidency.GetResidentMip(action.texture);
 			}
+			if (firstMip == texFirstMip)
+				return;
 
-			viewports[0] = { 0, 0, static_cast<FLOAT>(width), static_cast<FLOAT>(height), 0.0f, 1.0f };
-			scissorRects[0] = { 0, 0, static_cast<LONG>(width), static_cast<LONG>(height) };
+			// On failure streaming stops; the texture drawn with stays.
+			TextureData data;
+			if (!CreateCookedTexture(texCooked, firstMip, data) || !UploadTexture(data))
+			{
+				OutputDebugStringA("error: cannot stream Assets/wood.jpg\n");
+				texResidency.RemoveTexture(texResidencyIndex);
+				texResidencyIndex = ResidencyManager::InvalidTexture;
+				return;
+			}
+			texFirstMip = firstMip;
+			if (loading)
+				texResidency.OnLoaded(texResidencyIndex, firstMip);
+		}
 
-			WaitForGPU();
+		// Render thread: returns where to write size bytes in the upload ring,
+		// waiting on the GPU if the ring is full of in-flight data.
+		uint8_t* Stage(UINT64 size, UINT64 alignment, UINT64& offset)
+		{
+			offset = uploadRing.Allocate(size, alignment);
+			while (UploadRing::InvalidOffset == offset && 0 != uploadRing.GetOldestFenceValue())
+			{
+				WaitForFence(uploadRing.GetOldestFenceValue());
+				uploadRing.Retire(fence->GetCompletedValue());
+				offset = uploadRing.Allocate(size, alignment);
+			}
+
+			if (UploadRing::InvalidOffset == offset)
+			{
+				OutputDebugStringA("error: upload does not fit in the upload ring\n");
+				return nullptr;
+			}
+			return uploadData + offset;
+		}
+
+		// Render thread, with cmdList open: streams data into the upload ring,
+		// then places a default heap buffer and records the copy into it.
+		bool UploadBuffer(const void* data, size_t size, D3D12_RESOURCE_STATES state, GpuAllocation& res)
+		{
+			UINT64 offset = 0;
+			uint8_t* pData = Stage(size, 16, offset);
+			if (nullptr == pData)
+				return false;
+			StreamCopy(pData, data, size);
+			return CopyStagedBuffer(offset, size, state, res);
+		}
+
+		// Render thread, with cmdList open: places a default heap buffer and
+		// records the copy of size bytes at offset in the upload ring into it.
+		bool CopyStagedBuffer(UINT64 offset, size_t size, D3D12_RESOURCE_STATES state, GpuAllocation& res)
+		{
+			D3D12_RESOURCE_DESC desc = {};
+			desc.Dimension = D3D12_RESOURCE_DIMENSION_BUFFER;
+			desc.Width = size;
+			desc.Height = 1;
+			desc.DepthOrArraySize = 1;
+			desc.MipLevels = 1;
+			desc.SampleDesc.Count = 1;
+			desc.Layout = D3D12_TEXTURE_LAYOUT_ROW_MAJOR;
+
+			// Buffers start in COMMON and are promoted to COPY_DEST by the copy.
+			CHECKED(gpuAllocator.CreateResource(D3D12_HEAP_TYPE_DEFAULT, desc, D3D12_RESOURCE_STATE_COMMON, nullptr, res));
+
+			cmdList->CopyBufferRegion(res.resource, 0, uploadBuffer.resource, offset, size);
+
+			D3D12_RESOURCE_BARRIER barrier = {};
+			barrier.Type = D3D12_RESOURCE_BARRIER_TYPE_TRANSITION;
+			barrier.Transition.pResource = res.resource;
+			barrier.Transition.Subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES;
+			barrier.Transition.StateBefore = D3D12_RESOURCE_STATE_COPY_DEST;
+			barrier.Transition.StateAfter = state;
+			cmdList->ResourceBarrier(1, &barrier);
 			return true;
 		}
 
+		// Render thread: copies data into this frame's constant region and
+		// returns its GPU address, 0 when the region is full.
+		template<typename T>
+		D3D12_GPU_VIRTUAL_ADDRESS WriteConstants(const T& data)
+		{
+			UINT64 offset = constantAllocator.Allocate<T>();
+			if (ConstantAllocator::InvalidOffset == offset)
+				return 0;
+
+			memcpy(constantData + offset, &data, sizeof(T));
+			return constantBuffer.resource->GetGPUVirtualAddress() + offset;
+		}
+
 		void Update(float deltaTime)
 		{
-			D3D12_RANGE range = { 0, 0 };
-			void* pData = nullptr;
-			if (SUCCEEDED(cbRes2->Map(0, &range, &pData)))
-			{
-				DirectX::XMMATRIX world = DirectX::XMMatrixRotationAxis(DirectX::XMVectorSet(0, 1, 0, 0), timeElapsed);
-				DirectX::XMStoreFloat4x4(
-					reinterpret_cast<DirectX::XMFLOAT4X4*>(pData),
-					DirectX::XMMatrixTranspose(world)
-				);
-				DirectX::XMStoreFloat4x4(
-					reinterpret_cast<DirectX::XMFLOAT4X4*>(pData) + 1,
-					DirectX::XMMatrixInverse(nullptr, world)
-				);
-				cbRes2->Unmap(0, nullptr);
-			}
+			// Only the CPU side changes here, Render packs the instances into this frame's region.
+			if (!meshReady)
+				return;
+			PROFILE_SCOPE("Update");
+			scene.Update(timeElapsed, &ThreadPool::Shared());
+		}
+
+		// Everything a draw list needs, as lists don't inherit state from each other.
+		void SetDrawState(ID3D12GraphicsCommandList* list, D3D12_CPU_DESCRIPTOR_HANDLE rtvHandle, D3D12_GPU_VIRTUAL_ADDRESS cameraConstantsAddress, D3D12_GPU_VIRTUAL_ADDRESS meshConstantsAddress)
+		{
+			float blueColor[] = { 1.0f, 1.0f, 1.0f, 1.0f };
+
+			list->SetGraphicsRootSignature(rootSig);
+
+			list->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+			list->IASetVertexBuffers(0, 1, &vbView);
+
+			list->RSSetViewports(1, viewports);
+			list->RSSetScissorRects(1, scissorRects);
+
+			list->SetGraphicsRoot32BitConstants(0, 4, blueColor, 0);
+			// Materials set the texture table.
+			ID3D12DescriptorHeap* heaps[] = { descriptorHeap.GetHeap() };
+			list->SetDescriptorHeaps(1, heaps);
+			list->SetGraphicsRootConstantBufferView(2, cameraConstantsAddress);
+			list->SetGraphicsRootConstantBufferView(3, meshConstantsAddress);
+
+			D3D12_CPU_DESCRIPTOR_HANDLE dsvHandles[1] = { dsvHeap.GetCpuHandle(dsvHandle) };
+			list->OMSetRenderTargets(1, &rtvHandle, FALSE, dsvHandles);
 		}
 
 		void Render()
 		{
-			cmdAlloc->Reset();
-			cmdList->Reset(cmdAlloc, pso);
+			PROFILE_SCOPE("Render");
+			{
+				// Only blocks once the CPU is FramesInFlight frames ahead.
+				PROFILE_SCOPE("Wait for frame");
+				WaitForFence(frameScheduler.BeginFrame());
+			}
+			cmdListPool.BeginFrame(frameScheduler.GetFrameSlot());
+			gpuProfiler.BeginFrame(frameScheduler.GetFrameSlot());
+			cmdList = cmdListPool.Acquire();
+			if (nullptr == cmdList)
+			{
+				// Nothing recorded, but the frame still ends so its slot stays in step.
+				SubmitFrame(nullptr, 0, false);
+				return;
+			}
 
-			cmdList->SetGraphicsRootSignature(rootSig);
+			uploadRing.Retire(fence->GetCompletedValue());
+			constantAllocator.BeginFrame(fence->GetCompletedValue());
+			instanceAllocator.BeginFrame(fence->GetCompletedValue());
+			descriptorHeap.GetAllocator().Retire(fence->GetCompletedValue());
+			ReleaseRetiredTextures(fence->GetCompletedValue());
+			D3D12_GPU_VIRTUAL_ADDRESS cameraConstantsAddress = WriteConstants(cameraConstants);
+			D3D12_GPU_VIRTUAL_ADDRESS meshConstantsAddress = WriteConstants(meshConstants);
 
-			auto handle = rtvHeap->GetCPUDescriptorHandleForHeapStart();
-			handle.ptr += backBufferIndex * rtvHeapInc;
+			// Finished loads upload into this frame's command list.
+			{
+				PROFILE_SCOPE("Pump assets");
+				streamer.Pump();
+			}
 
-			float clearColor[] = { 0.7f, 0.7f, 0.7f, 1.0f };
-			float blueColor[] = { 1.0f, 1.0f, 1.0f, 1.0f };
+			if (nullptr == pso && 0 != psoKey)
+			{
+				pso = pipelines.Find(psoKey);
+				if (PipelineStatus::Failed == pipelines.GetStatus(psoKey))
+				{
+					OutputDebugStringA("error: cannot compile the pipeline\n");
+					psoKey = 0;
+				}
+			}
+			pipelineReady = nullptr != pso;
+			if (textureReady)
+				StreamTextureMips();
+
+			// Until everything has streamed in the frame is just cleared.
+			const bool assetsReady = meshReady && pipelineReady && textureReady;
+			if (assetsReady)
+				PackInstances();
+
+			auto handle = rtvHeap.GetCpuHandle(rtvHandles[backBufferIndex]);
+			auto depthHandle = dsvHeap.GetCpuHandle(dsvHandle);
+
+			// Passes record into list; barriers go to whichever list is current
+			// when their pass comes.
+			ID3D12GraphicsCommandList* list = cmdList;
+			RenderCommandList* drawLists[SceneRenderer::MaxLists] = {};
+			size_t drawListsCount = 0;
+
+			frameGraph.Reset();
+			uint32_t backBuffer = graphResources.Import(frameGraph, "back buffer", backBuffers[backBufferIndex], D3D12_RESOURCE_STATE_PRESENT, ResourceStatePresent);
+			uint32_t depth = graphResources.CreateTransient(frameGraph, "depth", depthDesc, &depthClearValue);
+			uint32_t texture = tex.IsValid() ? graphResources.Import(frameGraph, "wood", tex.resource, texState) : RenderGraph::NoResource;
+
+			uint32_t clearPass = frameGraph.AddPass("clear", [&]()
+			{
+				float clearColor[] = { 0.7f, 0.7f, 0.7f, 1.0f };
+				list->ClearRenderTargetView(handle, clearColor, 0, nullptr);
+				list->ClearDepthStencilView(depthHandle, D3D12_CLEAR_FLAG_DEPTH, 1.0, 0, 0, nullptr);
+			});
+			frameGraph.Write(clearPass, backBuffer, ResourceStateRenderTarget);
+			frameGraph.Write(clearPass, depth, ResourceStateDepthWrite);
+
+			if (assetsReady)
+			{
+				// The scene records its draws on the shared pool, a list per chunk
+				// of them, executed in chunk order.
+				uint32_t scenePass = frameGraph.AddPass("scene", [&]()
+				{
+					// What follows the draws goes in a list after theirs. Without
+					// one the draws are skipped and everything stays in list.
+					ID3D12GraphicsCommandList* nextList = cmdListPool.Acquire();
+					if (nullptr == nextList)
+						return;
+					list->Close();
+
+					// The SM 5.0 pixel shader reads one t0 table, which starts at the
+					// texture's slot.
+					materialTables.assign(scene.GetMaterialsCount(), descriptorHeap.GetGpuHandle(texBindless.index));
+					renderDevice.BeginFrame(pso, [&](ID3D12GraphicsCommandList* drawList) { SetDrawState(drawList, handle, cameraConstantsAddress, meshConstantsAddress); },
+						materialTables.data(), static_cast<uint32_t>(materialTables.size()));
+					drawListsCount = scene.Record(renderDevice, &ThreadPool::Shared(), drawLists);
+
+					const SceneRenderer::Stats& sceneStats = scene.GetStats();
+					recordStats.drawsCount = static_cast<int>(sceneStats.drawsCount);
+					recordStats.listsCount = static_cast<int>(sceneStats.listsCount);
+					recordStats.wallUs = static_cast<int>(sceneStats.recordMs * 1000.0);
+					recordStats.maxListUs = static_cast<int>(sceneStats.maxListMs * 1000.0);
+					list = nextList;
+				});
+				frameGraph.Write(scenePass, backBuffer, ResourceStateRenderTarget);
+				frameGraph.Write(scenePass, depth, ResourceStateDepthWrite);
+				frameGraph.Read(scenePass, texture, ResourceStatePixelShaderResource);
+			}
 
-			D3D12_RESOURCE_BARRIER barriers[1];
-			barriers[0] = {};
-			barriers[0].Type = D3D12_RESOURCE_BARRIER_TYPE_TRANSITION;
-			barriers[0].Transition.pResource = backBuffers[backBufferIndex];
-			barriers[0].Transition.StateBefore = D3D12_RESOURCE_STATE_PRESENT;
-			barriers[0].Transition.StateAfter = D3D12_RESOURCE_STATE_RENDER_TARGET;
-			cmdList->ResourceBarrier(1, barriers);
+			if (!frameGraph.Compile() || FAILED(graphResources.Place(frameGraph, fence->GetCompletedValue())))
+			{
+				// The passes are skipped, but whatever Pump recorded still runs.
+				OutputDebugStringA("error: cannot build the frame graph\n");
+				gpuProfiler.EndFrame(cmdList);
+				cmdList->Close();
+				descriptorHeap.FlushCopies();
+				ID3D12CommandList* uploadLists[] = { cmdList };
+				SubmitFrame(uploadLists, 1, false);
+				return;
+			}
+			device->CreateDepthStencilView(graphResources.GetResource(depth), nullptr, depthHandle);
 
-			cmdList->ClearRenderTargetView(handle, clearColor, 0, nullptr);
-			cmdList->ClearDepthStencilView(dsvHeap->GetCPUDescriptorHandleForHeapStart(), D3D12_CLEAR_FLAG_DEPTH, 1.0, 0, 0, nullptr);
+			for (const RenderGraph::Step& step : frameGraph.GetSteps())
+			{
+				graphResources.RecordBarriers(frameGraph, step, list);
+				// The final step only has barriers.
+				uint32_t gpuScope = RenderGraph::NoPass != step.pass ? gpuProfiler.Begin(list, frameGraph.GetPassName(step.pass)) : GpuProfiler::InvalidScope;
+				frameGraph.Execute(step);
+				// Passes may change lists; timestamps are ordered on the queue all the same.
+				gpuProfiler.End(list, gpuScope);
+			}
+			gpuProfiler.EndFrame(list);
+			list->Close();
+			if (RenderGraph::NoResource != texture)
+				texState = static_cast<D3D12_RESOURCE_STATES>(frameGraph.GetFinalState(texture));
 
-			cmdList->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
-			cmdList->IASetVertexBuffers(0, 1, &vbView);
-			cmdList->IASetIndexBuffer(&ibView);
+			descriptorHeap.FlushCopies();
 
-			cmdList->RSSetViewports(1, viewports);
-			cmdList->RSSetScissorRects(1, scissorRects);
+			ID3D12CommandList* cmdLists[SceneRenderer::MaxLists + 2];
+			UINT cmdListsCount = 0;
+			cmdLists[cmdListsCount++] = cmdList;
+			for (size_t i = 0; i < drawListsCount; ++i)
+			{
+				if (nullptr != drawLists[i])
+					cmdLists[cmdListsCount++] = D3D12RenderDevice::GetList(drawLists[i]);
+			}
+			if (list != cmdList)
+				cmdLists[cmdListsCount++] = list;
+			SubmitFrame(cmdLists, cmdListsCount, true);
 
-			cmdList->SetGraphicsRoot32BitConstants(0, 4, blueColor, 0);
-			cmdList->SetDescriptorHeaps(1, &srvHeap);
-			cmdList->SetGraphicsRootDescriptorTable(1, srvHeap->GetGPUDescriptorHandleForHeapStart());
-			cmdList->SetGraphicsRootConstantBufferView(2, cbRes1->GetGPUVirtualAddress());
-			cmdList->SetGraphicsRootConstantBufferView(3, cbRes2->GetGPUVirtualAddress());
+			if (!firstFrameLogged)
+			{
+				LogTiming("time to first frame");
+				firstFrameLogged = true;
+			}
+			if (assetsReady && !fullyLoadedLogged)
+			{
+				LogTiming("time to fully loaded");
+				LogHeapStats();
+				fullyLoadedLogged = true;
+			}
+		}
+
+		// Render thread: executes the frame's closed lists, presents if asked,
+		// and ends the frame on everything that waits for its fence value.
+		void SubmitFrame(ID3D12CommandList* const* lists, UINT listsCount, bool present)
+		{
+			if (0 != listsCount)
+				cmdQueue->ExecuteCommandLists(listsCount, lists);
+			if (present)
+			{
+				swapChain->Present(0, 0);
+				backBufferIndex = swapChain->GetCurrentBackBufferIndex();
+			}
+
+			UINT64 fenceValue = frameScheduler.EndFrame();
+			cmdQueue->Signal(fence, fenceValue);
+			uploadRing.Submit(fenceValue);
+			constantAllocator.EndFrame(fenceValue);
+			instanceAllocator.EndFrame(fenceValue);
+			descriptorHeap.GetAllocator().Submit(fenceValue);
+			graphResources.Submit(fenceValue);
+			for (RetiredTexture& retired : retiredTextures)
+			{
+				if (0 == retired.fenceValue)
+				{
+					retired.fenceValue = fenceValue;
+					descriptorHeap.GetAllocator().FreePersistent(retired.bindless, fenceValue);
+				}
+			}
+		}
+
+		// Render thread: writes this frame's instances to the instance buffer and
+		// has the scene list its draws.
+		void PackInstances()
+		{
+			size_t instancesCount = scene.GetInstancesCount();
+			recordStats.instancesCount = static_cast<int>(instancesCount);
+			UINT64 offset = instanceAllocator.Allocate(instancesCount * sizeof(InstanceData));
+			if (ConstantAllocator::InvalidOffset == offset)
+				return;
 
-			D3D12_CPU_DESCRIPTOR_HANDLE dsvHandles[1] = { dsvHeap->GetCPUDescriptorHandleForHeapStart() };
-			cmdList->OMSetRenderTargets(1, &handle, FALSE, dsvHandles);
-			cmdList->DrawInstanced(mesh.GetIndicesCount(), 1, 0, 0);
+			scene.Pack(reinterpret_cast<InstanceData*>(instanceData + offset), instanceBuffer.resource->GetGPUVirtualAddress() + offset);
+		}
 
-			barriers[0].Transition.StateBefore = D3D12_RESOURCE_STATE_RENDER_TARGET;
-			barriers[0].Transition.StateAfter = D3D12_RESOURCE_STATE_PRESENT;
-			cmdList->ResourceBarrier(1, barriers);
+		// Render thread: textures replaced during frames the GPU has finished.
+		void ReleaseRetiredTextures(UINT64 completedValue)
+		{
+			size_t kept = 0;
+			for (RetiredTexture& retired : retiredTextures)
+			{
+				if (0 != retired.fenceValue && retired.fenceValue <= completedValue)
+					gpuAllocator.Free(retired.texture);
+				else
+					retiredTextures[kept++] = retired;
+			}
+			retiredTextures.resize(kept);
+		}
 
-			cmdList->Close();
+		void LogTiming(const char* what)
+		{
+			LARGE_INTEGER now;
+			QueryPerformanceCounter(&now);
 
-			ID3D12CommandList* cmdLists[] = { cmdList };
-			cmdQueue->ExecuteCommandLists(1, cmdLists);
+			char message[128];
+			snprintf(message, sizeof(message), "%s: %.1f ms\n", what, (now.QuadPart - initCounter.QuadPart) * 1000.0 / counterFreq.QuadPart);
+			OutputDebugStringA(message);
+		}
 
-			swapChain->Present(0, 0);
+		void LogHeapStats()
+		{
+			GpuAllocator::Stats stats = gpuAllocator.GetStats();
 
-			WaitForGPU();
+			char message[192];
+			snprintf(message, sizeof(message), "gpu heaps: %u blocks, %.1f / %.1f MB used (%.0f%%), %u resources, %.0f%% fragmented\n",
+				stats.blocksCount, stats.usedSize / (1024.0 * 1024.0), stats.reservedSize / (1024.0 * 1024.0),
+				stats.GetUtilization() * 100.0, stats.allocationsCount, stats.GetFragmentation() * 100.0);
+			OutputDebugStringA(message);
 		}
 
 		void ReleaseAssets()
 		{
-			pso->Release();
+			// The streamed resources only exist once their load completed.
+			pipelines.Clear();
+			pso = nullptr;
+			if (pipelineDisk.IsDirty())
+				pipelineDisk.Save(PipelineCacheFilename);
 			rootSig->Release();
-			vbRes->Release();
-			ibRes->Release();
-			cbRes1->Release();
-			cbRes2->Release();
-			srvHeap->Release();
-			tex->Release();
-			uploadHeap->Release();
+			gpuAllocator.Free(vbRes);
+			gpuAllocator.Free(ibRes);
+			gpuAllocator.Free(constantBuffer);
+			gpuAllocator.Free(instanceBuffer);
+			descriptorHeap.Release();
+			gpuAllocator.Free(tex);
+			for (RetiredTexture& retired : retiredTextures)
+				gpuAllocator.Free(retired.texture);
+			retiredTextures.clear();
+			gpuAllocator.Free(uploadBuffer);
 		}
 
 	private:
-		ID3D12PipelineState*	pso;
+		PipelineDiskCache		pipelineDisk;
+		PipelineCache<ID3D12PipelineState>	pipelines{ ThreadPool::Shared(), &pipelineDisk };
+		uint64_t				rootSignatureHash = 0;
+		uint64_t				psoKey = 0;
+		ID3D12PipelineState*	pso = nullptr;
 		Memory					vs_mem;
 		Memory					ps_mem;
 		ID3D12RootSignature*	rootSig;
 
-		ID3D12Resource*			vbRes;
-		ID3D12Resource*			ibRes;
+		GpuAllocation			vbRes;
+		GpuAllocation			ibRes;
 		D3D12_VERTEX_BUFFER_VIEW	vbView;
-		D3D12_INDEX_BUFFER_VIEW		ibView;
-
-		ID3D12Resource*			cbRes1;
-		ID3D12Resource*			cbRes2;
-
-		ID3D12DescriptorHeap*	srvHeap;
-		ID3D12Resource*			tex;
-		ID3D12Resource*			uploadHeap;
+		std::vector<Mesh::IndexRange>	indexRanges;
+
+		// One region per frame; 256 slices of the two constant structs each.
+		static const UINT64		FrameConstantsSize = 64 * 1024;
+		GpuAllocation			constantBuffer;
+		uint8_t*				constantData = nullptr;
+		ConstantAllocator		constantAllocator;
+		ConstantsPerCamera		cameraConstants;
+		ConstantsPerMesh		meshConstants;
+
+		// InstanceGridSide cubed cubes of the one material, drawn with one
+		// instanced draw per LOD and submesh. The camera sits inside the grid,
+		// so culling has work to do.
+		static const size_t		InstanceGridSide = 48;
+		// PixelShader.hlsl's materialTints.
+		static const uint32_t	SceneTintsCount = 4;
+		static constexpr float	InstanceSpacing = 2.0f;
+		static constexpr float	CameraDistance = 20.0f;
+		SceneRenderer			scene;
+		D3D12RenderDevice		renderDevice;
+		std::vector<D3D12_GPU_DESCRIPTOR_HANDLE>	materialTables;
+		// One region per frame, sized for every scene object.
+		GpuAllocation			instanceBuffer;
+		uint8_t*				instanceData = nullptr;
+		ConstantAllocator		instanceAllocator;
+
+		static const uint32_t	BindlessDescriptorsCount = 4096;
+		static const uint32_t	TransientDescriptorsCount = 4096;
+		ShaderVisibleDescriptorHeap	descriptorHeap;
+		DescriptorHandle		texSrv;
+		DescriptorHandle		texBindless;
+		GpuAllocation			tex;
+		D3D12_RESOURCE_STATES	texState = D3D12_RESOURCE_STATE_COMMON;
+
+		static const UINT64		UploadRingSize = 32 * 1024 * 1024;
+		GpuAllocation			uploadBuffer;
+		uint8_t*				uploadData = nullptr;
+		UploadRing				uploadRing;
 
 		D3D12_VIEWPORT			viewports[1];
 		D3D12_RECT				scissorRects[1];
 
+		// Declared before everything that may point into its mapping.
+		AssetArchive			archive;
 		Mesh					mesh;
+		VertexLayout			vertexLayout = VertexLayout::Compressed();
+
+		// The cooked texture's finer mips stream in and out under the budget,
+		// from a mapping kept open for them. Until a frame's fence value is
+		// known its retired textures carry 0.
+		struct RetiredTexture
+		{
+			UINT64				fenceValue;
+			GpuAllocation		texture;
+			DescriptorHandle	bindless;
+		};
+		static const uint64_t	TextureTailSize = 64 * 1024;
+		ResidencyManager		texResidency{ 256 * 1024 * 1024 };
+		uint32_t				texResidencyIndex = ResidencyManager::InvalidTexture;
+		uint32_t				texFirstMip = 0;
+		std::unique_ptr<MappedFile>	texFile;
+		CookedTexture			texCooked;
+		std::vector<RetiredTexture>	retiredTextures;
+
+		struct
+		{
+			int					instancesCount = 0;
+			int					drawsCount = 0;
+			int					wallUs = 0;
+			int					listsCount = 0;
+			int					maxListUs = 0;
+		}						recordStats;
+
+		AssetStreamer			streamer;
+		bool					meshReady = false;
+		bool					pipelineReady = false;
+		bool					textureReady = false;
+		bool					firstFrameLogged = false;
+		bool					fullyLoadedLogged = false;
 	};
 
 